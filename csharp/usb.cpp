@@ -131,6 +131,15 @@ namespace NET {
 		}
 	}
 
+	Boolean USBDevice::LoadFirmware(array<Byte>^ bytes, Boolean force ) {
+		pin_ptr<Byte> b = &bytes[0];
+		try {
+			return m_dev->load_firmware(reinterpret_cast<char*>(b), bytes->Length, force );
+		} catch ( Nitro::Exception &e ) {
+			throw static_cast<NitroException^>(e);
+		}
+	}
+
 	UInt16 USBDevice::GetFirmwareVersion() {
 		try {
 			return m_dev->get_firmware_version();
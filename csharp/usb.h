@@ -52,6 +52,7 @@ namespace NET {
 		void Open(UInt32 index, Boolean override_version);
 		void Open(const String^ serial);
 		void LoadFirmware( array<Byte>^ bytes );
+		Boolean LoadFirmware( array<Byte>^ bytes, Boolean force );
 		UInt16 GetFirmwareVersion() ;
 
 		void SetSerial( const String^ );
@@ -62,6 +63,7 @@ namespace NET {
         void Unlock() { m_dev->unlock(); }
 		void SetTimeout(UInt32 t) { m_dev->set_timeout(t); }
 		UInt32 GetTimeout() { return m_dev->get_timeout(); }
+		void SetPipeThrottle(UInt32 depth, UInt32 hold) { m_dev->set_pipe_throttle(depth,hold); }
 
 		void EnableMode(UInt32 mode) { m_dev->enable_mode(mode); }
 		void DisableMode(UInt32 mode) { m_dev->disable_mode(mode); }
@@ -141,12 +141,17 @@
 #include "nitro/version.h"
 #include "nitro/error.h"
 #include "nitro/types.h"
+#include "nitro/bigint.h"
 #include "nitro/node.h"
 #include "nitro/usb.h"
 #include "nitro/userdevice.h"
 #include "nitro/xmlreader.h"
+#include "nitro/streamxmlreader.h"
 #include "nitro/xmlwriter.h"
+#include "nitro/binreader.h"
+#include "nitro/binwriter.h"
 #include "nitro/scripts.h"
+#include "nitro/recorder.h"
 
 
 #endif
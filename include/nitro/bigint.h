@@ -0,0 +1,102 @@
+// Copyright (C) 2009 Ubixum, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef NITRO_BIGINT_H
+#define NITRO_BIGINT_H
+
+#include <string>
+
+#include "types.h"
+
+namespace Nitro {
+
+/**
+ * \brief Unsigned integer for register values wider than 32 bits.
+ *
+ * The value is held in BigInt::WORDS 32 bit words, least significant
+ * word first, which covers the widest register a device interface can
+ * describe.  Bits shifted past the most significant word are dropped.
+ *
+ * Nitro::DataType stores BIGINT_DATA values as the significant words of
+ * a BigInt.  Use DataType::as_bigint to get the value back.
+ **/
+class DLL_API BigInt {
+    public:
+        enum {
+            WORDS=32, ///< number of 32 bit words
+            BITS=WORDS*32 ///< width in bits
+        };
+    private:
+        uint32 m_words[WORDS];
+    public:
+        /**
+         * \brief Construct from a 32 bit value.
+         **/
+        BigInt ( uint32 value=0 );
+
+        /**
+         * \brief Parse an unsigned integer.
+         *
+         * Strings starting with 0x are hexadecimal, 0b binary and other
+         * strings starting with 0 octal.  Otherwise the string is decimal.
+         * \throw Exception INVALID_CAST if the string isn't a number or
+         *        doesn't fit in BITS bits.
+         **/
+        static BigInt parse ( const std::string& str );
+
+        /**
+         * \brief A value with the low width bits set.
+         **/
+        static BigInt mask ( uint32 width );
+
+        /**
+         * \return word i, 0 is the least significant.
+         **/
+        uint32 word ( uint32 i ) const { return m_words[i]; }
+        void set_word ( uint32 i, uint32 value ) { m_words[i] = value; }
+
+        /**
+         * \return Number of words up to and including the most
+         *   significant nonzero word.  0 for the value 0.
+         **/
+        uint32 num_words() const;
+
+        /**
+         * \return true if any bit is set.
+         **/
+        bool any() const { return num_words() > 0; }
+
+        /**
+         * \return Decimal representation.
+         **/
+        std::string str() const;
+
+        BigInt& operator<<= ( uint32 n );
+        BigInt& operator>>= ( uint32 n );
+        BigInt& operator|= ( const BigInt& other );
+        BigInt& operator&= ( const BigInt& other );
+        BigInt operator<< ( uint32 n ) const { BigInt r(*this); return r <<= n; }
+        BigInt operator>> ( uint32 n ) const { BigInt r(*this); return r >>= n; }
+        BigInt operator| ( const BigInt& other ) const { BigInt r(*this); return r |= other; }
+        BigInt operator& ( const BigInt& other ) const { BigInt r(*this); return r &= other; }
+        BigInt operator~ () const;
+        bool operator== ( const BigInt& other ) const;
+        bool operator!= ( const BigInt& other ) const { return !(*this == other); }
+};
+
+} // end namespace
+
+#endif
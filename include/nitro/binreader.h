@@ -0,0 +1,69 @@
+// Copyright (C) 2009 Ubixum, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef BINREADER_H
+#define BINREADER_H
+
+
+#include "types.h"
+#include "reader.h"
+
+namespace Nitro {
+
+/**
+ * \ingroup devif
+ * \brief Construct device interface from a file written by Nitro::BinWriter.
+ *
+ * Nodes are restored exactly as they were written.  No device interface
+ * validation (auto addressing, default attributes) is repeated.
+ **/
+class DLL_API BinReader : public Reader {
+   private:
+        struct impl;
+        impl* m_impl;
+   public:
+        /**
+         * \param filepath Path to the binary file to read
+         * \param check_deps Throw BIN_STALE from read() if any recorded
+         *          dependency changed since the file was written.
+         **/
+        BinReader ( const std::string& filepath, bool check_deps=true );
+        ~BinReader() throw();
+
+        /**
+         * \throw Exception BIN_STALE if the file is out of date, BIN_FORMAT
+         *   if it is not a valid binary device interface.  The tree is
+         *   not modified when an exception is thrown.
+         **/
+        void read(NodeRef node);
+
+        /**
+         * \brief Restore a node from the output of BinWriter::serialize.
+         *
+         * The root node is returned with its own type and name.
+         * Dependencies and the library version that wrote the data are
+         * not checked.  data is only used during the call.
+         * \throw Exception BIN_STALE if written in a different format
+         *   version, BIN_FORMAT if the data is not a valid binary node.
+         **/
+        static NodeRef deserialize ( const void* data, size_t length );
+
+};
+
+
+} // end namespace
+
+#endif
@@ -0,0 +1,63 @@
+// Copyright (C) 2009 Ubixum, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef BINWRITER_H
+#define BINWRITER_H
+
+
+#include "types.h"
+#include "writer.h"
+
+namespace Nitro {
+
+/**
+ * \ingroup devif
+ * \brief Output a device interface in a compact binary form.
+ *
+ * The binary form loads much faster than xml and is used by
+ * Nitro::load_di as a cache.  Any files the device interface was
+ * built from can be recorded as dependencies.  Nitro::BinReader
+ * refuses to load the file if a dependency changed or the file was
+ * written by a different library version.
+ **/
+class DLL_API BinWriter: public Writer {
+   private:
+        struct impl;
+        impl* m_impl;
+   public:
+        /**
+         * \param filepath Output file.
+         * \param deps Files the device interface was built from.
+         **/
+        BinWriter ( const std::string& filepath, const std::vector<std::string>& deps=std::vector<std::string>() );
+        ~BinWriter() throw();
+
+        void write(const NodeRef& node);
+
+        /**
+         * \brief Serialize a node and its children to memory.
+         *
+         * The result has the same layout as a file written without
+         * dependencies.  Nitro::BinReader::deserialize restores it.
+         **/
+        static std::string serialize ( const NodeRef& node );
+
+};
+
+
+} // end namespace
+
+#endif
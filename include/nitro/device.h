@@ -18,6 +18,7 @@
 #define NITRO_DEVICE_H
 
 #include <map>
+#include <functional>
 
 #include "types.h"
 #include "error.h"
@@ -31,6 +32,13 @@
  *  from the Device base class.  Classes extending Device should not 
  *  worry about thread safety.  The Nitro:Device::get etc lock an instance
  *  specific Mutex before making the call to implementing device.
+ *
+ *  \warning Watches (Nitro::Device::watch) call _read from the watch
+ *  thread.  A device that can be watched must call unwatch_all() as the
+ *  first statement of its destructor, before any of its own state is
+ *  torn down.  The Device destructor can't do it because _read is
+ *  already gone by then.  Debug builds assert if a device is destroyed
+ *  while watched.
  **/
 
 /**
@@ -118,8 +126,45 @@ protected:
      * by adding each 16 bit value and ignoring the carry.
      **/
     virtual uint16 _transfer_checksum() { return 0; }
+
+    /**
+     * \ingroup devimpl
+     *
+     * Optionally abort _read/_write calls in progress on terminal_addr.
+     * Called from another thread without the device mutex, so it must
+     * be safe to run alongside _read and _write.  Aborted calls should
+     * throw DEVICE_CANCELLED.  The default does nothing.
+     **/
+    virtual void _cancel( uint32 terminal_addr ) {}
+
+    /**
+     * \ingroup devimpl
+     *
+     * Number of register class calls (IO_REGISTER) started and not yet
+     * returned, including calls still waiting for the device mutex.
+     * Implementations that queue pipe transfers ahead can keep fewer
+     * in flight while this is non-zero so register I/O isn't stuck
+     * behind them.  Safe to call from any thread.
+     **/
+    uint32 register_io_pending() const;
 public:
 
+    /**
+     * \brief Register watch callback.
+     *
+     * Called from the watch thread with the register value.  Return
+     * false to remove the watch.
+     **/
+    typedef std::function<bool(const DataType& value)> WatchFunc;
+
+    /**
+     * \brief Register watch error callback.
+     *
+     * Called from the watch thread when reading the register fails.
+     * Return false to remove the watch.
+     **/
+    typedef std::function<bool(const Exception& e)> WatchErrorFunc;
+
     /**
      * \brief modes for enable/disable_mode
      **/
@@ -132,6 +177,41 @@ public:
         RETRY_ON_FAILURE=1<<31 ///< If a mode check failes and this is set, the transfer will be attempted again.
     };
 
+    /**
+     * \brief I/O priority classes.
+     *
+     * Register I/O is latency sensitive.  Pipe streaming is throughput
+     * bound and yields to it, see register_io_pending.
+     **/
+    enum IO_CLASS {
+        IO_REGISTER, ///< get/set and read/write of register terminals
+        IO_PIPE, ///< read/write of pipe terminals
+        IO_CLASSES
+    };
+
+    /**
+     * \brief Latency of the calls of one IO_CLASS.
+     *
+     * A call's latency runs from the call until it returns, including
+     * the time it waits for the device or pipe mutex.
+     **/
+    struct IoStats {
+        enum { BUCKETS=32 };
+        uint64 count; ///< Calls returned, with or without an error.
+        double total; ///< Seconds spent in the calls.
+        double max; ///< Slowest call in seconds.
+        uint64 buckets[BUCKETS]; ///< buckets[i] counts calls under 2^i microseconds and not under 2^(i-1).
+        /**
+         * \brief Mean latency in seconds.
+         **/
+        double mean() const;
+        /**
+         * \brief Latency in seconds that fraction p (0-1) of the calls
+         * didn't exceed.  Rounded up to a power of 2 microseconds.
+         **/
+        double percentile ( double p ) const;
+    };
+
     /**
      * \brief Retry Callback function.
      *
@@ -162,6 +242,10 @@ public:
      * Device is a pure virtual class and cannot be instantiated directly.
      **/
     Device();
+    /**
+     * \warning Derived devices must call unwatch_all() at the start of
+     * their destructor.  See \ref devimpl.
+     **/
     virtual ~Device() throw();
 
     /**
@@ -183,6 +267,14 @@ public:
      *  reader.read(usbd.get_di());
      * \endcode
      * 
+     * The new tree is published atomically and doesn't wait for
+     * operations in progress.  Calls that already started finish with
+     * the tree they started with, later calls use the new one.  Lookups
+     * (get_di, get_terminal, get_register) never take the device lock.
+     * Modifying the current tree in place is not synchronized with other
+     * threads; to change the device interface while the device is in use,
+     * build or clone a tree and pass it to set_di.
+     *
      * \param di The new device interface tree to use.
      **/
     void set_di(const NodeRef& di);
@@ -319,6 +411,19 @@ public:
      **/
     uint32 get_timeout ();
 
+    /**
+     * \ingroup dataac
+     * \brief Latency statistics of get/set/read/write calls since the
+     * device was created or reset_io_stats was called.
+     **/
+    IoStats io_stats ( IO_CLASS c ) const;
+
+    /**
+     * \ingroup dataac
+     * \brief Clear the io_stats of every class.
+     **/
+    void reset_io_stats ();
+
     /**
      * \ingroup dataac
      * \brief Thread-safe set.
@@ -374,6 +479,41 @@ public:
      **/
     NodeRef get_subregs ( const DataType& term, const DataType& reg , int32 timeout=-1 );
 
+    /**
+     * \ingroup dataac
+     * \brief Get consecutive register words by address.
+     *
+     * The transfer behind the typed accessors in nitro/regs.h.  No
+     * device interface lookup is done.  The device lock, modes and
+     * retries apply as they do for get.
+     *
+     * \param term_addr Terminal address.
+     * \param reg_addr Address of the first word.
+     * \param values Receives words values.
+     * \param words Number of addresses to get.
+     * \param bytes Bytes per address (the terminal regDataWidth in bytes).
+     * \param verify Whether DOUBLEGET_VERIFY applies.  Get does so for
+     *        write registers.
+     * \param timeout Timeout in milliseconds. -1 = use the default timeout.  0 = no timeout.
+     * \throw Nitro::Exception on communication error.
+     **/
+    void get_words ( uint32 term_addr, uint32 reg_addr, uint32* values, uint32 words, uint32 bytes, bool verify, int32 timeout=-1 );
+
+    /**
+     * \ingroup dataac
+     * \brief Set consecutive register words by address.
+     *
+     * With masks, each word is read first and only the bits set in
+     * masks[i] are replaced, all under one lock.  This is how a
+     * subregister is set.
+     *
+     * \param masks NULL sets the whole words.
+     * \param verify Whether GETSET_VERIFY applies.  Set does so for
+     *        write registers that aren't triggers.
+     * See get_words for the other parameters.
+     **/
+    void set_words ( uint32 term_addr, uint32 reg_addr, const uint32* values, const uint32* masks, uint32 words, uint32 bytes, bool verify, int32 timeout=-1 );
+
     /**
      * \ingroup dataac
      * \brief Thread-safe read.
@@ -397,6 +537,91 @@ public:
      **/
     void write(const DataType& term, const DataType& reg, const uint8* data, size_t length, int32 timeout=-1) ;
 
+    /**
+     * \ingroup dataac
+     * \brief Poll a register in the background.
+     *
+     * One watch thread per device polls every watched register.  Watches
+     * due at the same time are read together under one device lock.
+     * Adjacent 16 bit registers of a device interface terminal are read
+     * with a single read when the terminal isn't a pipe and
+     * DOUBLEGET_VERIFY and LOG_IO are off.
+     * Intervals are aligned so watches with the same interval are always
+     * due together.
+     *
+     * Callbacks run on the watch thread without the device lock and may
+     * call get/set.  They should return quickly since they delay the
+     * next poll.  A callback may also destroy the device, no other
+     * callbacks of that poll run afterwards.
+     *
+     * \param term String or integer address for terminal.
+     * \param reg String or integer address for register.
+     * \param func Called with the value.  Return false to stop watching.
+     * \param interval Milliseconds between polls.
+     * \param on_change If true func is only called when the value differs
+     *        from the previous poll (and for the first poll).  If false
+     *        func is called after every poll.
+     * \param on_error Called when a poll fails or func throws a
+     *        Nitro::Exception.  Without it failed polls are skipped and
+     *        the watch continues, and a throwing func removes the watch.
+     * \return Id for unwatch.
+     * \throw Nitro::Exception if the register does not exist in the device interface.
+     **/
+    uint32 watch ( const DataType& term, const DataType& reg, WatchFunc func, uint32 interval, bool on_change=true, WatchErrorFunc on_error=WatchErrorFunc() );
+
+    /**
+     * \ingroup dataac
+     * \brief Remove a watch.
+     *
+     * Once unwatch returns the watch callbacks are not called again,
+     * unless unwatch is called from the callback itself.  Unknown ids
+     * are ignored.
+     **/
+    void unwatch ( uint32 id );
+
+    /**
+     * \ingroup dataac
+     * \brief Remove every watch and wait for a poll in progress.
+     *
+     * Devices must call this at the start of their destructor if they
+     * can be watched so the watch thread doesn't read from a partly
+     * destroyed device.
+     **/
+    void unwatch_all ();
+
+    /**
+     * \ingroup dataac
+     * \brief Block until a register satisfies pred.
+     *
+     * Uses a watch so waiting threads share the watch thread polls.
+     * \param term String or integer address for terminal.
+     * \param reg String or integer address for register.
+     * \param pred Called on the watch thread with each polled value.
+     * \param timeout Milliseconds to wait.  0 = wait forever.
+     * \param interval Milliseconds between polls.
+     * \return The value that satisfied pred.
+     * \throw Nitro::Exception DEVICE_TIMEOUT if pred isn't satisfied in
+     *        time, or the error from a failed poll.  Exceptions thrown
+     *        by pred are rethrown here.  DEVICE_OP_ERROR if called from a
+     *        watch callback of this device, which would wait on a poll
+     *        only the calling thread can run.
+     **/
+    DataType wait_until ( const DataType& term, const DataType& reg, std::function<bool(const DataType&)> pred, uint32 timeout, uint32 interval=10 );
+
+    /**
+     * \ingroup dataac
+     * \brief Abort I/O in progress on a terminal.
+     *
+     * Safe to call from any thread.  It doesn't wait for the device or
+     * pipe mutex so it can stop a read or write blocked on a pipe, for
+     * instance during shutdown.  The aborted call throws
+     * DEVICE_CANCELLED.  Calls started after cancel returns are not
+     * affected.  Devices that can't cancel I/O ignore the request.
+     * \param term String or integer address for terminal.
+     * \throw Nitro::Exception if the terminal does not exist in the device interface.
+     **/
+    void cancel ( const DataType& term );
+
     /**
      * \brief Exclicitly close a device.
      **/
@@ -59,6 +59,8 @@ enum NITRO_ERROR {
     DEVICE_MUTEX=-100, ///< Device Mutex Error
     DEVICE_OP_ERROR, ///< Device operation error
     DEVICE_PARSE_ERROR, ///< Error parsing device get/set register
+    DEVICE_CANCELLED, ///< I/O aborted by Device::cancel
+    DEVICE_TIMEOUT, ///< Device::wait_until condition not met in time.
 
     XML_ENTITY=-150, ///< Invalid XML Entity
     XML_PARSE, ///< XML Parse Error.
@@ -77,7 +79,14 @@ enum NITRO_ERROR {
     USB_INIT=-300, ///< Usb initialization error.
     USB_PROTO, ///< Usb protocol error.
     USB_COMM, ///< Usb communication error.
-    USB_FIRMWARE ///< Invalid USB Firmware
+    USB_FIRMWARE, ///< Invalid USB Firmware
+    USB_TIMEOUT, ///< Usb transfer did not finish before its deadline.
+
+    RECORDER_IO=-350, ///< Recorder file I/O error.
+    RECORDER_FORMAT, ///< Invalid recorder capture file.
+
+    BIN_FORMAT=-400, ///< Invalid binary device interface file.
+    BIN_STALE ///< Binary device interface is out of date.
 };
 
 
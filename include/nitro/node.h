@@ -21,6 +21,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <utility>
 #include <iosfwd>
 #include <functional>
 
@@ -32,7 +33,51 @@ namespace Nitro {
 class DLL_API Node;
 
 typedef std::vector<NodeRef>::const_iterator DITreeIter;
-typedef std::map<std::string,DataType>::const_iterator DIAttrIter;
+typedef std::vector<std::pair<std::string,DataType> >::const_iterator DIAttrIter;
+
+
+/**
+ * \ingroup devif
+ * \brief Interned attribute name.
+ *
+ * All keys made from the same name share one stored copy of the name
+ * so keys are compared by address.  Constructing a key looks the name
+ * up in a global table.  Code that reads attributes often should keep
+ * its keys (or use the keys in Nitro::Attr) and pass them to
+ * Node::get_attr_ref() or Node::get_attr_uint().
+ **/
+class DLL_API AttrKey {
+    private:
+        const std::string* m_name;
+    public:
+        AttrKey ( const std::string& name );
+        AttrKey ( const char* name );
+        /**
+         * \brief The attribute name.
+         **/
+        const std::string& str() const { return *m_name; }
+        bool operator== ( const AttrKey& other ) const { return m_name == other.m_name; }
+        bool operator!= ( const AttrKey& other ) const { return m_name != other.m_name; }
+};
+
+/**
+ * \ingroup devif
+ * \brief Keys for the attributes used by device interface nodes.
+ **/
+namespace Attr {
+    extern DLL_API const AttrKey addr;
+    extern DLL_API const AttrKey array;
+    extern DLL_API const AttrKey comment;
+    extern DLL_API const AttrKey endian;
+    extern DLL_API const AttrKey init;
+    extern DLL_API const AttrKey mode;
+    extern DLL_API const AttrKey regAddrWidth;
+    extern DLL_API const AttrKey regDataWidth;
+    extern DLL_API const AttrKey shadowed;
+    extern DLL_API const AttrKey type;
+    extern DLL_API const AttrKey valuemap;
+    extern DLL_API const AttrKey width;
+}
 
 
 /**
@@ -171,6 +216,12 @@ class DLL_API Node {
         * is not a child of any other node.  Other than that, they should be the
         * same.
         *
+        * Only attribute storage is shared: every node of the copy is a new
+        * Node with its own children, but it shares its attribute names and
+        * values with the original until either node sets or removes an
+        * attribute.  Node valued attributes are cloned.  The copy and the
+        * original can be used from different threads.
+        *
         **/
        virtual NodeRef clone () const;
 
@@ -201,6 +252,26 @@ class DLL_API Node {
         NodeRef get_child(const std::string& name) const;
 
 
+        /**
+         * \brief Find a child by its addr attribute.
+         *
+         * Children with an integer addr attribute are indexed by address.
+         * If several children share an address, the first one added is
+         * returned.
+         * \throw Nitro::Exception if no child has the address.
+         **/
+        NodeRef get_child_by_addr(uint32 addr) const;
+
+        /**
+         * \return true if a child has an integer addr attribute equal to addr.
+         **/
+        bool has_child_addr(uint32 addr) const;
+
+        /**
+         * \return the lowest address >= start not used by a child.
+         **/
+        uint32 free_child_addr(uint32 start) const;
+
         /**
          * \brief Add a child node.
          *
@@ -276,6 +347,20 @@ class DLL_API Node {
          **/
         DataType get_attr(const std::string& name) const;
 
+        /**
+         * \brief Attribute value without a copy.
+         *
+         * The reference is valid until the attribute is changed or removed.
+         * \throw Exception If the attribute name is not found.
+         **/
+        const DataType& get_attr_ref(const AttrKey& key) const;
+
+        /**
+         * \brief Attribute value cast to uint32.
+         * \throw Exception If the attribute name is not found.
+         **/
+        uint32 get_attr_uint(const AttrKey& key) const;
+
 
         /**
          * \brief Number of attributes
@@ -301,8 +386,9 @@ class DLL_API Node {
 
 
         /**
-         * Attributes can be iterated exactly according to 
-         * std::map::iterator semantics.
+         * Attributes are iterated in name order.  The iterator
+         * is a std::vector iterator over (name,value) pairs.  Setting or
+         * removing an attribute invalidates iterators for that node.
          * \code
          *  DIAttrIter ai = n.attrs_begin();
          *  while ( ai != n.attrs_end() ) {
@@ -428,6 +514,79 @@ class DLL_API Valuemap : public DeviceInterface {
         virtual NODE_TYPE get_type() const { return VALUEMAP; }
 };
 
+/**
+ * \ingroup devif
+ * \brief Allocate the nodes of a device interface from large blocks of memory.
+ *
+ * While a NodeArena::Scope is active, nodes created by that thread
+ * (including the nodes created by the readers) are placed next to each
+ * other in the arena instead of being allocated one by one.  That uses
+ * less memory and makes walking a large tree faster.
+ *
+ * \code
+ *  NodeArena arena;
+ *  NodeRef di = DeviceInterface::create("di");
+ *  {
+ *      NodeArena::Scope scope ( arena );
+ *      XmlReader reader ( "devif.xml" );
+ *      reader.read ( di );
+ *  }
+ * \endcode
+ *
+ * Nodes are used the same way as any other node and may outlive the
+ * NodeArena object.  The memory is returned when the last node allocated
+ * from the arena is destroyed, so an arena suits trees that are kept or
+ * discarded as a whole.
+ **/
+class DLL_API NodeArena {
+    private:
+        struct impl;
+        impl* m_impl;
+        NodeArena(const NodeArena&);
+        NodeArena& operator=(const NodeArena&);
+    public:
+        /**
+         * \param block_size Size of each block of memory requested
+         *        from the system.
+         **/
+        NodeArena ( size_t block_size = 64*1024 );
+        ~NodeArena() throw();
+
+        /**
+         * \return Bytes of memory held by the arena.
+         **/
+        size_t bytes_allocated() const;
+
+        /**
+         * \brief Allocate nodes created by this thread from an arena
+         * until the scope ends.  Scopes can be nested.
+         **/
+        class DLL_API Scope {
+            private:
+                NodeArena::impl* m_prev;
+                Scope(const Scope&);
+                Scope& operator=(const Scope&);
+            public:
+                Scope ( NodeArena& arena );
+                ~Scope() throw();
+        };
+
+        /**
+         * \brief Allocate nodes created by this thread one by one until
+         * the scope ends, even inside a Scope.  For nodes kept apart
+         * from the tree being built, like cached documents.
+         **/
+        class DLL_API Suspend {
+            private:
+                NodeArena::impl* m_prev;
+                Suspend(const Suspend&);
+                Suspend& operator=(const Suspend&);
+            public:
+                Suspend();
+                ~Suspend() throw();
+        };
+};
+
 /**
  * \ingroup devif
  * \brief Load a Device interface from a file.
@@ -438,6 +597,15 @@ class DLL_API Valuemap : public DeviceInterface {
  *  paths in the environment variable for a match.  It loads the first one it 
  *  finds.
  *
+ *  The loaded device interface is cached in binary form (see Nitro::BinWriter)
+ *  next to the xml file, or in the directory named by the NITRO_DI_CACHE
+ *  environment variable.  Later loads use the cache until the xml, any
+ *  included file, or the library version changes.  Set NITRO_DI_CACHE=off
+ *  to disable the cache.  The cache is only used when dst has no children.
+ *
+ *  When dst has no children the loaded nodes are allocated from a
+ *  Nitro::NodeArena.
+ *
  * \param filepath relative or absolute path to a file.
  * \param dst Optional NodeRef destination.  If dst is passed as a parameter, the di
  *            is loaded into dst.  
@@ -0,0 +1,141 @@
+// Copyright (C) 2009 Ubixum, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef NITRO_RECORDER_H
+#define NITRO_RECORDER_H
+
+#include <functional>
+
+#include "types.h"
+#include "device.h"
+
+namespace Nitro {
+
+/**
+ * \ingroup dataac
+ * \brief Stream data from a terminal directly to disk.
+ *
+ * The recorder reads fixed size chunks from a (usually pipe) terminal
+ * into a small ring of buffers.  A separate writer thread drains filled
+ * buffers to the output file so device reads overlap with disk writes.
+ * Memory use is bounded by buffer_size * num_buffers regardless of the
+ * capture length.
+ *
+ * When compression is enabled each chunk is written as a frame of
+ * LZ4 style block compressed data.  Use Recorder::decompress to
+ * restore the raw capture.
+ *
+ * \code
+ *  Recorder rec ( dev, "PIPE", 0, "capture.bin" );
+ *  rec.set_progress ( print_stats, 1000 );
+ *  Recorder::Stats s = rec.record ( 1<<30, 1000 );
+ * \endcode
+ **/
+class DLL_API Recorder {
+    private:
+        struct impl;
+        impl* m_impl;
+        Recorder ( const Recorder& );
+        Recorder& operator=( const Recorder& );
+    public:
+
+        /**
+         * \brief Capture statistics.
+         **/
+        struct Stats {
+            uint64 bytes_read; ///< Bytes read from the device.
+            uint64 bytes_written; ///< Bytes written to disk (after compression).
+            uint64 bytes_dropped; ///< Bytes read while no buffer was free (drop_on_overflow only).
+            uint32 high_water; ///< Most buffers waiting on the disk at once.
+            uint32 num_buffers; ///< Total buffers in the ring.
+            double elapsed; ///< Seconds since the capture started.
+            /**
+             * \brief Sustained device throughput in MB/s.
+             **/
+            double mbps() const;
+        };
+
+        /**
+         * Progress callback.  Called from the recording thread.
+         **/
+        typedef std::function<void(const Stats&)> ProgressFunc;
+
+        /**
+         * \param dev Device to read from.
+         * \param term Terminal name or address.
+         * \param reg Register name or address.
+         * \param path Output file.  Truncated when record() starts.
+         **/
+        Recorder ( Device& dev, const DataType& term, const DataType& reg, const std::string& path );
+        ~Recorder() throw();
+
+        /**
+         * \brief Bytes requested from the device per read (default 1MB).
+         **/
+        void set_buffer_size ( uint32 bytes );
+        /**
+         * \brief Number of buffers in the ring (default 3, minimum 2).
+         **/
+        void set_num_buffers ( uint32 count );
+        /**
+         * \brief Compress each chunk before writing it (default false).
+         **/
+        void set_compression ( bool compress );
+        /**
+         * \brief Behavior when the disk falls behind the device.
+         *
+         * By default the recorder stops reading until a buffer is free.  If
+         * drop is true, the device is still drained into a scratch buffer
+         * and the lost data is counted in Stats::bytes_dropped.  Use this
+         * when stalling the device would overflow its own fifo.
+         **/
+        void set_drop_on_overflow ( bool drop );
+        /**
+         * \brief Report progress every interval milliseconds.
+         **/
+        void set_progress ( ProgressFunc func, uint32 interval=1000 );
+
+        /**
+         * \brief Capture nbytes from the device.
+         *
+         * \param nbytes Total bytes to read.  0 records until stop() is called.
+         * \param timeout Timeout for each device read.
+         * \return Final statistics.
+         **/
+        Stats record ( uint64 nbytes, int32 timeout=-1 );
+
+        /**
+         * \brief Request a running record() to finish.
+         *
+         * Safe to call from another thread or a signal handler.  Data
+         * already read is flushed to disk before record() returns.
+         **/
+        void stop();
+
+        /**
+         * \brief Statistics for the current or last capture.
+         **/
+        Stats stats() const;
+
+        /**
+         * \brief Restore a compressed capture to raw data.
+         **/
+        static void decompress ( const std::string& src, const std::string& dst );
+};
+
+} // end namespace
+
+#endif
@@ -0,0 +1,145 @@
+// Copyright (C) 2009 Ubixum, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef NITRO_REGS_H
+#define NITRO_REGS_H
+
+#include <type_traits>
+
+#include "types.h"
+#include "device.h"
+
+/**
+ * \defgroup regdesc Typed Register Access
+ *
+ * nitro.printCppDefs (python) writes a header of compile time
+ * descriptors for the terminals and registers of a device interface:
+ *
+ * \code
+ * namespace mydev {
+ * namespace Terminal1 {
+ *     typedef Nitro::TerminalDesc<0,16> terminal;
+ *     struct reg1 : Nitro::RegisterDesc<terminal,0,0,16,true,false> {
+ *         struct sub1 : Nitro::RegisterDesc<terminal,0,0,4,true,false> {};
+ *         enum class values : uint32 { off=0, on=1 };
+ *     };
+ * }
+ * }
+ * \endcode
+ *
+ * Nitro::get<mydev::Terminal1::reg1>(dev) and
+ * Nitro::set<mydev::Terminal1::reg1::sub1>(dev,v) then transfer the
+ * words of the register by address with Device::get_words and
+ * Device::set_words.  Unlike Device::get and Device::set there is no
+ * device interface lookup, name parsing or DataType conversion.  The
+ * addresses must match the device interface the header was generated
+ * from.
+ **/
+
+namespace Nitro {
+
+/**
+ * \ingroup regdesc
+ * \brief A terminal address and its register data width.
+ **/
+template <uint32 Addr, uint32 DataWidth>
+struct TerminalDesc {
+    static_assert ( DataWidth > 0 && DataWidth <= 32, "regDataWidth must be 1 to 32 bits." );
+    static constexpr uint32 addr = Addr;
+    static constexpr uint32 data_width = DataWidth; ///< bits per address
+    static constexpr uint32 word_bytes = (DataWidth+7)/8; ///< bytes transferred per address
+    static constexpr uint32 word_mask = (uint32)(0xffffffffULL >> (32-DataWidth));
+};
+
+/**
+ * \ingroup regdesc
+ * \brief A register or subregister.
+ *
+ * The value is Width bits starting Shift bits into the word at Addr.
+ * Subregisters use the address of the first word they occupy.
+ **/
+template <class Term, uint32 Addr, uint32 Shift, uint32 Width, bool Writable, bool Trigger>
+struct RegisterDesc {
+    static_assert ( Width > 0 && Shift + Width <= 64, "Typed registers are 1 to 64 bits." );
+    static_assert ( Shift < Term::data_width, "Shift must be inside the first word." );
+    typedef Term terminal;
+    typedef typename std::conditional<(Width>32), uint64, uint32>::type value_type;
+    static constexpr uint32 addr = Addr;
+    static constexpr uint32 shift = Shift;
+    static constexpr uint32 width = Width;
+    static constexpr uint32 words = (Shift + Width + Term::data_width - 1) / Term::data_width; ///< addresses transferred
+    static constexpr value_type mask = (value_type)(~0ULL >> (64-Width));
+    static constexpr bool writable = Writable; ///< mode is write
+    static constexpr bool trigger = Trigger; ///< type is trigger
+};
+
+/**
+ * \ingroup regdesc
+ * \brief Get a register or subregister.
+ * \param timeout Timeout in milliseconds. -1 = use the default timeout.  0 = no timeout.
+ * \throw Nitro::Exception on communication error.
+ **/
+template <class Reg>
+typename Reg::value_type get ( Device& dev, int32 timeout=-1 ) {
+    typedef typename Reg::terminal Term;
+    uint32 words[Reg::words];
+    dev.get_words ( Term::addr, Reg::addr, words, Reg::words, Term::word_bytes, Reg::writable, timeout );
+    uint64 bits = 0;
+    for (uint32 i=Reg::words; i--; ) {
+        bits = (bits << Term::data_width) | (words[i] & Term::word_mask);
+    }
+    return (typename Reg::value_type)(bits >> Reg::shift) & Reg::mask;
+}
+
+/**
+ * \ingroup regdesc
+ * \brief Set a register or subregister.
+ *
+ * A value that doesn't fill its words, like most subregisters, is a
+ * read-modify-write of them under the device lock.
+ *
+ * \param timeout Timeout in milliseconds. -1 = use the default timeout.  0 = no timeout.
+ * \throw Nitro::Exception on communication error.
+ **/
+template <class Reg>
+void set ( Device& dev, typename Reg::value_type value, int32 timeout=-1 ) {
+    static_assert ( Reg::writable, "Register is read only." );
+    typedef typename Reg::terminal Term;
+    uint64 bits = (uint64)(value & Reg::mask) << Reg::shift;
+    uint64 mask = (uint64)Reg::mask << Reg::shift;
+    uint32 words[Reg::words], masks[Reg::words];
+    for (uint32 i=0;i<Reg::words;++i) {
+        words[i] = (uint32)bits & Term::word_mask;
+        masks[i] = (uint32)mask & Term::word_mask;
+        bits >>= Term::data_width;
+        mask >>= Term::data_width;
+    }
+    bool whole = Reg::shift == 0 && Reg::width == Reg::words * Term::data_width;
+    dev.set_words ( Term::addr, Reg::addr, words, whole ? NULL : masks, Reg::words, Term::word_bytes, !Reg::trigger, timeout );
+}
+
+/**
+ * \ingroup regdesc
+ * \brief Set a register to one of its valuemap values.
+ **/
+template <class Reg>
+void set ( Device& dev, typename Reg::values value, int32 timeout=-1 ) {
+    set<Reg> ( dev, (typename Reg::value_type)value, timeout );
+}
+
+} // end namespace
+
+#endif
@@ -60,6 +60,15 @@ namespace Nitro {
  *          dev.get(0,1)
  *          return 1
  *  \endcode
+ *
+ *  A Scripts object made with Scripts(uint32) runs scripts in a pool of
+ *  worker interpreters so several threads can call exec at once:
+ *  \code
+ *      Scripts s(16);
+ *      s.import ( "test", "mytests.py" ); // imported once by each worker
+ *      // from any thread
+ *      DataType ret = s.exec( "test", "mytest", params );
+ *  \endcode
  **/
 
 
@@ -75,9 +84,45 @@ class DLL_API Scripts {
         struct impl;
         impl* m_impl;
     public:
+        /**
+         * \brief Run scripts in the calling thread's interpreter.
+         *
+         * The first Scripts object initializes Python and the thread
+         * that creates it holds the interpreter lock.  Methods must be
+         * called from that thread.
+         **/
         Scripts();
+
+        /**
+         * \brief Run scripts in a pool of worker interpreters.
+         *
+         * Each worker is a Python sub interpreter with its own thread,
+         * modules and globals.  import() loads the script in every
+         * worker and exec() runs on the next idle worker, so any thread
+         * may call exec() and up to workers calls run at once.
+         * Arguments and return values are converted in the worker's
+         * interpreter.
+         *
+         * Workers share the interpreter lock.  Device calls release it
+         * so scripts that mostly wait on devices run in parallel.
+         * Python code in the scripts still runs one worker at a time.
+         *
+         * If this object initializes Python the constructing thread
+         * doesn't hold the interpreter lock afterwards.  A caller that
+         * holds the lock releases it while waiting for a worker.
+         *
+         * \param workers Number of worker interpreters.  0 is the same
+         *  as Scripts().
+         **/
+        Scripts( uint32 workers );
         ~Scripts() throw();
 
+        /**
+         * \return Number of worker interpreters.  0 if scripts run in
+         *  the calling thread's interpreter.
+         **/
+        uint32 num_workers() const;
+
         /**
          * \brief Import script specified by script_path.
          * \param module A module name to associate loaded functions.  Loading
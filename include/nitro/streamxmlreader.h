@@ -0,0 +1,73 @@
+// Copyright (C) 2009 Ubixum, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+#ifndef STREAMXMLREADER_H
+#define STREAMXMLREADER_H
+
+
+#include "types.h"
+#include "reader.h"
+#include "xmlreader.h"
+
+namespace Nitro {
+
+/**
+ * \ingroup devif
+ * \brief Construct device interface from xml without Xerces.
+ *
+ * A single pass parser that only understands the device interface
+ * grammar.  It builds the same tree as Nitro::XmlReader, is much
+ * faster and does not need the Xerces runtime.  Files must be UTF-8
+ * (or ASCII) and may not define entities in a DTD.
+ **/
+class DLL_API StreamXmlReader : public Reader {
+   private:
+        struct impl;
+        impl* m_impl;
+   public:
+        /**
+         * \param filepath Path to the xml file to read
+         * \param validate Reject elements and attributes that are not part
+         *   of the device interface schema.  This is a structural check,
+         *   attribute values are not validated against the schema.
+         **/
+        StreamXmlReader ( const std::string& filepath, bool validate=false);
+        ~StreamXmlReader() throw();
+
+        void read(NodeRef node);
+
+        /**
+         * \brief Files included by the last call to read.
+         * \see XmlReader::includes
+         **/
+        const std::vector<std::string>& includes() const;
+
+        typedef XmlReader::Stats Stats;
+        /**
+         * \brief Load statistics for the last call to read.
+         *
+         * Parsed documents are cached the same way as Nitro::XmlReader.
+         * XmlReader::set_process_cache applies to both readers.
+         **/
+        const Stats& stats() const;
+
+};
+
+
+} // end namespace
+
+#endif
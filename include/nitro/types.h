@@ -17,6 +17,7 @@
 #define NITRO_TYPES_H
 
 
+#include <atomic>
 #include <string>
 #include <vector>
 #include <iosfwd>
@@ -81,6 +82,7 @@ typedef enum {
 class Node;
 typedef std::shared_ptr<Node> NodeRef;
 class Device;
+class BigInt;
 
 
 /**
@@ -103,12 +105,23 @@ class DLL_API DataType {
             uint32 m_uint;
             double m_float;
        }; 
+       bool m_has_str; // m_str holds the string
+       // formatted on first use for non string types.  Published
+       // once with compare and swap so concurrent readers agree.
+       mutable std::atomic<const std::string*> m_fmt;
        std::string m_str;
-       NodeRef* m_node;
-       std::vector<DataType>* m_list;
+       NodeRef m_node;
+       // list elements (std::vector<DataType>) or bigint words
+       // (std::vector<uint32>).  Immutable once constructed so
+       // copies share them.
+       std::shared_ptr<const void> m_shared;
        Device* m_dev;
-	   void copy(const DataType& other);
        uint8* m_buf;
+       const std::vector<DataType>& list() const { return *static_cast<const std::vector<DataType>*>(m_shared.get()); }
+       const std::vector<uint32>& words() const { return *static_cast<const std::vector<uint32>*>(m_shared.get()); }
+       void copy_value(const DataType& other);
+       void take(DataType& other) throw();
+       void clear() throw();
     public:
 
 		/**
@@ -130,14 +143,35 @@ class DLL_API DataType {
 
         /**
          * \brief for bigint data types
+         *
+         * \param ints 32 bit words, least significant first.
+         * \param str String representation.  If empty, the decimal value
+         *     is formatted when needed.
+         * \see DataType(const BigInt&)
          **/
         static DataType as_bigint_datatype ( const std::vector<DataType> &ints , const std::string str="");
 
         /**
          * \brief for bigint data types
+         * \see as_bigint
          **/
         static std::vector<DataType> as_bigints ( const DataType& d );
 
+        /**
+         * \brief Integer value of an INT_DATA, UINT_DATA or BIGINT_DATA
+         *  DataType.  INT_DATA values are taken as their 32 bit pattern.
+         * \throw Exception INVALID_CAST for other types.
+         **/
+        static BigInt as_bigint ( const DataType& d );
+
+        /**
+         * \brief Access the elements of a list without copying them.
+         *
+         * The reference is valid as long as d or a copy of d exists.
+         * \throw Exception if DATA_TYPE is not LIST_DATA
+         **/
+        static const std::vector<DataType>& as_list ( const DataType& d );
+
         /**
          * \brief Construct an integer DataType.
          **/
@@ -156,6 +190,10 @@ class DLL_API DataType {
          * \brief Construct a string DataType.  Commonly used for terminal and register names.
          **/
         DataType(const std::string& value);
+        /**
+         * \brief Construct a string DataType, taking value's storage.
+         **/
+        DataType(std::string&& value);
         /**
          * \brief Construct a string DataType.
          **/
@@ -167,6 +205,12 @@ class DLL_API DataType {
          **/
         DataType(const DataType& other);
 
+        /**
+         * \brief Construct a new DataType from other, leaving other
+         *  the integer 0.
+         **/
+        DataType(DataType&& other) noexcept;
+
         /**
          * \brief Construct a new DataType with a NodeRef
          **/
@@ -177,6 +221,20 @@ class DLL_API DataType {
          **/
         DataType(const std::vector<DataType>& list);
 
+        /**
+         * \brief Construct a new DataType for a DataType vector, taking
+         *  the vector's elements.
+         **/
+        DataType(std::vector<DataType>&& list);
+
+        /**
+         * \brief Construct an integer DataType from a BigInt.
+         *
+         * Values that fit in 32 bits are stored as INT_DATA (below 2^31)
+         * or UINT_DATA like other integers.  Wider values are BIGINT_DATA.
+         **/
+        DataType(const BigInt& value);
+
         /**
          * \brief Construct a new DataType from a Device
          *
@@ -197,6 +255,11 @@ class DLL_API DataType {
          **/
 		DataType& operator=(const DataType&);
 
+        /**
+         * \brief Move assignment.  other is left the integer 0.
+         **/
+		DataType& operator=(DataType&& other) noexcept;
+
         /**
          * \brief value comparision for two data types.
          *
@@ -233,6 +296,10 @@ class DLL_API DataType {
          * \brief string representation of underlying value.
          * \return String values are returned as they are stored.  int/uint
          * values are converted to a string representation.
+         *
+         * Non string values are formatted the first time their string is
+         * requested and the result is kept.  This is safe to call from
+         * several threads on the same DataType.
          **/
         const std::string& str_value() const; 
 
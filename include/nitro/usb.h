@@ -35,6 +35,7 @@ protected:
    void _close();
    int _transfer_status();
    uint16 _transfer_checksum();
+   void _cancel( uint32 terminal_addr );
 public:
     // core methods
     USBDevice(uint32 vid, uint32 pid);
@@ -202,6 +203,35 @@ public:
      **/
     void load_firmware( const char *bytes, size_t length );
 
+    /**
+     * Same as load_firmware(bytes,length) unless the device already runs
+     * this image, in which case nothing is sent and the device stays
+     * open.  load_firmware stamps each fx2 image it loads into a reserved
+     * block of device ram, see firmware_loaded.
+     *
+     * @param bytes Firmware file contents.
+     * @param length Length of bytes.
+     * @param force Load the firmware even if the device runs this image.
+     * @return true if the firmware was loaded and the device closed,
+     *   false if the load was skipped.
+     * @throw Exception
+     **/
+    bool load_firmware( const char *bytes, size_t length, bool force );
+
+    /**
+     * Compares the image with the stamp load_firmware left in device
+     * ram, then reads the image back from device ram and compares it so
+     * an image loaded by another tool isn't mistaken for this one.  The
+     * stamp does not survive a power cycle.  fx3 images are never
+     * stamped and always return false.
+     *
+     * @param bytes Firmware file contents.
+     * @param length Length of bytes.
+     * @return true if the open device runs this image.
+     * @throw Exception if the image can't be parsed.
+     **/
+    bool firmware_loaded( const char *bytes, size_t length );
+
     /**
      * @return the firmware protocol version of the open device.
      *  The firmware protocol version is composed of a major and minor version number
@@ -210,6 +240,21 @@ public:
      **/
     uint16 get_ver() const ;
 
+    /**
+     * \brief Limit pipe streaming while register I/O runs.
+     *
+     * Pipe reads and writes keep up to 32 urbs of 64k queued.  A get
+     * or set on the same bus would wait behind all of them, so while
+     * register I/O is pending (see Device::register_io_pending) pipe
+     * transfers stop refilling until only depth urbs are queued.  They
+     * grow back hold ms after the last register call, so the queue
+     * doesn't refill between the calls of a control loop.
+     * \param depth Urbs per pipe transfer while throttled.  Default 2.
+     *        0 turns throttling off.
+     * \param hold Milliseconds the throttle lasts after register I/O.
+     **/
+    void set_pipe_throttle ( uint32 depth, uint32 hold=10 );
+
     /**
      * This call causes the device to re-enumberate.  The USBDevice is no longer valid and 
      * close is automatically called.
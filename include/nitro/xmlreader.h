@@ -43,6 +43,40 @@ class DLL_API XmlReader : public Reader {
 
         void read(NodeRef node);
 
+        /**
+         * \brief Files included by the last call to read.
+         *
+         * Paths of every file pulled in with &lt;include&gt;, recursively.
+         * Useful for detecting when a loaded device interface is out of date.
+         **/
+        const std::vector<std::string>& includes() const;
+
+        /**
+         * \brief Load statistics for the last call to read.
+         **/
+        struct Stats {
+            double parse_time; ///< Seconds spent parsing xml documents.
+            double build_time; ///< Seconds spent building the device interface from parsed documents.
+            uint32 files_parsed; ///< Number of documents parsed.
+            uint32 cache_hits; ///< Documents found in the parse cache.
+        };
+        const Stats& stats() const;
+
+        /**
+         * \brief Share parsed documents between readers.
+         *
+         * A file included more than once is parsed only once per call
+         * to read.  With the process cache enabled, parsed documents
+         * are kept for the life of the process and shared by every
+         * XmlReader.  A cached document is parsed again when the file's
+         * modification time changes.
+         **/
+        static void set_process_cache ( bool enable );
+        /**
+         * \brief Drop all documents held by the process cache.
+         **/
+        static void clear_process_cache ();
+
 
 };
 
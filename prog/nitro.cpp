@@ -7,9 +7,16 @@
 #include <iostream>
 #include <sstream>
 #include <iomanip>
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <vector>
+#include <chrono>
+#include <thread>
 
 #include <getopt.h>
 #include <fnmatch.h>
+#include <csignal>
 
 #include "nitro.h"
 
@@ -30,19 +37,205 @@ int parseatoi( const char* const a ) {
 	return v;
 }
 
+uint64 parseatoull( const char* const a ) {
+	istringstream is (a);
+	uint64 v;
+	is >> setbase(0) >> v;
+	return v;
+}
+
+static Recorder* active_recorder=NULL;
+
+void stop_recording( int ) {
+    if (active_recorder) active_recorder->stop();
+}
+
+void print_record_stats ( const Recorder::Stats& s ) {
+    fprintf ( stderr, "\r%10.1f MB %8.2f MB/s  dropped %llu  buffers %u/%u ",
+        s.bytes_read/1048576.0, s.mbps(),
+        (unsigned long long)s.bytes_dropped, s.high_water, s.num_buffers );
+}
+
+// numeric tokens are addresses/values, anything else is a name
+DataType parse_token ( const string& tok ) {
+    if (isdigit(tok[0]) || (tok[0]=='-' && tok.size()>1)) return parseatoi(tok.c_str());
+    return tok;
+}
+
+/**
+ * Execute one command per line against an open device:
+ *
+ *  get <term> <reg>
+ *  set <term> <reg> <value>
+ *  read <term> <reg> <nBytes> <filename>
+ *  write <term> <reg> <filename> [nBytes]
+ *  sleep <milliseconds>
+ *
+ * Each command prints one tab separated line:
+ *  line  command  ok|error  seconds  result
+ * Execution stops at the first error.
+ **/
+int run_batch ( Device& dev, istream& in, unsigned int timeout ) {
+
+    string line;
+    int lineno=0;
+    while (getline(in,line)) {
+        ++lineno;
+        size_t comment = line.find('#');
+        if (comment != string::npos) line.erase(comment);
+        istringstream tokens(line);
+        vector<string> args;
+        string tok;
+        while (tokens >> tok) args.push_back(tok);
+        if (args.empty()) continue;
+
+        const string& cmd = args[0];
+        ostringstream result;
+        bool ok=true;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        try {
+            if (cmd == "get" && args.size()==3) {
+                result << dev.get ( parse_token(args[1]), parse_token(args[2]), timeout );
+            } else if (cmd == "set" && args.size()==4) {
+                dev.set ( parse_token(args[1]), parse_token(args[2]), parse_token(args[3]), timeout );
+            } else if (cmd == "read" && args.size()==5) {
+                uint64 n = parseatoull(args[3].c_str());
+                vector<uint8> buf(n);
+                if (n) dev.read ( parse_token(args[1]), parse_token(args[2]), &buf[0], n, timeout );
+                ofstream out ( args[4].c_str(), ios::binary );
+                out.write ( (char*)buf.data(), n );
+                if (!out.good()) throw Exception ( 1, "Unable to write " + args[4] );
+                result << n;
+            } else if (cmd == "write" && (args.size()==4 || args.size()==5)) {
+                ifstream fin ( args[3].c_str(), ios::binary );
+                if (!fin.good()) throw Exception ( 1, "Unable to open " + args[3] );
+                vector<uint8> buf ( (istreambuf_iterator<char>(fin)), istreambuf_iterator<char>() );
+                if (args.size()==5) {
+                    uint64 n = parseatoull(args[4].c_str());
+                    if (n>buf.size()) throw Exception ( 1, args[3] + " is shorter than " + args[4] + " bytes" );
+                    buf.resize(n);
+                }
+                if (buf.size()) dev.write ( parse_token(args[1]), parse_token(args[2]), &buf[0], buf.size(), timeout );
+                result << buf.size();
+            } else if (cmd == "sleep" && args.size()==2) {
+                this_thread::sleep_for ( chrono::milliseconds ( parseatoi(args[1].c_str()) ) );
+            } else {
+                throw Exception ( 1, "Invalid command '" + line + "'" );
+            }
+        } catch ( const Exception& e ) {
+            ok=false;
+            result << e.str_error();
+        }
+        double secs = chrono::duration<double>( chrono::steady_clock::now()-start ).count();
+
+        string res = result.str();
+        replace ( res.begin(), res.end(), '\t', ' ' );
+        replace ( res.begin(), res.end(), '\n', ' ' );
+        printf ( "%d\t%s\t%s\t%.6f\t%s\n", lineno, cmd.c_str(), ok ? "ok" : "error", secs, res.c_str() );
+        fflush(stdout);
+        if (!ok) return -1;
+    }
+    return 0;
+}
+
+/**
+ * Load firmware on every device in devs at once, one thread per
+ * device.  Devices that already run the image are skipped unless force
+ * is set.  Prints one tab separated line per device:
+ *  BUS=<address>  ok|current|error  seconds  message
+ * Returns -1 if any device failed.
+ **/
+int flash_devices ( const vector<vector<int> >& devs, const vector<char>& firmware, bool force ) {
+
+    size_t n = devs.size();
+    vector<USBDevice*> usb;
+    vector<string> errors(n);
+    vector<double> secs(n,0);
+    vector<char> loaded(n,0); // not vector<bool>, each thread writes its own element
+
+    // opening touches shared libusb state, do it before the threads start
+    for (size_t i=0;i<n;++i) {
+        usb.push_back ( new USBDevice ( devs[i][0], devs[i][1] ) );
+        try {
+            usb[i]->open_by_address ( devs[i][2] );
+        } catch ( const Exception& e ) {
+            errors[i] = e.str_error();
+        }
+    }
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    vector<thread> threads;
+    for (size_t i=0;i<n;++i) {
+        if (!errors[i].empty()) continue;
+        threads.push_back ( thread ( [&usb,&errors,&secs,&loaded,&firmware,force,i]() {
+            chrono::steady_clock::time_point dev_start = chrono::steady_clock::now();
+            try {
+                loaded[i] = usb[i]->load_firmware ( &firmware[0], firmware.size(), force );
+            } catch ( const Exception& e ) {
+                errors[i] = e.str_error();
+                if (errors[i].empty()) errors[i] = "failed";
+            }
+            secs[i] = chrono::duration<double>( chrono::steady_clock::now()-dev_start ).count();
+        } ) );
+    }
+    for (size_t i=0;i<threads.size();++i) threads[i].join();
+    double total = chrono::duration<double>( chrono::steady_clock::now()-start ).count();
+
+    int failed=0, current=0;
+    for (size_t i=0;i<n;++i) {
+        if (!errors[i].empty()) ++failed;
+        else if (!loaded[i]) ++current;
+        const char* status = !errors[i].empty() ? "error" : loaded[i] ? "ok" : "current";
+        printf ( "BUS=%04x\t%s\t%.3f\t%s\n", devs[i][2], status, secs[i], errors[i].c_str() );
+        delete usb[i];
+    }
+    printf ( "Flashed %d of %d devices in %.3f seconds, %d already current.\n", (int)(n-failed-current), (int)n, total, current );
+    return failed ? -1 : 0;
+}
+
 int main ( int argc, char* argv[] ) {
 
 	int vid=DEFAULT_VID,pid=DEFAULT_PID;
 	char* ihxfile=NULL, c;
 	bool errflag=false, dev_reset=false, do_set=false, do_get=false, do_read=false, do_write=false, do_shell=false;
+    bool do_record=false, rec_compress=false, rec_drop=false, do_flash=false, force=false;
+    uint32 rec_buffer_size=1<<20, rec_buffers=3;
     uint16 value=0;
     DataType term_addr(0), reg_addr(0);
     char *term_orig=NULL, *reg_orig=NULL, *vid_str=NULL, *pid_str=NULL;
-    unsigned int nBytes=0;
+    uint64 nBytes=0;
     unsigned int timeout=1000;
     char* rdwr_file=NULL;
     char* xml_file=NULL;
-	while ( (c=getopt(argc, argv, "hV:P:R:t:a:gs:r:n:w:i:x:S")) != -1 ) {
+    char* batch_file=NULL;
+    int batch_status=0;
+    static struct option long_options[] = {
+        {"batch", required_argument, 0, 'F'},
+        {0, 0, 0, 0}
+    };
+    if (argc==4 && !strcmp(argv[1],"unpack")) {
+        // nitro unpack <compressed capture> <raw file>
+        try {
+            Recorder::decompress ( argv[2], argv[3] );
+        } catch ( const Exception& e ) {
+            cout << e << endl;
+            return -1;
+        }
+        return 0;
+    }
+    if (argc>1 && !strcmp(argv[1],"record")) {
+        // nitro record [options] <file>
+        do_record=true;
+        --argc;
+        ++argv;
+    }
+    if (argc>1 && !strcmp(argv[1],"flash")) {
+        // nitro flash [options] <firmware file>
+        do_flash=true;
+        --argc;
+        ++argv;
+    }
+	while ( (c=getopt_long(argc, argv, "hV:P:R:ft:a:gs:r:n:w:i:x:Sb:B:zDF:", long_options, NULL)) != -1 ) {
 		switch (c) {
 			case 'h':
 				errflag=true;
@@ -57,6 +250,9 @@ int main ( int argc, char* argv[] ) {
 				dev_reset=true;
                 ihxfile=optarg;
 				break;
+            case 'f':
+                force=true;
+                break;
             case 't':
                 term_orig = optarg;
                 break;
@@ -82,21 +278,47 @@ int main ( int argc, char* argv[] ) {
                 rdwr_file=optarg;
                 break;
             case 'n':
-                nBytes=parseatoi(optarg);
+                nBytes=parseatoull(optarg);
+                break;
+            case 'b':
+                rec_buffer_size=parseatoi(optarg);
+                break;
+            case 'B':
+                rec_buffers=parseatoi(optarg);
+                break;
+            case 'z':
+                rec_compress=true;
+                break;
+            case 'D':
+                rec_drop=true;
                 break;
             case 'i':
                 timeout=parseatoi(optarg);
                 break;
             case 'x':
                 xml_file=optarg;
+                break;
+            case 'F':
+                batch_file=optarg;
                 break;
 			case '?':
 				errflag=true;
 				break;
 		}
 	}
+    if (do_record) {
+        if (optind < argc) rdwr_file = argv[optind];
+        else errflag=true;
+    }
+    if (do_flash) {
+        if (optind < argc) ihxfile = argv[optind];
+        else errflag=true;
+    }
 	if (errflag) {
 		printf ( "Usage: nitro [options]\n"
+				"       nitro record [options] <filename>\n"
+				"       nitro unpack <compressed capture> <filename>\n"
+				"       nitro flash [-V vid] [-P pid] [-f] <firmware file>\n"
 				"\tGeneric Options:\n"
 				"\t\t-h This Message\n"
 				"\t\t-V The Vendor Id or comma seperated list of VIDs [default 0x%04x].\n\t\t   Accepts wildcards such as '*','?', and '[]'.\n"
@@ -104,6 +326,10 @@ int main ( int argc, char* argv[] ) {
                 "\t\t-S Execute shell environment after other commands complete.\n"
 				"\tReset the Firmware (Ignores all other options)\n"
 				"\t\t-R Reset The Firmware (requires path to ihx file)\n"
+				"\tFlash Mode (load firmware on every matching device in parallel)\n"
+				"\t\t   Devices already running the same firmware are skipped.\n"
+				"\t\t-f Load the firmware even if the device already runs it.\n"
+				"\t\t   Prints 'BUS=<addr><TAB>ok|current|error<TAB>seconds<TAB>message' for each device.\n"
 				"\tTerminal Operations\n"
 				"\t\t-t terminal addr (default 0)\n"
 				"\t\t-a register addr (default 0)\n"
@@ -114,6 +340,17 @@ int main ( int argc, char* argv[] ) {
                 "\t\t-w <filename> write file data (uses file size by default, override with -n\n"
                 "\t\t-i <timeout> the timeout in milliseconds to wait for operations (default 1000).\n"
                 "\t\t-x <xmlfile> read device interface from xmlfile.  If used, causes terminal and register address to be interpreted as names strings instead of integer addresses.\n"
+				"\tBatch Mode\n"
+				"\t\t-F, --batch <filename> run commands from filename ('-' for stdin) against one open device:\n"
+				"\t\t   get <term> <reg> | set <term> <reg> <value> | read <term> <reg> <nBytes> <filename>\n"
+				"\t\t   write <term> <reg> <filename> [nBytes] | sleep <ms>\n"
+				"\t\t   Prints 'line<TAB>command<TAB>ok|error<TAB>seconds<TAB>result' for each command.\n"
+				"\tRecord Mode (stream -t/-a to filename, Ctrl-C to finish)\n"
+				"\t\t-n <nBytes> number of bytes to record (default until interrupted)\n"
+				"\t\t-b <bytes> size of each read (default 1MB)\n"
+				"\t\t-B <count> number of buffers (default 3)\n"
+				"\t\t-z compress the capture (restore with nitro unpack)\n"
+				"\t\t-D drop data instead of stalling the device when the disk falls behind\n"
 			 , DEFAULT_VID //, DEFAULT_PID
 				);
 		return 1;
@@ -167,18 +404,38 @@ int main ( int argc, char* argv[] ) {
 	}
     }
     
+    if (do_flash) {
+        if (candidates.empty()) {
+            printf ( "No Nitro USB Devices with vendor ID %s and product ID %s.\n", vid_str, pid_str );
+            return -1;
+        }
+        ifstream in ( ihxfile, ios::binary );
+        if (!in.good()) {
+            printf ( "Failed to open firmware file '%s'.\n", ihxfile );
+            return -1;
+        }
+        vector<char> firmware ( (istreambuf_iterator<char>(in)), istreambuf_iterator<char>() );
+        if (firmware.empty()) {
+            printf ( "Firmware file '%s' is empty.\n", ihxfile );
+            return -1;
+        }
+        return flash_devices ( candidates, firmware, force );
+    }
+
     // now figure out which of the candidates to use
+    // (batch output is parsed, keep device messages off stdout)
+    FILE* info = batch_file ? stderr : stdout;
     if(candidates.size() < 1) {
-        printf("No Nitro USB Devices with vendor ID %s and product ID %s.\n", vid_str, pid_str);
+        fprintf(info, "No Nitro USB Devices with vendor ID %s and product ID %s.\n", vid_str, pid_str);
         return -1;
     } else if(candidates.size() > 1) {
-	printf("The following multiple devices matched your specification:\n");
+	fprintf(info, "The following multiple devices matched your specification:\n");
 	for(unsigned int i=0; i<candidates.size(); i++) {
-	    printf("   VID=%04x  PID=%04x  BUS=%04x\n", candidates[i][0], candidates[i][1], candidates[i][2]);
+	    fprintf(info, "   VID=%04x  PID=%04x  BUS=%04x\n", candidates[i][0], candidates[i][1], candidates[i][2]);
 	}
-	printf("Using the first device.\n");
+	fprintf(info, "Using the first device.\n");
     } else {
-	printf("Found device VID=%04x  PID=%04x  BUS=%04x\n", candidates[0][0], candidates[0][1], candidates[0][2]);
+	fprintf(info, "Found device VID=%04x  PID=%04x  BUS=%04x\n", candidates[0][0], candidates[0][1], candidates[0][2]);
     }
     // take the first candidate in the list
     vid = candidates[0][0];
@@ -235,24 +492,59 @@ int main ( int argc, char* argv[] ) {
                 if (reg_orig ) reg_addr = parseatoi(reg_orig);
             }
 
-    	    if (do_get) {
+            if (batch_file) {
+                if (!strcmp(batch_file,"-")) {
+                    batch_status = run_batch ( dev, cin, timeout );
+                } else {
+                    ifstream batch ( batch_file );
+                    if (!batch.good()) {
+                        fprintf ( stderr, "Failed to open batch file '%s'.\n", batch_file );
+                        return -1;
+                    }
+                    batch_status = run_batch ( dev, batch, timeout );
+                }
+            } else if (do_get) {
                cout << dev.get(term_addr,reg_addr,timeout) << endl;
            } else if (do_set) {
                dev.set(term_addr,reg_addr,value,timeout);
+           } else if (do_record) {
+               Recorder rec ( dev, term_addr, reg_addr, rdwr_file );
+               rec.set_buffer_size ( rec_buffer_size );
+               rec.set_num_buffers ( rec_buffers );
+               rec.set_compression ( rec_compress );
+               rec.set_drop_on_overflow ( rec_drop );
+               rec.set_progress ( print_record_stats );
+
+               active_recorder = &rec;
+               signal ( SIGINT, stop_recording );
+               Recorder::Stats s;
+               try {
+                   s = rec.record ( nBytes, timeout );
+               } catch ( ... ) {
+                   signal ( SIGINT, SIG_DFL );
+                   active_recorder = NULL;
+                   throw;
+               }
+               signal ( SIGINT, SIG_DFL );
+               active_recorder = NULL;
+
+               print_record_stats ( s );
+               fprintf ( stderr, "\n" );
+               printf ( "Recorded %llu bytes to %s in %.2f seconds (%llu bytes on disk).\n",
+                    (unsigned long long)s.bytes_read, rdwr_file, s.elapsed,
+                    (unsigned long long)s.bytes_written );
            } else if (do_read) {
                if (0==nBytes) {
                  printf ( "Specify number of bytes to read with -n\n" );             
                } else {
-                 uint8 *read_buf=new uint8[nBytes];
-                 dev.read ( term_addr, reg_addr, read_buf, nBytes, timeout );
+                 vector<uint8> read_buf(nBytes);
+                 dev.read ( term_addr, reg_addr, &read_buf[0], nBytes, timeout );
 
                  printf ("save bytes to %s\n", rdwr_file );
                  ofstream out;
                  out.open( rdwr_file, ios::binary );
-                 out.write ( (char*)read_buf, nBytes );
+                 out.write ( (char*)&read_buf[0], nBytes );
                  out.close();
-
-                delete [] read_buf; // mem leak if throw
                }
            } else if (do_write) {
              ifstream in;
@@ -265,11 +557,10 @@ int main ( int argc, char* argv[] ) {
                     bytes_to_write=in.tellg();
                     in.seekg(0,ios::beg);                
                 }
-                uint8 *write_buf = new uint8[bytes_to_write];
-                in.read((char*)write_buf,bytes_to_write);
+                vector<uint8> write_buf(bytes_to_write);
+                in.read((char*)&write_buf[0],bytes_to_write);
 
-                dev.write(term_addr, reg_addr, write_buf, bytes_to_write, timeout);
-                delete [] write_buf;
+                dev.write(term_addr, reg_addr, &write_buf[0], bytes_to_write, timeout);
              } else {
                 printf ( "Failed to open file '%s' for reading.\n", rdwr_file );
              }
@@ -309,6 +600,6 @@ int main ( int argc, char* argv[] ) {
 	
     dev.close(); // this happens anyway when program exits.
 
-	return 0;
+	return batch_status;
 
 }
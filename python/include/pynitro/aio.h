@@ -0,0 +1,53 @@
+/**
+ * Copyright (C) 2009 Ubixum, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ **/
+
+
+#include <Python.h>
+
+#ifndef PYAIO_H
+#define PYAIO_H
+
+#include "device.h"
+
+/**
+ * asyncio support for nitro.Device.
+ *
+ * The *_async methods queue the transfer for an I/O thread owned by the
+ * device and return an asyncio future of the running loop.  The thread
+ * runs queued transfers in order without the GIL.  Finished transfers
+ * are collected per loop and completed by one call_soon_threadsafe
+ * callback, so a burst of transfers costs a single loop wakeup.
+ *
+ * Python 3 only.
+ **/
+
+#if PY_MAJOR_VERSION >= 3
+PyObject* nitro_Device_GetAsync(nitro_DeviceObject* self, NITRO_FASTCALL_ARGS);
+PyObject* nitro_Device_SetAsync(nitro_DeviceObject* self, NITRO_FASTCALL_ARGS);
+PyObject* nitro_Device_ReadAsync(nitro_DeviceObject* self, NITRO_FASTCALL_ARGS);
+PyObject* nitro_Device_WriteAsync(nitro_DeviceObject* self, NITRO_FASTCALL_ARGS);
+#endif
+
+/**
+ * Stops the device's I/O thread if there is one.  Called before the
+ * nitro device is deleted.  Requires the GIL.
+ **/
+void nitro_Device_StopAio(nitro_DeviceObject* self);
+
+#endif
+
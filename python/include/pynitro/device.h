@@ -24,8 +24,11 @@
 
 #include <nitro.h>
 
+#include "nitro_pyutil.h"
+
 
 class PyRetryFunc; // predef
+struct DeviceAio; // predef
 
 /**
  * The basic device type
@@ -36,6 +39,7 @@ typedef struct {
     PyObject_HEAD
     Nitro::Device* nitro_device;
     PyRetryFunc* retry_func;
+    DeviceAio* aio; // I/O thread for the *_async methods
 } nitro_DeviceObject;
 
 
@@ -45,11 +49,14 @@ PyObject* nitro_Device_GetDi(nitro_DeviceObject* self);
 PyObject* nitro_Device_SetDi(nitro_DeviceObject* self, PyObject *arg);
 PyObject* nitro_Device_Lock(nitro_DeviceObject* self);
 PyObject* nitro_Device_Unlock(nitro_DeviceObject* self);
-PyObject* nitro_Device_Get(nitro_DeviceObject* self, PyObject *args);
+PyObject* nitro_Device_Get(nitro_DeviceObject* self, NITRO_FASTCALL_ARGS);
 PyObject* nitro_Device_GetSubregs(nitro_DeviceObject* self, PyObject *args);
-PyObject* nitro_Device_Set(nitro_DeviceObject* self, PyObject *args);
-PyObject* nitro_Device_Read(nitro_DeviceObject* self, PyObject *args);
-PyObject* nitro_Device_Write(nitro_DeviceObject* self, PyObject *args);
+PyObject* nitro_Device_Set(nitro_DeviceObject* self, NITRO_FASTCALL_ARGS);
+PyObject* nitro_Device_GetMany(nitro_DeviceObject* self, NITRO_FASTCALL_ARGS);
+PyObject* nitro_Device_SetMany(nitro_DeviceObject* self, NITRO_FASTCALL_ARGS);
+PyObject* nitro_Device_Read(nitro_DeviceObject* self, NITRO_FASTCALL_ARGS);
+PyObject* nitro_Device_Write(nitro_DeviceObject* self, NITRO_FASTCALL_ARGS);
+PyObject* nitro_Device_Cancel(nitro_DeviceObject* self, PyObject *arg);
 PyObject* nitro_Device_Close(nitro_DeviceObject* self);
 PyObject* nitro_Device_LoadXML(nitro_DeviceObject*, PyObject *args);
 PyObject* nitro_Device_WriteXML(nitro_DeviceObject*, PyObject *arg);
@@ -58,7 +65,13 @@ PyObject* nitro_Device_DisableMode(nitro_DeviceObject* self, PyObject *args);
 PyObject* nitro_Device_SetModes(nitro_DeviceObject* self, PyObject *args);
 PyObject* nitro_Device_GetModes(nitro_DeviceObject* self, PyObject *args);
 PyObject* nitro_Device_SetTimeout(nitro_DeviceObject* self, PyObject *arg);
+PyObject* nitro_Device_IoStats(nitro_DeviceObject* self, PyObject *args);
+PyObject* nitro_Device_ResetIoStats(nitro_DeviceObject* self);
 PyObject* nitro_Device_SetRetryFunc(nitro_DeviceObject* self, PyObject *arg);
+
+// argument helpers for the NITRO_FASTCALL_ARGS methods
+bool check_nargs ( const char* usage, Py_ssize_t nargs, Py_ssize_t min, Py_ssize_t max );
+bool to_uint32 ( PyObject* obj, uint32& val );
 #endif
 
 
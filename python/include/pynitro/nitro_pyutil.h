@@ -56,6 +56,31 @@ extern PyObject* nitro_Exception;
         SET_NITRO_EXC(e); \
         return r;
 
+/**
+ * Methods declared with NITRO_FASTCALL_ARGS receive their positional
+ * arguments as args[0..nargs) without PyArg_ParseTuple.  Python 3.7 and
+ * later pass the array directly (METH_FASTCALL).  Older versions use
+ * METH_VARARGS and NITRO_FASTCALL_UNPACK points args at the tuple items.
+ * \code
+ * PyObject* nitro_Device_Get(nitro_DeviceObject* self, NITRO_FASTCALL_ARGS) {
+ *   NITRO_FASTCALL_UNPACK
+ *   ...
+ * }
+ * {"get", (PyCFunction)nitro_Device_Get, NITRO_METH_FASTCALL, "..." },
+ * \endcode
+ **/
+#if PY_VERSION_HEX >= 0x03070000
+#define NITRO_METH_FASTCALL METH_FASTCALL
+#define NITRO_FASTCALL_ARGS PyObject* const* args, Py_ssize_t nargs
+#define NITRO_FASTCALL_UNPACK
+#else
+#define NITRO_METH_FASTCALL METH_VARARGS
+#define NITRO_FASTCALL_ARGS PyObject* arg_tuple
+#define NITRO_FASTCALL_UNPACK \
+        PyObject* const* args = &PyTuple_GET_ITEM(arg_tuple,0); \
+        Py_ssize_t nargs = PyTuple_GET_SIZE(arg_tuple);
+#endif
+
 /**
  *  \brief convert PyObject to DataType.
  *  \param address, Pointer to DataType memory
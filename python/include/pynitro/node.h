@@ -32,6 +32,7 @@
 typedef struct {
     PyObject_HEAD
     Nitro::NodeRef* m_node;
+    PyObject* m_children; // child name -> wrapper returned by __getitem__
 } nitro_NodeObject;
 
 
@@ -67,6 +68,16 @@ extern PyTypeObject nitro_ValuemapType;
 
 PyObject* nitro_BuildNode(const Nitro::NodeRef& node);
 
+/**
+ * \brief node_dumps(node) -> bytes in the Nitro::BinWriter::serialize format.
+ **/
+PyObject* nitro_NodeDumps(PyObject* module, PyObject* arg);
+
+/**
+ * \brief node_loads(buffer) -> node written by node_dumps.
+ **/
+PyObject* nitro_NodeLoads(PyObject* module, PyObject* arg);
+
 
 #endif
 
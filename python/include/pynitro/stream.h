@@ -0,0 +1,73 @@
+/**
+ * Copyright (C) 2009 Ubixum, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ **/
+
+
+#include <Python.h>
+
+#ifndef PYSTREAM_H
+#define PYSTREAM_H
+
+#include "device.h"
+
+#define NITRO_STREAM_MAXDIM 4
+
+struct StreamPool; // predef
+
+/**
+ * \brief nitro.ReadStream
+ *
+ * Iterator returned by Device.stream().  A reader thread fills a
+ * rotating pool of frame buffers from a pipe terminal without holding
+ * the GIL.  Each iteration returns the oldest filled buffer as a
+ * nitro.Frame.
+ **/
+typedef struct {
+    PyObject_HEAD
+    PyObject* device; // keeps the nitro device alive
+    StreamPool* pool;
+    char format[2];
+    int ndim;
+    Py_ssize_t itemsize;
+    Py_ssize_t shape[NITRO_STREAM_MAXDIM];
+    Py_ssize_t strides[NITRO_STREAM_MAXDIM];
+} nitro_ReadStreamObject;
+
+/**
+ * \brief nitro.Frame
+ *
+ * One filled buffer of a ReadStream.  Exports the buffer protocol with
+ * the stream's format and shape so numpy.asarray(frame) or
+ * memoryview(frame) use the data in place.  The buffer goes back to
+ * the pool when the frame and every view of it are released.
+ **/
+typedef struct {
+    PyObject_HEAD
+    nitro_ReadStreamObject* stream;
+    uint32 slot;
+    uint32 index;
+} nitro_FrameObject;
+
+
+extern PyTypeObject nitro_ReadStreamType;
+extern PyTypeObject nitro_FrameType;
+
+PyObject* nitro_Device_Stream(nitro_DeviceObject* self, PyObject* args, PyObject* kwds);
+
+#endif
+
+
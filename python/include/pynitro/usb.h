@@ -45,6 +45,7 @@ PyObject* nitro_USBDevice_Renum(nitro_USBDeviceObject* self);
 PyObject* nitro_USBDevice_Reset(nitro_USBDeviceObject* self);
 PyObject* nitro_USBDevice_LoadFirmware(nitro_USBDeviceObject* self, PyObject* args);
 PyObject* nitro_USBDevice_GetFirmwareVersion(nitro_USBDeviceObject* self);
+PyObject* nitro_USBDevice_SetPipeThrottle(nitro_USBDeviceObject* self, PyObject* args);
 PyObject* nitro_USBDevice_SetSerial(nitro_USBDeviceObject* self, PyObject *arg);
 PyObject* nitro_USBDevice_GetSerial(nitro_USBDeviceObject* self, PyObject* args);
 PyObject* nitro_USBDevice_GetAddress(nitro_USBDeviceObject* self, PyObject* args);
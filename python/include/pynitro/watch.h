@@ -0,0 +1,40 @@
+/**
+ * Copyright (C) 2009 Ubixum, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ **/
+
+
+#include <Python.h>
+
+#ifndef PYWATCH_H
+#define PYWATCH_H
+
+#include "device.h"
+
+/**
+ * Register watches for nitro.Device.
+ *
+ * Callbacks run on the device's watch thread.  They take the GIL (or a
+ * thread state of their interpreter) for the call only, so the polls
+ * themselves never hold it.
+ **/
+
+PyObject* nitro_Device_Watch(nitro_DeviceObject* self, PyObject* args, PyObject* kwds);
+PyObject* nitro_Device_Unwatch(nitro_DeviceObject* self, PyObject* arg);
+PyObject* nitro_Device_UnwatchAll(nitro_DeviceObject* self);
+PyObject* nitro_Device_WaitUntil(nitro_DeviceObject* self, PyObject* args, PyObject* kwds);
+
+#endif
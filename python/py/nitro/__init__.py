@@ -14,15 +14,55 @@
 # You should have received a copy of the GNU Lesser General Public
 # License along with this library; if not, write to the Free Software
 # Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USAimport struct
-from _nitro import Device, USBDevice, UserDevice, XmlReader, XmlWriter, _NITRO_API , Exception, Buffer, Node, \
-    GETSET_VERIFY, DOUBLEGET_VERIFY, STATUS_VERIFY, CHECKSUM_VERIFY, RETRY_ON_FAILURE, LOG_IO, \
-    version, str_version, load_di
+from _nitro import Device, USBDevice, UserDevice, XmlReader, XmlWriter, _NITRO_API , Exception, Buffer, ReadStream, Frame, Node, \
+    GETSET_VERIFY, DOUBLEGET_VERIFY, STATUS_VERIFY, CHECKSUM_VERIFY, RETRY_ON_FAILURE, LOG_IO, IO_REGISTER, IO_PIPE, \
+    version, str_version, load_di, node_dumps, node_loads
 from .di import * 
 
 import logging
 log = logging.getLogger(__name__)
 
 
+###############################################################################
+# Nodes pickle in the binary device interface format.  For a large device
+# interface handed to many worker processes, share_node serializes it once
+# into shared memory and each worker loads it with attach_node instead of
+# receiving its own pickled copy.  Requires python 3.8.
+#
+# Example:
+#
+# shm = nitro.share_node(dev.get_di())
+# pool.map(work, [(shm.name, job) for job in jobs])
+# shm.close(); shm.unlink()
+#
+# def work(args):
+#     di = nitro.attach_node(args[0])
+#
+def share_node(node):
+    """Serialize node into a new multiprocessing.shared_memory block.
+    Returns the SharedMemory.  Pass its name to attach_node.  The caller
+    closes and unlinks it when the workers are done."""
+    import struct
+    from multiprocessing import shared_memory
+    data = node_dumps(node)
+    shm = shared_memory.SharedMemory(create=True, size=len(data) + 8)
+    shm.buf[:8] = struct.pack('<Q', len(data))
+    shm.buf[8:8 + len(data)] = data
+    return shm
+
+def attach_node(name):
+    """Load a node stored by share_node in another process."""
+    import struct
+    from multiprocessing import shared_memory
+    shm = shared_memory.SharedMemory(name=name)
+    try:
+        size = struct.unpack('<Q', bytes(shm.buf[:8]))[0]
+        with shm.buf[8:8 + size] as data:
+            return node_loads(data)
+    finally:
+        shm.close()
+
+
 ###############################################################################
 # The below set of functions implement an atomic decorator. Use this to
 # wrap a function whose first argument is a nitro.Device with a lock()
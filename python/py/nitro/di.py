@@ -18,7 +18,8 @@ import types
 import _nitro
 
 __all__ = [ 'DeviceInterface', 'Terminal', 'Register', 'SubReg', 'Valuemap' ,
-'printVerilogInstance', 'printVerilogDefs', 'printVerilogModule', 'printCDefs', ]
+'printVerilogInstance', 'printVerilogDefs', 'printVerilogModule', 'printCDefs',
+'printCppDefs', ]
 
 
 def hasattr_(k,v):
@@ -453,3 +454,99 @@ def printCDefs(di, filename, registers_only=False):
     f.close()
 
 
+_cpp_keywords = set ( """alignas alignof and and_eq asm auto bitand bitor bool break case catch
+char char16_t char32_t class compl const constexpr const_cast continue decltype default
+delete do double dynamic_cast else enum explicit export extern false float for friend
+goto if inline int long mutable namespace new noexcept not not_eq nullptr operator or
+or_eq private protected public register reinterpret_cast return short signed sizeof
+static static_assert static_cast struct switch template this thread_local throw true
+try typedef typeid typename union unsigned using virtual void volatile wchar_t while
+xor xor_eq""".split() )
+
+# members of Nitro::RegisterDesc that a nested subregister struct would hide
+_cpp_reg_members = ( 'terminal', 'value_type', 'addr', 'shift', 'width', 'words',
+    'mask', 'writable', 'trigger', 'values' )
+
+def _cppName(name, reserved=()):
+    """
+    A C++ identifier for a DI name.
+    """
+    n = ''.join ( c if c.isalnum() or c == '_' else '_' for c in str(name) )
+    if not n or n[0].isdigit(): n = '_' + n
+    while n in _cpp_keywords or n in reserved: n += '_'
+    return n
+
+def _attrStr(node, name):
+    v = getattr(node, name)
+    if type(v) == bytes: v = v.decode()
+    return v.strip()
+
+def _cppValues(f, node, indent, value_type):
+    if not hasattr_(node, "valuemap"): return
+    f.write ( indent + "enum class values : %s {" % value_type )
+    f.write ( ",".join ( " %s=%s" % (_cppName(k), v) for k,v in node.valuemap.attr_items() ) )
+    f.write ( " };\n" )
+
+def printCppDefs(di, filename, namespace=None):
+    """
+    Write a C++ header of the compile time register descriptors used
+    by the Nitro::get<Reg>(dev) and Nitro::set<Reg>(dev,v) templates in
+    nitro/regs.h.  Each terminal is a namespace with a terminal typedef
+    and a struct per register.  Subregisters are structs nested in
+    their register and valuemaps are a values enum class.
+
+    namespace: Outer namespace.  Defaults to the device interface name.
+
+    Array registers and values wider than 64 bits are listed in a
+    comment but not generated.  A register wider than 64 bits is only a
+    scope for its subregisters.  Names that are C++ keywords, or that
+    would hide a RegisterDesc member or their register, get a trailing
+    underscore.
+    """
+    f = open(filename, "w");
+    f.write("// This file is auto-generated. Do not edit.\n");
+    defname = "_" + filename.upper().replace(".","_").replace('\\','_').replace('/','_') + "_"
+    f.write("#ifndef %s\n" % defname)
+    f.write("#define %s\n\n" % defname)
+    f.write("#include <nitro/regs.h>\n\n")
+    f.write("namespace %s {\n\n" % _cppName(namespace or di.name))
+
+    for term in di.values():
+        dwidth = term.regDataWidth
+        f.write(("/"*75) + "\n")
+        f.write("namespace %s {\n" % _cppName(term.name))
+        f.write("    typedef Nitro::TerminalDesc<%d,%d> terminal;\n" % (term.addr, dwidth))
+        for reg in term.values():
+            name = _cppName(reg.name, ('terminal',))
+            if reg.array > 1:
+                f.write("    // %s not generated (array)\n" % name)
+                continue
+            writable = 'true' if _attrStr(reg,'mode') == 'write' else 'false'
+            trigger = 'true' if _attrStr(reg,'type') == 'trigger' else 'false'
+            value_type = 'uint64' if reg.width > 32 else 'uint32'
+            if reg.width > 64:
+                f.write("    struct %s { // wider than 64 bits\n" % name)
+            else:
+                f.write("    struct %s : Nitro::RegisterDesc<terminal,%d,0,%d,%s,%s> {\n" % (name, reg.addr, reg.width, writable, trigger))
+            for sub in reg.values():
+                sname = _cppName(sub.name, _cpp_reg_members + (name,))
+                addr = reg.addr + sub.addr // dwidth
+                shift = sub.addr % dwidth
+                if shift + sub.width > 64:
+                    f.write("        // %s not generated (wider than 64 bits)\n" % sname)
+                    continue
+                f.write("        struct %s : Nitro::RegisterDesc<terminal,%d,%d,%d,%s,%s> {" % (sname, addr, shift, sub.width, writable, trigger))
+                if hasattr_(sub, "valuemap"):
+                    f.write("\n")
+                    _cppValues(f, sub, "            ", 'uint64' if sub.width > 32 else 'uint32')
+                    f.write("        };\n")
+                else:
+                    f.write("};\n")
+            if reg.width <= 64: _cppValues(f, reg, "        ", value_type)
+            f.write("    };\n")
+        f.write("}\n\n")
+
+    f.write("}\n\n")
+    f.write("#endif\n")
+    f.close()
+
@@ -49,7 +49,7 @@ def get_ext():
        define_macros=plat_define_macros,
        export_symbols = plat_export_symbols,
        extra_compile_args = plat_extra_compile_args,
-       sources = ['src/nitro.cpp', 'src/device.cpp', 'src/usb.cpp', 'src/userdevice.cpp', 'src/node.cpp', 'src/buffer.cpp', 'src/xml.cpp']
+       sources = ['src/nitro.cpp', 'src/device.cpp', 'src/usb.cpp', 'src/userdevice.cpp', 'src/node.cpp', 'src/buffer.cpp', 'src/stream.cpp', 'src/aio.cpp', 'src/watch.cpp', 'src/xml.cpp']
        )
 
 def get_scripts():
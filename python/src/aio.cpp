@@ -0,0 +1,413 @@
+/**
+ * Copyright (C) 2009 Ubixum, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ **/
+
+#include <pynitro/aio.h>
+
+#include <pynitro/nitro_pyutil.h>
+
+#if PY_MAJOR_VERSION >= 3
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace Nitro;
+
+
+/**
+ * One queued transfer.  The python references are only touched with
+ * the GIL held.  The I/O thread uses the DataType and buffer members.
+ **/
+struct AioOp {
+    enum Kind { GET, SET, READ, WRITE };
+    Kind m_kind;
+    DataType m_term;
+    DataType m_reg;
+    DataType m_val; // set value or get result
+    uint32 m_timeout;
+    uint32 m_width;
+    Py_buffer m_view; // read/write data
+    Exception* m_error;
+
+    PyObject* m_device; // keeps the nitro device alive
+    PyObject* m_loop;
+    PyObject* m_future;
+
+    AioOp ( Kind kind ) : m_kind(kind), m_term(0), m_reg(0), m_val(0),
+        m_timeout(0), m_width(0), m_error(NULL),
+        m_device(NULL), m_loop(NULL), m_future(NULL) {
+        m_view.obj = NULL;
+    }
+
+    // requires the GIL
+    ~AioOp() {
+        if (m_view.obj) PyBuffer_Release(&m_view);
+        Py_XDECREF(m_device);
+        Py_XDECREF(m_loop);
+        Py_XDECREF(m_future);
+        delete m_error;
+    }
+
+    void run ( Device& dev ) {
+        try {
+            switch (m_kind) {
+                case GET:
+                    m_val = dev.get ( m_term, m_reg, (int32)m_timeout, m_width );
+                    break;
+                case SET:
+                    dev.set ( m_term, m_reg, m_val, (int32)m_timeout, m_width );
+                    break;
+                case READ:
+                    dev.read ( m_term, m_reg, (uint8*)m_view.buf, (uint32)m_view.len, m_timeout );
+                    break;
+                case WRITE:
+                    dev.write ( m_term, m_reg, (uint8*)m_view.buf, (uint32)m_view.len, m_timeout );
+                    break;
+            }
+        } catch ( const Exception& e ) {
+            m_error = new Exception ( e );
+        }
+    }
+};
+
+
+/**
+ * I/O thread of a device.  Transfers run in the order they were
+ * queued.  Finished transfers wait in m_done, grouped by the loop
+ * that awaits them, until that loop runs aio_drain.  Only the
+ * transition from no finished transfers to one schedules a drain.
+ **/
+struct DeviceAio {
+    Device& m_dev;
+    PyObject* m_device; // borrowed, the owning python device
+    PyThreadState* m_tstate; // used by the I/O thread to schedule drains
+
+    deque<AioOp*> m_pending;
+    map<PyObject*, vector<AioOp*> > m_done;
+    bool m_stop;
+
+    mutex m_mutex;
+    condition_variable m_cond;
+    thread m_thread;
+
+    // requires the GIL
+    DeviceAio ( Device& dev, PyObject* device ) : m_dev(dev), m_device(device),
+        m_tstate(PyThreadState_New(PyThreadState_Get()->interp)), m_stop(false) {
+        m_thread = thread ( &DeviceAio::run, this );
+    }
+
+    // requires the GIL.  Every op holds a reference to the device so
+    // nothing is queued once the device is being deallocated.
+    ~DeviceAio() {
+        {
+            lock_guard<mutex> lock ( m_mutex );
+            m_stop = true;
+        }
+        m_cond.notify_one();
+        Py_BEGIN_ALLOW_THREADS
+        m_thread.join();
+        Py_END_ALLOW_THREADS
+        PyThreadState_Clear ( m_tstate );
+        PyThreadState_Delete ( m_tstate );
+    }
+
+    void submit ( AioOp* op ) {
+        {
+            lock_guard<mutex> lock ( m_mutex );
+            m_pending.push_back ( op );
+        }
+        m_cond.notify_one();
+    }
+
+    void run();
+    void schedule_drain ( PyObject* loop );
+};
+
+static PyObject* aio_drain ( PyObject* ctx, PyObject* );
+
+static PyMethodDef aio_drain_def = {
+    "_aio_drain", (PyCFunction)aio_drain, METH_NOARGS, "Completes finished device transfers."
+};
+
+static int aio_release ( void* obj ) {
+    Py_DECREF((PyObject*)obj);
+    return 0;
+}
+
+void DeviceAio::run() {
+    for (;;) {
+        AioOp* op;
+        {
+            unique_lock<mutex> lock ( m_mutex );
+            while (!m_stop && m_pending.empty()) m_cond.wait ( lock );
+            if (m_pending.empty()) return;
+            op = m_pending.front();
+            m_pending.pop_front();
+        }
+
+        op->run ( m_dev );
+
+        bool first;
+        {
+            lock_guard<mutex> lock ( m_mutex );
+            vector<AioOp*>& done = m_done[op->m_loop];
+            first = done.empty();
+            done.push_back ( op );
+        }
+        if (first) {
+            PyEval_RestoreThread ( m_tstate );
+            schedule_drain ( op->m_loop );
+            PyEval_SaveThread();
+        }
+    }
+}
+
+// requires the GIL
+void DeviceAio::schedule_drain ( PyObject* loop ) {
+    PyObject* ctx = Py_BuildValue ( "(OO)", m_device, loop );
+    PyObject* drain = ctx ? PyCFunction_New ( &aio_drain_def, ctx ) : NULL;
+    Py_XDECREF(ctx);
+    PyObject* ret = drain ? PyObject_CallMethod ( loop, "call_soon_threadsafe", "O", drain ) : NULL;
+    Py_XDECREF(drain);
+    if (ret) {
+        Py_DECREF(ret);
+        return;
+    }
+
+    // the loop is closed.  Nobody can await the futures anymore.  The
+    // ops may hold the last references to the device, which must not
+    // be deallocated on its own I/O thread.
+    PyErr_Clear();
+    vector<AioOp*> ops;
+    {
+        lock_guard<mutex> lock ( m_mutex );
+        ops.swap ( m_done[loop] );
+        m_done.erase ( loop );
+    }
+    Py_INCREF(m_device);
+    for (size_t i=0;i<ops.size();++i) delete ops[i];
+    // if the call can't be queued the device leaks
+    Py_AddPendingCall ( aio_release, m_device );
+}
+
+
+static PyObject* aio_str_done = NULL;
+static PyObject* aio_str_set_result = NULL;
+static PyObject* aio_str_set_exception = NULL;
+
+// completes one future.  Futures cancelled while their transfer ran
+// are skipped.
+static bool aio_complete ( AioOp* op ) {
+    PyObject* done = PyObject_CallMethodObjArgs ( op->m_future, aio_str_done, NULL );
+    if (!done) return false;
+    int is_done = PyObject_IsTrue ( done );
+    Py_DECREF(done);
+    if (is_done < 0) return false;
+    if (is_done) return true;
+
+    PyObject* ret;
+    if (op->m_error) {
+        const Exception& e = *op->m_error;
+        PyObject* exc = PyObject_CallFunction ( nitro_Exception, "isN",
+            e.code(), e.str_error().c_str(), from_datatype ( e.userdata() ) );
+        if (!exc) return false;
+        ret = PyObject_CallMethodObjArgs ( op->m_future, aio_str_set_exception, exc, NULL );
+        Py_DECREF(exc);
+    } else {
+        PyObject* result;
+        if (op->m_kind == AioOp::GET) {
+            result = from_datatype ( op->m_val );
+            if (!result) return false;
+        } else {
+            result = Py_None;
+            Py_INCREF(result);
+        }
+        ret = PyObject_CallMethodObjArgs ( op->m_future, aio_str_set_result, result, NULL );
+        Py_DECREF(result);
+    }
+    Py_XDECREF(ret);
+    return ret != NULL;
+}
+
+/**
+ * Runs on the event loop.  ctx is a (device, loop) tuple.
+ **/
+static PyObject* aio_drain ( PyObject* ctx, PyObject* ) {
+    nitro_DeviceObject* self = (nitro_DeviceObject*)PyTuple_GET_ITEM(ctx,0);
+    PyObject* loop = PyTuple_GET_ITEM(ctx,1);
+    DeviceAio* aio = self->aio;
+
+    vector<AioOp*> ops;
+    {
+        lock_guard<mutex> lock ( aio->m_mutex );
+        map<PyObject*, vector<AioOp*> >::iterator itr = aio->m_done.find ( loop );
+        if (itr != aio->m_done.end()) {
+            ops.swap ( itr->second );
+            aio->m_done.erase ( itr );
+        }
+    }
+
+    // every op is released even if one fails.  The last op can hold
+    // the last reference to the device, which ctx keeps alive here.
+    bool ok = true;
+    for (size_t i=0;i<ops.size();++i) {
+        if (ok) ok = aio_complete ( ops[i] );
+        delete ops[i];
+    }
+    if (!ok) return NULL;
+    Py_RETURN_NONE;
+}
+
+
+#define CHECK_ABSTRACT() if (!self->nitro_device) { \
+        PyErr_SetString(PyExc_Exception,"Device is abstract and cannot be uses directly."); \
+        return NULL; \
+    }
+
+/**
+ * Creates the future for op on the running loop and queues op.
+ * Takes ownership of op.
+ **/
+static PyObject* aio_submit ( nitro_DeviceObject* self, AioOp* op ) {
+    static PyObject* get_loop = NULL;
+    if (!get_loop) {
+        aio_str_done = PyUnicode_InternFromString ( "done" );
+        aio_str_set_result = PyUnicode_InternFromString ( "set_result" );
+        aio_str_set_exception = PyUnicode_InternFromString ( "set_exception" );
+        PyObject* asyncio = PyImport_ImportModule ( "asyncio" );
+        if (!asyncio) {
+            delete op;
+            return NULL;
+        }
+#if PY_VERSION_HEX >= 0x03070000
+        get_loop = PyObject_GetAttrString ( asyncio, "get_running_loop" );
+#else
+        get_loop = PyObject_GetAttrString ( asyncio, "get_event_loop" );
+#endif
+        Py_DECREF(asyncio);
+        if (!get_loop) {
+            delete op;
+            return NULL;
+        }
+    }
+
+    op->m_loop = PyObject_CallObject ( get_loop, NULL );
+    if (op->m_loop) op->m_future = PyObject_CallMethod ( op->m_loop, "create_future", NULL );
+    if (!op->m_future) {
+        delete op;
+        return NULL;
+    }
+    op->m_device = (PyObject*)self;
+    Py_INCREF(op->m_device);
+
+    if (!self->aio) self->aio = new DeviceAio ( *self->nitro_device, (PyObject*)self );
+    PyObject* future = op->m_future;
+    Py_INCREF(future);
+    self->aio->submit ( op );
+    return future;
+}
+
+// gets the data buffer for read_async/write_async
+static bool aio_buffer ( AioOp* op, PyObject* pydata, int flags ) {
+    if (PyObject_GetBuffer ( pydata, &op->m_view, flags|PyBUF_C_CONTIGUOUS ) == 0) return true;
+    op->m_view.obj = NULL;
+    PyErr_SetString ( PyExc_Exception, flags & PyBUF_WRITABLE ?
+        "Data must be a writable contiguous buffer such as a bytearray or array object." :
+        "Data must be a bytes, contiguous buffer or array object." );
+    return false;
+}
+
+PyObject* nitro_Device_GetAsync(nitro_DeviceObject* self, NITRO_FASTCALL_ARGS) {
+    NITRO_FASTCALL_UNPACK
+    CHECK_ABSTRACT();
+    AioOp* op = new AioOp ( AioOp::GET );
+    op->m_timeout = (uint32)-1;
+    if (!check_nargs ( "get_async(term,reg,timeout=-1,width=0)", nargs, 2, 4 ) ||
+        !to_datatype ( args[0], &op->m_term ) ||
+        !to_datatype ( args[1], &op->m_reg ) ||
+        (nargs > 2 && !to_uint32 ( args[2], op->m_timeout )) ||
+        (nargs > 3 && !to_uint32 ( args[3], op->m_width )) ) {
+        delete op;
+        return NULL;
+    }
+    return aio_submit ( self, op );
+}
+
+PyObject* nitro_Device_SetAsync(nitro_DeviceObject* self, NITRO_FASTCALL_ARGS) {
+    NITRO_FASTCALL_UNPACK
+    CHECK_ABSTRACT();
+    AioOp* op = new AioOp ( AioOp::SET );
+    op->m_timeout = (uint32)-1;
+    if (!check_nargs ( "set_async(term,reg,value,timeout=-1,width=0)", nargs, 3, 5 ) ||
+        !to_datatype ( args[0], &op->m_term ) ||
+        !to_datatype ( args[1], &op->m_reg ) ||
+        !to_datatype ( args[2], &op->m_val ) ||
+        (nargs > 3 && !to_uint32 ( args[3], op->m_timeout )) ||
+        (nargs > 4 && !to_uint32 ( args[4], op->m_width )) ) {
+        delete op;
+        return NULL;
+    }
+    return aio_submit ( self, op );
+}
+
+PyObject* nitro_Device_ReadAsync(nitro_DeviceObject* self, NITRO_FASTCALL_ARGS) {
+    NITRO_FASTCALL_UNPACK
+    CHECK_ABSTRACT();
+    AioOp* op = new AioOp ( AioOp::READ );
+    op->m_timeout = 1000;
+    if (!check_nargs ( "read_async(term,reg,data,timeout=1000)", nargs, 3, 4 ) ||
+        !to_datatype ( args[0], &op->m_term ) ||
+        !to_datatype ( args[1], &op->m_reg ) ||
+        (nargs > 3 && !to_uint32 ( args[3], op->m_timeout )) ||
+        !aio_buffer ( op, args[2], PyBUF_WRITABLE ) ) {
+        delete op;
+        return NULL;
+    }
+    return aio_submit ( self, op );
+}
+
+PyObject* nitro_Device_WriteAsync(nitro_DeviceObject* self, NITRO_FASTCALL_ARGS) {
+    NITRO_FASTCALL_UNPACK
+    CHECK_ABSTRACT();
+    AioOp* op = new AioOp ( AioOp::WRITE );
+    op->m_timeout = 1000;
+    if (!check_nargs ( "write_async(term,reg,data,timeout=1000)", nargs, 3, 4 ) ||
+        !to_datatype ( args[0], &op->m_term ) ||
+        !to_datatype ( args[1], &op->m_reg ) ||
+        (nargs > 3 && !to_uint32 ( args[3], op->m_timeout )) ||
+        !aio_buffer ( op, args[2], 0 ) ) {
+        delete op;
+        return NULL;
+    }
+    return aio_submit ( self, op );
+}
+
+#endif // PY_MAJOR_VERSION >= 3
+
+
+void nitro_Device_StopAio(nitro_DeviceObject* self) {
+#if PY_MAJOR_VERSION >= 3
+    delete self->aio;
+    self->aio = NULL;
+#endif
+}
+
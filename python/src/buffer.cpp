@@ -78,14 +78,18 @@ Py_ssize_t buffer_charbuffer ( PyObject* self, Py_ssize_t seg, char** buf ) {
 }
 
 
+#if PY_MAJOR_VERSION >= 3
+static int buffer_getbuffer ( PyObject* self, Py_buffer* view, int flags ) {
+	nitro_BufferObject* b = (nitro_BufferObject*)self;
+	return PyBuffer_FillInfo ( view, self, b->m_buf, b->m_len, 0, flags );
+}
+#endif
+
 static 
 #if PY_MAJOR_VERSION >= 3
 PyBufferProcs buffer_procs = {
-// TODO: needs implemented for python3
-//	buffer_readproc, // read buffer
-//	buffer_readproc, // write buffer ( they are both the same )
-//	buffer_seg_count,
-//	(charbufferproc)buffer_charbuffer
+	buffer_getbuffer, // bf_getbuffer
+	NULL // bf_releasebuffer
 };
 #else
 PyBufferProcs buffer_procs = {
@@ -24,11 +24,15 @@
 
 #include <iostream>
 #include <string>
+#include <vector>
 
 
 #include <pynitro/nitro_pyutil.h>
 
 #include <pynitro/node.h>
+#include <pynitro/stream.h>
+#include <pynitro/aio.h>
+#include <pynitro/watch.h>
 
 using namespace std;
 using namespace Nitro;
@@ -38,9 +42,10 @@ using namespace Nitro;
 class PyRetryFunc : public Device::RetryFunc {
     private:
         PyObject* m_pyfunc;
+        PyInterpreterState* m_interp; // the function's interpreter
  
     public:
-        PyRetryFunc(PyObject* func) : RetryFunc(), m_pyfunc(func) {
+        PyRetryFunc(PyObject* func) : RetryFunc(), m_pyfunc(func), m_interp(PyThreadState_Get()->interp) {
             Py_INCREF(m_pyfunc);
         }
         ~PyRetryFunc() {
@@ -49,8 +54,18 @@ class PyRetryFunc : public Device::RetryFunc {
 
         bool operator() ( Nitro::Device &dev, uint32 term_addr, uint32 reg_addr, uint32 retries, const Exception &exc ) {
 
-            PyGILState_STATE gstate; // GIL state
-            gstate = PyGILState_Ensure();
+            // PyGILState only knows one thread state per thread.  When
+            // that isn't in the function's interpreter (Scripts workers
+            // run in sub interpreters) use a temporary thread state.
+            PyThreadState* this_ts = PyGILState_GetThisThreadState();
+            PyThreadState* tmp_ts = NULL;
+            PyGILState_STATE gstate = PyGILState_UNLOCKED; // GIL state
+            if (this_ts && this_ts->interp == m_interp) {
+                gstate = PyGILState_Ensure();
+            } else {
+                tmp_ts = PyThreadState_New ( m_interp );
+                PyEval_RestoreThread ( tmp_ts );
+            }
             // safe to call python stuff now
             
             DataType devdt(dev);
@@ -74,7 +89,12 @@ class PyRetryFunc : public Device::RetryFunc {
                Py_XDECREF(str_value);
             }
             Py_XDECREF(pyret);
-            PyGILState_Release(gstate); 
+            if (tmp_ts) {
+                PyThreadState_Clear ( tmp_ts );
+                PyThreadState_DeleteCurrent();
+            } else {
+                PyGILState_Release(gstate); 
+            }
 
             // no more python
             if (str_error)
@@ -87,7 +107,12 @@ class PyRetryFunc : public Device::RetryFunc {
 
 
 PyMethodDef nitro_Device_methods[] = {
-    {"load_xml", (PyCFunction)nitro_Device_LoadXML, METH_VARARGS, "load_xml( xml_path )" },
+    {"load_xml", (PyCFunction)nitro_Device_LoadXML, METH_VARARGS,
+        "load_xml( xml_path ) -> Device Interface Nodes\n\n"
+        "Load the file into a copy of the device interface and replace\n"
+        "the device's with it.  Nodes from an earlier get_di() still\n"
+        "belong to the old device interface and don't see the loaded\n"
+        "terminals.  Use the returned device interface instead." },
     {"write_xml", (PyCFunction)nitro_Device_WriteXML, METH_O, "write_xml ( xml_path )" },
     {"get_di", (PyCFunction)nitro_Device_GetDi, METH_NOARGS, "get_di()-> Device Interface Nodes"},
     {"set_di", (PyCFunction)nitro_Device_SetDi, METH_O, "set_di(di)" },
@@ -95,13 +120,70 @@ PyMethodDef nitro_Device_methods[] = {
     {"set_tree", (PyCFunction)nitro_Device_SetDi, METH_O, "Deprecated->Use set_di(di)" },
     {"lock", (PyCFunction)nitro_Device_Lock, METH_NOARGS, "lock()"},
     {"unlock", (PyCFunction)nitro_Device_Unlock, METH_NOARGS, "lock()"},
-    {"get", (PyCFunction)nitro_Device_Get, METH_VARARGS, "Wrapped C++ API member function" },
+    {"get", (PyCFunction)nitro_Device_Get, NITRO_METH_FASTCALL, "get(term,reg,timeout=-1,width=0)" },
     {"get_subregs", (PyCFunction)nitro_Device_GetSubregs, METH_VARARGS, "get_subregs(term,reg,timeout=None)" },
-    {"set", (PyCFunction)nitro_Device_Set, METH_VARARGS, "Wrapped C++ API member function" },
-    {"read", (PyCFunction)nitro_Device_Read, METH_VARARGS, 
+    {"set", (PyCFunction)nitro_Device_Set, NITRO_METH_FASTCALL, "set(term,reg,value,timeout=-1,width=0)" },
+    {"get_many", (PyCFunction)nitro_Device_GetMany, NITRO_METH_FASTCALL,
+        "get_many( [(term,reg),...], timeout=-1 ) -> [value,...]\n\n"
+        "Get several registers with one call.  The device is locked for\n"
+        "the whole list so other threads can't interleave." },
+    {"set_many", (PyCFunction)nitro_Device_SetMany, NITRO_METH_FASTCALL,
+        "set_many( [(term,reg,value),...], timeout=-1 )\n\n"
+        "Set several registers with one call.  The device is locked for\n"
+        "the whole list.  Registers before a failing one stay set." },
+    {"read", (PyCFunction)nitro_Device_Read, NITRO_METH_FASTCALL, 
         "read( term, reg, data, timeout=1000 )\n"
         "\tdata can be either string or array data." },
-    {"write", (PyCFunction)nitro_Device_Write, METH_VARARGS, "Wrapped C++ API member function" },
+    {"write", (PyCFunction)nitro_Device_Write, NITRO_METH_FASTCALL, "write( term, reg, data, timeout=1000 )" },
+    {"stream", (PyCFunction)nitro_Device_Stream, METH_VARARGS|METH_KEYWORDS,
+        "stream( term, reg, shape, dtype='B', buffers=4, count=-1, timeout=1000 ) -> ReadStream\n\n"
+        "Iterate over frames read from a pipe register.  A reader thread\n"
+        "fills a pool of buffers frames in advance without holding the GIL.\n\n"
+        "shape: int or tuple giving the frame dimensions.\n"
+        "dtype: struct format character or numpy.dtype of the frame items.\n"
+        "buffers: number of frame buffers in the pool.\n"
+        "count: number of frames to read, -1 reads until close().\n\n"
+        "Each frame supports the buffer protocol.  numpy.asarray(frame)\n"
+        "uses the frame memory without a copy.  A buffer is reused once the\n"
+        "frame and arrays made from it are released, so holding every frame\n"
+        "stalls the reader." },
+#if PY_MAJOR_VERSION >= 3
+    {"get_async", (PyCFunction)nitro_Device_GetAsync, NITRO_METH_FASTCALL,
+        "get_async(term,reg,timeout=-1,width=0) -> asyncio.Future\n\n"
+        "Awaitable get.  Transfers queued by the *_async methods run in\n"
+        "order on an I/O thread of the device without blocking the loop." },
+    {"set_async", (PyCFunction)nitro_Device_SetAsync, NITRO_METH_FASTCALL,
+        "set_async(term,reg,value,timeout=-1,width=0) -> asyncio.Future" },
+    {"read_async", (PyCFunction)nitro_Device_ReadAsync, NITRO_METH_FASTCALL,
+        "read_async( term, reg, data, timeout=1000 ) -> asyncio.Future\n"
+        "\tdata must be a writable buffer such as a bytearray.  It is\n"
+        "\tfilled when the future completes." },
+    {"write_async", (PyCFunction)nitro_Device_WriteAsync, NITRO_METH_FASTCALL,
+        "write_async( term, reg, data, timeout=1000 ) -> asyncio.Future" },
+#endif
+    {"watch", (PyCFunction)nitro_Device_Watch, METH_VARARGS|METH_KEYWORDS,
+        "watch( term, reg, func, interval=100, on_change=True, on_error=None ) -> id\n\n"
+        "Poll a register every interval ms on the device's watch thread.\n"
+        "One thread serves every watch of the device.  Due watches are\n"
+        "read together and adjacent registers with one transfer.\n\n"
+        "func(value) is called with each new value, or every poll when\n"
+        "on_change is False.  It runs on the watch thread.  Return False\n"
+        "to remove the watch.  An exception is printed and removes it.\n"
+        "on_error(exc) is called with the nitro.Exception of a failed\n"
+        "poll.  Without it failed polls are skipped." },
+    {"unwatch", (PyCFunction)nitro_Device_Unwatch, METH_O,
+        "unwatch(id)\n\n"
+        "Remove a watch.  Its callbacks aren't called once this returns." },
+    {"unwatch_all", (PyCFunction)nitro_Device_UnwatchAll, METH_NOARGS, "unwatch_all()" },
+    {"wait_until", (PyCFunction)nitro_Device_WaitUntil, METH_VARARGS|METH_KEYWORDS,
+        "wait_until( term, reg, pred, timeout=0, interval=10 ) -> value\n\n"
+        "Block until pred(value) is true for a polled value and return it.\n"
+        "Waits share the watch thread polls.  timeout is in ms, 0 waits\n"
+        "forever.  Raises nitro.Exception with DEVICE_TIMEOUT in time." },
+    {"cancel", (PyCFunction)nitro_Device_Cancel, METH_O,
+        "cancel(term)\n\n"
+        "Abort a read or write in progress on term from another thread.\n"
+        "The aborted call raises nitro.Exception with DEVICE_CANCELLED." },
     {"close", (PyCFunction)nitro_Device_Close, METH_NOARGS, "Wrapped C++ API member function" },
     {"enable_mode",(PyCFunction)nitro_Device_EnableMode, METH_VARARGS, "enable_mode(mode,term=None)" },
     {"disable_mode",(PyCFunction)nitro_Device_DisableMode, METH_VARARGS, "disable_mode(mode,term=None)" },
@@ -116,6 +198,13 @@ PyMethodDef nitro_Device_methods[] = {
         "retries: Number of times retried so far.\n"
         "exc: The exception that occurred."},
     {"set_timeout",(PyCFunction)nitro_Device_SetTimeout, METH_O, "set_timeout(timeout)" },
+    {"io_stats",(PyCFunction)nitro_Device_IoStats, METH_VARARGS,
+        "io_stats(cls=IO_REGISTER) -> dict\n\n"
+        "Latency of the get/set/read/write calls of an io class since the\n"
+        "device was created or reset_io_stats was called.  Keys count,\n"
+        "total, max, mean, p50, p90 and p99.  Times are in seconds.\n"
+        "Percentiles are rounded up to a power of 2 microseconds." },
+    {"reset_io_stats",(PyCFunction)nitro_Device_ResetIoStats, METH_NOARGS, "reset_io_stats()" },
     {NULL}
 };
 
@@ -125,6 +214,7 @@ nitro_Device_new ( PyTypeObject* type, PyObject *args, PyObject *kwds ) {
     nitro_DeviceObject *self = (nitro_DeviceObject*)type->tp_alloc(type,0);
     if (self != NULL) {
         self->nitro_device = NULL;
+        self->aio = NULL;
         if (self->retry_func) {
             self->retry_func = NULL;
         }
@@ -134,6 +224,13 @@ nitro_Device_new ( PyTypeObject* type, PyObject *args, PyObject *kwds ) {
 }
 
 static void nitro_Device_dealloc (nitro_DeviceObject* self) {
+    nitro_Device_StopAio(self);
+    if (self->nitro_device) {
+        // watch callbacks need the GIL to finish
+        Py_BEGIN_ALLOW_THREADS
+        self->nitro_device->unwatch_all();
+        Py_END_ALLOW_THREADS
+    }
     if (self->retry_func) {
         delete self->retry_func;
     }
@@ -297,14 +394,60 @@ PyObject* nitro_Device_Unlock(nitro_DeviceObject* self) {
 
 
 
-PyObject* nitro_Device_Get(nitro_DeviceObject* self, PyObject* args) {
+// argument helpers for the NITRO_FASTCALL_ARGS methods
+
+bool check_nargs ( const char* usage, Py_ssize_t nargs, Py_ssize_t min, Py_ssize_t max ) {
+    if (nargs >= min && nargs <= max) return true;
+    PyErr_SetString ( PyExc_TypeError, usage );
+    return false;
+}
+
+// same conversion as the "I" format
+bool to_uint32 ( PyObject* obj, uint32& val ) {
+    val = (uint32) PyLong_AsUnsignedLongMask(obj);
+    return !(val == (uint32)-1 && PyErr_Occurred());
+}
+
+// converts a sequence of width length tuples to a flat list
+static bool to_batch ( PyObject* items, Py_ssize_t width, const char* usage, vector<DataType>& out ) {
+    PyObject* seq = PySequence_Fast ( items, usage );
+    if (!seq) return false;
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+    out.reserve ( n*width );
+    for (Py_ssize_t i=0;i<n;++i) {
+        PyObject* item = PySequence_Fast ( PySequence_Fast_GET_ITEM(seq,i), usage );
+        if (!item) {
+            Py_DECREF(seq);
+            return false;
+        }
+        bool ok = PySequence_Fast_GET_SIZE(item) == width;
+        if (!ok) PyErr_SetString ( PyExc_TypeError, usage );
+        for (Py_ssize_t j=0;ok && j<width;++j) {
+            out.push_back ( DataType(0) );
+            ok = to_datatype ( PySequence_Fast_GET_ITEM(item,j), &out.back() ) != 0;
+        }
+        Py_DECREF(item);
+        if (!ok) {
+            Py_DECREF(seq);
+            return false;
+        }
+    }
+    Py_DECREF(seq);
+    return true;
+}
+
+PyObject* nitro_Device_Get(nitro_DeviceObject* self, NITRO_FASTCALL_ARGS) {
+      NITRO_FASTCALL_UNPACK
       CHECK_ABSTRACT();
       DataType term(0);
       DataType reg(0);
-      int32 timeout=-1;
+      uint32 timeout=(uint32)-1;
       uint32 width=0;
-      PyObject obj1, obj2;
-      if (!PyArg_ParseTuple ( args, "O&O&|II", to_datatype, &term, to_datatype, &reg, &timeout, &width ) ) {
+      if (!check_nargs ( "get(term,reg,timeout=-1,width=0)", nargs, 2, 4 ) ||
+          !to_datatype ( args[0], &term ) ||
+          !to_datatype ( args[1], &reg ) ||
+          (nargs > 2 && !to_uint32 ( args[2], timeout )) ||
+          (nargs > 3 && !to_uint32 ( args[3], width )) ) {
         return NULL;
       }
 
@@ -312,7 +455,7 @@ PyObject* nitro_Device_Get(nitro_DeviceObject* self, PyObject* args) {
       Exception* saveme=NULL;
       Py_BEGIN_ALLOW_THREADS
       try {
-        ret = self->nitro_device->get (term,reg,timeout, width);
+        ret = self->nitro_device->get (term,reg,(int32)timeout, width);
       } catch (const Exception& e) {
 	   // can't use NITRO_EXC here.
        saveme=new Exception(e);
@@ -359,22 +502,28 @@ PyObject* nitro_Device_GetSubregs(nitro_DeviceObject* self, PyObject* args) {
 
 }
 
-PyObject* nitro_Device_Set(nitro_DeviceObject* self, PyObject *args) {
+PyObject* nitro_Device_Set(nitro_DeviceObject* self, NITRO_FASTCALL_ARGS) {
+    NITRO_FASTCALL_UNPACK
     CHECK_ABSTRACT();
 
     DataType term(0);
     DataType reg(0);
     DataType val(0);
-    int32 timeout=-1;
-    int32 width=0;
-    if (!PyArg_ParseTuple ( args, "O&O&O&|II", to_datatype, &term, to_datatype, &reg, to_datatype, &val, &timeout, &width ) ) {
+    uint32 timeout=(uint32)-1;
+    uint32 width=0;
+    if (!check_nargs ( "set(term,reg,value,timeout=-1,width=0)", nargs, 3, 5 ) ||
+        !to_datatype ( args[0], &term ) ||
+        !to_datatype ( args[1], &reg ) ||
+        !to_datatype ( args[2], &val ) ||
+        (nargs > 3 && !to_uint32 ( args[3], timeout )) ||
+        (nargs > 4 && !to_uint32 ( args[4], width )) ) {
         return NULL;
     }
     
     Exception* saveme=NULL;
     Py_BEGIN_ALLOW_THREADS
     try {
-      self->nitro_device->set(term,reg,val,timeout,width);
+      self->nitro_device->set(term,reg,val,(int32)timeout,width);
 
     } catch (const Exception& e) {
         saveme=new Exception(e);
@@ -389,8 +538,87 @@ PyObject* nitro_Device_Set(nitro_DeviceObject* self, PyObject *args) {
     Py_RETURN_NONE;
 }
 
-PyObject* nitro_Device_Read(nitro_DeviceObject* self, PyObject *args) {
+PyObject* nitro_Device_GetMany(nitro_DeviceObject* self, NITRO_FASTCALL_ARGS) {
+    NITRO_FASTCALL_UNPACK
+    CHECK_ABSTRACT();
+
+    uint32 timeout=(uint32)-1;
+    vector<DataType> addrs; // term,reg pairs
+    if (!check_nargs ( "get_many(items,timeout=-1)", nargs, 1, 2 ) ||
+        (nargs > 1 && !to_uint32 ( args[1], timeout )) ||
+        !to_batch ( args[0], 2, "get_many items must be (term,reg) sequences", addrs )) {
+        return NULL;
+    }
+
+    size_t n = addrs.size()/2;
+    vector<DataType> values ( n, DataType(0) );
+    Exception* saveme=NULL;
+    Py_BEGIN_ALLOW_THREADS
+    self->nitro_device->lock();
+    try {
+        for (size_t i=0;i<n;++i) {
+            values[i] = self->nitro_device->get ( addrs[2*i], addrs[2*i+1], (int32)timeout );
+        }
+    } catch (const Exception& e) {
+        saveme=new Exception(e);
+    }
+    self->nitro_device->unlock();
+    Py_END_ALLOW_THREADS
+
+    if (saveme) {
+        SET_NITRO_EXC(*saveme);
+        delete saveme;
+        return NULL;
+    }
+
+    PyObject* ret = PyList_New ( n );
+    if (!ret) return NULL;
+    for (size_t i=0;i<n;++i) {
+        PyObject* val = from_datatype ( values[i] );
+        if (!val) {
+            Py_DECREF(ret);
+            return NULL;
+        }
+        PyList_SET_ITEM ( ret, i, val ); // steals val
+    }
+    return ret;
+}
+
+PyObject* nitro_Device_SetMany(nitro_DeviceObject* self, NITRO_FASTCALL_ARGS) {
+    NITRO_FASTCALL_UNPACK
+    CHECK_ABSTRACT();
+
+    uint32 timeout=(uint32)-1;
+    vector<DataType> items; // term,reg,value triples
+    if (!check_nargs ( "set_many(items,timeout=-1)", nargs, 1, 2 ) ||
+        (nargs > 1 && !to_uint32 ( args[1], timeout )) ||
+        !to_batch ( args[0], 3, "set_many items must be (term,reg,value) sequences", items )) {
+        return NULL;
+    }
+
+    Exception* saveme=NULL;
+    Py_BEGIN_ALLOW_THREADS
+    self->nitro_device->lock();
+    try {
+        for (size_t i=0;i<items.size();i+=3) {
+            self->nitro_device->set ( items[i], items[i+1], items[i+2], (int32)timeout );
+        }
+    } catch (const Exception& e) {
+        saveme=new Exception(e);
+    }
+    self->nitro_device->unlock();
+    Py_END_ALLOW_THREADS
+
+    if (saveme) {
+        SET_NITRO_EXC(*saveme);
+        delete saveme;
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
 
+PyObject* nitro_Device_Read(nitro_DeviceObject* self, NITRO_FASTCALL_ARGS) {
+    NITRO_FASTCALL_UNPACK
     CHECK_ABSTRACT();
 
     DataType term(0);
@@ -399,11 +627,29 @@ PyObject* nitro_Device_Read(nitro_DeviceObject* self, PyObject *args) {
     uint8* data = NULL;
     uint32 timeout=1000;
 
-    if (!PyArg_ParseTuple( args, "O&O&O|I",
-                    to_datatype, &term, to_datatype, &reg, &pydata, &timeout )) {
+    if (!check_nargs ( "read(term,reg,data,timeout=1000)", nargs, 3, 4 ) ||
+        !to_datatype ( args[0], &term ) ||
+        !to_datatype ( args[1], &reg ) ||
+        (nargs > 3 && !to_uint32 ( args[3], timeout )) ) {
         return NULL;
     }
+    pydata = args[2];
     uint32 length;
+#if PY_MAJOR_VERSION >= 3
+    Py_buffer view;
+    view.obj = NULL;
+    if (PyBytes_Check(pydata)) {
+        // filled in place for older callers
+        data = (uint8*)PyBytes_AsString(pydata);
+        length = PyBytes_Size(pydata);
+    } else if (PyObject_GetBuffer(pydata, &view, PyBUF_WRITABLE|PyBUF_C_CONTIGUOUS) == 0) {
+        data = (uint8*)view.buf;
+        length = (uint32)view.len;
+    } else {
+        PyErr_SetString(PyExc_Exception, "Data must be a string or writable contiguous buffer such as a bytearray or array object." );
+        return NULL;
+    }
+#else
     if (PyBytes_Check(pydata)) {
         data = (uint8*)PyBytes_AsString(pydata);
         length = PyBytes_Size(pydata);
@@ -419,6 +665,7 @@ PyObject* nitro_Device_Read(nitro_DeviceObject* self, PyObject *args) {
         PyErr_SetString(PyExc_Exception, "Data must be a string, single-segment buffer, or array object." );
         return NULL;
     }
+#endif
     
          
     Exception* saveme=NULL;
@@ -432,6 +679,9 @@ PyObject* nitro_Device_Read(nitro_DeviceObject* self, PyObject *args) {
             saveme=new Exception(e);
         }
     Py_END_ALLOW_THREADS
+#if PY_MAJOR_VERSION >= 3
+    if (view.obj) PyBuffer_Release(&view);
+#endif
 
     if (saveme) {
         SET_NITRO_EXC(*saveme);
@@ -441,7 +691,8 @@ PyObject* nitro_Device_Read(nitro_DeviceObject* self, PyObject *args) {
     Py_RETURN_NONE;
 
 }
-PyObject* nitro_Device_Write(nitro_DeviceObject* self, PyObject *args) {
+PyObject* nitro_Device_Write(nitro_DeviceObject* self, NITRO_FASTCALL_ARGS) {
+   NITRO_FASTCALL_UNPACK
    CHECK_ABSTRACT();
 
 
@@ -451,12 +702,24 @@ PyObject* nitro_Device_Write(nitro_DeviceObject* self, PyObject *args) {
     uint8* data = NULL;
     uint32 timeout=1000;
 
-    if (!PyArg_ParseTuple( args, "O&O&O|I",  
-                    to_datatype, &term, to_datatype, &reg, &pydata, &timeout )) {
+    if (!check_nargs ( "write(term,reg,data,timeout=1000)", nargs, 3, 4 ) ||
+        !to_datatype ( args[0], &term ) ||
+        !to_datatype ( args[1], &reg ) ||
+        (nargs > 3 && !to_uint32 ( args[3], timeout )) ) {
         return NULL;
     }
+    pydata = args[2];
 
     uint32 length;
+#if PY_MAJOR_VERSION >= 3
+    Py_buffer view;
+    if (PyObject_GetBuffer(pydata, &view, PyBUF_C_CONTIGUOUS) == -1) {
+        PyErr_SetString(PyExc_Exception, "Data must be a bytes, contiguous buffer or array object." );
+        return NULL;
+    }
+    data = (uint8*)view.buf;
+    length = (uint32)view.len;
+#else
     if (PyBytes_Check(pydata)) {
         data = (uint8*)PyBytes_AsString(pydata);
         length = PyBytes_Size(pydata);
@@ -472,6 +735,7 @@ PyObject* nitro_Device_Write(nitro_DeviceObject* self, PyObject *args) {
         PyErr_SetString(PyExc_Exception, "Data must be a string or array object." );
         return NULL;
     }
+#endif
     
          
     Exception* saveme=NULL;
@@ -485,6 +749,9 @@ PyObject* nitro_Device_Write(nitro_DeviceObject* self, PyObject *args) {
             saveme=new Exception(e);
         }
     Py_END_ALLOW_THREADS
+#if PY_MAJOR_VERSION >= 3
+    PyBuffer_Release(&view);
+#endif
 
     if (saveme) {
         SET_NITRO_EXC(*saveme);
@@ -494,6 +761,20 @@ PyObject* nitro_Device_Write(nitro_DeviceObject* self, PyObject *args) {
     Py_RETURN_NONE;
 
 }
+PyObject* nitro_Device_Cancel(nitro_DeviceObject* self, PyObject* arg) {
+
+    CHECK_ABSTRACT();
+
+    DataType term(0);
+    if (!to_datatype ( arg, &term )) return NULL;
+    try {
+        self->nitro_device->cancel ( term );
+    } catch ( const Exception& e ) {
+        NITRO_EXC(e,NULL);
+    }
+    Py_RETURN_NONE;
+}
+
 PyObject* nitro_Device_Close(nitro_DeviceObject* self) {
 
     CHECK_ABSTRACT(); 
@@ -514,8 +795,12 @@ PyObject* nitro_Device_LoadXML(nitro_DeviceObject* self, PyObject *args) {
     }
 
     try { 
-        Nitro::load_di( s, self->nitro_device->get_di() );
-        Py_RETURN_NONE;
+        // load into a copy and publish it so threads browsing or using
+        // the current tree never see a partly loaded one.
+        Nitro::NodeRef di = self->nitro_device->get_di()->clone();
+        Nitro::load_di( s, di );
+        self->nitro_device->set_di ( di );
+        return nitro_BuildNode(di);
     } catch ( const Exception &e ) {
         NITRO_EXC(e,NULL);
     }
@@ -728,6 +1013,36 @@ PyObject* nitro_Device_SetRetryFunc(nitro_DeviceObject* self, PyObject *arg) {
 
 }
 
+PyObject* nitro_Device_IoStats(nitro_DeviceObject* self, PyObject *args) {
+
+    CHECK_ABSTRACT();
+
+    uint32 c = Device::IO_REGISTER;
+    if (!PyArg_ParseTuple( args, "|I", &c )) return NULL;
+    Device::IoStats st;
+    try {
+        st = self->nitro_device->io_stats ( (Device::IO_CLASS)c );
+    } catch ( const Exception& e ) {
+        NITRO_EXC(e,NULL);
+    }
+    return Py_BuildValue ( "{s:K,s:d,s:d,s:d,s:d,s:d,s:d}",
+        "count", (unsigned long long)st.count,
+        "total", st.total,
+        "max", st.max,
+        "mean", st.mean(),
+        "p50", st.percentile(.5),
+        "p90", st.percentile(.9),
+        "p99", st.percentile(.99) );
+}
+
+PyObject* nitro_Device_ResetIoStats(nitro_DeviceObject* self) {
+
+    CHECK_ABSTRACT();
+
+    self->nitro_device->reset_io_stats();
+    Py_RETURN_NONE;
+}
+
 PyObject* nitro_Device_SetTimeout(nitro_DeviceObject* self, PyObject *arg) {
   
   CHECK_ABSTRACT();
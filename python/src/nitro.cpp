@@ -29,6 +29,7 @@
 #include <pynitro/node.h>
 #include <pynitro/xml.h>
 #include <pynitro/buffer.h>
+#include <pynitro/stream.h>
 
 #include <pynitro/nitro_pyutil.h>
 
@@ -41,6 +42,11 @@ static PyObject* nitro_LoadDi(PyObject*, PyObject*);
 
 static PyMethodDef core_methods[] = {
    {"load_di", (PyCFunction)nitro_LoadDi, METH_VARARGS, "load_di(filename) -> Load a device interface." }, 
+   {"node_dumps", (PyCFunction)nitro_NodeDumps, METH_O, "node_dumps(node) -> bytes\n\n"
+        "Serialize a node and its children in the binary device interface format." },
+   {"node_loads", (PyCFunction)nitro_NodeLoads, METH_O, "node_loads(buffer) -> node\n\n"
+        "Restore a node from node_dumps output.  Any buffer works, including\n"
+        "shared memory.  Data from any library version with the same format loads." },
    {NULL}
 };
 
@@ -103,6 +109,20 @@ init_nitro(void)
       return NULL;
 #else
       return;
+#endif
+    }
+    if (PyType_Ready(&nitro_ReadStreamType)<0) {
+#if PY_MAJOR_VERSION >= 3
+      return NULL;
+#else
+      return;
+#endif
+    }
+    if (PyType_Ready(&nitro_FrameType)<0) {
+#if PY_MAJOR_VERSION >= 3
+      return NULL;
+#else
+      return;
 #endif
     }
     if (PyType_Ready(&nitro_BufferType)<0) {
@@ -208,6 +228,10 @@ init_nitro(void)
     PyModule_AddObject(m, "XmlWriter", (PyObject*)&nitro_XmlWriterType);
     Py_INCREF(&nitro_BufferType);
     PyModule_AddObject(m, "Buffer", (PyObject*)&nitro_BufferType);
+    Py_INCREF(&nitro_ReadStreamType);
+    PyModule_AddObject(m, "ReadStream", (PyObject*)&nitro_ReadStreamType);
+    Py_INCREF(&nitro_FrameType);
+    PyModule_AddObject(m, "Frame", (PyObject*)&nitro_FrameType);
 
     PyModule_AddObject(m, "Exception", nitro_Exception );
 
@@ -219,6 +243,8 @@ init_nitro(void)
     PyModule_AddIntConstant(m, "CHECKSUM_VERIFY", Nitro::Device::CHECKSUM_VERIFY);
     PyModule_AddIntConstant(m, "RETRY_ON_FAILURE", Nitro::Device::RETRY_ON_FAILURE);
     PyModule_AddIntConstant(m, "LOG_IO", Nitro::Device::LOG_IO);
+    PyModule_AddIntConstant(m, "IO_REGISTER", Nitro::Device::IO_REGISTER);
+    PyModule_AddIntConstant(m, "IO_PIPE", Nitro::Device::IO_PIPE);
     PyModule_AddStringConstant(m, "str_version", (char*)Nitro::str_version().c_str() ); 
     PyModule_AddIntConstant(m, "version", Nitro::get_version() );
 
@@ -230,7 +256,8 @@ init_nitro(void)
     NitroCAPI[NITRO_EXCEPTION] = (void*) nitro_Exception;
     NitroCAPI[NITRO_BUILD_BUFFER] = (void*) nitro_BuildBuffer;
 
-    PyObject* capi = PyCapsule_New ( (void*) NitroCAPI , NULL, NULL );
+    // named for PyCapsule_Import in import_nitro()
+    PyObject* capi = PyCapsule_New ( (void*) NitroCAPI , "nitro._NITRO_API", NULL );
     if (capi) {
         PyModule_AddObject ( m, "_NITRO_API", capi );
     }    
@@ -274,6 +301,20 @@ static PyObject* nitro_LoadDi(PyObject* self, PyObject* arg) {
 }
 
 
+// ints from -2^31 to 2^32-1 convert like the general case below
+// without creating intermediate python objects.
+static bool long_to_uint32 ( PyObject* object, Nitro::DataType& dt ) {
+    int overflow;
+    PY_LONG_LONG v = PyLong_AsLongLongAndOverflow ( object, &overflow );
+    if (overflow || v < -0x80000000LL || v > 0xffffffffLL) return false;
+    if (v == -1 && PyErr_Occurred()) {
+        PyErr_Clear();
+        return false;
+    }
+    dt = (uint32) v;
+    return true;
+}
+
 int to_datatype(PyObject *object, void *address) {
 
 
@@ -295,6 +336,8 @@ int to_datatype(PyObject *object, void *address) {
     } else if ( PyFloat_Check ( object ) ) {
         // check float first to not loose precision
         *dt = PyFloat_AsDouble(object);
+    } else if ( PyLong_CheckExact(object) && long_to_uint32 ( object, *dt ) ) {
+        // common register addresses and values
     }else if ( PyNumber_Check(object) ) {
         PyObject* int_val = PyNumber_Long(object);
         if (NULL==int_val) {
@@ -371,7 +414,7 @@ int to_datatype(PyObject *object, void *address) {
         while ( (item = PyIter_Next ( itr )) ) {
             Nitro::DataType dt_item(0);
             if (to_datatype ( item, &dt_item ) ){
-                new_list.push_back(dt_item);
+                new_list.push_back(std::move(dt_item));
             }
             Py_DECREF(item);
         }
@@ -379,7 +422,7 @@ int to_datatype(PyObject *object, void *address) {
         if (PyErr_Occurred()) {
             return 0;
         } else {
-            *dt = new_list;
+            *dt = std::move(new_list);
         }
     } else if ( PyMapping_Check ( object ) ) {
         Nitro::NodeRef node = Nitro::Node::create("mapping");
@@ -467,8 +510,8 @@ PyObject* from_datatype(const Nitro::DataType& dt) {
             }
         case Nitro::LIST_DATA:
             {
-                std::vector<Nitro::DataType> list = dt ;
-                std::vector<Nitro::DataType>::iterator itr = list.begin();
+                const std::vector<Nitro::DataType>& list = Nitro::DataType::as_list ( dt );
+                std::vector<Nitro::DataType>::const_iterator itr = list.begin();
                 PyObject* new_list = PyList_New( list.size() );
                 int i=0;
                 while ( itr != list.end() ) {
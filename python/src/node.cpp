@@ -23,6 +23,7 @@
 
 #include <iostream>
 #include <string>
+#include <unordered_map>
 
 #include <pynitro/nitro_pyutil.h>
 
@@ -35,6 +36,8 @@ using namespace Nitro;
 #define PyUnicode_FromString   PyString_FromString
 #define PyUnicode_Check        PyString_Check
 #define PyUnicode_ConcatAndDel PyString_ConcatAndDel
+#define PyUnicode_CheckExact   PyString_CheckExact
+#define PyUnicode_InternInPlace PyString_InternInPlace
 #endif
 
 
@@ -51,11 +54,13 @@ nitro_Node_new ( PyTypeObject* type, PyObject *args, PyObject *kwds ) {
     nitro_NodeObject *self = (nitro_NodeObject*)type->tp_alloc(type,0);
 
     self->m_node = new Nitro::NodeRef();
+    self->m_children = NULL;
     return (PyObject*)self;
 }
 
 static void nitro_Node_dealloc (nitro_NodeObject* self) {
     delete self->m_node;
+    Py_XDECREF(self->m_children);
 #if PY_MAJOR_VERSION >= 3
     self->ob_base.ob_type->tp_free((PyObject*)self);
 #else
@@ -75,6 +80,7 @@ node_init_help ( nitro_NodeObject* self, PyObject *args, PyObject *kwds, NodeRef
   // one arg is a string for a node name or 
   // a cobject node ref
   *(self->m_node) = target_node;
+  Py_CLEAR(self->m_children);
   if (!PyArg_ParseTuple(args,"O|OO",&init, &arg2, &arg3)) {
     return -1;
   }
@@ -236,6 +242,7 @@ PyObject* nitro_Node_AddChild(nitro_NodeObject* self, PyObject* arg) {
     try {
         NodeRef *ref = ((nitro_NodeObject*)arg)->m_node;
         (*self->m_node)->add_child(*ref);
+        Py_CLEAR(self->m_children); // may have replaced a child
         Py_RETURN_NONE;
     } catch ( const Exception &e) {
         NITRO_EXC(e,NULL);
@@ -293,7 +300,75 @@ PyObject* nitro_Node_Attr_Items(nitro_NodeObject* self) {
     }
 }
 
+// wraps node in the python type for its node type
+static PyObject* build_typed_node ( const NodeRef& node ) {
+    PyTypeObject* type;
+    switch (node->get_type()) {
+        case Node::DEVIF: type = &nitro_DeviceInterfaceType; break;
+        case Node::TERMINAL: type = &nitro_TerminalType; break;
+        case Node::REGISTER: type = &nitro_RegisterType; break;
+        case Node::SUBREGISTER: type = &nitro_SubregisterType; break;
+        case Node::VALUEMAP: type = &nitro_ValuemapType; break;
+        default: type = &nitro_NodeType;
+    }
+    PyObject* node_obj = PyCapsule_New((void*)&node, NULL, NULL);
+    PyObject* arg = Py_BuildValue ( "(N)", node_obj );
+    PyObject* ret = PyObject_CallObject ( (PyObject*)type, arg );
+    Py_DECREF(arg);
+    return ret;
+}
+
+PyObject* nitro_NodeDumps(PyObject* module, PyObject* arg) {
+    if (!PyObject_TypeCheck(arg, &nitro_NodeType)) {
+        PyErr_SetString ( PyExc_TypeError, "node_dumps(node)" );
+        return NULL;
+    }
+    try {
+        string data = BinWriter::serialize ( *((nitro_NodeObject*)arg)->m_node );
+        return PyBytes_FromStringAndSize ( data.data(), data.size() );
+    } catch ( const Exception& e ) {
+        NITRO_EXC(e,NULL);
+    }
+}
+
+PyObject* nitro_NodeLoads(PyObject* module, PyObject* arg) {
+    Py_buffer view;
+    if (PyObject_GetBuffer ( arg, &view, PyBUF_SIMPLE ) == -1) return NULL;
+
+    NodeRef node;
+    Exception* saveme=NULL;
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        node = BinReader::deserialize ( view.buf, view.len );
+    } catch ( const Exception& e ) {
+        saveme=new Exception(e);
+    }
+    Py_END_ALLOW_THREADS
+    PyBuffer_Release(&view);
+
+    if (saveme) {
+        SET_NITRO_EXC(*saveme);
+        delete saveme;
+        return NULL;
+    }
+    return build_typed_node ( node );
+}
+
 PyObject* nitro_Node_reduce (nitro_NodeObject* self) {
+    // binary form unless an attribute can't be serialized
+    PyObject* data = nitro_NodeDumps ( NULL, (PyObject*)self );
+    if (data) {
+        PyObject* module = PyImport_ImportModule ( "_nitro" );
+        PyObject* loads = module ? PyObject_GetAttrString ( module, "node_loads" ) : NULL;
+        Py_XDECREF(module);
+        if (!loads) {
+            Py_DECREF(data);
+            return NULL;
+        }
+        return Py_BuildValue ( "N(N)", loads, data );
+    }
+    PyErr_Clear();
+
     // list  of attrs
     // and of children
     return Py_BuildValue ( "O(sNN)",
@@ -325,36 +400,56 @@ static PyMethodDef nitro_Node_Methods[] = {
 
 // *********** attr functions **************
 
-static PyObject* nitro_Node_GetAttr(PyObject* s, PyObject* attr) {
+// DI attribute keys by python attribute name.  Names are interned so
+// the string object identifies the name.  The cache holds a reference
+// to each name so the address isn't reused.  Protected by the GIL.
+static const AttrKey& attr_key ( PyObject* attr ) {
+    static std::unordered_map<PyObject*,AttrKey> keys;
+    Py_INCREF(attr);
+    PyUnicode_InternInPlace(&attr);
+    std::unordered_map<PyObject*,AttrKey>::iterator itr = keys.find(attr);
+    if (itr != keys.end()) {
+        Py_DECREF(attr);
+        return itr->second;
+    }
+    return keys.insert ( std::make_pair ( attr, AttrKey ( PyUnicode_AsUTF8(attr) ) ) ).first->second;
+}
 
-    // check for class attrs 1st
-  PyObject *tmp;
-  if (!(tmp = PyObject_GenericGetAttr(s, attr))) {
-      if (!PyErr_ExceptionMatches(PyExc_AttributeError))
-         return NULL; // some error occurred, propagate it.
-      PyErr_Clear();
-   } else {
-        // found a class attribute
-        return tmp;
-   }
+static PyObject* nitro_Node_GetAttr(PyObject* s, PyObject* attr) {
 
-   // no class attr found.  
-   nitro_NodeObject* self=(nitro_NodeObject*)s;
-   const char* a;
    if (!PyUnicode_Check(attr)) {
     PyErr_SetObject(PyExc_Exception, attr);
     return NULL;
    }
-   a=PyUnicode_AsUTF8(attr);
-
 
-   if (!strcmp(a,"name")) {
-       return Py_BuildValue("s",(*self->m_node)->get_name().c_str());
+   // check for class attrs 1st.  Node types have no instance dict so
+   // a miss in the type means a DI attribute and GenericGetAttr
+   // would only raise an AttributeError for us to clear.
+   PyTypeObject* type = Py_TYPE(s);
+   if (type->tp_dictoffset || !PyUnicode_CheckExact(attr)) {
+      PyObject *tmp;
+      if (!(tmp = PyObject_GenericGetAttr(s, attr))) {
+          if (!PyErr_ExceptionMatches(PyExc_AttributeError))
+             return NULL; // some error occurred, propagate it.
+          PyErr_Clear();
+      } else {
+          // found a class or instance attribute
+          return tmp;
+      }
+   } else if (_PyType_Lookup(type, attr)) {
+      return PyObject_GenericGetAttr(s, attr);
    }
 
+   // no class attr found.  
+   nitro_NodeObject* self=(nitro_NodeObject*)s;
+   static const AttrKey name_key ( "name" );
+
    try {
-       DataType dt = (*self->m_node)->get_attr( string(a) );
-       return from_datatype ( dt );
+       AttrKey key = PyUnicode_CheckExact(attr) ? attr_key(attr) : AttrKey(PyUnicode_AsUTF8(attr));
+       if (key == name_key) {
+           return PyUnicode_FromString((*self->m_node)->get_name().c_str());
+       }
+       return from_datatype ( (*self->m_node)->get_attr_ref( key ) );
    } catch ( const Exception &e) {
     NITRO_EXC(e,NULL);
    }
@@ -408,7 +503,25 @@ static PyObject* nitro_Node_GetItem (PyObject* s, PyObject* key) {
     try {
 
         NodeRef ref = (*self->m_node)->get_child(a);
-        return nitro_BuildNode(ref);
+
+        // reuse the wrapper from an earlier lookup while it still
+        // wraps this child.  The check catches changes made in C++
+        // or through another wrapper of this node.
+        if (self->m_children) {
+            PyObject* cached = PyDict_GetItem ( self->m_children, key );
+            if (cached && ((nitro_NodeObject*)cached)->m_node->get() == ref.get()) {
+                Py_INCREF(cached);
+                return cached;
+            }
+        } else if (!(self->m_children = PyDict_New())) {
+            return NULL;
+        }
+        PyObject* child = nitro_BuildNode(ref);
+        if (child && PyDict_SetItem ( self->m_children, key, child )) {
+            Py_DECREF(child);
+            return NULL;
+        }
+        return child;
         
     } catch (const Exception &e) {
         NITRO_EXC(e,NULL);
@@ -423,6 +536,7 @@ static int nitro_Node_SetItem(PyObject* s, PyObject* key, PyObject *v) {
     }
     const char* k = PyUnicode_AsUTF8(key);
     nitro_NodeObject* self = (nitro_NodeObject*)s;
+    Py_CLEAR(self->m_children);
     try {
         if (NULL==v) {
            // delete item
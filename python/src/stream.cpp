@@ -0,0 +1,582 @@
+/**
+ * Copyright (C) 2009 Ubixum, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ **/
+
+#include <pynitro/stream.h>
+
+#include <structmember.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <pynitro/nitro_pyutil.h>
+
+using namespace std;
+using namespace Nitro;
+
+
+/**
+ * Buffers and reader thread of a stream.  Nothing in here touches
+ * python so the reader runs without the GIL.
+ **/
+struct StreamPool {
+    Device& m_dev;
+    DataType m_term;
+    DataType m_reg;
+    uint32 m_timeout;
+    size_t m_frame_len;
+    int32 m_remaining; // frames left to read, -1 for no limit
+
+    vector<vector<uint64> > m_bufs; // uint64 keeps frames 8 byte aligned
+    deque<uint32> m_free;
+    deque<uint32> m_filled;
+    uint32 m_next_index;
+    bool m_stop;
+    bool m_done;
+    Exception* m_error;
+
+    mutex m_mutex;
+    condition_variable m_cond;
+    thread m_reader;
+
+    StreamPool ( Device& dev, const DataType& term, const DataType& reg,
+                 size_t frame_len, uint32 buffers, int32 count, uint32 timeout ) :
+        m_dev(dev), m_term(term), m_reg(reg), m_timeout(timeout),
+        m_frame_len(frame_len), m_remaining(count),
+        m_bufs(buffers, vector<uint64>((frame_len+7)/8)),
+        m_next_index(0), m_stop(false), m_done(false), m_error(NULL) {
+        for (uint32 i=0;i<buffers;++i) m_free.push_back(i);
+        m_reader = thread ( &StreamPool::run, this );
+    }
+
+    ~StreamPool() {
+        stop();
+        delete m_error;
+    }
+
+    uint8* data ( uint32 slot ) { return (uint8*)&m_bufs[slot][0]; }
+
+    void run() {
+        for (;;) {
+            uint32 slot;
+            {
+                unique_lock<mutex> lock ( m_mutex );
+                while (!m_stop && m_free.empty()) m_cond.wait ( lock );
+                if (m_stop) return;
+                if (!m_remaining) {
+                    m_done=true;
+                    m_cond.notify_all();
+                    return;
+                }
+                if (m_remaining>0) --m_remaining;
+                slot = m_free.front();
+                m_free.pop_front();
+            }
+
+            Exception* error=NULL;
+            try {
+                m_dev.read ( m_term, m_reg, data(slot), m_frame_len, m_timeout );
+            } catch ( const Exception& e ) {
+                error = new Exception(e);
+            }
+
+            lock_guard<mutex> lock ( m_mutex );
+            if (error) {
+                m_free.push_front(slot);
+                m_error=error;
+                m_done=true;
+            } else {
+                m_filled.push_back(slot);
+            }
+            m_cond.notify_all();
+            if (error) return;
+        }
+    }
+
+    /**
+     * Wait for the next filled buffer.  Call without the GIL.
+     * \return false when the stream has ended.
+     **/
+    bool next ( uint32& slot, uint32& index ) {
+        unique_lock<mutex> lock ( m_mutex );
+        while (m_filled.empty() && !m_done && !m_stop) m_cond.wait ( lock );
+        if (m_filled.empty()) return false;
+        slot = m_filled.front();
+        m_filled.pop_front();
+        index = m_next_index++;
+        return true;
+    }
+
+    void release ( uint32 slot ) {
+        lock_guard<mutex> lock ( m_mutex );
+        m_free.push_back(slot);
+        m_cond.notify_all();
+    }
+
+    /**
+     * Stop the reader and wait for a read in progress to finish.
+     * Call without the GIL.
+     **/
+    void stop() {
+        {
+            lock_guard<mutex> lock ( m_mutex );
+            m_stop=true;
+            m_cond.notify_all();
+        }
+        if (m_reader.joinable()) m_reader.join();
+    }
+};
+
+
+// ***************************** nitro.Frame *****************************
+
+static void nitro_Frame_dealloc ( nitro_FrameObject* self ) {
+    self->stream->pool->release ( self->slot );
+    Py_DECREF(self->stream);
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static int nitro_Frame_getbuffer ( PyObject* obj, Py_buffer* view, int flags ) {
+    nitro_FrameObject* self = (nitro_FrameObject*)obj;
+    nitro_ReadStreamObject* stream = self->stream;
+
+    view->obj = obj;
+    Py_INCREF(obj);
+    view->buf = stream->pool->data ( self->slot );
+    view->len = stream->pool->m_frame_len;
+    view->readonly = 0;
+    view->itemsize = stream->itemsize;
+    view->format = (flags & PyBUF_FORMAT) ? stream->format : NULL;
+    if ((flags & PyBUF_ND) == PyBUF_ND) {
+        view->ndim = stream->ndim;
+        view->shape = stream->shape;
+    } else {
+        view->ndim = 1;
+        view->shape = NULL;
+    }
+    view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? stream->strides : NULL;
+    view->suboffsets = NULL;
+    view->internal = NULL;
+    return 0;
+}
+
+static Py_ssize_t nitro_Frame_Length ( PyObject* obj ) {
+    return ((nitro_FrameObject*)obj)->stream->pool->m_frame_len;
+}
+
+static
+PySequenceMethods frame_sequence = {
+    nitro_Frame_Length, // len() is the frame size in bytes
+};
+
+#if PY_MAJOR_VERSION >= 3
+static PyBufferProcs frame_buffer_procs = {
+    nitro_Frame_getbuffer, // getbufferproc bf_getbuffer
+    NULL // releasebufferproc bf_releasebuffer
+};
+#else
+static PyBufferProcs frame_buffer_procs = {
+    NULL, NULL, NULL, NULL, // old style buffer
+    nitro_Frame_getbuffer,
+    NULL
+};
+#endif
+
+static PyMemberDef nitro_Frame_members[] = {
+    {(char*)"index", T_UINT, offsetof(nitro_FrameObject,index), READONLY, (char*)"Frame number within the stream, starting at 0." },
+    {NULL}
+};
+
+#if PY_MAJOR_VERSION >= 3
+PyTypeObject nitro_FrameType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "nitro.Frame", //const char *tp_name; For printing, in format "<module>.<name>"
+    sizeof(nitro_FrameObject), //Py_ssize_t tp_basicsize,
+    NULL, //tp_itemsize; /* For allocation */
+
+    /* Methods to implement standard operations */
+    (destructor)nitro_Frame_dealloc, //destructor tp_dealloc;
+    NULL, //printfunc tp_print;
+    NULL, //getattrfunc tp_getattr;
+    NULL, //setattrfunc tp_setattr;
+    NULL, //PyAsyncMethods *tp_as_async; formerly known as tp_compare (Python 2) or tp_reserved (Python 3)
+    NULL, //reprfunc tp_repr;
+
+    /* Method suites for standard classes */
+    NULL, //PyNumberMethods *tp_as_number;
+    &frame_sequence, //PySequenceMethods *tp_as_sequence;
+    NULL, //PyMappingMethods *tp_as_mapping;
+
+    /* More standard operations (here for binary compatibility) */
+    NULL, //hashfunc tp_hash;
+    NULL, //ternaryfunc tp_call;
+    NULL, //reprfunc tp_str;
+    NULL, //getattrofunc tp_getattro;
+    NULL, //setattrofunc tp_setattro;
+
+    /* Functions to access object as input/output buffer */
+    &frame_buffer_procs, //PyBufferProcs *tp_as_buffer;
+
+    /* Flags to define presence of optional/expanded features */
+    Py_TPFLAGS_DEFAULT, //unsigned long tp_flags;
+
+    "Frame read by a nitro.ReadStream", //const char *tp_doc; /* Documentation string */
+
+    /* call function for all accessible objects */
+    NULL, //traverseproc tp_traverse;
+
+    /* delete references to contained objects */
+    NULL, //inquiry tp_clear;
+
+    /* rich comparisons */
+    NULL, //richcmpfunc tp_richcompare;
+
+    /* weak reference enabler */
+    NULL, //Py_ssize_t tp_weaklistoffset;
+
+    /* Iterators */
+    NULL, //getiterfunc tp_iter;
+    NULL, //iternextfunc tp_iternext;
+
+    /* Attribute descriptor and subclassing stuff */
+    NULL, //struct PyMethodDef *tp_methods;
+    nitro_Frame_members, //struct PyMemberDef *tp_members;
+};
+#else
+PyTypeObject nitro_FrameType = {
+    PyObject_HEAD_INIT(NULL)
+    0,                         /*ob_size*/
+    "nitro.Frame",             /*tp_name*/
+    sizeof(nitro_FrameObject), /*tp_basicsize*/
+    0,                         /*tp_itemsize*/
+    (destructor)nitro_Frame_dealloc, /*tp_dealloc*/
+    0,                         /*tp_print*/
+    0,                         /*tp_getattr*/
+    0,                         /*tp_setattr*/
+    0,                         /*tp_compare*/
+    0,                         /*tp_repr*/
+    0,                         /*tp_as_number*/
+    &frame_sequence,           /*tp_as_sequence*/
+    0,                         /*tp_as_mapping*/
+    0,                         /*tp_hash */
+    0,                         /*tp_call*/
+    0,                         /*tp_str*/
+    0,                         /*tp_getattro*/
+    0,                         /*tp_setattro*/
+    &frame_buffer_procs,       /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT|Py_TPFLAGS_HAVE_NEWBUFFER, /*tp_flags*/
+    "Frame read by a nitro.ReadStream", /* tp_doc */
+    0,                         /* tp_traverse */
+    0,                         /* tp_clear */
+    0,                         /* tp_richcompare */
+    0,                         /* tp_weaklistoffset */
+    0,                         /* tp_iter */
+    0,                         /* tp_iternext */
+    0,                         /* tp_methods */
+    nitro_Frame_members,       /* tp_members */
+};
+#endif
+
+
+// *************************** nitro.ReadStream ***************************
+
+static void nitro_ReadStream_dealloc ( nitro_ReadStreamObject* self ) {
+    if (self->pool) {
+        // frames hold a reference to the stream so none are left.
+        Py_BEGIN_ALLOW_THREADS
+        delete self->pool;
+        Py_END_ALLOW_THREADS
+    }
+    Py_XDECREF(self->device);
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static PyObject* nitro_ReadStream_iter ( PyObject* self ) {
+    Py_INCREF(self);
+    return self;
+}
+
+static PyObject* nitro_ReadStream_next ( nitro_ReadStreamObject* self ) {
+    uint32 slot=0, index=0;
+    bool ok;
+    Py_BEGIN_ALLOW_THREADS
+    ok = self->pool->next ( slot, index );
+    Py_END_ALLOW_THREADS
+
+    if (!ok) {
+        if (self->pool->m_error) {
+            SET_NITRO_EXC(*self->pool->m_error);
+            delete self->pool->m_error;
+            self->pool->m_error=NULL;
+        }
+        return NULL; // StopIteration if no error is set
+    }
+
+    nitro_FrameObject* frame = PyObject_New ( nitro_FrameObject, &nitro_FrameType );
+    if (!frame) {
+        self->pool->release ( slot );
+        return NULL;
+    }
+    Py_INCREF(self);
+    frame->stream = self;
+    frame->slot = slot;
+    frame->index = index;
+    return (PyObject*)frame;
+}
+
+static PyObject* nitro_ReadStream_Close ( nitro_ReadStreamObject* self ) {
+    Py_BEGIN_ALLOW_THREADS
+    self->pool->stop();
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+}
+
+static PyObject* nitro_ReadStream_Enter ( nitro_ReadStreamObject* self ) {
+    Py_INCREF(self);
+    return (PyObject*)self;
+}
+
+static PyObject* nitro_ReadStream_Exit ( nitro_ReadStreamObject* self, PyObject* args ) {
+    return nitro_ReadStream_Close ( self );
+}
+
+static PyMethodDef nitro_ReadStream_methods[] = {
+    {"close", (PyCFunction)nitro_ReadStream_Close, METH_NOARGS,
+        "close()\n\n"
+        "Stop reading.  Frames already returned stay valid." },
+    {"__enter__", (PyCFunction)nitro_ReadStream_Enter, METH_NOARGS, "" },
+    {"__exit__", (PyCFunction)nitro_ReadStream_Exit, METH_VARARGS, "" },
+    {NULL}
+};
+
+#if PY_MAJOR_VERSION >= 3
+PyTypeObject nitro_ReadStreamType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "nitro.ReadStream", //const char *tp_name; For printing, in format "<module>.<name>"
+    sizeof(nitro_ReadStreamObject), //Py_ssize_t tp_basicsize,
+    NULL, //tp_itemsize; /* For allocation */
+
+    /* Methods to implement standard operations */
+    (destructor)nitro_ReadStream_dealloc, //destructor tp_dealloc;
+    NULL, //printfunc tp_print;
+    NULL, //getattrfunc tp_getattr;
+    NULL, //setattrfunc tp_setattr;
+    NULL, //PyAsyncMethods *tp_as_async; formerly known as tp_compare (Python 2) or tp_reserved (Python 3)
+    NULL, //reprfunc tp_repr;
+
+    /* Method suites for standard classes */
+    NULL, //PyNumberMethods *tp_as_number;
+    NULL, //PySequenceMethods *tp_as_sequence;
+    NULL, //PyMappingMethods *tp_as_mapping;
+
+    /* More standard operations (here for binary compatibility) */
+    NULL, //hashfunc tp_hash;
+    NULL, //ternaryfunc tp_call;
+    NULL, //reprfunc tp_str;
+    NULL, //getattrofunc tp_getattro;
+    NULL, //setattrofunc tp_setattro;
+
+    /* Functions to access object as input/output buffer */
+    NULL, //PyBufferProcs *tp_as_buffer;
+
+    /* Flags to define presence of optional/expanded features */
+    Py_TPFLAGS_DEFAULT, //unsigned long tp_flags;
+
+    "Frames read from a pipe terminal, see Device.stream()", //const char *tp_doc; /* Documentation string */
+
+    /* call function for all accessible objects */
+    NULL, //traverseproc tp_traverse;
+
+    /* delete references to contained objects */
+    NULL, //inquiry tp_clear;
+
+    /* rich comparisons */
+    NULL, //richcmpfunc tp_richcompare;
+
+    /* weak reference enabler */
+    NULL, //Py_ssize_t tp_weaklistoffset;
+
+    /* Iterators */
+    nitro_ReadStream_iter, //getiterfunc tp_iter;
+    (iternextfunc)nitro_ReadStream_next, //iternextfunc tp_iternext;
+
+    /* Attribute descriptor and subclassing stuff */
+    nitro_ReadStream_methods, //struct PyMethodDef *tp_methods;
+};
+#else
+PyTypeObject nitro_ReadStreamType = {
+    PyObject_HEAD_INIT(NULL)
+    0,                         /*ob_size*/
+    "nitro.ReadStream",        /*tp_name*/
+    sizeof(nitro_ReadStreamObject), /*tp_basicsize*/
+    0,                         /*tp_itemsize*/
+    (destructor)nitro_ReadStream_dealloc, /*tp_dealloc*/
+    0,                         /*tp_print*/
+    0,                         /*tp_getattr*/
+    0,                         /*tp_setattr*/
+    0,                         /*tp_compare*/
+    0,                         /*tp_repr*/
+    0,                         /*tp_as_number*/
+    0,                         /*tp_as_sequence*/
+    0,                         /*tp_as_mapping*/
+    0,                         /*tp_hash */
+    0,                         /*tp_call*/
+    0,                         /*tp_str*/
+    0,                         /*tp_getattro*/
+    0,                         /*tp_setattro*/
+    0,                         /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT|Py_TPFLAGS_HAVE_ITER, /*tp_flags*/
+    "Frames read from a pipe terminal, see Device.stream()", /* tp_doc */
+    0,                         /* tp_traverse */
+    0,                         /* tp_clear */
+    0,                         /* tp_richcompare */
+    0,                         /* tp_weaklistoffset */
+    nitro_ReadStream_iter,     /* tp_iter */
+    (iternextfunc)nitro_ReadStream_next, /* tp_iternext */
+    nitro_ReadStream_methods,  /* tp_methods */
+};
+#endif
+
+
+// item sizes of the struct module format characters numpy uses
+static Py_ssize_t format_itemsize ( char c ) {
+    switch (c) {
+        case 'b': case 'B': return 1;
+        case 'h': case 'H': return 2;
+        case 'i': case 'I': return 4;
+        case 'l': case 'L': return sizeof(long);
+        case 'q': case 'Q': return 8;
+        case 'f': return 4;
+        case 'd': return 8;
+        default: return 0;
+    }
+}
+
+// dtype is a format character or anything with a char attribute
+// like a numpy.dtype
+static bool parse_dtype ( PyObject* dtype, char& c ) {
+    PyObject* str;
+    if (PyObject_HasAttrString ( dtype, "char" )) {
+        str = PyObject_GetAttrString ( dtype, "char" );
+    } else {
+        Py_INCREF(dtype);
+        str = dtype;
+    }
+    if (!str) return false;
+    c = 0;
+#if PY_MAJOR_VERSION >= 3
+    if (PyUnicode_Check(str) && PyUnicode_GetLength(str) == 1)
+        c = (char)PyUnicode_ReadChar ( str, 0 );
+#else
+    if (PyBytes_Check(str) && PyBytes_Size(str) == 1)
+        c = PyBytes_AsString(str)[0];
+#endif
+    Py_DECREF(str);
+    if (!format_itemsize(c)) {
+        PyErr_SetString ( PyExc_ValueError, "dtype must be one of bBhHiIlLqQfd" );
+        return false;
+    }
+    return true;
+}
+
+static bool parse_shape ( PyObject* shape, nitro_ReadStreamObject* stream ) {
+    PyObject* seq;
+    if (PyTuple_Check(shape) || PyList_Check(shape)) {
+        Py_INCREF(shape);
+        seq = shape;
+    } else {
+        seq = Py_BuildValue ( "(O)", shape );
+        if (!seq) return false;
+    }
+    Py_ssize_t ndim = PySequence_Size(seq);
+    if (ndim < 1 || ndim > NITRO_STREAM_MAXDIM) {
+        Py_DECREF(seq);
+        PyErr_SetString ( PyExc_ValueError, "shape must have 1 to 4 dimensions" );
+        return false;
+    }
+    stream->ndim = (int)ndim;
+    for (Py_ssize_t i=0;i<ndim;++i) {
+        Py_ssize_t dim = PyLong_AsSsize_t ( PySequence_Fast_GET_ITEM ( seq, i ) );
+        if (dim < 1) {
+            Py_DECREF(seq);
+            if (!PyErr_Occurred())
+                PyErr_SetString ( PyExc_ValueError, "shape dimensions must be positive" );
+            return false;
+        }
+        stream->shape[i] = dim;
+    }
+    Py_DECREF(seq);
+
+    // c contiguous
+    Py_ssize_t stride = stream->itemsize;
+    for (int i=stream->ndim;i-- > 0;) {
+        stream->strides[i] = stride;
+        stride *= stream->shape[i];
+    }
+    return true;
+}
+
+PyObject* nitro_Device_Stream(nitro_DeviceObject* self, PyObject* args, PyObject* kwds) {
+    if (!self->nitro_device) {
+        PyErr_SetString(PyExc_Exception,"Device is abstract and cannot be uses directly.");
+        return NULL;
+    }
+
+    static const char* kwlist[] = { "term", "reg", "shape", "dtype", "buffers", "count", "timeout", NULL };
+    DataType term(0);
+    DataType reg(0);
+    PyObject* shape=NULL;
+    PyObject* dtype=NULL;
+    uint32 buffers=4;
+    int32 count=-1;
+    uint32 timeout=1000;
+    if (!PyArg_ParseTupleAndKeywords ( args, kwds, "O&O&O|OIiI", (char**)kwlist,
+            to_datatype, &term, to_datatype, &reg, &shape, &dtype, &buffers, &count, &timeout )) {
+        return NULL;
+    }
+    if (buffers < 1) {
+        PyErr_SetString ( PyExc_ValueError, "buffers must be at least 1" );
+        return NULL;
+    }
+
+    char format='B';
+    if (dtype && !parse_dtype ( dtype, format )) return NULL;
+
+    nitro_ReadStreamObject* stream = PyObject_New ( nitro_ReadStreamObject, &nitro_ReadStreamType );
+    if (!stream) return NULL;
+    stream->pool = NULL;
+    stream->device = NULL;
+    stream->format[0] = format;
+    stream->format[1] = 0;
+    stream->itemsize = format_itemsize(format);
+    if (!parse_shape ( shape, stream )) {
+        Py_DECREF(stream);
+        return NULL;
+    }
+
+    size_t frame_len = stream->itemsize;
+    for (int i=0;i<stream->ndim;++i) frame_len *= stream->shape[i];
+
+    Py_INCREF(self);
+    stream->device = (PyObject*)self;
+    stream->pool = new StreamPool ( *self->nitro_device, term, reg, frame_len, buffers, count, timeout );
+    return (PyObject*)stream;
+}
+
@@ -29,6 +29,7 @@
 
 
 #include <pynitro/nitro_pyutil.h>
+#include <pynitro/aio.h>
 
 using namespace std;
 using namespace Nitro;
@@ -49,13 +50,22 @@ PyMethodDef nitro_USBDevice_methods[] = {
     {"is_open", (PyCFunction)nitro_USBDevice_IsOpen, METH_NOARGS, "Wrapped C++ API member function" },
     {"renum", (PyCFunction)nitro_USBDevice_Renum, METH_NOARGS, "Wrapped C++ API member function" },
     {"reset", (PyCFunction)nitro_USBDevice_Reset, METH_NOARGS, "Wrapped C++ API member function" },
-    {"load_firmware", (PyCFunction)nitro_USBDevice_LoadFirmware, METH_VARARGS, "Wrapped C++ API member function" },
+    {"load_firmware", (PyCFunction)nitro_USBDevice_LoadFirmware, METH_VARARGS, "load_firmware(bytes[,force=True]) -> True if loaded, False if the device already ran the image" },
     {"get_ver", (PyCFunction)nitro_USBDevice_GetFirmwareVersion, METH_NOARGS, "Wrapped C++ API member function" },
+    {"set_pipe_throttle", (PyCFunction)nitro_USBDevice_SetPipeThrottle, METH_VARARGS,
+        "set_pipe_throttle(depth[,hold=10])\n\n"
+        "Urbs each pipe read or write keeps queued while gets and sets are\n"
+        "pending and for hold ms after.  Default 2, 0 turns it off." },
     {NULL}
 };
 
 static void nitro_USBDevice_dealloc (nitro_USBDeviceObject* self) {
+    nitro_Device_StopAio((nitro_DeviceObject*)self);
     if (!self->wrapped_dev) {
+       // watch callbacks need the GIL to finish
+       Py_BEGIN_ALLOW_THREADS
+       ((nitro_DeviceObject*)self)->nitro_device->unwatch_all();
+       Py_END_ALLOW_THREADS
        delete  ((nitro_DeviceObject*)self)->nitro_device ;
     } else {
         Py_DECREF(self->wrapped_dev);
@@ -336,7 +346,8 @@ PyObject* nitro_USBDevice_Reset(nitro_USBDeviceObject* self) {
 
 PyObject* nitro_USBDevice_LoadFirmware(nitro_USBDeviceObject* self, PyObject* args) {
     PyObject* str;
-    if (!PyArg_ParseTuple( args, "O", &str)) {
+    PyObject* force=Py_True;
+    if (!PyArg_ParseTuple( args, "O|O", &str, &force)) {
         return NULL;
     }
     if (!PyBytes_Check(str)) {
@@ -345,11 +356,22 @@ PyObject* nitro_USBDevice_LoadFirmware(nitro_USBDeviceObject* self, PyObject* ar
     }
     const char* firmware = PyBytes_AsString(str);
     int length = PyBytes_Size(str);
+    int f = PyObject_IsTrue(force);
+    if (f<0) return NULL;
     try {
-       ((USBDevice*)self->dev_base.nitro_device)->load_firmware ( firmware, length ); 
+       bool loaded = ((USBDevice*)self->dev_base.nitro_device)->load_firmware ( firmware, length, f ); 
+       return PyBool_FromLong(loaded);
     } catch ( const Exception &e) {
         NITRO_EXC(e,NULL);
     }
+}
+
+PyObject* nitro_USBDevice_SetPipeThrottle(nitro_USBDeviceObject* self, PyObject* args) {
+    uint32 depth, hold=10;
+    if (!PyArg_ParseTuple( args, "I|I", &depth, &hold )) {
+        return NULL;
+    }
+    ((USBDevice*)self->dev_base.nitro_device)->set_pipe_throttle ( depth, hold );
     Py_RETURN_NONE;
 }
 
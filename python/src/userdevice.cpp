@@ -32,7 +32,14 @@ using namespace Nitro;
 
 static int
 nitro_UserDevice_init(nitro_UserDeviceObject* self, PyObject *args, PyObject *kwds) {
-    if ( nitro_DeviceType.tp_init((PyObject*)self, args, kwds) < 0) {
+    // the base init takes no arguments
+    PyObject *ar, *kw;
+    ar = PyTuple_New(0);
+    kw = PyDict_New();
+    int ret = nitro_DeviceType.tp_init((PyObject*)self, ar, kw);
+    Py_DECREF(ar);
+    Py_DECREF(kw);
+    if (ret < 0) {
         return -1;
     }
 
@@ -0,0 +1,280 @@
+/**
+ * Copyright (C) 2009 Ubixum, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ **/
+
+#include <pynitro/watch.h>
+
+#include <pynitro/nitro_pyutil.h>
+
+#include <memory>
+
+using namespace std;
+using namespace Nitro;
+
+
+/**
+ * Holds the GIL while a nitro thread calls python.  PyGILState only
+ * knows one thread state per thread.  When that isn't in the
+ * callback's interpreter (Scripts workers run in sub interpreters) a
+ * temporary thread state is used, as in PyRetryFunc.
+ **/
+class CallbackLock {
+    private:
+        PyThreadState* m_tmp_ts;
+        PyGILState_STATE m_gstate;
+    public:
+        CallbackLock ( PyInterpreterState* interp ) : m_tmp_ts(NULL), m_gstate(PyGILState_UNLOCKED) {
+            PyThreadState* this_ts = PyGILState_GetThisThreadState();
+            if (this_ts && this_ts->interp == interp) {
+                m_gstate = PyGILState_Ensure();
+            } else {
+                m_tmp_ts = PyThreadState_New ( interp );
+                PyEval_RestoreThread ( m_tmp_ts );
+            }
+        }
+        ~CallbackLock() {
+            if (m_tmp_ts) {
+                PyThreadState_Clear ( m_tmp_ts );
+                PyThreadState_DeleteCurrent();
+            } else {
+                PyGILState_Release ( m_gstate );
+            }
+        }
+};
+
+
+/**
+ * A python callable shared by the copies of a watch callback.  The
+ * last reference must be dropped without the GIL: by the watch thread
+ * or inside Py_BEGIN_ALLOW_THREADS.
+ **/
+struct PyCallback {
+    PyObject* m_func;
+    PyInterpreterState* m_interp;
+
+    // requires the GIL
+    PyCallback ( PyObject* func ) : m_func(func), m_interp(PyThreadState_Get()->interp) {
+        Py_INCREF(m_func);
+    }
+
+    ~PyCallback() {
+        CallbackLock lock ( m_interp );
+        Py_DECREF(m_func);
+    }
+};
+typedef shared_ptr<PyCallback> PyCallbackRef;
+
+
+// func(value).  A None result keeps the watch.  Errors are reported
+// and remove the watch.
+struct WatchCallback {
+    PyCallbackRef m_cb;
+    WatchCallback ( PyCallbackRef cb ) : m_cb(cb) {}
+    bool operator() ( const DataType& value ) {
+        CallbackLock lock ( m_cb->m_interp );
+        PyObject* ret = PyObject_CallFunction ( m_cb->m_func, "N", from_datatype(value) );
+        if (!ret) {
+            PyErr_WriteUnraisable ( m_cb->m_func );
+            return false;
+        }
+        int keep = ret == Py_None ? 1 : PyObject_IsTrue ( ret );
+        Py_DECREF(ret);
+        if (keep < 0) {
+            PyErr_WriteUnraisable ( m_cb->m_func );
+            return false;
+        }
+        return keep != 0;
+    }
+};
+
+
+// on_error(nitro.Exception) for a failed poll
+struct WatchErrorCallback {
+    PyCallbackRef m_cb;
+    WatchErrorCallback ( PyCallbackRef cb ) : m_cb(cb) {}
+    bool operator() ( const Exception& e ) {
+        CallbackLock lock ( m_cb->m_interp );
+        PyObject* exc = PyObject_CallFunction ( nitro_Exception, "isN", e.code(), e.str_error().c_str(), from_datatype(e.userdata()) );
+        PyObject* ret = exc ? PyObject_CallFunctionObjArgs ( m_cb->m_func, exc, NULL ) : NULL;
+        Py_XDECREF(exc);
+        if (!ret) {
+            PyErr_WriteUnraisable ( m_cb->m_func );
+            return false;
+        }
+        int keep = ret == Py_None ? 1 : PyObject_IsTrue ( ret );
+        Py_DECREF(ret);
+        if (keep < 0) {
+            PyErr_WriteUnraisable ( m_cb->m_func );
+            return false;
+        }
+        return keep != 0;
+    }
+};
+
+
+/**
+ * An error raised by a wait_until predicate.  Kept so the original
+ * python exception is raised by wait_until.
+ **/
+struct PredError {
+    PyObject* m_type;
+    PyObject* m_value;
+    PyObject* m_tb;
+    PredError() : m_type(NULL), m_value(NULL), m_tb(NULL) {}
+};
+
+// pred(value) -> truth
+struct WaitPredicate {
+    PyCallbackRef m_cb;
+    shared_ptr<PredError> m_err;
+    WaitPredicate ( PyCallbackRef cb, shared_ptr<PredError> err ) : m_cb(cb), m_err(err) {}
+    bool operator() ( const DataType& value ) {
+        CallbackLock lock ( m_cb->m_interp );
+        PyObject* ret = PyObject_CallFunction ( m_cb->m_func, "N", from_datatype(value) );
+        int ok = ret ? PyObject_IsTrue ( ret ) : -1;
+        Py_XDECREF(ret);
+        if (ok < 0) {
+            PyErr_Fetch ( &m_err->m_type, &m_err->m_value, &m_err->m_tb );
+            throw Exception ( SCRIPTS_SCRIPT, "wait_until predicate raised an exception." );
+        }
+        return ok != 0;
+    }
+};
+
+
+PyObject* nitro_Device_Watch(nitro_DeviceObject* self, PyObject* args, PyObject* kwds) {
+    if (!self->nitro_device) {
+        PyErr_SetString(PyExc_Exception,"Device is abstract and cannot be uses directly.");
+        return NULL;
+    }
+
+    static const char* kwlist[] = { "term", "reg", "func", "interval", "on_change", "on_error", NULL };
+    DataType term(0);
+    DataType reg(0);
+    PyObject* func=NULL;
+    uint32 interval=100;
+    PyObject* on_change=Py_True;
+    PyObject* on_error=Py_None;
+    if (!PyArg_ParseTupleAndKeywords ( args, kwds, "O&O&O|IOO", (char**)kwlist,
+            to_datatype, &term, to_datatype, &reg, &func, &interval, &on_change, &on_error )) {
+        return NULL;
+    }
+    if (!PyCallable_Check(func) || (on_error != Py_None && !PyCallable_Check(on_error))) {
+        PyErr_SetString ( PyExc_TypeError, "watch callbacks must be callable" );
+        return NULL;
+    }
+    int changes = PyObject_IsTrue ( on_change );
+    if (changes < 0) return NULL;
+
+    Device::WatchFunc* cb = new Device::WatchFunc ( WatchCallback ( PyCallbackRef ( new PyCallback ( func ) ) ) );
+    Device::WatchErrorFunc* err_cb = new Device::WatchErrorFunc();
+    if (on_error != Py_None) *err_cb = WatchErrorCallback ( PyCallbackRef ( new PyCallback ( on_error ) ) );
+
+    uint32 id=0;
+    Exception* saveme=NULL;
+    Py_BEGIN_ALLOW_THREADS
+        try {
+            id = self->nitro_device->watch ( term, reg, *cb, interval, changes != 0, *err_cb );
+        } catch ( const Exception& e ) {
+            saveme=new Exception(e);
+        }
+        // the callbacks are released without the GIL
+        delete cb;
+        delete err_cb;
+    Py_END_ALLOW_THREADS
+
+    if (saveme) {
+        SET_NITRO_EXC(*saveme);
+        delete saveme;
+        return NULL;
+    }
+    return Py_BuildValue ( "I", id );
+}
+
+PyObject* nitro_Device_Unwatch(nitro_DeviceObject* self, PyObject* arg) {
+    if (!self->nitro_device) {
+        PyErr_SetString(PyExc_Exception,"Device is abstract and cannot be uses directly.");
+        return NULL;
+    }
+    unsigned long id = PyLong_AsUnsignedLong ( arg );
+    if (PyErr_Occurred()) return NULL;
+
+    // waits for a poll in progress, which may need the GIL
+    Py_BEGIN_ALLOW_THREADS
+    self->nitro_device->unwatch ( (uint32)id );
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+}
+
+PyObject* nitro_Device_UnwatchAll(nitro_DeviceObject* self) {
+    if (!self->nitro_device) {
+        PyErr_SetString(PyExc_Exception,"Device is abstract and cannot be uses directly.");
+        return NULL;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    self->nitro_device->unwatch_all();
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+}
+
+PyObject* nitro_Device_WaitUntil(nitro_DeviceObject* self, PyObject* args, PyObject* kwds) {
+    if (!self->nitro_device) {
+        PyErr_SetString(PyExc_Exception,"Device is abstract and cannot be uses directly.");
+        return NULL;
+    }
+
+    static const char* kwlist[] = { "term", "reg", "pred", "timeout", "interval", NULL };
+    DataType term(0);
+    DataType reg(0);
+    PyObject* pred=NULL;
+    uint32 timeout=0;
+    uint32 interval=10;
+    if (!PyArg_ParseTupleAndKeywords ( args, kwds, "O&O&O|II", (char**)kwlist,
+            to_datatype, &term, to_datatype, &reg, &pred, &timeout, &interval )) {
+        return NULL;
+    }
+    if (!PyCallable_Check(pred)) {
+        PyErr_SetString ( PyExc_TypeError, "pred must be callable" );
+        return NULL;
+    }
+
+    shared_ptr<PredError> pred_err ( new PredError );
+    function<bool(const DataType&)>* p = new function<bool(const DataType&)> ( WaitPredicate ( PyCallbackRef ( new PyCallback ( pred ) ), pred_err ) );
+
+    DataType value(0);
+    Exception* saveme=NULL;
+    Py_BEGIN_ALLOW_THREADS
+        try {
+            value = self->nitro_device->wait_until ( term, reg, *p, timeout, interval );
+        } catch ( const Exception& e ) {
+            saveme=new Exception(e);
+        }
+        delete p;
+    Py_END_ALLOW_THREADS
+
+    if (pred_err->m_type) {
+        delete saveme;
+        PyErr_Restore ( pred_err->m_type, pred_err->m_value, pred_err->m_tb );
+        return NULL;
+    }
+    if (saveme) {
+        SET_NITRO_EXC(*saveme);
+        delete saveme;
+        return NULL;
+    }
+    return from_datatype ( value );
+}
@@ -0,0 +1,82 @@
+"""
+asyncio benchmark.
+
+Compares wrapping Device.get in run_in_executor with the native
+get_async.  Each device is an in memory user device that sleeps on every
+transfer like a bus round trip.  "gather" keeps every access of a round
+in flight at once, "await" waits for each one before the next.  Each row
+is the best of a few runs.
+
+usage: python aiobench.py [rounds] [devices] [transfer us] [path to benchdev.so]
+"""
+from __future__ import print_function
+
+import asyncio
+import os
+import sys
+import time
+
+import nitro
+
+REGS = 16
+RUNS = 3
+
+
+def run(name, coro_func, devs, rounds):
+    best = None
+    for n in range(RUNS):
+        start = time.time()
+        asyncio.run(coro_func(devs, rounds))
+        secs = time.time() - start
+        if best is None or secs < best:
+            best = secs
+    ops = rounds * REGS * len(devs)
+    print("%-24s %8.2f us/reg %12.0f regs/s" % (name, best / ops * 1e6, ops / best))
+
+
+async def executor_gather(devs, rounds):
+    loop = asyncio.get_running_loop()
+    for i in range(rounds):
+        await asyncio.gather(*[loop.run_in_executor(None, dev.get, 1, r)
+                               for dev in devs for r in range(REGS)])
+
+
+async def async_gather(devs, rounds):
+    for i in range(rounds):
+        await asyncio.gather(*[dev.get_async(1, r)
+                               for dev in devs for r in range(REGS)])
+
+
+async def executor_await(devs, rounds):
+    loop = asyncio.get_running_loop()
+    for i in range(rounds):
+        for dev in devs:
+            for r in range(REGS):
+                await loop.run_in_executor(None, dev.get, 1, r)
+
+
+async def async_await(devs, rounds):
+    for i in range(rounds):
+        for dev in devs:
+            for r in range(REGS):
+                await dev.get_async(1, r)
+
+
+def main():
+    rounds = int(sys.argv[1]) if len(sys.argv) > 1 else 200
+    ndevs = int(sys.argv[2]) if len(sys.argv) > 2 else 4
+    us = sys.argv[3] if len(sys.argv) > 3 else '50'
+    path = sys.argv[4] if len(sys.argv) > 4 else \
+        os.path.join(os.path.dirname(os.path.abspath(__file__)), 'benchdev.so')
+    devs = [nitro.UserDevice(path, [us.encode()]) for i in range(ndevs)]
+    print("%d rounds of %d registers on %d devices, %s us per transfer" % (rounds, REGS, ndevs, us))
+    run("run_in_executor gather", executor_gather, devs, rounds)
+    run("get_async gather", async_gather, devs, rounds)
+    run("run_in_executor await", executor_await, devs, rounds)
+    run("get_async await", async_await, devs, rounds)
+    for dev in devs:
+        dev.close()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,83 @@
+"""
+Python binding overhead benchmark.
+
+Times get/set and get_many/set_many on an in memory user device so the
+numbers are the cost of the binding and Device rather than the bus.
+Each row is the best of a few runs.
+
+usage: python bench.py [iterations] [path to benchdev.so]
+"""
+from __future__ import print_function
+
+import os
+import sys
+import time
+
+import nitro
+
+REGS = 16
+RUNS = 3
+
+
+def run(name, func, iterations):
+    best = None
+    for n in range(RUNS):
+        start = time.time()
+        func(iterations)
+        secs = time.time() - start
+        if best is None or secs < best:
+            best = secs
+    ops = iterations * REGS
+    print("%-20s %8.2f us/reg %12.0f regs/s" % (name, best / ops * 1e6, ops / best))
+
+
+def bench(dev, iterations):
+    regs = list(range(REGS))
+
+    def set_loop(n):
+        for i in range(n):
+            for r in regs:
+                dev.set(1, r, i)
+
+    def get_loop(n):
+        for i in range(n):
+            for r in regs:
+                dev.get(1, r)
+
+    def get_args_loop(n):
+        for i in range(n):
+            for r in regs:
+                dev.get(1, r, 1000, 16)
+
+    run("set", set_loop, iterations)
+    run("get", get_loop, iterations)
+    run("get timeout,width", get_args_loop, iterations)
+
+    if hasattr(dev, 'get_many'):
+        items = [(1, r, 0) for r in regs]
+        addrs = [(1, r) for r in regs]
+
+        def set_many_loop(n):
+            for i in range(n):
+                dev.set_many(items)
+
+        def get_many_loop(n):
+            for i in range(n):
+                dev.get_many(addrs)
+
+        run("set_many", set_many_loop, iterations)
+        run("get_many", get_many_loop, iterations)
+
+
+def main():
+    iterations = int(sys.argv[1]) if len(sys.argv) > 1 else 10000
+    path = sys.argv[2] if len(sys.argv) > 2 else \
+        os.path.join(os.path.dirname(os.path.abspath(__file__)), 'benchdev.so')
+    dev = nitro.UserDevice(path)
+    print("%d iterations of %d registers" % (iterations, REGS))
+    bench(dev, iterations)
+    dev.close()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,60 @@
+// In memory user device for bench.py.  Each terminal/register address
+// holds the bytes last written to it.  An optional first argument gives
+// a delay in microseconds for every transfer, like a bus round trip.
+//
+// g++ -shared -fPIC -I../../include -o benchdev.so benchdev.cpp
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <thread>
+
+#include <nitro/types.h>
+
+#ifdef WIN32
+#define UD_API __declspec(dllexport)
+#else
+#define UD_API
+#endif
+
+typedef std::map<uint64, std::string> Memory;
+
+struct BenchDev {
+    Memory mem;
+    int delay_us;
+};
+
+static void delay ( BenchDev* dev ) {
+    if (dev->delay_us) std::this_thread::sleep_for ( std::chrono::microseconds ( dev->delay_us ) );
+}
+
+extern "C" {
+
+UD_API void* ud_init ( const char* args[], void* ud ) {
+    BenchDev* dev = new BenchDev;
+    dev->delay_us = args[0] ? atoi ( args[0] ) : 0;
+    return dev;
+}
+UD_API int ud_read( uint32 terminal_addr, uint32 reg_addr, uint8* data, size_t length, size_t* transferred, uint32 timeout, void* ud ) {
+    BenchDev* dev = (BenchDev*)ud;
+    delay ( dev );
+    const std::string& val = dev->mem[((uint64)terminal_addr<<32)|reg_addr];
+    memset ( data, 0, length );
+    memcpy ( data, val.data(), val.size() < length ? val.size() : length );
+    *transferred = length;
+    return 0;
+}
+UD_API int ud_write( uint32 terminal_addr, uint32 reg_addr, const uint8* data, size_t length, size_t* transferred, uint32 timeout, void* ud ) {
+    BenchDev* dev = (BenchDev*)ud;
+    delay ( dev );
+    dev->mem[((uint64)terminal_addr<<32)|reg_addr].assign ( (const char*)data, length );
+    *transferred = length;
+    return 0;
+}
+UD_API void ud_close(void* ud) {
+    delete (BenchDev*)ud;
+}
+
+}
@@ -0,0 +1,98 @@
+"""
+Device interface node access benchmark.
+
+Times the lookups GUIs and scripts do in tight loops: child nodes with
+di['Term']['reg'] and attributes with reg.width.  Each row is the best
+of a few runs.
+
+usage: python nodebench.py [iterations] [device interface xml]
+"""
+from __future__ import print_function
+
+import sys
+import time
+
+import nitro
+
+TERMS = 4
+REGS = 32
+RUNS = 3
+
+
+def run(name, func, iterations, per_iter):
+    best = None
+    for n in range(RUNS):
+        start = time.time()
+        func(iterations)
+        secs = time.time() - start
+        if best is None or secs < best:
+            best = secs
+    ops = iterations * per_iter
+    print("%-20s %8.3f us/op %12.0f ops/s" % (name, best / ops * 1e6, ops / best))
+
+
+def make_di():
+    di = nitro.DeviceInterface('bench')
+    for t in range(TERMS):
+        term = nitro.Terminal('Term%d' % t, addr=t, regAddrWidth=16, regDataWidth=16)
+        for r in range(REGS):
+            term.add_child(nitro.Register('reg%d' % r, addr=r, mode='write',
+                type='int', width=16, init=0, comment='register %d' % r))
+        di.add_child(term)
+    return di
+
+
+def bench(di, iterations):
+    terms = di.keys()
+    regs = [(t, r) for t in terms for r in di[t].keys()]
+    per_iter = len(regs)
+
+    def child_loop(n):
+        for i in range(n):
+            for t, r in regs:
+                di[t][r]
+
+    def attr_loop(n):
+        for i in range(n):
+            for t, r in regs:
+                di[t][r].width
+
+    def reg_attr_loop(n):
+        nodes = [di[t][r] for t, r in regs]
+        for i in range(n):
+            for reg in nodes:
+                reg.addr
+                reg.width
+                reg.mode
+
+    def name_loop(n):
+        nodes = [di[t][r] for t, r in regs]
+        for i in range(n):
+            for reg in nodes:
+                reg.name
+
+    def method_loop(n):
+        nodes = [di[t][r] for t, r in regs]
+        for i in range(n):
+            for reg in nodes:
+                reg.num_children
+
+    run("di[t][r]", child_loop, iterations, per_iter)
+    run("di[t][r].width", attr_loop, iterations, per_iter)
+    run("reg.attr", reg_attr_loop, iterations, per_iter * 3)
+    run("reg.name", name_loop, iterations, per_iter)
+    run("reg.method", method_loop, iterations, per_iter)
+
+
+def main():
+    iterations = int(sys.argv[1]) if len(sys.argv) > 1 else 1000
+    if len(sys.argv) > 2:
+        di = nitro.load_di(sys.argv[2])
+    else:
+        di = make_di()
+    print("%d iterations" % iterations)
+    bench(di, iterations)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,148 @@
+/**
+ * Copyright (C) 2009 Ubixum, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ **/
+
+#include <algorithm>
+#include <cstring>
+
+#include <nitro/bigint.h>
+#include <nitro/error.h>
+
+namespace Nitro {
+
+
+BigInt::BigInt ( uint32 value ) {
+    memset ( m_words, 0, sizeof(m_words) );
+    m_words[0] = value;
+}
+
+// value = value*mul + add, false if the value overflows
+static bool mul_add ( BigInt& value, uint32 mul, uint32 add ) {
+    uint64 carry = add;
+    for (uint32 i=0;i<BigInt::WORDS;++i) {
+        carry += (uint64) value.word(i) * mul;
+        value.set_word ( i, (uint32) carry );
+        carry >>= 32;
+    }
+    return carry == 0;
+}
+
+BigInt BigInt::parse ( const std::string& str ) {
+    size_t pos = 0;
+    uint32 base = 10;
+    if (str.size() > 1 && str[0] == '0') {
+        if (str[1] == 'x' || str[1] == 'X') { base = 16; pos = 2; }
+        else if (str[1] == 'b' || str[1] == 'B') { base = 2; pos = 2; }
+        else { base = 8; pos = 1; }
+    }
+    if (pos >= str.size()) throw Exception ( INVALID_CAST, "Invalid integer", str );
+
+    BigInt res;
+    for (;pos<str.size();++pos) {
+        char c = str[pos];
+        uint32 digit = c >= '0' && c <= '9' ? c - '0' :
+                       c >= 'a' && c <= 'f' ? c - 'a' + 10 :
+                       c >= 'A' && c <= 'F' ? c - 'A' + 10 : 16;
+        if (digit >= base) throw Exception ( INVALID_CAST, "Invalid integer", str );
+        if (!mul_add ( res, base, digit )) throw Exception ( INVALID_CAST, "Integer too large", str );
+    }
+    return res;
+}
+
+BigInt BigInt::mask ( uint32 width ) {
+    BigInt res;
+    if (width > BITS) width = BITS;
+    for (uint32 i=0;i<width/32;++i) res.m_words[i] = 0xffffffff;
+    if (width % 32) res.m_words[width/32] = (1u << (width % 32)) - 1;
+    return res;
+}
+
+uint32 BigInt::num_words() const {
+    uint32 n = WORDS;
+    while (n && !m_words[n-1]) --n;
+    return n;
+}
+
+std::string BigInt::str() const {
+    // peel off 9 decimal digits at a time
+    BigInt value ( *this );
+    uint32 n = value.num_words();
+    std::string res;
+    do {
+        uint64 rem = 0;
+        for (uint32 i=n;i-- > 0;) {
+            uint64 cur = (rem << 32) | value.m_words[i];
+            value.m_words[i] = (uint32) (cur / 1000000000);
+            rem = cur % 1000000000;
+        }
+        while (n && !value.m_words[n-1]) --n;
+        for (int d=0;d<9;++d) {
+            res.push_back ( (char)('0' + rem % 10) );
+            rem /= 10;
+            if (!n && !rem) break;
+        }
+    } while (n);
+    std::reverse ( res.begin(), res.end() );
+    return res;
+}
+
+BigInt& BigInt::operator<<= ( uint32 n ) {
+    if (n >= BITS) return *this = BigInt();
+    uint32 words = n / 32, bits = n % 32;
+    for (uint32 i=WORDS;i-- > words;) {
+        uint32 w = m_words[i-words] << bits;
+        if (bits && i > words) w |= m_words[i-words-1] >> (32-bits);
+        m_words[i] = w;
+    }
+    for (uint32 i=0;i<words;++i) m_words[i] = 0;
+    return *this;
+}
+
+BigInt& BigInt::operator>>= ( uint32 n ) {
+    if (n >= BITS) return *this = BigInt();
+    uint32 words = n / 32, bits = n % 32;
+    for (uint32 i=0;i+words<WORDS;++i) {
+        uint32 w = m_words[i+words] >> bits;
+        if (bits && i+words+1 < WORDS) w |= m_words[i+words+1] << (32-bits);
+        m_words[i] = w;
+    }
+    for (uint32 i=WORDS-words;i<WORDS;++i) m_words[i] = 0;
+    return *this;
+}
+
+BigInt& BigInt::operator|= ( const BigInt& other ) {
+    for (uint32 i=0;i<WORDS;++i) m_words[i] |= other.m_words[i];
+    return *this;
+}
+
+BigInt& BigInt::operator&= ( const BigInt& other ) {
+    for (uint32 i=0;i<WORDS;++i) m_words[i] &= other.m_words[i];
+    return *this;
+}
+
+BigInt BigInt::operator~ () const {
+    BigInt res;
+    for (uint32 i=0;i<WORDS;++i) res.m_words[i] = ~m_words[i];
+    return res;
+}
+
+bool BigInt::operator== ( const BigInt& other ) const {
+    return !memcmp ( m_words, other.m_words, sizeof(m_words) );
+}
+
+
+} // end namespace
@@ -0,0 +1,38 @@
+#ifndef NITRO_BINFMT_H
+#define NITRO_BINFMT_H
+
+#include <string>
+
+#include <nitro/types.h>
+
+/**
+ * Binary device interface layout shared by BinReader and BinWriter.
+ *
+ * All integers are little endian.  Strings are a uint32 length
+ * followed by the bytes.
+ *
+ *  "NDIB"  magic
+ *  uint32  format version
+ *  uint32  library version (NITRO_VERSION)
+ *  uint32  number of dependencies
+ *    string path, uint64 content hash (one per dependency)
+ *  node    root node
+ *
+ * node:  uint8 Node::NODE_TYPE, string name,
+ *        uint32 num attrs, (string key, value)...,
+ *        uint32 num children, node...
+ * value: uint8 DATA_TYPE followed by the type payload.
+ *
+ * BinWriter::serialize produces the same layout with no dependencies.
+ **/
+
+#define NITRO_BIN_MAGIC "NDIB"
+#define NITRO_BIN_FORMAT 1
+
+/**
+ * FNV-1a hash of a file's contents.
+ * \return false if the file can't be read.
+ **/
+bool bin_file_hash ( const std::string& path, uint64& hash );
+
+#endif
@@ -0,0 +1,242 @@
+/**
+ * Copyright (C) 2009 Ubixum, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ **/
+
+#include <cstring>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include <nitro/binreader.h>
+#include <nitro/bigint.h>
+#include <nitro/node.h>
+#include <nitro/error.h>
+#include <nitro/version.h>
+
+#include "binfmt.h"
+
+#ifdef DEBUG_BIN
+#define debug(x) std::cout << x << " (" __FILE__ ":" << __LINE__ << ")" << std::endl;
+#else
+#define debug(x)
+#endif
+
+using namespace std;
+
+namespace Nitro {
+
+
+struct BinReader::impl {
+    string m_path;
+    bool m_check_deps;
+    bool m_check_version; // reject files from other library versions
+
+    vector<char> m_data; // file contents
+
+    // read cursor into m_data or the buffer passed to deserialize
+    const char* m_buf;
+    size_t m_len;
+    size_t m_pos;
+
+    impl(const string& path, bool check_deps) : m_path(path), m_check_deps(check_deps), m_check_version(true), m_buf(NULL), m_len(0), m_pos(0) {}
+
+    void need ( size_t n ) {
+        if (m_len - m_pos < n) throw Exception ( BIN_FORMAT, "Unexpected end of file " + m_path );
+    }
+    uint8 get8 () {
+        need(1);
+        return (uint8)m_buf[m_pos++];
+    }
+    uint32 get32 () {
+        need(4);
+        const uint8* p = (const uint8*)&m_buf[m_pos];
+        m_pos += 4;
+        return p[0] | (p[1]<<8) | (p[2]<<16) | ((uint32)p[3]<<24);
+    }
+    uint64 get64 () {
+        uint64 lo = get32();
+        return lo | ((uint64)get32() << 32);
+    }
+    string get_str () {
+        uint32 len = get32();
+        need(len);
+        string s ( m_buf+m_pos, len );
+        m_pos += len;
+        return s;
+    }
+    void get_header ();
+    DataType get_value ();
+    NodeRef create_node ( uint8 type, const string& name );
+    NodeRef get_node ( vector<NodeRef>* detached=NULL );
+};
+
+void BinReader::impl::get_header() {
+    need(4);
+    if (memcmp ( m_buf, NITRO_BIN_MAGIC, 4 ))
+        throw Exception ( BIN_FORMAT, m_path + " is not a binary device interface" );
+    m_pos = 4;
+    if (get32() != NITRO_BIN_FORMAT)
+        throw Exception ( BIN_STALE, "Unsupported format version" );
+    if (get32() != NITRO_VERSION && m_check_version)
+        throw Exception ( BIN_STALE, "Written by a different library version" );
+
+    uint32 ndeps = get32();
+    for (uint32 i=0;i<ndeps;++i) {
+        string dep = get_str();
+        uint64 hash = get64();
+        if (m_check_deps) {
+            uint64 cur;
+            if (!bin_file_hash ( dep, cur ) || cur != hash) {
+                debug ( "Stale dependency " << dep );
+                throw Exception ( BIN_STALE, dep + " changed" );
+            }
+        }
+    }
+}
+
+DataType BinReader::impl::get_value() {
+    uint8 type = get8();
+    switch (type) {
+        case INT_DATA:
+            return (int32) get32();
+        case UINT_DATA:
+            return get32();
+        case FLOAT_DATA:
+            {
+                uint64 bits = get64();
+                double d;
+                memcpy ( &d, &bits, sizeof(d) );
+                return d;
+            }
+        case STR_DATA:
+            return get_str();
+        case BIGINT_DATA:
+            {
+                uint32 n = get32();
+                if (n > BigInt::WORDS) throw Exception ( BIN_FORMAT, "Invalid bigint size", n );
+                BigInt bi;
+                for (uint32 i=0;i<n;++i) bi.set_word ( i, get32() );
+                get_str(); // formatted again when needed
+                return DataType ( bi );
+            }
+        case LIST_DATA:
+            {
+                uint32 n = get32();
+                need(n); // at least a type byte each
+                vector<DataType> list;
+                list.reserve(n);
+                for (uint32 i=0;i<n;++i) list.push_back ( get_value() );
+                return DataType ( std::move(list) );
+            }
+        case NODE_DATA:
+            return get_node();
+        default:
+            throw Exception ( BIN_FORMAT, "Invalid attribute type", type );
+    }
+}
+
+NodeRef BinReader::impl::create_node ( uint8 type, const string& name ) {
+    switch (type) {
+        case Node::BASENODE: return Node::create ( name );
+        case Node::DEVIF: return DeviceInterface::create ( name );
+        case Node::TERMINAL: return Terminal::create ( name );
+        case Node::REGISTER: return Register::create ( name );
+        case Node::SUBREGISTER: return Subregister::create ( name );
+        case Node::VALUEMAP: return Valuemap::create ( name );
+        default:
+            throw Exception ( BIN_FORMAT, "Invalid node type", type );
+    }
+}
+
+// if detached is set, children are returned there instead of
+// being linked to the node.
+NodeRef BinReader::impl::get_node( vector<NodeRef>* detached ) {
+    uint8 type = get8();
+    NodeRef node = create_node ( type, get_str() );
+    uint32 nattrs = get32();
+    for (uint32 i=0;i<nattrs;++i) {
+        string key = get_str();
+        node->set_attr ( key, get_value() );
+    }
+    uint32 nchildren = get32();
+    for (uint32 i=0;i<nchildren;++i) {
+        // the base class add_child skips device interface validation.
+        // Nodes were valid when written.
+        if (detached) detached->push_back ( get_node() );
+        else node->Node::add_child ( get_node() );
+    }
+    return node;
+}
+
+
+
+BinReader::BinReader(const std::string& file_path, bool check_deps) : m_impl(new impl(file_path, check_deps)) {
+}
+BinReader::~BinReader() throw() { delete m_impl;}
+
+
+void BinReader::read(NodeRef node) {
+
+    ifstream in ( m_impl->m_path.c_str(), ios::binary );
+    if (!in.good()) throw Exception ( BIN_FORMAT, "Unable to open " + m_impl->m_path );
+    in.seekg(0,ios::end);
+    streamoff len = in.tellg();
+    in.seekg(0,ios::beg);
+    m_impl->m_data.resize ( (size_t)len );
+    if (len) in.read ( &m_impl->m_data[0], len );
+    if (!in.good()) throw Exception ( BIN_FORMAT, "Unable to read " + m_impl->m_path );
+    m_impl->m_buf = m_impl->m_data.empty() ? NULL : &m_impl->m_data[0];
+    m_impl->m_len = m_impl->m_data.size();
+    m_impl->m_pos = 0;
+    m_impl->get_header();
+
+    // build the complete tree before touching node so a corrupt
+    // file leaves the destination unchanged.
+    vector<NodeRef> children;
+    NodeRef root = m_impl->get_node( &children );
+    m_impl->m_data.clear();
+    m_impl->m_buf = NULL;
+    m_impl->m_len = 0;
+
+    for (DIAttrIter itr = root->attrs_begin(); itr != root->attrs_end(); ++itr ) {
+        node->set_attr ( itr->first, itr->second );
+    }
+    for (vector<NodeRef>::iterator itr = children.begin(); itr != children.end(); ++itr ) {
+        if (node->has_child ( (*itr)->get_name() )) node->del_child ( (*itr)->get_name() );
+        node->Node::add_child ( *itr );
+    }
+}
+
+NodeRef BinReader::deserialize ( const void* data, size_t length ) {
+    impl in ( "serialized node", false );
+    // serialized nodes outlive the library that wrote them (pickles),
+    // only the layout has to match
+    in.m_check_version = false;
+    in.m_buf = (const char*)data;
+    in.m_len = length;
+    in.get_header();
+
+    // the tree is kept together like one loaded by load_di
+    NodeArena arena;
+    NodeArena::Scope scope ( arena );
+    NodeRef root = in.get_node();
+    if (in.m_pos != in.m_len) throw Exception ( BIN_FORMAT, "Trailing data after serialized node" );
+    return root;
+}
+
+} // end namespace
@@ -0,0 +1,201 @@
+/**
+ * Copyright (C) 2009 Ubixum, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ **/
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <fstream>
+#include <vector>
+
+#ifdef WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+#include <nitro/binwriter.h>
+#include <nitro/bigint.h>
+#include <nitro/node.h>
+#include <nitro/error.h>
+#include <nitro/version.h>
+
+#include "binfmt.h"
+
+
+using namespace std;
+
+bool bin_file_hash ( const string& path, uint64& hash ) {
+    ifstream in ( path.c_str(), ios::binary );
+    if (!in.good()) return false;
+    hash = 14695981039346656037ULL;
+    char buf[16384];
+    while (in.read ( buf, sizeof(buf) ) || in.gcount()) {
+        for (streamsize i=0;i<in.gcount();++i) {
+            hash ^= (uint8)buf[i];
+            hash *= 1099511628211ULL;
+        }
+    }
+    return true;
+}
+
+namespace Nitro {
+
+
+struct BinWriter::impl {
+  string m_path;
+  vector<string> m_deps;
+  string m_out; // whole file is built in memory then written once
+
+  impl ( const string& path, const vector<string>& deps ) : m_path ( path ), m_deps ( deps ) {}
+
+  void put8 ( uint8 v ) { m_out.push_back ( (char)v ); }
+  void put32 ( uint32 v ) {
+      for (int i=0;i<4;++i) put8 ( (uint8)(v >> (i*8)) );
+  }
+  void put64 ( uint64 v ) {
+      for (int i=0;i<8;++i) put8 ( (uint8)(v >> (i*8)) );
+  }
+  void put_str ( const string& s ) {
+      put32 ( (uint32)s.size() );
+      m_out.append ( s );
+  }
+  void put_header ();
+  void put_value ( const DataType& v );
+  void put_node ( const NodeRef& node );
+};
+
+void BinWriter::impl::put_header () {
+   m_out.append ( NITRO_BIN_MAGIC, 4 );
+   put32 ( NITRO_BIN_FORMAT );
+   put32 ( NITRO_VERSION );
+   put32 ( (uint32)m_deps.size() );
+   for (vector<string>::const_iterator itr = m_deps.begin(); itr != m_deps.end(); ++itr ) {
+        uint64 hash;
+        if (!bin_file_hash ( *itr, hash )) throw Exception ( BIN_FORMAT, "Unable to read dependency " + *itr );
+        put_str ( *itr );
+        put64 ( hash );
+   }
+}
+
+void BinWriter::impl::put_value ( const DataType& v ) {
+    put8 ( (uint8)v.get_type() );
+    switch ( v.get_type() ) {
+        case INT_DATA:
+        case UINT_DATA:
+            put32 ( (uint32)v );
+            break;
+        case FLOAT_DATA:
+            {
+                double d = v;
+                uint64 bits;
+                memcpy ( &bits, &d, sizeof(bits) );
+                put64 ( bits );
+            }
+            break;
+        case STR_DATA:
+            put_str ( v.str_value() );
+            break;
+        case BIGINT_DATA:
+            {
+                BigInt bi = DataType::as_bigint ( v );
+                uint32 n = bi.num_words();
+                put32 ( n );
+                for (uint32 i=0;i<n;++i) put32 ( bi.word(i) );
+                put_str ( v.str_value() );
+            }
+            break;
+        case LIST_DATA:
+            {
+                const vector<DataType>& list = DataType::as_list ( v );
+                put32 ( (uint32)list.size() );
+                for (size_t i=0;i<list.size();++i) put_value ( list[i] );
+            }
+            break;
+        case NODE_DATA:
+            put_node ( v );
+            break;
+        default:
+            throw Exception ( BIN_FORMAT, "Unsupported attribute type " + v.str_type() );
+    }
+}
+
+void BinWriter::impl::put_node ( const NodeRef& node ) {
+    put8 ( (uint8)node->get_type() );
+    put_str ( node->get_name() );
+    put32 ( node->num_attrs() );
+    for (DIAttrIter itr = node->attrs_begin(); itr != node->attrs_end(); ++itr ) {
+        put_str ( itr->first );
+        put_value ( itr->second );
+    }
+    put32 ( node->num_children() );
+    for (DITreeIter itr = node->child_begin(); itr != node->child_end(); ++itr ) {
+        put_node ( *itr );
+    }
+}
+
+
+BinWriter::BinWriter(const string& path, const vector<string>& deps) : m_impl ( new impl ( path, deps ) ) {}
+BinWriter::~BinWriter() throw () {
+    delete m_impl;
+}
+
+
+void BinWriter::write(const NodeRef& node) {
+
+   m_impl->m_out.clear();
+   m_impl->put_header();
+   m_impl->put_node ( node );
+
+   // write a temporary file and rename it so a concurrent
+   // reader never sees a partial file.  The name is unique to this
+   // process and call so concurrent writers don't share it.
+   static atomic<uint32> tmp_count(0);
+   ostringstream tmp_name;
+   tmp_name << m_impl->m_path << '.' << getpid() << '.' << tmp_count++ << ".tmp";
+   string tmp = tmp_name.str();
+   {
+       ofstream out ( tmp.c_str(), ios::binary );
+       out.write ( m_impl->m_out.data(), m_impl->m_out.size() );
+       if (!out.good()) {
+           out.close();
+           remove ( tmp.c_str() );
+           throw Exception ( BIN_FORMAT, "Unable to write " + m_impl->m_path );
+       }
+   }
+   m_impl->m_out.clear();
+   if (rename ( tmp.c_str(), m_impl->m_path.c_str() )) {
+       // windows won't rename over an existing file
+       remove ( m_impl->m_path.c_str() );
+       if (rename ( tmp.c_str(), m_impl->m_path.c_str() )) {
+           remove ( tmp.c_str() );
+           throw Exception ( BIN_FORMAT, "Unable to write " + m_impl->m_path );
+       }
+   }
+}
+
+string BinWriter::serialize ( const NodeRef& node ) {
+    impl out ( "", vector<string>() );
+    out.put_header();
+    out.put_node ( node );
+    return out.m_out;
+}
+
+} // end namespace
@@ -17,15 +17,20 @@
  **/
 
 
-#include <bitset>
 #include <string>
 #include <cstdio>
 #include <map>
 #include <memory>
 #include <algorithm>
+#include <cassert>
 #include <iostream>
 #include <cstring>
 #include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
 
 #ifdef DEBUG_DEV
 #define dev_debug(x) cout << x << " (" << __FILE__ << ':' << __LINE__ << ')' << endl;
@@ -40,6 +45,7 @@
 #endif
 
 #include <nitro/device.h>
+#include <nitro/bigint.h>
 #include <nitro/error.h>
 #include <nitro/node.h>
 
@@ -72,15 +78,37 @@ struct AddressData {
         NodeRef term_node; ///< only valid if type is != RAW
         NodeRef reg_node; ///< same
         NodeRef subreg_node; ///< only valid if type == SUBREG
+
+        /// DOUBLEGET_VERIFY applies to raw addresses and write registers
+        bool get_verify() const {
+            return type == RAW || reg_node->get_attr_ref(Attr::mode) == "write";
+        }
+        /// GETSET_VERIFY applies to raw addresses and write registers that aren't triggers
+        bool set_verify() const {
+            return type == RAW ||
+                (reg_node->get_attr_ref(Attr::type) != string("trigger") &&
+                 reg_node->get_attr_ref(Attr::mode) == string("write"));
+        }
 };
 
 
+/**
+ * Device interface published by set_di.  Snapshots are never modified
+ * once published.  Each operation loads the current snapshot once and
+ * uses it to the end so a concurrent set_di doesn't change addresses
+ * part way through a get or set.
+ **/
+struct DISnapshot {
+    NodeRef di;
+    map<uint32,shared_ptr<recursive_mutex>> rdwrmutexes; // protect normal terminals/pipes separately
+};
+typedef shared_ptr<const DISnapshot> DISnapshotRef;
+
 struct Device::impl{
     uint32 m_timeout;
     shared_ptr<recursive_mutex> m_mutex;
-    map<uint32_t,shared_ptr<recursive_mutex>> m_rdwrmutexes; // protect normal terminals/pipes separately
-                                                   // mutexes added at set_di
-    NodeRef di;
+    std::mutex m_publish; // serializes set_di, readers never take it
+    DISnapshotRef m_snap; // only accessed with atomic_load/atomic_store
     uint32 m_modes;
     map<uint32,uint32> m_term_modes;
     Device::RetryFunc *m_retry_func;
@@ -98,68 +126,150 @@ struct Device::impl{
     DefaultRetry m_default_retry;
     bool m_retry_bit;
 
-    impl(): m_timeout(1000), m_mutex(new recursive_mutex), di(DeviceInterface::create("di")), m_modes(STATUS_VERIFY), m_retry_bit(false) {
+    std::mutex m_watch_lock; // protects creating m_watch
+    struct Watch;
+    shared_ptr<Watch> m_watch; // started by the first watch
+    Watch& watcher(Device& dev);
+    bool on_watch_thread();
+
+    std::atomic<uint32> m_register_io; // IO_REGISTER calls in progress
+    mutable std::mutex m_io_lock; // protects m_io
+    IoStats m_io[IO_CLASSES];
+    struct IoCall;
+    void record_io ( IO_CLASS c, double elapsed );
+
+    impl(): m_timeout(1000), m_mutex(new recursive_mutex), m_modes(STATUS_VERIFY), m_retry_bit(false), m_register_io(0) {
         m_retry_func=&m_default_retry;
+        memset ( m_io, 0, sizeof(m_io) );
+        shared_ptr<DISnapshot> snap ( new DISnapshot );
+        snap->di = DeviceInterface::create("di");
+        m_snap = snap;
     }
 
+    DISnapshotRef snapshot() const { return atomic_load ( &m_snap ); }
+    void publish ( const NodeRef& di );
+
     uint32 get_timeout(int32 timeout);
-    uint32 term_addr( const DataType& term );
-    NodeRef find_name_or_addr( NodeRef& parent, const DataType& find);
-    uint32 reg_addr( const DataType& term, const DataType& reg );
+    uint32 term_addr( const NodeRef& di, const DataType& term );
+    NodeRef find_name_or_addr( const NodeRef& parent, const DataType& find);
+    uint32 reg_addr( const NodeRef& di, const DataType& term, const DataType& reg );
     DataType valmap_or_const_val ( NodeRef node, const DataType& val );
-    shared_ptr<recursive_mutex> mutex_for_rdwr(const DataType& addr);
-    unique_ptr<AddressData> resolve_addrs ( const DataType& term, const DataType& reg, uint32 width ) ;
-    void get_set_subreg ( bitset<1024> &bits, uint32 term_addr, uint32 reg_addr, bitset<1024> &value, uint32 offset, uint32 width, uint32 dwidth, vector<uint32> &clean_regs, int32 timeout , Device &dev);
-    DataType do_get(Device &dev, uint32 term_addr, uint32 reg_addr, AddressData &a, uint32 width, int32 timeout ); 
-    void do_set(Device &dev, uint32 term_addr, uint32 reg_addr, DataType &value, uint32 width, AddressData &a, int32 timeout);
+    shared_ptr<recursive_mutex> mutex_for_rdwr(const DISnapshot& snap, const DataType& addr);
+    unique_ptr<AddressData> resolve_addrs ( const NodeRef& di, const DataType& term, const DataType& reg, uint32 width ) ;
+    void get_set_subreg ( BigInt &bits, uint32 term_addr, uint32 reg_addr, BigInt &value, uint32 offset, uint32 width, uint32 dwidth, vector<uint32> &clean_regs, int32 timeout , Device &dev);
+    uint32 do_get(Device &dev, uint32 term_addr, uint32 reg_addr, bool verify, uint32 width, int32 timeout ); 
+    DataType build_value ( const AddressData& addrs, vector<DataType>& results );
+    void do_set(Device &dev, uint32 term_addr, uint32 reg_addr, uint32 value, uint32 width, bool verify, int32 timeout);
     void do_read(Device &dev, uint32 term_addr, uint32 reg_addr, uint8* data, size_t length, int32 timeout);
     void do_write(Device &dev, uint32 term_addr, uint32 reg_addr, const uint8* data, size_t length, int32 timeout);
     private:
-    DataType raw_get( Device &dev, uint32 term_addr, uint32 reg_addr, AddressData &a, uint32 width, uint32 timeout ); // only called by do_get
-    void raw_set ( Device &dev, uint32 term_addr, uint32 reg_addr, DataType &value, uint32 width, AddressData &a, uint32 timeout );
+    uint32 raw_get( Device &dev, uint32 term_addr, uint32 reg_addr, bool verify, uint32 width, uint32 timeout ); // only called by do_get
+    void raw_set ( Device &dev, uint32 term_addr, uint32 reg_addr, uint32 value, uint32 width, bool verify, uint32 timeout );
     void raw_write(Device &dev, uint32 term_addr, uint32 reg_addr, const uint8* data, size_t length, uint32 timeout);
     void raw_read(Device &dev, uint32 term_addr, uint32 reg_addr, uint8* data, size_t length, uint32 timeout);
     void check_status(Device &dev, uint32 term_addr);
     void check_checksum(Device &dev, uint32 term_addr, const uint8* data, size_t length );
 };
 
+/**
+ * One get/set/read/write call.  Counted as pending from the call, before
+ * it waits for a mutex, until it returns, when its latency is recorded.
+ **/
+struct Device::impl::IoCall {
+    impl& m_impl;
+    IO_CLASS m_class;
+    std::chrono::steady_clock::time_point m_start;
+
+    IoCall ( impl& i, IO_CLASS c ) : m_impl(i), m_class(c), m_start(std::chrono::steady_clock::now()) {
+        if (m_class == IO_REGISTER) ++m_impl.m_register_io;
+    }
+    ~IoCall() {
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - m_start;
+        if (m_class == IO_REGISTER) --m_impl.m_register_io;
+        m_impl.record_io ( m_class, elapsed.count() );
+    }
+};
+
+void Device::impl::record_io ( IO_CLASS c, double elapsed ) {
+    double us = elapsed * 1e6;
+    uint32 bucket = 0;
+    while (bucket < IoStats::BUCKETS-1 && us >= (double)(1ULL << bucket)) ++bucket;
+    std::lock_guard<std::mutex> lock(m_io_lock);
+    IoStats& st = m_io[c];
+    ++st.count;
+    st.total += elapsed;
+    if (elapsed > st.max) st.max = elapsed;
+    ++st.buckets[bucket];
+}
+
+double Device::IoStats::mean() const {
+    return count ? total / count : 0;
+}
+
+double Device::IoStats::percentile ( double p ) const {
+    if (!count) return 0;
+    uint64 want = (uint64)(p * count + 0.999999);
+    if (want < 1) want = 1;
+    uint64 seen = 0;
+    for (uint32 i=0;i<BUCKETS-1;++i) {
+        seen += buckets[i];
+        if (seen >= want) return std::min ( (double)(1ULL << i) / 1e6, max );
+    }
+    return max;
+}
+
 uint32 Device::impl::get_timeout ( int32 timeout ) {
     return timeout < 0 ? m_timeout : timeout ;
 }
 
-uint32 Device::impl::term_addr(const DataType& term ) {
+void Device::impl::publish ( const NodeRef& node ) {
+    std::lock_guard<std::mutex> lock ( m_publish );
+    DISnapshotRef old = snapshot();
+    shared_ptr<DISnapshot> snap ( new DISnapshot );
+    snap->di = node;
+
+    // scan terminals for pipes and set up rdwr mutexes.  A pipe that
+    // keeps its address keeps its mutex so reads still in progress on
+    // the old snapshot are serialized with reads on the new one.
+    for ( auto i =  node->child_begin(); i!=node->child_end(); ++i ) {
+        if ((*i)->has_attr("type") && (*i)->get_attr_ref(Attr::type) == "pipe") {
+            uint32 addr = (*i)->get_attr_uint(Attr::addr);
+            auto prev = old->rdwrmutexes.find(addr);
+            snap->rdwrmutexes[addr] = prev != old->rdwrmutexes.end() ? prev->second : shared_ptr<recursive_mutex>(new recursive_mutex);
+        }
+    }
+    atomic_store ( &m_snap, DISnapshotRef(snap) );
+}
+
+uint32 Device::impl::term_addr(const NodeRef& di, const DataType& term ) {
     if (STR_DATA != term.get_type()) return term;
-    return find_name_or_addr( di, term)->get_attr("addr");
+    return find_name_or_addr( di, term)->get_attr_uint(Attr::addr);
 }
-uint32 Device::impl::reg_addr( const DataType& term, const DataType& reg ) {
+uint32 Device::impl::reg_addr( const NodeRef& di, const DataType& term, const DataType& reg ) {
     if (STR_DATA != reg.get_type()) return reg;
 
     NodeRef pterm = find_name_or_addr( di, term );
-    return find_name_or_addr( pterm, reg )->get_attr("addr"); 
+    return find_name_or_addr( pterm, reg )->get_attr_uint(Attr::addr); 
 }
 
-NodeRef Device::impl::find_name_or_addr(NodeRef& parent, const DataType& find) {
+NodeRef Device::impl::find_name_or_addr(const NodeRef& parent, const DataType& find) {
     if (STR_DATA==find.get_type()) return parent->get_child(find);
-    for ( DITreeIter itr=parent->child_begin();
-          itr != parent->child_end();
-          ++itr ) {
-        if ((*itr)->get_attr("addr") == find ) return *itr;
-    }
-    throw Exception ( NODE_NOT_FOUND );
+    return parent->get_child_by_addr(find);
 }
 
 DataType Device::impl::valmap_or_const_val ( NodeRef node, const DataType& val ) {
    if ( val.get_type() != STR_DATA ) return val; // should cast as a uint32
 
    dev_debug ( "Attempt to find value from valuemap" << val );
-   NodeRef valuemap = node->get_attr ( "valuemap" );
+   NodeRef valuemap = node->get_attr_ref(Attr::valuemap);
    return valuemap->get_attr(val); 
 }
 
-shared_ptr<recursive_mutex> Device::impl::mutex_for_rdwr(const DataType &term) {
-    uint32 addr = term_addr(term);
-    if (m_rdwrmutexes.count(addr)) {
-        return m_rdwrmutexes[addr];
+shared_ptr<recursive_mutex> Device::impl::mutex_for_rdwr(const DISnapshot& snap, const DataType &term) {
+    uint32 addr = term_addr(snap.di, term);
+    auto itr = snap.rdwrmutexes.find(addr);
+    if (itr != snap.rdwrmutexes.end()) {
+        return itr->second;
     }
     return m_mutex; // just lock the dev mutex for non-pipe terminals
 }
@@ -196,7 +306,7 @@ void Device::impl::check_checksum(Device& dev, uint32 term_addr, const uint8* da
     }
 }
 
-DataType Device::impl::raw_get ( Device &dev, uint32 term_addr, uint32 reg_addr, AddressData &a, uint32 width, uint32 timeout ) {
+uint32 Device::impl::raw_get ( Device &dev, uint32 term_addr, uint32 reg_addr, bool verify, uint32 width, uint32 timeout ) {
 
 
    uint8 bytes[4]={0}; // NOTE width not ready to compile on old vs2008
@@ -211,17 +321,14 @@ DataType Device::impl::raw_get ( Device &dev, uint32 term_addr, uint32 reg_addr,
            printf ( " %02x", (uint32)bytes[i] );
        std::cout << endl;
    }
-   uint32 v=0;
-   memcpy(&v,bytes,width>4?4:width); // TODO fix bigger register widths.
-   DataType res = v; 
+   uint32 res=0;
+   memcpy(&res,bytes,width>4?4:width); // TODO fix bigger register widths.
 
    check_status(dev,term_addr);
    check_checksum(dev,term_addr, bytes, width);
 
    if ( (m_term_modes[term_addr] & DOUBLEGET_VERIFY ||
-         m_modes & DOUBLEGET_VERIFY) && 
-        (a.type == AddressData::RAW || 
-         a.reg_node->get_attr("mode") == "write" ) ) { 
+         m_modes & DOUBLEGET_VERIFY) && verify ) { 
          uint8 check[4] = {0}; // NOTE fix win32 again
          dev._read ( term_addr, reg_addr, check, width, timeout );
          uint32 res2 = 0;
@@ -271,22 +378,21 @@ DataType Device::impl::raw_get ( Device &dev, uint32 term_addr, uint32 reg_addr,
         break; \
    } while (true);
 
-DataType Device::impl::do_get (Device &dev, uint32 term_addr, uint32 reg_addr, AddressData &a, uint32 width, int32 timeout) {
+uint32 Device::impl::do_get (Device &dev, uint32 term_addr, uint32 reg_addr, bool verify, uint32 width, int32 timeout) {
 
     RETRY_LOGIC_START
-    return raw_get ( dev, term_addr, reg_addr, a, width, get_timeout(timeout) );
+    return raw_get ( dev, term_addr, reg_addr, verify, width, get_timeout(timeout) );
     RETRY_LOGIC_END
    
 }
 
-void Device::impl::raw_set( Device &dev, uint32 term_addr, uint32 reg_addr, DataType &value, uint32 width, AddressData &a, uint32 timeout ) {
+void Device::impl::raw_set( Device &dev, uint32 term_addr, uint32 reg_addr, uint32 value, uint32 width, bool verify, uint32 timeout ) {
     // TODO 
     // support _get/_set of other data types?
     uint8 buf[4];
     //if (width>4)
     //    throw Exception ( DEVICE_OP_ERROR, "Sets larger than 32 bits unsupported." );
-    uint32 val=(uint32)value;
-    memcpy(buf,&val,width); // width > 4?
+    memcpy(buf,&value,width); // width > 4?
 
 
     if (m_term_modes[term_addr] & LOG_IO || m_modes&LOG_IO) {
@@ -301,15 +407,9 @@ void Device::impl::raw_set( Device &dev, uint32 term_addr, uint32 reg_addr, Data
    //    uint32 val = value;
     check_checksum(dev,term_addr, buf, width );
    //}
-    if (
-        (m_term_modes[term_addr] & GETSET_VERIFY || 
-         m_modes & GETSET_VERIFY) && 
-        (a.type == AddressData::RAW || 
-         (a.reg_node->get_attr("type") != string("trigger") &&
-          a.reg_node->get_attr("mode") == string("write" ))
-        )
-       ) {
-         DataType v = raw_get ( dev, term_addr, reg_addr, a, width, timeout); 
+    if ( (m_term_modes[term_addr] & GETSET_VERIFY || 
+          m_modes & GETSET_VERIFY) && verify ) {
+         uint32 v = raw_get ( dev, term_addr, reg_addr, verify, width, timeout); 
          if (v != value ) {
             NodeRef exc_info = Node::create("exc_info");
             exc_info->set_attr("term",term_addr);
@@ -322,10 +422,10 @@ void Device::impl::raw_set( Device &dev, uint32 term_addr, uint32 reg_addr, Data
 
 }
 
-void Device::impl::do_set (Device &dev, uint32 term_addr, uint32 reg_addr, DataType &value, uint32 width, AddressData &a, int32 timeout) {
+void Device::impl::do_set (Device &dev, uint32 term_addr, uint32 reg_addr, uint32 value, uint32 width, bool verify, int32 timeout) {
 
    RETRY_LOGIC_START
-   raw_set ( dev, term_addr, reg_addr, value, width, a, get_timeout(timeout) );
+   raw_set ( dev, term_addr, reg_addr, value, width, verify, get_timeout(timeout) );
    RETRY_LOGIC_END   
 }
 
@@ -360,7 +460,7 @@ void Device::impl::do_write(Device &dev, uint32 term_addr, uint32 reg_addr, cons
    RETRY_LOGIC_END
 }
 
-unique_ptr<AddressData> Device::impl::resolve_addrs ( const DataType& term, const DataType& reg, uint32 data_width ) {
+unique_ptr<AddressData> Device::impl::resolve_addrs ( const NodeRef& di, const DataType& term, const DataType& reg, uint32 data_width ) {
     unique_ptr<AddressData> addrs ( new AddressData() );
 
     if ( STR_DATA != reg.get_type() ) {
@@ -369,12 +469,13 @@ unique_ptr<AddressData> Device::impl::resolve_addrs ( const DataType& term, cons
         if ( data_width == 0 ) {
             // if there is a di, use the regDataWidth from the terminal
             // otherwise use the old default of 2
-            try {
+            bool known = STR_DATA == term.get_type() ? di->has_child ( term ) : di->has_child_addr ( term );
+            if (known) {
                 NodeRef term_node = find_name_or_addr ( di, term );
-                uint32 term_data_width = term_node->get_attr("regDataWidth");
+                uint32 term_data_width = term_node->get_attr_uint(Attr::regDataWidth);
                 addrs->widths.push_back ( term_data_width/8 + (term_data_width%8?1:0) );
                 // term resolved
-            } catch ( Exception &e ) {
+            } else {
                 addrs->widths.push_back ( 2 ); 
             }
         } else {
@@ -386,7 +487,7 @@ unique_ptr<AddressData> Device::impl::resolve_addrs ( const DataType& term, cons
     // resolve str data 
 
     NodeRef term_node = find_name_or_addr ( di, term ); 
-    uint32 term_data_width = term_node->get_attr("regDataWidth");
+    uint32 term_data_width = term_node->get_attr_uint(Attr::regDataWidth);
     NodeRef reg_node;
 
     // . = subregister
@@ -402,12 +503,12 @@ unique_ptr<AddressData> Device::impl::resolve_addrs ( const DataType& term, cons
          
         // depending on subreg width, could span multiple addresses
 
-        uint32 addr = reg_node->get_attr("addr");
-        uint32 offset = sub_node->get_attr("addr");
+        uint32 addr = reg_node->get_attr_uint(Attr::addr);
+        uint32 offset = sub_node->get_attr_uint(Attr::addr);
         addr += offset / term_data_width; // skip the number of registers before this subregister starts
         offset = offset % term_data_width;
 
-        int32 width = sub_node->get_attr("width");
+        int32 width = sub_node->get_attr_ref(Attr::width);
         do {
             // how many bits fit in this address
             uint32 cur_bits = term_data_width - offset;
@@ -434,15 +535,15 @@ unique_ptr<AddressData> Device::impl::resolve_addrs ( const DataType& term, cons
             throw Exception ( DEVICE_PARSE_ERROR, "Failed to parse array index", idx );
         }
         
-        if ( nidx > ((uint32) reg_node->get_attr("array")) - 1 ) {
+        if ( nidx > reg_node->get_attr_uint(Attr::array) - 1 ) {
             throw Exception ( DEVICE_PARSE_ERROR, "Invalid array index", nidx );
         }
 
-        uint32 width = reg_node->get_attr("width");
+        uint32 width = reg_node->get_attr_uint(Attr::width);
         // width in registers, not bits
         uint32 item_width = (width / term_data_width) + 
                            (width % term_data_width > 0 ? 1 : 0);
-        uint32 addr = reg_node->get_attr("addr");
+        uint32 addr = reg_node->get_attr_uint(Attr::addr);
         addr += nidx * item_width;
         addrs->type = AddressData::SINGLE;
 
@@ -454,11 +555,11 @@ unique_ptr<AddressData> Device::impl::resolve_addrs ( const DataType& term, cons
     } else {
         reg_node = find_name_or_addr ( term_node, reg_name );
 
-        if ( (uint32)reg_node->get_attr("array") > 1) {
+        if ( reg_node->get_attr_uint(Attr::array) > 1) {
             addrs->type=AddressData::ARRAY;
-            uint32 addr = reg_node->get_attr("addr");
-            uint32 array_len = reg_node->get_attr("array");
-            int32 width = reg_node->get_attr("width");  
+            uint32 addr = reg_node->get_attr_uint(Attr::addr);
+            uint32 array_len = reg_node->get_attr_uint(Attr::array);
+            int32 width = reg_node->get_attr_ref(Attr::width);  
             do {
                int32 awidth = width; 
                do {
@@ -469,8 +570,8 @@ unique_ptr<AddressData> Device::impl::resolve_addrs ( const DataType& term, cons
             } while ( --array_len > 0 );
         } else {
             // logic for a subreg is the same is if it's a register that spans multiple gets
-            uint32 addr = reg_node->get_attr("addr");
-            int32 width = reg_node->get_attr("width");
+            uint32 addr = reg_node->get_attr_uint(Attr::addr);
+            int32 width = reg_node->get_attr_ref(Attr::width);
             addrs->type = AddressData::SINGLE; 
             do {
                 addrs->addrs.push_back(addr++);
@@ -486,6 +587,306 @@ unique_ptr<AddressData> Device::impl::resolve_addrs ( const DataType& term, cons
     return addrs;
 }
 
+#define NITRO_WATCH_BURST 64 // most bytes read at once for adjacent watched registers
+
+/**
+ * Polls registers for Device::watch.  The thread sleeps until the
+ * earliest watch is due, reads every due watch under one device lock
+ * and then runs the callbacks without any lock.  Due times are aligned
+ * to multiples of the interval so watches with the same interval are
+ * read together.
+ **/
+struct Device::impl::Watch {
+    typedef std::chrono::steady_clock Clock;
+
+    struct Entry {
+        uint32 id;
+        DataType term;
+        DataType reg;
+        uint32 interval;
+        bool on_change;
+        Device::WatchFunc func;
+        Device::WatchErrorFunc on_error;
+        Clock::time_point due;
+        bool has_last;
+        DataType last;
+        // results of the current poll
+        unique_ptr<AddressData> addrs;
+        uint32 term_addr;
+        DataType value;
+        unique_ptr<Exception> err;
+        Entry() : term(0), reg(0), has_last(false), last(0), value(0) {}
+    };
+    typedef shared_ptr<Entry> EntryRef;
+
+    // one register address read by a poll
+    struct Word {
+        uint32 width;
+        AddressData* addrs; // of the first watch that needs it
+        DataType value;
+        shared_ptr<Exception> err;
+        Word() : width(0), addrs(NULL), value(0) {}
+    };
+    typedef map<pair<uint32,uint32>,Word> WordMap; // (term addr, reg addr)
+
+    Device& m_dev;
+    Device::impl& m_impl;
+    std::mutex m_lock;
+    std::condition_variable m_wake; // new watch or stop
+    std::condition_variable m_idle; // a poll finished
+    map<uint32,EntryRef> m_entries;
+    uint32 m_next_id;
+    bool m_busy;
+    bool m_stop;
+    Clock::time_point m_epoch;
+    std::thread m_thread;
+    std::thread::id m_thread_id;
+
+    Watch ( Device& dev, Device::impl& impl ) : m_dev(dev), m_impl(impl), m_next_id(1), m_busy(false), m_stop(false), m_epoch(Clock::now()) {}
+
+    // the thread keeps its own reference so the watch outlives a device
+    // destroyed from one of its callbacks.
+    static shared_ptr<Watch> start ( Device& dev, Device::impl& impl ) {
+        shared_ptr<Watch> w ( new Watch ( dev, impl ) );
+        std::lock_guard<std::mutex> lock(w->m_lock);
+        w->m_thread = std::thread ( [w]() { w->run(); } );
+        w->m_thread_id = w->m_thread.get_id();
+        return w;
+    }
+
+    // Called by ~Device.  From a callback the thread can't be joined, it
+    // finishes the callback and exits without touching the device again.
+    void stop() {
+        std::unique_lock<std::mutex> lock(m_lock);
+        m_stop = true;
+        m_wake.notify_all();
+        if (on_thread()) {
+            m_thread.detach();
+            return;
+        }
+        lock.unlock();
+        m_thread.join();
+    }
+
+    bool on_thread() const { return m_thread_id == std::this_thread::get_id(); }
+
+    uint32 add ( const DataType& term, const DataType& reg, Device::WatchFunc func, uint32 interval, bool on_change, Device::WatchErrorFunc on_error ) {
+        EntryRef e ( new Entry );
+        e->term = term;
+        e->reg = reg;
+        e->interval = interval ? interval : 1;
+        e->on_change = on_change;
+        e->func = func;
+        e->on_error = on_error;
+        // a short delay lets watches added together share the first poll
+        e->due = Clock::now() + std::chrono::milliseconds(1);
+        std::lock_guard<std::mutex> lock(m_lock);
+        e->id = m_next_id++;
+        m_entries[e->id] = e;
+        m_wake.notify_all();
+        return e->id;
+    }
+
+    void remove ( uint32 id ) {
+        EntryRef e; // released without the lock
+        std::unique_lock<std::mutex> lock(m_lock);
+        auto itr = m_entries.find(id);
+        if (itr == m_entries.end()) return;
+        e = itr->second;
+        m_entries.erase(itr);
+        wait_idle(lock);
+    }
+
+    void remove_all() {
+        map<uint32,EntryRef> entries;
+        std::unique_lock<std::mutex> lock(m_lock);
+        entries.swap(m_entries);
+        wait_idle(lock);
+    }
+
+    // watches left or a poll running, other than the one calling
+    bool watching() {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return !m_entries.empty() || (m_busy && !on_thread());
+    }
+
+    // wait for the poll in progress unless called from a callback
+    void wait_idle ( std::unique_lock<std::mutex>& lock ) {
+        if (on_thread()) return;
+        m_idle.wait ( lock, [this]() { return !m_busy; } );
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(m_lock);
+        while (!m_stop) {
+            Clock::time_point now = Clock::now();
+            Clock::time_point next = Clock::time_point::max();
+            vector<EntryRef> due;
+            for (auto itr=m_entries.begin(); itr != m_entries.end(); ++itr) {
+                if (itr->second->due <= now) due.push_back(itr->second);
+                else next = min ( next, itr->second->due );
+            }
+            if (due.empty()) {
+                if (next == Clock::time_point::max()) m_wake.wait(lock);
+                else m_wake.wait_until(lock, next);
+                continue;
+            }
+
+            m_busy = true;
+            lock.unlock();
+            poll(due);
+            dispatch(due);
+            due.clear();
+            lock.lock();
+            m_busy = false;
+            m_idle.notify_all();
+        }
+    }
+
+    // true if adjacent registers of the terminal can be read at once.
+    // Only register terminals of the device interface are known to
+    // step addresses on reads.
+    bool can_burst ( const DISnapshot& snap, uint32 term_addr ) {
+        uint32 modes = m_impl.m_modes | m_impl.m_term_modes[term_addr];
+        return !(modes & (Device::DOUBLEGET_VERIFY|Device::LOG_IO)) &&
+               !snap.rdwrmutexes.count(term_addr) &&
+               snap.di->has_child_addr(term_addr);
+    }
+
+    void poll ( vector<EntryRef>& due ) {
+        IoCall call ( m_impl, IO_REGISTER );
+        MutexLock thread_safe_method(*m_impl.m_mutex);
+        DISnapshotRef snap = m_impl.snapshot();
+
+        // every register address the due watches need, once
+        WordMap words;
+        for (auto itr=due.begin(); itr != due.end(); ++itr) {
+            Entry& e = **itr;
+            e.err.reset();
+            try {
+                e.addrs = m_impl.resolve_addrs ( snap->di, e.term, e.reg, 0 );
+                e.term_addr = e.addrs->type == AddressData::RAW ? m_impl.term_addr(snap->di, e.term) : e.addrs->term_node->get_attr_uint(Attr::addr);
+            } catch ( const Exception& ex ) {
+                e.addrs.reset();
+                e.err.reset ( new Exception(ex) );
+                continue;
+            }
+            for (size_t i=0;i<e.addrs->addrs.size();++i) {
+                Word& w = words[make_pair(e.term_addr, e.addrs->addrs[i])];
+                if (!w.addrs) {
+                    w.width = e.addrs->widths[i];
+                    w.addrs = e.addrs.get();
+                }
+            }
+        }
+
+        // read runs of adjacent 16 bit registers with one read.  Register
+        // terminals step one address per 16 bit word, as multi-word
+        // registers rely on.
+        for (WordMap::iterator itr=words.begin(); itr != words.end(); ) {
+            uint32 term_addr = itr->first.first;
+            uint32 reg_addr = itr->first.second;
+            uint32 width = itr->second.width;
+            WordMap::iterator end = itr;
+            uint32 n = 1;
+            ++end;
+            if (width == 2 && can_burst(*snap, term_addr)) {
+                while (end != words.end() && end->first.first == term_addr &&
+                       end->first.second == reg_addr + n && end->second.width == width &&
+                       (n+1)*width <= NITRO_WATCH_BURST) {
+                    ++end;
+                    ++n;
+                }
+            }
+            try {
+                if (n == 1) {
+                    itr->second.value = m_impl.do_get ( m_dev, term_addr, reg_addr, itr->second.addrs->get_verify(), width, -1 );
+                } else {
+                    uint8 buf[NITRO_WATCH_BURST];
+                    m_impl.do_read ( m_dev, term_addr, reg_addr, buf, n*width, -1 );
+                    uint32 i = 0;
+                    for (WordMap::iterator w=itr; w != end; ++w, ++i) {
+                        uint32 v = 0;
+                        memcpy ( &v, buf + i*width, width );
+                        w->second.value = v;
+                    }
+                }
+            } catch ( const Exception& ex ) {
+                shared_ptr<Exception> err ( new Exception(ex) );
+                for (WordMap::iterator w=itr; w != end; ++w) w->second.err = err;
+            }
+            itr = end;
+        }
+
+        for (auto itr=due.begin(); itr != due.end(); ++itr) {
+            Entry& e = **itr;
+            if (!e.addrs) continue;
+            vector<DataType> results;
+            for (size_t i=0;i<e.addrs->addrs.size() && !e.err;++i) {
+                Word& w = words[make_pair(e.term_addr, e.addrs->addrs[i])];
+                if (w.err) e.err.reset ( new Exception(*w.err) );
+                else results.push_back ( w.value );
+            }
+            if (e.err) continue;
+            try {
+                e.value = m_impl.build_value ( *e.addrs, results );
+            } catch ( const Exception& ex ) {
+                e.err.reset ( new Exception(ex) );
+            }
+        }
+    }
+
+    bool is_watched ( const EntryRef& e ) {
+        std::lock_guard<std::mutex> lock(m_lock);
+        auto itr = m_entries.find(e->id);
+        return itr != m_entries.end() && itr->second == e;
+    }
+
+    void dispatch ( vector<EntryRef>& due ) {
+        for (auto itr=due.begin(); itr != due.end(); ++itr) {
+            Entry& e = **itr;
+            if (!is_watched(*itr)) continue; // unwatched during the poll
+            bool keep = true;
+            try {
+                if (e.err) {
+                    if (e.on_error) keep = e.on_error ( *e.err );
+                } else if (!e.on_change || !e.has_last || e.last != e.value) {
+                    e.last = e.value;
+                    e.has_last = true;
+                    keep = e.func ( e.value );
+                }
+            } catch ( const Exception& ex ) {
+                keep = e.on_error ? e.on_error ( ex ) : false;
+            } catch ( const std::exception& ) {
+                keep = false;
+            } // anything else, like a thread exit unwinding, isn't ours to stop
+
+            std::lock_guard<std::mutex> lock(m_lock);
+            if (m_stop) return; // the device may be gone
+            if (!keep) {
+                auto found = m_entries.find(e.id);
+                if (found != m_entries.end() && found->second == *itr) m_entries.erase(found);
+                continue;
+            }
+            // next multiple of the interval after now
+            Clock::duration since = Clock::now() - m_epoch;
+            std::chrono::milliseconds interval(e.interval);
+            e.due = m_epoch + (since / interval + 1) * interval;
+        }
+    }
+};
+
+Device::impl::Watch& Device::impl::watcher(Device& dev) {
+    std::lock_guard<std::mutex> lock(m_watch_lock);
+    if (!m_watch) m_watch = Watch::start ( dev, *this );
+    return *m_watch;
+}
+
+bool Device::impl::on_watch_thread() {
+    std::lock_guard<std::mutex> lock(m_watch_lock);
+    return m_watch && m_watch->on_thread();
+}
+
 Device::Device() {
    m_impl=new impl(); 
 }
@@ -493,30 +894,32 @@ Device::Device() {
 Device::~Device() throw() {
     //close();
     // NOTE can't call virtual function in destructor...
+    // derived devices have to call unwatch_all first, by now the watch
+    // thread may already have read from the destroyed device.  A device
+    // destroyed from its own callback is fine, that poll is done reading.
+    if (m_impl->m_watch) {
+        if (m_impl->m_watch->watching()) {
+            cerr << "Nitro::Device destroyed while watched.  Derived devices must call unwatch_all() at the start of their destructor." << endl;
+            assert ( !"Device destroyed while watched" );
+        }
+        m_impl->m_watch->stop();
+        m_impl->m_watch.reset();
+    }
     delete m_impl;
 }
 
 
 void Device::set_di( const NodeRef& node ) {
-   MutexLock thread_safe_method(*m_impl->m_mutex);
-   m_impl->di = node;
-
-   // scan terminals for pipes and set up rdwr mutexes
-   m_impl->m_rdwrmutexes.clear();
-   for ( auto i =  node->child_begin(); i!=node->child_end(); ++i ) {
-       if ((*i)->has_attr("type") && (*i)->get_attr("type") == "pipe") {
-           m_impl->m_rdwrmutexes[(*i)->get_attr("addr")] = shared_ptr<recursive_mutex>(new recursive_mutex);
-       }
-   }
+   m_impl->publish ( node );
 }
 NodeRef Device::get_di( ) const {
-    return m_impl->di;
+    return m_impl->snapshot()->di;
 }
 NodeRef Device::get_terminal ( const DataType& name ) const {
-    return m_impl->find_name_or_addr( m_impl->di, name );
+    return m_impl->find_name_or_addr( m_impl->snapshot()->di, name );
 }
 NodeRef Device::get_register ( const DataType& term , const DataType& reg ) const {
-    NodeRef t = m_impl->find_name_or_addr(m_impl->di, term);
+    NodeRef t = m_impl->find_name_or_addr(m_impl->snapshot()->di, term);
     return m_impl->find_name_or_addr ( t , reg );
 }
 
@@ -525,64 +928,57 @@ void Device::set_timeout ( uint32 timeout ) {
     m_impl->m_timeout=timeout;
 }
 
+Device::IoStats Device::io_stats ( IO_CLASS c ) const {
+    if (c >= IO_CLASSES) throw Exception ( DEVICE_OP_ERROR, "Invalid io class.", (uint32)c );
+    std::lock_guard<std::mutex> lock(m_impl->m_io_lock);
+    return m_impl->m_io[c];
+}
+
+void Device::reset_io_stats () {
+    std::lock_guard<std::mutex> lock(m_impl->m_io_lock);
+    memset ( m_impl->m_io, 0, sizeof(m_impl->m_io) );
+}
+
+uint32 Device::register_io_pending () const {
+    return m_impl->m_register_io;
+}
+
 uint32 Device::get_timeout () {
     MutexLock thread_safe_method(*m_impl->m_mutex);
     return m_impl->m_timeout;
 }
 
-bitset<1024> to_bitset(const DataType& dt) {
-    bitset<1024> res;
-    if (dt.get_type() == BIGINT_DATA) {
-        vector<DataType> ints = DataType::as_bigints(dt);
-        while (ints.size()) {
-            res <<= 32; 
-            res |= (uint32) ints.back();
-            ints.pop_back();
-        }        
-   } else {
-    res |= (uint32) dt;
-   }
-   return res;
+BigInt to_bits(const DataType& dt) {
+    switch (dt.get_type()) {
+        case INT_DATA:
+        case UINT_DATA:
+        case BIGINT_DATA:
+            return DataType::as_bigint(dt);
+        default:
+            return BigInt ( (uint32) dt );
+    }
 }
 
 /**
  * split value into ints of width
  **/
 void to_vector ( DataType &val, vector<DataType> &vals, uint32 n, uint32 width ) {
-    bitset<1024> bits = to_bitset(val);
-    bitset<1024> mask;
-    for (uint32 i=0;i<width;++i) mask.set(i);
+    BigInt bits = to_bits(val);
+    uint32 mask = width >= 32 ? 0xffffffff : (1u << width) - 1;
     do {
-       vals.push_back ( (uint32)(bits & mask).to_ulong() ); 
+       vals.push_back ( bits.word(0) & mask );
        bits >>= width;
     } while (--n);
 }
 
 
-uint32 lsint ( bitset<1024> &bits ) {
-   string resstr = bits.to_string().substr( 1024-32 );
-   bitset<32> smaller ( resstr );
-   uint32 res= smaller.to_ulong();
-   return res;
-}
-
-DataType from_bitset(bitset<1024> &bits ) {
+DataType from_bits(const BigInt &bits ) {
 
     // if dt can fit in an int, return it that way..
-    string resstr = bits.to_string();
-    size_t f = resstr.find ( "1" );
-    if (f == string::npos) return 0;
-    if (1024-f<=32) return lsint(bits);
-
-
-    vector<DataType> ints;
-    //bitset<1024> mask = 0xffffffff;    
-    do {
-        uint32 lsd = lsint(bits);
-        ints.push_back(lsd);
-        bits >>= 32;
-    } while (bits.any());
-    return DataType::as_bigint_datatype(ints);
+    uint32 n = bits.num_words();
+    if (!n) return 0;
+    if (n==1) return bits.word(0);
+    return DataType ( bits );
 }
 
 void Device::lock() {
@@ -613,22 +1009,22 @@ uint32 Device::get_modes() const {
 
 void Device::enable_mode(const DataType &term, uint32 modes) {
     MutexLock thread_safe_method (*m_impl->m_mutex);
-    uint32 addr = m_impl->term_addr(term);
+    uint32 addr = m_impl->term_addr(m_impl->snapshot()->di, term);
     m_impl->m_term_modes[addr] |= modes; 
 }
 void Device::set_modes(const DataType &term, uint32 modes) {
     MutexLock thread_safe_method (*m_impl->m_mutex);
-    uint32 addr = m_impl->term_addr(term);
+    uint32 addr = m_impl->term_addr(m_impl->snapshot()->di, term);
     m_impl->m_term_modes[addr] = modes; 
 }
 void Device::disable_mode(const DataType &term, uint32 modes) {
     MutexLock thread_safe_method (*m_impl->m_mutex);
-    uint32 addr = m_impl->term_addr(term);
+    uint32 addr = m_impl->term_addr(m_impl->snapshot()->di, term);
     m_impl->m_term_modes[addr] &= ~modes;
 }
 uint32 Device::get_modes(const DataType &term) const {
     MutexLock thread_safe_method(*m_impl->m_mutex);
-    return m_impl->m_term_modes[m_impl->term_addr(term)];
+    return m_impl->m_term_modes[m_impl->term_addr(m_impl->snapshot()->di, term)];
 }
 
 void Device::set_retry_func( Device::RetryFunc *func) {
@@ -642,7 +1038,7 @@ void Device::set_retry_func( Device::RetryFunc *func) {
 /**
  * get orig register if part of register is dirty. 
  **/
-void Device::impl::get_set_subreg ( bitset<1024> &bits, uint32 term_addr, uint32 reg_addr, bitset<1024> &value, uint32 offset, uint32 width, uint32 dwidth, vector<uint32> &clean_regs, int32 timeout, Device &dev) {
+void Device::impl::get_set_subreg ( BigInt &bits, uint32 term_addr, uint32 reg_addr, BigInt &value, uint32 offset, uint32 width, uint32 dwidth, vector<uint32> &clean_regs, int32 timeout, Device &dev) {
     uint32 subreg_start = reg_addr + (offset / dwidth);
     uint32 subreg_end = subreg_start;
     uint32 subreg_offset = offset % dwidth;
@@ -655,15 +1051,14 @@ void Device::impl::get_set_subreg ( bitset<1024> &bits, uint32 term_addr, uint32
 
     for (uint32 addr = subreg_start; addr < subreg_end; ++addr ) { 
         if ( count ( clean_regs.begin(), clean_regs.end(), addr ) == 0 ) {
-            bitset<1024> dirty_reg ( (uint32) dev.get ( term_addr, addr, timeout, dwidth/8 ) );
+            BigInt dirty_reg ( (uint32) dev.get ( term_addr, addr, timeout, dwidth/8 ) );
             dirty_reg <<= (addr-subreg_start + offset/dwidth) * dwidth;
             bits |= dirty_reg;
             clean_regs.push_back(addr);
         }
     }
 
-    bitset<1024> mask;
-    for (uint32 i=0;i<width;++i) mask.set(i);
+    BigInt mask = BigInt::mask ( width );
     mask <<= offset;
     bits &= ~mask;
     value <<= offset;
@@ -674,12 +1069,13 @@ void Device::impl::get_set_subreg ( bitset<1024> &bits, uint32 term_addr, uint32
 
 void Device::set ( const DataType& term, const DataType& reg, const DataType& value, int32 timeout, uint32 data_width ) {
 
+    impl::IoCall call ( *m_impl, IO_REGISTER );
     MutexLock thread_safe_method(*m_impl->m_mutex);
 
     dev_debug ( "Set: " << term << " " << reg << ": " << value );
 
-
-    unique_ptr<AddressData> addrs = m_impl->resolve_addrs( term, reg, data_width );
+    DISnapshotRef snap = m_impl->snapshot();
+    unique_ptr<AddressData> addrs = m_impl->resolve_addrs( snap->di, term, reg, data_width );
 
     vector<DataType> set_vals;
     // val setters
@@ -692,15 +1088,15 @@ void Device::set ( const DataType& term, const DataType& reg, const DataType& va
         case AddressData::ARRAY:
             {
                 if ( LIST_DATA != value.get_type()) throw Exception ( DEVICE_OP_ERROR, "Expected array data for setting array register.", value );
-                vector<DataType> val_array = value; 
-                uint32 asize = addrs->reg_node->get_attr("array");
+                const vector<DataType>& val_array = DataType::as_list ( value );
+                uint32 asize = addrs->reg_node->get_attr_uint(Attr::array);
                 if (val_array.size() != asize ) throw Exception ( DEVICE_OP_ERROR, "Array data must be same length as register array." ); 
 
-                uint32 dwidth = addrs->term_node->get_attr("regDataWidth");
-                uint32 awidth = addrs->reg_node->get_attr("width");
+                uint32 dwidth = addrs->term_node->get_attr_uint(Attr::regDataWidth);
+                uint32 awidth = addrs->reg_node->get_attr_uint(Attr::width);
                 uint32 regs = (awidth / dwidth ) +
                               (awidth % dwidth > 0 ? 1 : 0);
-                for (vector<DataType>::iterator itr = val_array.begin();
+                for (vector<DataType>::const_iterator itr = val_array.begin();
                      itr != val_array.end(); ++itr ) {
                      DataType val = m_impl->valmap_or_const_val( addrs->reg_node , *itr);
                      to_vector ( val, set_vals, regs, dwidth );
@@ -709,23 +1105,23 @@ void Device::set ( const DataType& term, const DataType& reg, const DataType& va
             break;
         case AddressData::SINGLE:
             {
-                uint32 dwidth = addrs->term_node->get_attr("regDataWidth");
+                uint32 dwidth = addrs->term_node->get_attr_uint(Attr::regDataWidth);
                 
                 if ( NODE_DATA == value.get_type() ) {
 
 
-                    bitset<1024> new_value;
+                    BigInt new_value;
                     NodeRef val_map = value;
-                    uint32 term_addr = addrs->term_node->get_attr("addr");
-                    uint32 reg_addr = addrs->reg_node->get_attr("addr");
+                    uint32 term_addr = addrs->term_node->get_attr_uint(Attr::addr);
+                    uint32 reg_addr = addrs->reg_node->get_attr_uint(Attr::addr);
                     for ( DIAttrIter itr = val_map->attrs_begin();
                           itr != val_map->attrs_end();
                           ++itr ) {
                           NodeRef subreg = addrs->reg_node->get_child ( itr->first );
-                          uint32 offset = subreg->get_attr("addr");
-                          uint32 width = subreg->get_attr("width");
+                          uint32 offset = subreg->get_attr_uint(Attr::addr);
+                          uint32 width = subreg->get_attr_uint(Attr::width);
 
-                          bitset<1024> set_bits = to_bitset(m_impl->valmap_or_const_val ( subreg, itr->second ) );
+                          BigInt set_bits = to_bits(m_impl->valmap_or_const_val ( subreg, itr->second ) );
                           m_impl->get_set_subreg ( 
                             new_value,
                             term_addr,
@@ -737,7 +1133,7 @@ void Device::set ( const DataType& term, const DataType& reg, const DataType& va
                             dirty_regs,
                             timeout, *this );
                     }
-                    DataType set_val = from_bitset(new_value);
+                    DataType set_val = from_bits(new_value);
                     to_vector ( set_val, set_vals, addrs->addrs.size(), dwidth ); 
                 } else {
                     DataType tmp = m_impl->valmap_or_const_val( addrs->reg_node, value );
@@ -748,26 +1144,26 @@ void Device::set ( const DataType& term, const DataType& reg, const DataType& va
         case AddressData::SUBREG:
             {
                     
-                uint32 dwidth = addrs->term_node->get_attr("regDataWidth");
-                uint32 offset = addrs->subreg_node->get_attr("addr");
+                uint32 dwidth = addrs->term_node->get_attr_uint(Attr::regDataWidth);
+                uint32 offset = addrs->subreg_node->get_attr_uint(Attr::addr);
 
-                bitset<1024> vals;
+                BigInt vals;
 
-                bitset<1024> set_bits = to_bitset( m_impl->valmap_or_const_val ( addrs->subreg_node , value ) );
+                BigInt set_bits = to_bits( m_impl->valmap_or_const_val ( addrs->subreg_node , value ) );
                 m_impl->get_set_subreg ( 
                     vals,
-                    (uint32) addrs->term_node->get_attr("addr"),
-                    (uint32) addrs->reg_node->get_attr("addr"),
+                    addrs->term_node->get_attr_uint(Attr::addr),
+                    addrs->reg_node->get_attr_uint(Attr::addr),
                     set_bits,
                     offset,
-                    (uint32) addrs->subreg_node->get_attr("width"),
+                    addrs->subreg_node->get_attr_uint(Attr::width),
                     dwidth,
                     dirty_regs,
                     timeout,
                     *this);
 
                 vals >>= (offset / dwidth) * dwidth;
-                DataType set_val = from_bitset(vals);
+                DataType set_val = from_bits(vals);
                 to_vector ( set_val, set_vals, addrs->addrs.size(), dwidth);
 
             }
@@ -791,52 +1187,35 @@ void Device::set ( const DataType& term, const DataType& reg, const DataType& va
         }
 
 
-        uint32 term_addr = addrs->type == AddressData::RAW ? m_impl->term_addr(term) : (uint32) addrs->term_node->get_attr("addr");
-        m_impl->do_set ( *this, term_addr, addr, set, width, *addrs, timeout); 
+        uint32 term_addr = addrs->type == AddressData::RAW ? m_impl->term_addr(snap->di, term) : addrs->term_node->get_attr_uint(Attr::addr);
+        m_impl->do_set ( *this, term_addr, addr, (uint32)set, width, addrs->set_verify(), timeout); 
     }
 }
 
 /**
- * Basic Get 
+ * Combine the register values read for each of addrs into the value
+ * get returns.  results is consumed.
  **/
-DataType Device::get( const DataType& term, const DataType& reg, int32 timeout, uint32 data_width ) {
-
-    MutexLock thread_safe_method(*m_impl->m_mutex);
-
-    unique_ptr<AddressData> addrs = m_impl->resolve_addrs( term, reg, data_width );
-
-    vector<DataType> results;
-    //uint8 read_bytes = addrs->bytes / addrs->addrs.size();
-    for (unsigned i=0; i<addrs->addrs.size(); ++i ) {
-    //for ( vector<uint32>::iterator itr = addrs->addrs.begin();
-    //      itr != addrs->addrs.end(); ++itr ) {
-          uint32 addr = addrs->addrs.at(i);
-          uint32 width = addrs->widths.at(i);
-          uint32 term_addr = addrs->type == AddressData::RAW ? m_impl->term_addr(term) : (uint32) addrs->term_node->get_attr("addr");
-          DataType res = m_impl->do_get ( *this, term_addr, addr, *addrs, width, timeout ); 
-          results.push_back(res);
-    }
-
-    // val builder
-    switch ( addrs->type ) {
+DataType Device::impl::build_value ( const AddressData& addrs, vector<DataType>& results ) {
+    switch ( addrs.type ) {
         case AddressData::RAW:
             return results.front();
         case AddressData::SINGLE:
             {
-                uint32 width = addrs->term_node->get_attr("regDataWidth");
-                bitset<1024> bits;
+                uint32 width = addrs.term_node->get_attr_uint(Attr::regDataWidth);
+                BigInt bits;
                 while (results.size()) {
                     bits <<= width;
                     bits |= (uint32) results.back();
                     results.pop_back();
                 }
-                return from_bitset(bits);
+                return from_bits(bits);
             }
         case AddressData::ARRAY:
             {
-                uint32 dwidth = addrs->term_node->get_attr("regDataWidth");
-                uint32 awidth = addrs->reg_node->get_attr("width");
-                uint32 array = addrs->reg_node->get_attr("array");
+                uint32 dwidth = addrs.term_node->get_attr_uint(Attr::regDataWidth);
+                uint32 awidth = addrs.reg_node->get_attr_uint(Attr::width);
+                uint32 array = addrs.reg_node->get_attr_uint(Attr::array);
                 vector<DataType> ret;
                 while (array--) {
                     uint32 width = (awidth / dwidth) +
@@ -848,39 +1227,38 @@ DataType Device::get( const DataType& term, const DataType& reg, int32 timeout,
                         results.erase(results.begin());
                     }
 
-                    bitset<1024> bits;
+                    BigInt bits;
                     while ( cur_array.size() ) {
                        bits <<= dwidth; 
                        bits |= (uint32)cur_array.back();
                        cur_array.pop_back();
                     }
-                    ret.push_back(from_bitset(bits));
+                    ret.push_back(from_bits(bits));
                 }
-                return ret;
+                return DataType ( std::move(ret) );
             }
         case AddressData::SUBREG:
             {
-                uint32 dwidth = addrs->term_node->get_attr("regDataWidth");
-                uint32 start_addr = addrs->reg_node->get_attr("addr");
-                bitset<1024> reg_data;
+                uint32 dwidth = addrs.term_node->get_attr_uint(Attr::regDataWidth);
+                uint32 start_addr = addrs.reg_node->get_attr_uint(Attr::addr);
+                BigInt reg_data;
                 while ( results.size() ) {
                     reg_data <<= dwidth;
                     reg_data |= (uint32) results.back();
                     results.pop_back();
                 }
 
-                while ( start_addr < addrs->addrs.front() ) {
+                while ( start_addr < addrs.addrs.front() ) {
                     ++start_addr;
                     reg_data <<= dwidth;
                 }
 
-                uint32 swidth = addrs->subreg_node->get_attr("width");
-                uint32 soffset = addrs->subreg_node->get_attr("addr");
+                uint32 swidth = addrs.subreg_node->get_attr_uint(Attr::width);
+                uint32 soffset = addrs.subreg_node->get_attr_uint(Attr::addr);
                 reg_data >>= soffset;
-                bitset<1024> mask;
-                for (uint32 i=0;i<swidth;++i) mask.set(i);
+                BigInt mask = BigInt::mask ( swidth );
                 reg_data &= mask;
-                return from_bitset(reg_data);
+                return from_bits(reg_data);
             }
 
     }
@@ -889,26 +1267,75 @@ DataType Device::get( const DataType& term, const DataType& reg, int32 timeout,
 
 }
 
+/**
+ * Basic Get 
+ **/
+DataType Device::get( const DataType& term, const DataType& reg, int32 timeout, uint32 data_width ) {
+
+    impl::IoCall call ( *m_impl, IO_REGISTER );
+    MutexLock thread_safe_method(*m_impl->m_mutex);
+
+    DISnapshotRef snap = m_impl->snapshot();
+    unique_ptr<AddressData> addrs = m_impl->resolve_addrs( snap->di, term, reg, data_width );
+
+    vector<DataType> results;
+    //uint8 read_bytes = addrs->bytes / addrs->addrs.size();
+    for (unsigned i=0; i<addrs->addrs.size(); ++i ) {
+    //for ( vector<uint32>::iterator itr = addrs->addrs.begin();
+    //      itr != addrs->addrs.end(); ++itr ) {
+          uint32 addr = addrs->addrs.at(i);
+          uint32 width = addrs->widths.at(i);
+          uint32 term_addr = addrs->type == AddressData::RAW ? m_impl->term_addr(snap->di, term) : addrs->term_node->get_attr_uint(Attr::addr);
+          results.push_back( m_impl->do_get ( *this, term_addr, addr, addrs->get_verify(), width, timeout ) );
+    }
+
+    return m_impl->build_value ( *addrs, results );
+}
+
+void Device::get_words ( uint32 term_addr, uint32 reg_addr, uint32* values, uint32 words, uint32 bytes, bool verify, int32 timeout ) {
+
+    impl::IoCall call ( *m_impl, IO_REGISTER );
+    MutexLock thread_safe_method(*m_impl->m_mutex);
+
+    for (uint32 i=0;i<words;++i) {
+        values[i] = m_impl->do_get ( *this, term_addr, reg_addr+i, verify, bytes, timeout );
+    }
+}
+
+void Device::set_words ( uint32 term_addr, uint32 reg_addr, const uint32* values, const uint32* masks, uint32 words, uint32 bytes, bool verify, int32 timeout ) {
+
+    impl::IoCall call ( *m_impl, IO_REGISTER );
+    MutexLock thread_safe_method(*m_impl->m_mutex);
+
+    for (uint32 i=0;i<words;++i) {
+        uint32 value = values[i];
+        if (masks) {
+            uint32 cur = m_impl->do_get ( *this, term_addr, reg_addr+i, verify, bytes, timeout );
+            value = (cur & ~masks[i]) | (value & masks[i]);
+        }
+        m_impl->do_set ( *this, term_addr, reg_addr+i, value, bytes, verify, timeout );
+    }
+}
+
 NodeRef Device::get_subregs ( const DataType& term, const DataType& reg , int32 timeout ) {
 
     MutexLock thread_safe_method(*m_impl->m_mutex);
 
-    NodeRef tnode = m_impl->find_name_or_addr( m_impl->di , term );
+    NodeRef tnode = m_impl->find_name_or_addr( m_impl->snapshot()->di , term );
     NodeRef rnode = m_impl->find_name_or_addr( tnode, reg ); 
     if ( !rnode->has_children()) {
         throw Exception ( DEVICE_OP_ERROR, "Register must have subregisters to use this method.", reg );
     }
     DataType ret = get ( term, reg, timeout ); // TODO rnode->get_attr("addr"), timeout, rnode->get_attr("width") );
-    bitset<1024> data = to_bitset(ret); 
+    BigInt data = to_bits(ret); 
     NodeRef subreg_vals = Node::create(rnode->get_name());
     for (DITreeIter itr = rnode->child_begin(); itr != rnode->child_end(); ++itr ) {
         NodeRef subreg = *itr;
-        uint32 swidth = subreg->get_attr("width");
-        bitset<1024> mask;
-        for (uint32 i=0;i<swidth;++i) mask.set(i);
-        bitset<1024> subreg_val = data & mask; 
+        uint32 swidth = subreg->get_attr_uint(Attr::width);
+        BigInt mask = BigInt::mask ( swidth );
+        BigInt subreg_val = data & mask; 
         data >>= swidth;
-        subreg_vals->set_attr( subreg->get_name(), from_bitset(subreg_val) );
+        subreg_vals->set_attr( subreg->get_name(), from_bits(subreg_val) );
     }
     return subreg_vals;
 }
@@ -919,18 +1346,97 @@ NodeRef Device::get_subregs ( const DataType& term, const DataType& reg , int32
  **/
 void Device::read(const DataType& term, const DataType& reg, uint8* data, size_t length, int32 timeout) {
 
-    MutexLock thread_safe_method(*m_impl->mutex_for_rdwr(term));
+    DISnapshotRef snap = m_impl->snapshot();
+    shared_ptr<recursive_mutex> m = m_impl->mutex_for_rdwr(*snap, term);
+    impl::IoCall call ( *m_impl, m == m_impl->m_mutex ? IO_REGISTER : IO_PIPE );
+    MutexLock thread_safe_method(*m);
 
     dev_debug ( "Read " << length << " bytes from " << term << ", " << reg );
     dev_debug ( "Mem addr " << (uint64)data );
-    m_impl->do_read(*this, m_impl->term_addr(term), m_impl->reg_addr(term,reg), data, length, timeout);
+    m_impl->do_read(*this, m_impl->term_addr(snap->di, term), m_impl->reg_addr(snap->di,term,reg), data, length, timeout);
 }
 void Device::write(const DataType& term, const DataType& reg, const uint8* data, size_t length, int32 timeout) {
-    MutexLock thread_safe_method(*m_impl->mutex_for_rdwr(term));
+    DISnapshotRef snap = m_impl->snapshot();
+    shared_ptr<recursive_mutex> m = m_impl->mutex_for_rdwr(*snap, term);
+    impl::IoCall call ( *m_impl, m == m_impl->m_mutex ? IO_REGISTER : IO_PIPE );
+    MutexLock thread_safe_method(*m);
     dev_debug ( "Write " << length << " bytes to " << term << ", " << reg );
-    m_impl->do_write(*this, m_impl->term_addr(term),m_impl->reg_addr(term,reg),data,length,timeout);
+    m_impl->do_write(*this, m_impl->term_addr(snap->di, term),m_impl->reg_addr(snap->di,term,reg),data,length,timeout);
 };
 
+uint32 Device::watch ( const DataType& term, const DataType& reg, WatchFunc func, uint32 interval, bool on_change, WatchErrorFunc on_error ) {
+    if (!func) throw Exception ( DEVICE_OP_ERROR, "watch requires a callback." );
+    DISnapshotRef snap = m_impl->snapshot();
+    m_impl->resolve_addrs ( snap->di, term, reg, 0 ); // throws for unknown registers
+    return m_impl->watcher(*this).add ( term, reg, func, interval, on_change, on_error );
+}
+
+void Device::unwatch ( uint32 id ) {
+    std::unique_lock<std::mutex> lock(m_impl->m_watch_lock);
+    impl::Watch* w = m_impl->m_watch.get();
+    lock.unlock();
+    if (w) w->remove(id);
+}
+
+void Device::unwatch_all () {
+    std::unique_lock<std::mutex> lock(m_impl->m_watch_lock);
+    impl::Watch* w = m_impl->m_watch.get();
+    lock.unlock();
+    if (w) w->remove_all();
+}
+
+DataType Device::wait_until ( const DataType& term, const DataType& reg, std::function<bool(const DataType&)> pred, uint32 timeout, uint32 interval ) {
+    struct Waiter {
+        std::mutex m;
+        std::condition_variable cond;
+        bool done;
+        DataType value;
+        std::exception_ptr err;
+        Waiter() : done(false), value(0) {}
+        bool finish ( const DataType& v, std::exception_ptr e ) {
+            std::lock_guard<std::mutex> lock(m);
+            value = v;
+            err = e;
+            done = true;
+            cond.notify_all();
+            return false;
+        }
+    };
+    // only the watch thread could finish the wait
+    if (m_impl->on_watch_thread()) throw Exception ( DEVICE_OP_ERROR, "wait_until can't be called from a watch callback." );
+    shared_ptr<Waiter> w ( new Waiter );
+    uint32 id = watch ( term, reg,
+        [w,pred]( const DataType& v ) {
+            try {
+                return pred(v) ? w->finish ( v, std::exception_ptr() ) : true;
+            } catch ( const Exception& ) {
+                return w->finish ( v, std::current_exception() );
+            } catch ( const std::exception& ) {
+                return w->finish ( v, std::current_exception() );
+            }
+        }, interval, false,
+        [w]( const Exception& e ) {
+            return w->finish ( DataType(0), std::make_exception_ptr(e) );
+        } );
+
+    std::unique_lock<std::mutex> lock(w->m);
+    if (timeout) w->cond.wait_for ( lock, std::chrono::milliseconds(timeout), [w]() { return w->done; } );
+    else w->cond.wait ( lock, [w]() { return w->done; } );
+    if (!w->done) {
+        lock.unlock();
+        unwatch(id); // the last poll may still finish the wait
+        lock.lock();
+        if (!w->done) throw Exception ( DEVICE_TIMEOUT, "wait_until", (uint32)timeout );
+    }
+    if (w->err) std::rethrow_exception ( w->err );
+    return w->value;
+}
+
+void Device::cancel(const DataType& term) {
+    // no lock, the transfer being cancelled holds it
+    _cancel ( m_impl->term_addr ( m_impl->snapshot()->di, term ) );
+}
+
 void Device::close() {
     MutexLock thread_safe_method (*m_impl->m_mutex);
     _close();
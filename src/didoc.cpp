@@ -0,0 +1,317 @@
+/**
+ * Copyright (C) 2009 Ubixum, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ **/
+
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+
+#include <nitro/error.h>
+#include <nitro/node.h>
+#include <nitro/bigint.h>
+
+#include "didoc.h"
+#include "hr_time.h"
+#include "xutils.h"
+
+using namespace std;
+using namespace Nitro;
+
+#ifdef DEBUG_XML
+#define debug(x) cout << x << " (" __FILE__ ":" << __LINE__ << ")" << endl;
+#else
+#define debug(x)
+#endif
+
+
+string& trim ( string& s ) {
+    static string ws = "\t\n\n ";
+    size_t startpos = s.find_first_not_of (ws);
+    size_t endpos = s.find_last_not_of (ws);
+    if (string::npos == startpos || string::npos == endpos ) s = "";
+    else s=s.substr( startpos, endpos-startpos+1 );
+
+    return s;
+}
+
+bool isnumeric ( const string& s ) {
+    if (!s.size()) return false;
+    char first=s.at(0);
+    if (s.size()==1 && !isdigit(first)) return false;
+    if (first != '+' && first != '-' && !isdigit(first)) return false;
+    for (size_t pos=1;pos<s.size();++pos) {
+        if (!isdigit(s.at(pos))) return false;
+    }
+    return true;
+}
+
+
+namespace Nitro {
+
+struct CacheEntry {
+    ParsedDocRef doc;
+    time_t mtime;
+};
+typedef map<string,CacheEntry> DocCache;
+
+static bool process_cache_enabled=false;
+static DocCache process_cache;
+static mutex process_cache_mutex;
+
+/**
+ * State shared by the top level document and
+ * all the files it includes.
+ **/
+struct LoadContext {
+    DocParser parser;
+    const char* parser_name;
+    bool validate;
+    vector<string> &includes;
+    XmlReader::Stats &stats;
+    DocCache &cache;
+    bool shared; // cache is the process cache
+    LoadContext ( DocParser p, const char* pn, bool v, vector<string> &i, XmlReader::Stats &s, DocCache &c, bool sh ) :
+        parser(p), parser_name(pn), validate(v), includes(i), stats(s), cache(c), shared(sh) {}
+};
+
+
+void set_doc_cache ( bool enable ) {
+    lock_guard<mutex> lock ( process_cache_mutex );
+    process_cache_enabled = enable;
+    if (!enable) process_cache.clear();
+}
+
+void clear_doc_cache () {
+    lock_guard<mutex> lock ( process_cache_mutex );
+    process_cache.clear();
+}
+
+
+// numeric init value.  Negative values must fit in an int32.
+static DataType parse_int ( const string& str ) {
+    if (str[0] == '+') return DataType ( BigInt::parse ( str.substr(1) ) );
+    if (str[0] != '-') return DataType ( BigInt::parse ( str ) );
+    BigInt mag = BigInt::parse ( str.substr(1) );
+    if (mag.num_words() > 1 || mag.word(0) > 0x80000000u)
+        throw Exception ( INVALID_TYPE, "Unsupported negative large integer.", str );
+    return (int32) (0u - mag.word(0));
+}
+
+void handle_init ( NodeRef reg, const string &init_str) {
+    string init = init_str;
+    vector<string> array;
+    do {
+        trim(init);
+        size_t pos = init.find(",");
+        if (string::npos == pos) {
+            array.push_back ( init );
+        } else {
+            string elem = init.substr(0,pos);
+            init=init.substr(pos+1); // skip the comma
+            array.push_back ( trim(elem) );
+        }
+    } while ( init.find(",") != string::npos );
+
+    vector<DataType> arraydt;
+    for (vector<string>::iterator itr = array.begin();
+             itr != array.end();
+             ++itr ) {
+             
+        string elem = *itr; 
+        if ( isnumeric(elem) ) {
+            // numeric, may be wider than 32 bits
+            arraydt.push_back ( parse_int ( elem ) ); 
+        } else {
+            // string init values are resolved when added to the di 
+            arraydt.push_back(elem);
+        } 
+
+    }
+
+    DataType initdt(0);
+    if (arraydt.size()==1) initdt = arraydt.at(0);
+    else initdt=arraydt;
+
+    reg->set_attr("init", initdt );
+}
+
+
+/**
+ * Parsed documents are cached by absolute path until
+ * the file is modified.  Cached documents are never
+ * modified, building the device interface copies the nodes.
+ * They are parsed outside any NodeArena so a cached document
+ * doesn't keep the arena of the first di that loaded it.
+ **/
+ParsedDocRef load_doc ( const string& path, LoadContext &ctx ) {
+    stringstream key;
+    key << ctx.parser_name << '|' << xabspath(path) << '|' << ctx.validate;
+    time_t mtime=0;
+    bool have_mtime = xmtime ( path, mtime );
+
+    {
+        unique_lock<mutex> lock ( process_cache_mutex, defer_lock );
+        if (ctx.shared) lock.lock();
+        DocCache::iterator itr = ctx.cache.find ( key.str() );
+        if (itr != ctx.cache.end()) {
+            if (have_mtime && itr->second.mtime == mtime) {
+                debug ( "Cached " << path );
+                ++ctx.stats.cache_hits;
+                return itr->second.doc;
+            }
+            ctx.cache.erase(itr);
+        }
+    }
+
+    CStopWatch timer;
+    timer.startTimer();
+    ParsedDocRef doc;
+    {
+        NodeArena::Suspend heap;
+        doc = ctx.parser ( path, ctx.validate );
+    }
+    timer.stopTimer();
+    ctx.stats.parse_time += timer.getElapsedTime();
+    ++ctx.stats.files_parsed;
+
+    if (have_mtime) {
+        unique_lock<mutex> lock ( process_cache_mutex, defer_lock );
+        if (ctx.shared) lock.lock();
+        CacheEntry &entry = ctx.cache[key.str()];
+        entry.doc = doc;
+        entry.mtime = mtime;
+    }
+    return doc;
+}
+
+
+void build_doc ( NodeRef dest, const ParsedDoc &doc, LoadContext &ctx );
+
+void add_terminal ( NodeRef di, const NodeRef &term ) {
+    NodeRef diterm = term->clone();
+    if (di->has_child ( diterm->get_name() ) ) di->del_child ( diterm->get_name() );
+    di->add_child ( diterm );
+}
+
+void apply_regover ( NodeRef term, const RegOverlayDef &overlay ) {
+    NodeRef origreg = term->get_child( overlay.name );
+    if (overlay.has_newname) {
+        origreg->set_name( overlay.newname );
+    }
+    if (overlay.has_addr) {
+        origreg->set_attr( "addr", overlay.addr );
+    }
+}
+
+
+void apply_termoverlay ( NodeRef di, const TermOverlayDef &overlay ) {
+    NodeRef origterm = di->get_child ( overlay.name );
+    if (overlay.has_newname) {
+        origterm->set_name(overlay.newname);
+    }
+    if (overlay.has_addr) {
+        origterm->set_attr("addr", overlay.addr);
+    }
+
+    for (vector<RegOverlayDef>::const_iterator itr = overlay.regs.begin(); itr != overlay.regs.end(); ++itr ) {
+        if ( itr->reg ) {
+            origterm->add_child( itr->reg->clone() );
+        } else {
+            apply_regover ( origterm, *itr );
+        }
+    }
+}
+
+void handle_include ( NodeRef dest, const DocItem &include, const string &orig_path, LoadContext &ctx ) {
+     NodeRef includedi = DeviceInterface::create("includedi");
+     string unique_fake_term_name = "fake_addr_term879873498723947293797998749527"; 
+     if ( dest->has_children() ) {
+        /**
+         * To make sure the included terminals are 
+         * auto-number (address) from the correct 
+         * address number, we need a fake terminal
+         **/
+        NodeRef fake_addr_term = Terminal::create(unique_fake_term_name);
+        NodeRef last_real_term = *(dest->child_end()-1);
+        fake_addr_term->set_attr("addr", last_real_term->get_attr("addr"));
+        includedi->add_child(fake_addr_term);
+     }
+     
+     // resolve src path to abs path
+     string absdir = xdirname ( orig_path );
+     string abspath = xjoin ( absdir , include.src );
+
+     ParsedDocRef doc = load_doc ( abspath, ctx );
+     ctx.includes.push_back ( abspath );
+     build_doc ( includedi, *doc, ctx );
+
+     for (vector<TermOverlayDef>::const_iterator itr = include.overlays.begin(); itr != include.overlays.end(); ++itr ) {
+         apply_termoverlay ( includedi, *itr );
+     }
+
+     for ( DITreeIter itr = includedi->child_begin(); itr != includedi->child_end(); ++itr ) {
+         NodeRef iterm = (*itr)->clone();
+         if (iterm->get_name() != unique_fake_term_name ) {
+             if (dest->has_child( iterm->get_name() ) ) dest->del_child ( iterm->get_name() );
+             dest->add_child(iterm);
+         }
+     }
+}
+
+void build_doc ( NodeRef dest, const ParsedDoc &doc, LoadContext &ctx ) {
+    for (vector<pair<string,DataType> >::const_iterator itr = doc.attrs.begin(); itr != doc.attrs.end(); ++itr ) {
+        dest->set_attr ( itr->first, itr->second );
+    }
+    for (vector<DocItem>::const_iterator itr = doc.items.begin(); itr != doc.items.end(); ++itr ) {
+        if (itr->term) add_terminal ( dest, itr->term );
+        else handle_include ( dest, *itr, doc.path, ctx );
+    }
+}
+
+
+void load_doc_tree ( NodeRef node, const string& path, DocParser parser, const char* parser_name,
+                     bool validate, vector<string> &includes, XmlReader::Stats &stats ) {
+
+    includes.clear();
+    memset ( &stats, 0, sizeof(stats) );
+
+    CStopWatch timer;
+    timer.startTimer();
+
+    DocCache load_cache;
+    bool shared;
+    {
+        lock_guard<mutex> lock ( process_cache_mutex );
+        shared = process_cache_enabled;
+    }
+    LoadContext ctx ( parser, parser_name, validate, includes, stats,
+                      shared ? process_cache : load_cache, shared );
+    ParsedDocRef doc = load_doc ( path, ctx );
+    build_doc ( node, *doc, ctx );
+
+    timer.stopTimer();
+    stats.build_time = timer.getElapsedTime() - stats.parse_time;
+    debug ( path << ": parse " << stats.parse_time << "s build " << stats.build_time << "s "
+            << stats.files_parsed << " files parsed " << stats.cache_hits << " cached" );
+
+}
+
+
+} // end namespace
@@ -0,0 +1,82 @@
+#ifndef NITRO_DIDOC_H
+#define NITRO_DIDOC_H
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include <nitro/types.h>
+#include <nitro/xmlreader.h>
+
+/**
+ * Parsed form of a device interface xml file shared by the
+ * xml readers.
+ *
+ * A file is parsed into a list of terminals and includes.
+ * Building the device interface from the parsed form is
+ * repeated for every include so the parsed form of a
+ * file can be shared by each place it is included.
+ **/
+
+std::string& trim ( std::string& s );
+bool isnumeric ( const std::string& s );
+
+namespace Nitro {
+
+struct RegOverlayDef {
+    NodeRef reg; // register added by the overlay, or NULL for a regoverlay
+    std::string name;
+    bool has_newname;
+    std::string newname;
+    bool has_addr;
+    uint32 addr;
+    RegOverlayDef() : has_newname(false), has_addr(false), addr(0) {}
+};
+
+struct TermOverlayDef {
+    std::string name;
+    bool has_newname;
+    std::string newname;
+    bool has_addr;
+    uint32 addr;
+    std::vector<RegOverlayDef> regs;
+    TermOverlayDef() : has_newname(false), has_addr(false), addr(0) {}
+};
+
+struct DocItem {
+    NodeRef term; // terminal definition, or NULL for an include
+    std::string src;
+    std::vector<TermOverlayDef> overlays;
+};
+
+struct ParsedDoc {
+    std::string path;
+    std::vector<std::pair<std::string,DataType> > attrs; // attributes of a deviceinterface root
+    std::vector<DocItem> items;
+};
+typedef std::shared_ptr<const ParsedDoc> ParsedDocRef;
+
+/**
+ * Parse one file.  Includes are not followed.
+ **/
+typedef ParsedDocRef (*DocParser) ( const std::string& path, bool validate );
+
+/**
+ * Parse path and every file it includes and add the terminals to node.
+ * \param parser_name Documents are only shared between loads with the
+ *      same parser.
+ **/
+void load_doc_tree ( NodeRef node, const std::string& path, DocParser parser, const char* parser_name,
+                     bool validate, std::vector<std::string> &includes, XmlReader::Stats &stats );
+
+void set_doc_cache ( bool enable );
+void clear_doc_cache ();
+
+/**
+ * Set the init attribute from a comma separated list.
+ **/
+void handle_init ( NodeRef reg, const std::string &init_str );
+
+} // end namespace
+
+#endif
@@ -110,6 +110,10 @@ string make_str( int32 m_err, const string* m_str, DataType m_userdata ) {
                 return MAKESTR("Device operation error.");
             case DEVICE_PARSE_ERROR:
                 return MAKESTR("Device parse error.");
+            case DEVICE_CANCELLED:
+                return MAKESTR("Device I/O cancelled.");
+            case DEVICE_TIMEOUT:
+                return MAKESTR("Timed out waiting for device.");
 
 
 
@@ -139,6 +143,8 @@ string make_str( int32 m_err, const string* m_str, DataType m_userdata ) {
                 return MAKESTR("User Device function didn't operate as expected.");
             case USB_FIRMWARE:
                 return MAKESTR("Invalid USB firmware." );
+            case USB_TIMEOUT:
+                return MAKESTR("Usb transfer timed out." );
 
             case SCRIPTS_INIT:
                 return MAKESTR("Cannot initialized script engine.");
@@ -149,6 +155,16 @@ string make_str( int32 m_err, const string* m_str, DataType m_userdata ) {
             case SCRIPTS_SCRIPT:
                 return MAKESTR("Error executing user script.");
 
+            case RECORDER_IO:
+                return MAKESTR("Recorder file I/O error.");
+            case RECORDER_FORMAT:
+                return MAKESTR("Invalid recorder capture file.");
+
+            case BIN_FORMAT:
+                return MAKESTR("Invalid binary device interface.");
+            case BIN_STALE:
+                return MAKESTR("Binary device interface is out of date.");
+
             default:
                 return MAKESTR("Unknown Nitro error.");
         }  
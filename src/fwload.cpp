@@ -0,0 +1,177 @@
+/**
+ * Copyright (C) 2009 Ubixum, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ **/
+
+#include <cstring>
+
+#include "fwload.h"
+#include "ihx.h"
+#include "hr_time.h"
+
+#define FX2_RAM_CHUNK 1024
+#define FX3_RAM_CHUNK 4096
+#define FX2_CPUCS 0xe600
+
+using namespace std;
+
+namespace Nitro {
+
+void ram_writes ( uint32 addr, const uint8* data, size_t length, size_t max_length, bool fx3, vector<RamWrite>& writes ) {
+    for (size_t done=0; done<length; ) {
+        size_t n = length-done > max_length ? max_length : length-done;
+        uint32 a = addr + (uint32)done;
+        RamWrite w = { (uint16)(a & 0xffff), (uint16)(fx3 ? a >> 16 : 0), data+done, (uint16)n };
+        writes.push_back ( w );
+        done += n;
+    }
+}
+
+static void fx2_cpu_reset ( FirmwareTransport& t, bool reset ) {
+    static const uint8 hold=1, run=0;
+    vector<RamWrite> writes;
+    ram_writes ( FX2_CPUCS, reset ? &hold : &run, 1, 1, false, writes );
+    t.write_ram_blocks ( writes, 1000 );
+}
+
+static void put_le ( uint8* buf, uint64 v, int n ) {
+    for (int i=0;i<n;++i) buf[i] = (uint8)(v >> (8*i));
+}
+
+static bool stamp_blocks ( const IhxFile& blocks, uint8 stamp[FW_STAMP_LEN] ) {
+    // FNV-1a over each block's address and bytes
+    uint64 hash = 14695981039346656037ULL;
+    uint32 total = 0;
+    for (IhxFile::const_iterator itr=blocks.begin(); itr != blocks.end(); ++itr) {
+        uint32 end = itr->addr + (uint32)itr->bytes.size();
+        if (itr->addr < FW_STAMP_ADDR + FW_STAMP_LEN && end > FW_STAMP_ADDR) return false;
+        uint8 addr[2];
+        put_le ( addr, itr->addr, 2 );
+        for (int i=0;i<2;++i) {
+            hash ^= addr[i];
+            hash *= 1099511628211ULL;
+        }
+        for (size_t i=0;i<itr->bytes.size();++i) {
+            hash ^= itr->bytes[i];
+            hash *= 1099511628211ULL;
+        }
+        total += itr->bytes.size();
+    }
+    memcpy ( stamp, FW_STAMP_MAGIC, 4 );
+    put_le ( stamp+4, hash, 8 );
+    put_le ( stamp+12, total, 4 );
+    return true;
+}
+
+bool ihx_stamp ( const char* bytes, size_t length, uint8 stamp[FW_STAMP_LEN] ) {
+    return stamp_blocks ( coalesce_ihx ( parse_ihx ( bytes, length ) ), stamp );
+}
+
+bool ihx_loaded ( FirmwareTransport& t, const char* bytes, size_t length ) {
+    IhxFile blocks = coalesce_ihx ( parse_ihx ( bytes, length ) );
+    uint8 expect[FW_STAMP_LEN], stamp[FW_STAMP_LEN];
+    if (!stamp_blocks ( blocks, expect )) return false;
+    int ret = t.read_ram ( FW_STAMP_ADDR, 0, stamp, FW_STAMP_LEN, 1000 );
+    if (ret != FW_STAMP_LEN || memcmp ( stamp, expect, FW_STAMP_LEN )) return false;
+
+    // another loader can replace the image and leave the stamp, so the
+    // image itself has to be in ram too
+    uint8 buf[FX2_RAM_CHUNK];
+    for (IhxFile::iterator itr=blocks.begin(); itr != blocks.end(); ++itr ) {
+        for (size_t done=0; done<itr->bytes.size(); ) {
+            uint16 n = itr->bytes.size()-done > FX2_RAM_CHUNK ? FX2_RAM_CHUNK : (uint16)(itr->bytes.size()-done);
+            ret = t.read_ram ( (uint16)(itr->addr+done), 0, buf, n, 1000 );
+            if (ret != n || memcmp ( buf, itr->bytes.data()+done, n )) return false;
+            done += n;
+        }
+    }
+    return true;
+}
+
+void load_ihx ( FirmwareTransport& t, const char* bytes, size_t length ) {
+
+    IhxFile blocks = coalesce_ihx ( parse_ihx ( bytes, length ) );
+
+    vector<RamWrite> writes;
+    for (IhxFile::iterator itr=blocks.begin(); itr != blocks.end(); ++itr ) {
+        ram_writes ( itr->addr, itr->bytes.data(), itr->bytes.size(), FX2_RAM_CHUNK, false, writes );
+    }
+    uint8 stamp[FW_STAMP_LEN];
+    if (stamp_blocks ( blocks, stamp )) {
+        ram_writes ( FW_STAMP_ADDR, stamp, FW_STAMP_LEN, FX2_RAM_CHUNK, false, writes );
+    }
+
+    fx2_cpu_reset ( t, true );
+    t.write_ram_blocks ( writes, 1000 );
+    fx2_cpu_reset ( t, false );
+}
+
+static uint32 get32 ( const uint8*& buf, const uint8* end ) {
+    if (end-buf < 4) throw Exception ( USB_FIRMWARE, "Image is truncated." );
+    uint32 v;
+    memcpy ( &v, buf, 4 );
+    buf += 4;
+    return v;
+}
+
+void load_fx3 ( FirmwareTransport& t, const char* bytes, size_t length ) {
+    const uint8* buf = (const uint8*) bytes;
+    const uint8* end = buf + length;
+
+    /* Check first 2 bytes, must be equal to 'CY'	*/
+    if ( length < 4 || strncmp((const char *) buf, "CY", 2) ) {
+        throw Exception ( USB_FIRMWARE, "Image does not have 'CY' at start. Aborting.", -2);
+    }
+    buf += 2;
+
+    /* Read 1 byte. bImageCTL	*/
+    if ( buf[0] & 0x01 ) {
+        throw Exception ( USB_FIRMWARE, "Image does not contain executable code.", -3);
+    }
+    buf += 1;
+
+    /* Read 1 byte. bImageType	*/
+    if ( !(buf[0] == 0xB0) ) {
+        throw Exception (USB_FIRMWARE, "Not a normal FW binary with checksum", -4);
+    }
+    buf += 1;
+
+    // every section goes out in one batch
+    vector<RamWrite> writes;
+    uint32 program_entry;
+    for (;;) {
+        /* Length in words and address of section 1,2,3,...	*/
+        uint32 dlen = get32 ( buf, end );
+        uint32 address = get32 ( buf, end );
+        if ( !dlen ) {
+            program_entry = address;
+            break;
+        }
+        if ((size_t)(end-buf)/4 < dlen) throw Exception ( USB_FIRMWARE, "Image is truncated." );
+        ram_writes ( address, buf, dlen*4, FX3_RAM_CHUNK, true, writes );
+        buf += dlen*4;
+    }
+    t.write_ram_blocks ( writes, 1000 );
+
+    nitro_sleep(1e6); // 1 second
+    // write the program entry point
+    writes.clear();
+    RamWrite entry = { (uint16)(program_entry & 0xffff), (uint16)(program_entry >> 16), NULL, 0 };
+    writes.push_back ( entry );
+    t.write_ram_blocks ( writes, 1000 );
+}
+
+} // end namespace
@@ -0,0 +1,92 @@
+#ifndef FWLOAD_H
+#define FWLOAD_H
+
+#include <vector>
+
+#include <nitro/types.h>
+#include <nitro/error.h>
+
+#include "vendor_commands.h"
+
+namespace Nitro {
+
+/**
+ * One VC_RDWR_RAM control transfer.  For the fx2 value is the ram
+ * address.  For the fx3 value and index are the low and high words of
+ * the address.  data is not owned.
+ **/
+struct RamWrite {
+    uint16 value;
+    uint16 index;
+    const uint8* data;
+    uint16 length;
+};
+
+/**
+ * Control transfers used to load firmware.  USBDevice implements it
+ * with libusb.  Anything that implements it can be loaded, which lets
+ * the loaders run against an emulated device.
+ **/
+class FirmwareTransport {
+    public:
+        virtual ~FirmwareTransport() {}
+
+        /**
+         * Send the writes to the device in order.  Implementations may
+         * keep several in flight.  Zero length writes carry only value
+         * and index.
+         * \throw Exception USB_COMM if a write fails.  Writes after it
+         *  may or may not have been sent.
+         **/
+        virtual void write_ram_blocks ( const std::vector<RamWrite>& writes, uint32 timeout ) = 0;
+
+        /**
+         * Read device ram with one VC_RDWR_RAM transfer.  value and
+         * index are the same as for RamWrite.
+         * \return bytes read or a negative error.
+         **/
+        virtual int read_ram ( uint16 value, uint16 index, uint8* data, uint16 length, uint32 timeout ) = 0;
+};
+
+/**
+ * Split a block of device ram into control transfers of at most
+ * max_length bytes.  With fx3 set the 32 bit address is split across
+ * value and index.  The writes point into data.
+ **/
+void ram_writes ( uint32 addr, const uint8* data, size_t length, size_t max_length, bool fx3, std::vector<RamWrite>& writes );
+
+/**
+ * Build the FW_STAMP_ADDR stamp for an intel hex image.  The hash is
+ * taken over the coalesced blocks so the record order in the file does
+ * not matter.
+ * \return false if the image itself covers the stamp bytes.
+ * \throw Exception if the image does not parse.
+ **/
+bool ihx_stamp ( const char* bytes, size_t length, uint8 stamp[FW_STAMP_LEN] );
+
+/**
+ * Whether the fx2 runs this intel hex image.  The stamp load_ihx left
+ * in ram has to match and the image blocks are read back and compared,
+ * since loading with another tool replaces the image but not the stamp.
+ * Unreadable ram counts as not loaded.
+ * \throw Exception if the image does not parse.
+ **/
+bool ihx_loaded ( FirmwareTransport& t, const char* bytes, size_t length );
+
+/**
+ * Hold the fx2 cpu in reset, load an intel hex image and let the cpu
+ * run.  Records are coalesced and sent as one pipelined batch along
+ * with the image stamp.
+ * \throw Exception
+ **/
+void load_ihx ( FirmwareTransport& t, const char* bytes, size_t length );
+
+/**
+ * Load an fx3 boot image ("CY" header) and jump to its entry point.
+ * \throw Exception
+ **/
+void load_fx3 ( FirmwareTransport& t, const char* bytes, size_t length );
+
+} // end namespace
+
+#endif
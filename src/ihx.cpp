@@ -24,6 +24,7 @@
 #include <iostream>
 #include <iomanip>
 #include <iterator>
+#include <algorithm>
 
 using namespace Nitro;
 
@@ -76,3 +77,34 @@ IhxFile parse_ihx ( const char* bytes, size_t length ) {
     return ihxfile;
 
 }
+
+IhxFile coalesce_ihx ( const IhxFile& ihx ) {
+
+    // paint the records on an image of the 64k address space (plus
+    // the tail of a record starting near the top) so overlaps resolve
+    // in file order.
+    const size_t space = 0x10000 + 0x100;
+    std::vector<uint8> image ( space );
+    std::vector<bool> used ( space );
+    for (IhxFile::const_iterator itr=ihx.begin(); itr != ihx.end(); ++itr ) {
+        std::copy ( itr->bytes.begin(), itr->bytes.end(), image.begin() + itr->addr );
+        std::fill ( used.begin() + itr->addr, used.begin() + itr->addr + itr->bytes.size(), true );
+    }
+
+    IhxFile blocks;
+    size_t addr=0;
+    while (addr < space) {
+        if (!used[addr]) {
+            ++addr;
+            continue;
+        }
+        size_t end=addr;
+        while (end < space && used[end]) ++end;
+        IhxRecord block;
+        block.addr = (uint16)addr;
+        block.bytes.assign ( image.begin() + addr, image.begin() + end );
+        blocks.push_back ( block );
+        addr = end;
+    }
+    return blocks;
+}
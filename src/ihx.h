@@ -28,5 +28,13 @@ typedef std::vector<IhxRecord> IhxFile;
  **/
 IhxFile parse_ihx ( const char *bytes, size_t length ) ; 
 
+/**
+ * Merge adjacent and overlapping records into the fewest contiguous
+ * blocks.  Where records overlap the later record wins, the same as
+ * writing them in file order.  Blocks are returned in address order.
+ * Block sizes are not limited by the 255 byte record length.
+ **/
+IhxFile coalesce_ihx ( const IhxFile& ihx );
+
 #endif
 
@@ -27,13 +27,24 @@
 #include <queue>
 #include <mutex>
 #include <atomic>
+#include <functional>
+#include <chrono>
 #include <algorithm> // remove_if
 
+#include "pipethrottle.h"
+
 //typedef std::vector<struct usb_device*> DeviceList;
 //typedef std::vector<struct usb_device*>::iterator DeviceListItr;
 
 namespace Nitro {
 
+#define NITRO_TX_SIZE  (64*1024) // seemed to be the fastest buffer size
+#define NITRO_TX_QUEUE_DEPTH 32 
+#define NITRO_TX_THROTTLE_DEPTH 2 // default pipe urbs in flight while register I/O runs
+#define NITRO_TX_THROTTLE_HOLD 10 // default ms pipes stay throttled after register I/O
+
+struct usb_async_tx_struct;
+
 struct USBDevice::impl : public usbdev_impl_core {
     /**
      * Need to initialize once per process (lib load)
@@ -50,6 +61,9 @@ struct USBDevice::impl : public usbdev_impl_core {
         mutable std::mutex handle_lock; // need for non-thread safe read/write
         libusb_device_handle* m_dev;
 
+        std::mutex m_active_lock; // protects m_active
+        std::vector<std::shared_ptr<usb_async_tx_struct>> m_active; // bulk transfers in progress
+
         void config_device();
         void check_open() const;
 
@@ -212,7 +226,19 @@ struct USBDevice::impl : public usbdev_impl_core {
         uint8 m_read_ep;
         uint8 m_write_ep;
 
-        impl(uint32 vid, uint32 pid): usbdev_impl_core(vid,pid), m_dev(NULL) { ++m_ref_count; }
+        std::function<uint32()> m_register_io; // Device::register_io_pending of the owner
+        PipeThrottle m_throttle;
+
+        /**
+         * Urbs a pipe transfer keeps queued.  Called from pipe callers
+         * and the libusb event thread.
+         **/
+        unsigned pipe_depth() {
+            return m_throttle.depth ( m_register_io() != 0 );
+        }
+
+        impl(uint32 vid, uint32 pid): usbdev_impl_core(vid,pid), m_dev(NULL),
+            m_throttle(NITRO_TX_QUEUE_DEPTH, NITRO_TX_THROTTLE_DEPTH, NITRO_TX_THROTTLE_HOLD) { ++m_ref_count; }
         ~impl() { close();
             --m_ref_count;
             if (m_initialized && !m_ref_count ) {
@@ -239,6 +265,13 @@ struct USBDevice::impl : public usbdev_impl_core {
 
         int control_transfer ( NITRO_DIR, NITRO_VC, uint16 value, uint16 index, uint8* data, size_t length, uint32 timeout );
         int bulk_transfer ( NITRO_DIR, uint8 ep, uint8* data, size_t length, uint32 timeout );
+        void write_ram_blocks ( const std::vector<RamWrite>& writes, uint32 timeout );
+
+        /**
+         * Abort bulk transfers in progress on ep.  Safe to call from any
+         * thread.
+         **/
+        void cancel_transfers ( uint8 ep );
 
         void close();
 
@@ -562,10 +595,119 @@ int USBDevice::impl::control_transfer ( NITRO_DIR d, NITRO_VC c, uint16 value, u
    return libusb_control_transfer( m_dev, type, c, value, index, data, length, timeout );
 }
 
-#define NITRO_TX_SIZE  (64*1024) // seemed to be the fastest buffer size
-#define NITRO_TX_QUEUE_DEPTH 32 
+#define NITRO_CTRL_QUEUE_DEPTH 8 // ram writes in flight while loading firmware
+
+/**
+ * Ram writes submitted asynchronously.  A finished transfer is refilled
+ * with the next write from the callback so the control pipe always has
+ * writes queued.  Control transfers on a pipe complete in order.
+ **/
+struct usb_ctrl_batch {
+    std::mutex mutex;
+    libusb_device_handle* dev;
+    const std::vector<RamWrite>* writes;
+    size_t next; // next write to submit
+    unsigned in_flight;
+    unsigned timeout;
+    int err; // first libusb error
+    int completed;
+
+    // requires mutex.  Returns false if tx was not submitted.
+    bool submit ( libusb_transfer* tx ) {
+        if (err || next >= writes->size()) return false;
+        const RamWrite& w = (*writes)[next];
+        uint8* buf = tx->buffer;
+        libusb_fill_control_setup ( buf, 0x40, VC_RDWR_RAM, w.value, w.index, w.length );
+        if (w.length) memcpy ( buf + LIBUSB_CONTROL_SETUP_SIZE, w.data, w.length );
+        libusb_fill_control_transfer ( tx, dev, buf, usb_ctrl_callback, this, timeout );
+        int ret = libusb_submit_transfer ( tx );
+        if (ret) {
+            err = ret;
+            return false;
+        }
+        ++next;
+        ++in_flight;
+        return true;
+    }
+
+    static int status_error ( libusb_transfer* tx ) {
+        switch (tx->status) {
+            case LIBUSB_TRANSFER_COMPLETED:
+                return tx->actual_length == tx->length - LIBUSB_CONTROL_SETUP_SIZE ? 0 : LIBUSB_ERROR_IO;
+            case LIBUSB_TRANSFER_TIMED_OUT: return LIBUSB_ERROR_TIMEOUT;
+            case LIBUSB_TRANSFER_STALL: return LIBUSB_ERROR_PIPE;
+            case LIBUSB_TRANSFER_NO_DEVICE: return LIBUSB_ERROR_NO_DEVICE;
+            case LIBUSB_TRANSFER_OVERFLOW: return LIBUSB_ERROR_OVERFLOW;
+            default: return LIBUSB_ERROR_IO;
+        }
+    }
+
+    static void LIBUSB_CALL usb_ctrl_callback ( libusb_transfer* tx ) {
+        usb_ctrl_batch* batch = (usb_ctrl_batch*)tx->user_data;
+        std::lock_guard<std::mutex> lock ( batch->mutex );
+        --batch->in_flight;
+        int ret = status_error ( tx );
+        if (ret && !batch->err) batch->err = ret;
+        batch->submit ( tx );
+        if (!batch->in_flight) batch->completed = 1;
+    }
+};
+
+void USBDevice::impl::write_ram_blocks ( const std::vector<RamWrite>& writes, uint32 timeout ) {
+    check_open();
+    if (writes.empty()) return;
+
+    usb_ctrl_batch batch;
+    batch.dev = m_dev;
+    batch.writes = &writes;
+    batch.next = 0;
+    batch.in_flight = 0;
+    batch.timeout = timeout;
+    batch.err = 0;
+    batch.completed = 0;
+
+    size_t max_length = 0;
+    for (std::vector<RamWrite>::const_iterator itr=writes.begin(); itr != writes.end(); ++itr)
+        max_length = std::max ( max_length, (size_t)itr->length );
+    size_t depth = std::min ( writes.size(), (size_t)NITRO_CTRL_QUEUE_DEPTH );
+    std::vector<std::vector<uint8> > bufs ( depth, std::vector<uint8> ( LIBUSB_CONTROL_SETUP_SIZE + max_length ) );
+    std::vector<libusb_transfer*> txs;
+
+    {
+        std::lock_guard<std::mutex> lock ( batch.mutex );
+        for (size_t i=0;i<depth;++i) {
+            libusb_transfer* tx = libusb_alloc_transfer(0);
+            if (!tx) {
+                batch.err = LIBUSB_ERROR_NO_MEM;
+                break;
+            }
+            txs.push_back ( tx );
+            tx->buffer = &bufs[i][0];
+            if (!batch.submit ( tx )) break;
+        }
+        if (!batch.in_flight) batch.completed = 1;
+    }
 
-typedef struct {
+    timeval tv = { 1, 0 };
+    while (!batch.completed) {
+        int ret = libusb_handle_events_timeout_completed ( NULL, &tv, &batch.completed );
+        if (ret) {
+            // stop refilling and let the queued transfers finish
+            std::lock_guard<std::mutex> lock ( batch.mutex );
+            if (!batch.err) batch.err = ret;
+        }
+    }
+
+    for (size_t i=0;i<txs.size();++i) libusb_free_transfer ( txs[i] );
+
+    if (batch.err) {
+        throw Exception ( USB_COMM, "Failed to transfer bytes to usb device memory.", libusb_error_name(batch.err) );
+    }
+    usb_debug ( "Transfered " << writes.size() << " ram blocks to device." );
+}
+
+
+typedef struct usb_async_tx_struct {
     std::mutex *devlock;
     libusb_device_handle **dev;
     uint8_t ep;
@@ -577,6 +719,8 @@ typedef struct {
     unsigned timeout;
     int err;
     int completed;
+    int32 aborted; // USB_TIMEOUT or DEVICE_CANCELLED once the transfers are cancelled
+    std::function<unsigned()> depth; // urbs to keep in flight
     std::mutex mutex;
 
 } usb_async_tx_struct;
@@ -632,7 +776,12 @@ void usb_tx_callback(libusb_transfer *tx) {
 	    usb_tx_free_helper(tx, "libusb error" );    
     } else {
         tx_struct->transferred += tx->actual_length;
-        usb_tx_submit_helper(tx_struct, tx); // resubmit or free
+        if (tx_struct->transfers.size() >= tx_struct->depth()) {
+            // throttled, the queue drains to the new depth
+            usb_tx_free_helper(tx, "throttled");
+        } else {
+            usb_tx_submit_helper(tx_struct, tx); // resubmit or free
+        }
     }
     tx_struct->completed = tx_struct->transfers.size() == 0 ? 1 : 0;
 }
@@ -645,9 +794,9 @@ void usb_tx_submit_helper(tx_struct_ptr tx_struct, libusb_transfer *tx) {
     // note tx_struct always locked first!
     std::lock_guard<std::mutex> lock ( *tx_struct->devlock);
 
-    if (tx_struct->queued >= tx_struct->length || !(*tx_struct->dev)) {
+    if (tx_struct->queued >= tx_struct->length || tx_struct->aborted || !(*tx_struct->dev)) {
         // in this case, we're done queuing, free the tx
-        // or the device has gone away
+        // or the transfer was aborted or the device has gone away
         if (tx) {
 	    usb_tx_free_helper(tx,"finished");
         }
@@ -687,6 +836,38 @@ void usb_tx_submit_helper(tx_struct_ptr tx_struct, libusb_transfer *tx) {
 }
 
 
+/**
+ * Queue urbs until the transfer has depth() in flight.  Requires
+ * tx_struct->mutex.
+ **/
+void usb_tx_fill(tx_struct_ptr tx_struct) {
+    unsigned depth = tx_struct->depth();
+    while (tx_struct->transfers.size() < depth && tx_struct->queued < tx_struct->length &&
+           !tx_struct->err && !tx_struct->aborted && *tx_struct->dev) {
+       usb_tx_submit_helper(tx_struct,NULL);
+    }
+}
+
+/**
+ * Cancel the queued urbs of a transfer.  Their callbacks come back with
+ * LIBUSB_TRANSFER_CANCELLED and nothing more is submitted.
+ **/
+void usb_tx_abort(usb_async_tx_struct& tx_struct, int32 code) {
+    std::lock_guard<std::mutex> lock(tx_struct.mutex);
+    if (tx_struct.aborted) return;
+    tx_struct.aborted = code;
+    for (auto tx : tx_struct.transfers) {
+        libusb_cancel_transfer(tx);
+    }
+}
+
+void USBDevice::impl::cancel_transfers ( uint8 ep ) {
+    std::lock_guard<std::mutex> lock(m_active_lock);
+    for (auto& tx_struct : m_active) {
+        if (tx_struct->ep == ep) usb_tx_abort(*tx_struct, DEVICE_CANCELLED);
+    }
+}
+
 int USBDevice::impl::bulk_transfer ( NITRO_DIR d, uint8 ep, uint8* data, size_t length, uint32 timeout ) {
    check_open();
   //int transferred=0;
@@ -701,24 +882,54 @@ int USBDevice::impl::bulk_transfer ( NITRO_DIR d, uint8 ep, uint8* data, size_t
    tx_struct->transferred = 0;
    tx_struct->err=0;
    tx_struct->completed = 0;
+   tx_struct->aborted = 0;
    tx_struct->timeout=timeout;
    usb_debug ( "Transfer Timeout " << timeout ); 
 
-    timeval tv;
-    tv.tv_sec = timeout / 1e3;
-    tv.tv_usec = (timeout % 1000) * 1e3;
+   // pipes stream many urbs ahead.  While register I/O is pending they
+   // keep only a few queued so register transfers don't wait behind
+   // them on the bus.
+   if (ep != m_read_ep && ep != m_write_ep && m_register_io) {
+       tx_struct->depth = [this]() { return pipe_depth(); };
+   } else {
+       tx_struct->depth = []() { return (unsigned)NITRO_TX_QUEUE_DEPTH; };
+   }
 
-    auto stop = std::chrono::system_clock::now() + std::chrono::seconds(tv.tv_sec) + std::chrono::microseconds(tv.tv_usec);
+    // the timeout covers the whole transfer, not each urb
+    bool deadline = timeout > 0;
+    auto stop = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
 
+    {
+        std::lock_guard<std::mutex> lock(m_active_lock);
+        m_active.push_back(tx_struct);
+    }
 
     tx_struct->mutex.lock();
-    while (tx_struct->transfers.size() < NITRO_TX_QUEUE_DEPTH && tx_struct->queued < length && !tx_struct->err) {
-       usb_tx_submit_helper(tx_struct,NULL);
-    }
+    usb_tx_fill(tx_struct);
+    if (tx_struct->transfers.empty()) tx_struct->completed = 1; // nothing submitted
     tx_struct->mutex.unlock();
 
    // the tx callback queues events adding to transferred   '
     while (!tx_struct->completed) {
+        {
+            // grow back to full depth once register I/O is done
+            std::lock_guard<std::mutex> lock(tx_struct->mutex);
+            usb_tx_fill(tx_struct);
+        }
+        timeval tv = { 1, 0 };
+        if (deadline) {
+            auto left = std::chrono::duration_cast<std::chrono::microseconds>(stop - std::chrono::steady_clock::now()).count();
+            if (left <= 0) {
+                usb_debug ( "Transfer deadline passed, cancelling." );
+                usb_tx_abort(*tx_struct, USB_TIMEOUT);
+                deadline = false; // now wait for the cancelled urbs
+                continue;
+            }
+            if (left < 1000000) {
+                tv.tv_sec = 0;
+                tv.tv_usec = left;
+            }
+        }
         int ret;
         //usb_debug("libusb_handle_events..");
         if ((ret = libusb_handle_events_timeout_completed(NULL, &tv, &tx_struct->completed))) {
@@ -726,11 +937,22 @@ int USBDevice::impl::bulk_transfer ( NITRO_DIR d, uint8 ep, uint8* data, size_t
         }
     }
 
+    {
+        std::lock_guard<std::mutex> lock(m_active_lock);
+        m_active.erase(std::remove(m_active.begin(), m_active.end(), tx_struct), m_active.end());
+    }
+
    // tx_struct empty now so no need to lock mutex
    assert(tx_struct.use_count()==1); // we have a bug in the libusb or usage of it if   
    // refs haven't all been cleaned up.
 
    if (tx_struct->err || tx_struct->transferred < length ) {
+     if (tx_struct->aborted == DEVICE_CANCELLED) {
+       throw Exception ( DEVICE_CANCELLED, "bulk transfer cancelled", tx_struct->transferred );
+     }
+     if (tx_struct->aborted == USB_TIMEOUT) {
+       throw Exception ( USB_TIMEOUT, "bulk transfer deadline passed", tx_struct->transferred );
+     }
      DataType info(0);
      if (tx_struct->err >= LIBUSB_ERROR_OTHER) info = libusb_error_name(tx_struct->err);
      else info = tx_struct->err;
@@ -0,0 +1,155 @@
+/**
+ * Copyright (C) 2009 Ubixum, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ **/
+
+#include "lzblock.h"
+
+#include <cstring>
+#include <vector>
+
+#define LZ_MINMATCH 4
+#define LZ_HASH_LOG 14
+#define LZ_MAX_OFFSET 65535
+// the format requires the last 5 bytes to be literals and
+// the last match to start at least 12 bytes from the end.
+#define LZ_LAST_LITERALS 5
+#define LZ_MFLIMIT 12
+
+static inline uint32 read32 ( const uint8* p ) {
+    uint32 v;
+    memcpy ( &v, p, sizeof(v) );
+    return v;
+}
+
+static inline uint32 lz_hash ( uint32 v ) {
+    return (v * 2654435761U) >> (32-LZ_HASH_LOG);
+}
+
+size_t lz_bound ( size_t len ) {
+    return len + len/255 + 16;
+}
+
+// writes a length continuation (255,255,...,rest)
+static inline bool put_len ( uint8*& op, uint8* oend, size_t len ) {
+    while (len >= 255) {
+        if (op >= oend) return false;
+        *op++ = 255;
+        len -= 255;
+    }
+    if (op >= oend) return false;
+    *op++ = (uint8)len;
+    return true;
+}
+
+static bool put_sequence ( uint8*& op, uint8* oend, const uint8* lit, size_t lit_len, uint32 offset, size_t match_len, bool last ) {
+    if (op >= oend) return false;
+    uint8* token = op++;
+    *token = (uint8)((lit_len >= 15 ? 15 : lit_len) << 4);
+    if (lit_len >= 15 && !put_len ( op, oend, lit_len-15 )) return false;
+    if ((size_t)(oend-op) < lit_len) return false;
+    memcpy ( op, lit, lit_len );
+    op += lit_len;
+    if (last) return true;
+
+    if (oend-op < 2) return false;
+    *op++ = (uint8)(offset & 0xff);
+    *op++ = (uint8)(offset >> 8);
+    size_t ml = match_len - LZ_MINMATCH;
+    *token |= (uint8)(ml >= 15 ? 15 : ml);
+    if (ml >= 15 && !put_len ( op, oend, ml-15 )) return false;
+    return true;
+}
+
+size_t lz_compress ( const uint8* src, size_t len, uint8* dst, size_t dst_len ) {
+
+    uint8* op = dst;
+    uint8* oend = dst + dst_len;
+    size_t anchor = 0;
+
+    if (len > LZ_MFLIMIT) {
+        std::vector<uint32> table ( 1<<LZ_HASH_LOG, 0 );
+        size_t ip = 1; // position 0 is the implicit table value
+        size_t limit = len - LZ_MFLIMIT;
+        size_t match_limit = len - LZ_LAST_LITERALS;
+        while (ip < limit) {
+            uint32 seq = read32 ( src+ip );
+            uint32 h = lz_hash ( seq );
+            size_t ref = table[h];
+            table[h] = (uint32)ip;
+            if ( ip - ref > LZ_MAX_OFFSET || read32(src+ref) != seq ) {
+                ++ip;
+                continue;
+            }
+
+            size_t mlen = LZ_MINMATCH;
+            while (ip+mlen < match_limit && src[ref+mlen] == src[ip+mlen]) ++mlen;
+
+            if (!put_sequence ( op, oend, src+anchor, ip-anchor, (uint32)(ip-ref), mlen, false )) return 0;
+            ip += mlen;
+            anchor = ip;
+        }
+    }
+
+    if (!put_sequence ( op, oend, src+anchor, len-anchor, 0, 0, true )) return 0;
+    return op - dst;
+}
+
+static inline bool get_len ( const uint8*& ip, const uint8* iend, size_t &len ) {
+    uint8 b;
+    do {
+        if (ip >= iend) return false;
+        b = *ip++;
+        len += b;
+    } while (b == 255);
+    return true;
+}
+
+bool lz_decompress ( const uint8* src, size_t len, uint8* dst, size_t dst_len, size_t &out_len ) {
+
+    const uint8* ip = src;
+    const uint8* iend = src + len;
+    uint8* op = dst;
+    uint8* oend = dst + dst_len;
+
+    while (ip < iend) {
+        uint8 token = *ip++;
+        size_t lit_len = token >> 4;
+        if (lit_len == 15 && !get_len ( ip, iend, lit_len )) return false;
+        if ((size_t)(iend-ip) < lit_len || (size_t)(oend-op) < lit_len) return false;
+        memcpy ( op, ip, lit_len );
+        ip += lit_len;
+        op += lit_len;
+        if (ip == iend) break; // last sequence has no match
+
+        if (iend-ip < 2) return false;
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op-dst)) return false;
+
+        size_t mlen = token & 0x0f;
+        if (mlen == 15 && !get_len ( ip, iend, mlen )) return false;
+        mlen += LZ_MINMATCH;
+        if ((size_t)(oend-op) < mlen) return false;
+        // overlapping copy is intended (run length encoding)
+        const uint8* match = op - offset;
+        for (size_t i=0;i<mlen;++i) op[i] = match[i];
+        op += mlen;
+    }
+
+    out_len = op - dst;
+    return true;
+}
@@ -0,0 +1,29 @@
+#ifndef NITRO_LZBLOCK_H
+#define NITRO_LZBLOCK_H
+
+#include <nitro/types.h>
+
+/**
+ * Fast byte oriented block compression.  The output uses the LZ4 block
+ * layout (token, literals, 16 bit offset, match length) so captures can
+ * also be unpacked with standard lz4 block tools.
+ **/
+
+/**
+ * Worst case size of the compressed output for len input bytes.
+ **/
+size_t lz_bound ( size_t len );
+
+/**
+ * Compress src into dst.
+ * \return The compressed size or 0 if the result would not fit in dst_len.
+ **/
+size_t lz_compress ( const uint8* src, size_t len, uint8* dst, size_t dst_len );
+
+/**
+ * Decompress src into dst.
+ * \return false if the input is malformed or does not fit in dst_len.
+ **/
+bool lz_decompress ( const uint8* src, size_t len, uint8* dst, size_t dst_len, size_t &out_len );
+
+#endif
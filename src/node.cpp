@@ -24,12 +24,20 @@
 #include <sstream>
 #include <cctype> // isalnum
 #include <atomic>
+#include <algorithm>
+#include <cstddef> // max_align_t
+#include <memory>
+#include <mutex>
+#include <new>
+#include <set>
 
 #include <nitro/node.h>
+#include <nitro/bigint.h>
 #include <nitro/error.h>
 #include <nitro/xmlreader.h>
+#include <nitro/binreader.h>
+#include <nitro/binwriter.h>
 
-#include "bihelp.h"
 #include "xutils.h"
 
 namespace Nitro {
@@ -48,6 +56,32 @@ bool file_exists(const std::string &path) {
 
 #ifndef ANDROID
 
+/**
+ * Loaded xml files are cached in binary form.  By default the cache is
+ * written next to the xml file.  NITRO_DI_CACHE can name a directory
+ * to hold cache files instead, or be set to "off" to disable caching.
+ **/
+bool di_cache_path ( const std::string &xml_path, std::string &cache_path ) {
+    char *env = getenv ( "NITRO_DI_CACHE" );
+    if (!env || !*env) {
+        cache_path = xml_path + ".dicache";
+        return true;
+    }
+    std::string dir ( env );
+    if (dir == "off" || dir == "0") return false;
+
+    // unique file name per xml path
+    uint64 hash = 14695981039346656037ULL;
+    for (std::string::const_iterator i=xml_path.begin(); i != xml_path.end(); ++i) {
+        hash ^= (uint8)*i;
+        hash *= 1099511628211ULL;
+    }
+    std::ostringstream name;
+    name << std::hex << hash << ".dicache";
+    cache_path = xjoin ( dir, name.str() );
+    return true;
+}
+
 NodeRef load_di( const std::string &path, NodeRef dst ) {
     // construct list of paths to search
 
@@ -85,8 +119,42 @@ NodeRef load_di( const std::string &path, NodeRef dst ) {
         if (!found) throw Exception ( PATH_LOOKUP );
     }
 
+    // cache dependencies must not depend on the working directory
+    found_path = xabspath ( found_path );
+
+    // a complete di is allocated together
+    NodeArena arena;
+    std::unique_ptr<NodeArena::Scope> scope;
+    if (!dst->has_children()) scope.reset ( new NodeArena::Scope ( arena ) );
+
+    // the cache holds a complete di, it can't be merged into existing nodes.
+    std::string cache_path;
+    bool use_cache = !dst->has_children() && di_cache_path ( found_path, cache_path );
+    if (use_cache && file_exists ( cache_path )) {
+        try {
+            BinReader cache ( cache_path );
+            cache.read(dst);
+            node_debug ( "Loaded " << found_path << " from " << cache_path );
+            return dst;
+        } catch ( const Exception &e ) {
+            node_debug ( "Ignore di cache " << cache_path << ": " << e );
+        }
+    }
+
     XmlReader reader ( found_path );
     reader.read(dst);
+
+    if (use_cache) {
+        std::vector<std::string> deps ( 1, found_path );
+        deps.insert ( deps.end(), reader.includes().begin(), reader.includes().end() );
+        try {
+            BinWriter cache ( cache_path, deps );
+            cache.write(dst);
+        } catch ( const Exception &e ) {
+            // caching is best effort (read only install dirs etc.)
+            node_debug ( "Unable to write di cache " << cache_path << ": " << e );
+        }
+    }
     return dst;
 }
 
@@ -113,46 +181,286 @@ bool operator== ( NodeRef lhs, const DataType& rhs) {
 }
 
 
+//********** AttrKey *****************
+
+static const std::string* intern_attr ( const std::string& name ) {
+    static std::mutex lock;
+    static std::set<std::string> names; // set nodes don't move
+    std::lock_guard<std::mutex> guard ( lock );
+    return &*names.insert ( name ).first;
+}
+
+AttrKey::AttrKey ( const std::string& name ) : m_name ( intern_attr ( name ) ) {}
+AttrKey::AttrKey ( const char* name ) : m_name ( intern_attr ( name ) ) {}
+
+namespace Attr {
+    const AttrKey addr ( "addr" );
+    const AttrKey array ( "array" );
+    const AttrKey comment ( "comment" );
+    const AttrKey endian ( "endian" );
+    const AttrKey init ( "init" );
+    const AttrKey mode ( "mode" );
+    const AttrKey regAddrWidth ( "regAddrWidth" );
+    const AttrKey regDataWidth ( "regDataWidth" );
+    const AttrKey shadowed ( "shadowed" );
+    const AttrKey type ( "type" );
+    const AttrKey valuemap ( "valuemap" );
+    const AttrKey width ( "width" );
+}
+
+
+//********** NodeArena ***************
+
+// Memory for nodes created in a NodeArena::Scope.  Allocations are
+// never reused, the blocks are returned when the NodeArena and every
+// allocation have been released.
+struct Arena {
+    std::mutex m_lock;
+    std::vector<void*> m_blocks;
+    size_t m_block_size;
+    char* m_cur;
+    size_t m_left; // bytes left in m_cur
+    size_t m_bytes;
+    // the NodeArena plus one for each allocation in use
+    std::atomic<size_t> m_refs;
+
+    Arena ( size_t block_size ) : m_block_size ( block_size ), m_cur ( NULL ), m_left ( 0 ), m_bytes ( 0 ) {
+        m_refs=1;
+    }
+    virtual ~Arena() {
+        for (size_t i=0;i<m_blocks.size();++i) ::operator delete ( m_blocks[i] );
+    }
+    void* alloc ( size_t n );
+    void release() { if (--m_refs == 0) delete this; }
+};
+
+void* Arena::alloc ( size_t n ) {
+    const size_t align = alignof(std::max_align_t);
+    n = (n + align-1) & ~(align-1);
+    std::lock_guard<std::mutex> guard ( m_lock );
+    m_blocks.reserve ( m_blocks.size()+1 );
+    void* p;
+    if (n > m_block_size) {
+        // too big to share a block
+        p = ::operator new ( n );
+        m_blocks.push_back ( p );
+        m_bytes += n;
+    } else {
+        if (n > m_left) {
+            m_cur = (char*) ::operator new ( m_block_size );
+            m_blocks.push_back ( m_cur );
+            m_left = m_block_size;
+            m_bytes += m_block_size;
+        }
+        p = m_cur;
+        m_cur += n;
+        m_left -= n;
+    }
+    ++m_refs;
+    return p;
+}
+
+// arena of the active NodeArena::Scope
+static thread_local Arena* t_arena = NULL;
+
+// allocates shared_ptr control blocks and attributes in an arena
+template <class T>
+struct ArenaAlloc {
+    typedef T value_type;
+    Arena* m_arena;
+    ArenaAlloc ( Arena* arena ) : m_arena ( arena ) {}
+    template <class U> ArenaAlloc ( const ArenaAlloc<U>& o ) : m_arena ( o.m_arena ) {}
+    T* allocate ( size_t n ) { return (T*) m_arena->alloc ( n*sizeof(T) ); }
+    void deallocate ( T*, size_t ) { m_arena->release(); }
+    template <class U> bool operator== ( const ArenaAlloc<U>& o ) const { return m_arena == o.m_arena; }
+    template <class U> bool operator!= ( const ArenaAlloc<U>& o ) const { return m_arena != o.m_arena; }
+};
+
+struct ArenaDelete {
+    Arena* m_arena;
+    void operator() ( Node* node ) const {
+        node->~Node();
+        m_arena->release();
+    }
+};
+
+// memory for a new node object.  Derived create methods
+// construct the node in get() and pass it to ref().
+class NodeMem {
+    Arena* m_arena;
+    void* m_mem;
+  public:
+    NodeMem ( size_t n ) : m_arena ( t_arena ), m_mem ( m_arena ? m_arena->alloc ( n ) : ::operator new ( n ) ) {}
+    ~NodeMem() {
+        if (!m_mem) return;
+        // the constructor threw
+        if (m_arena) m_arena->release();
+        else ::operator delete ( m_mem );
+    }
+    void* get() const { return m_mem; }
+    NodeRef ref ( Node* node ) {
+        m_mem = NULL;
+        if (!m_arena) return NodeRef ( node );
+        ArenaDelete del = { m_arena };
+        return NodeRef ( node, del, ArenaAlloc<Node> ( m_arena ) );
+    }
+};
+
+struct NodeArena::impl : public Arena {
+    impl ( size_t block_size ) : Arena ( block_size ) {}
+};
+
+NodeArena::NodeArena ( size_t block_size ) : m_impl ( new impl ( block_size ) ) {}
+NodeArena::~NodeArena() throw() { m_impl->release(); }
+
+size_t NodeArena::bytes_allocated() const {
+    std::lock_guard<std::mutex> guard ( m_impl->m_lock );
+    return m_impl->m_bytes;
+}
+
+NodeArena::Scope::Scope ( NodeArena& arena ) : m_prev ( static_cast<NodeArena::impl*> ( t_arena ) ) {
+    t_arena = arena.m_impl;
+}
+NodeArena::Scope::~Scope() throw() { t_arena = m_prev; }
+
+NodeArena::Suspend::Suspend() : m_prev ( static_cast<NodeArena::impl*> ( t_arena ) ) {
+    t_arena = NULL;
+}
+NodeArena::Suspend::~Suspend() throw() { t_arena = m_prev; }
+
+
 //********** Node::impl **************
 
-typedef std::map<std::string,int> childrenmap_t;
+typedef std::map<std::string,NodeRef> childrenmap_t;
+typedef std::multimap<uint32,NodeRef> addrmap_t;
+typedef std::vector<std::pair<std::string,DataType> > attrlist_t;
+
+static bool attr_less ( const attrlist_t::value_type& a, const std::string& name ) {
+    return a.first < name;
+}
+
+// clones share attributes until one of them writes.  Only the
+// attributes are shared, each clone has its own nodes.
+struct AttrData {
+    // sorted by name.  keys holds the interned
+    // names in the same order for AttrKey lookups.
+	attrlist_t attrs;
+    std::vector<const std::string*> keys;
+};
 
 struct Node::impl {
 	std::string m_name;
 	std::vector<NodeRef> m_children;
 	childrenmap_t m_childrenmap;
-	std::map<std::string,DataType> m_attrmap;
-    static std::atomic<int> m_global_refs;
-    std::atomic<int> m_ref_count;
+    // children with integer addr attributes
+    addrmap_t m_addrmap;
+    // addresses in [m_free_base,m_free_next) are all used by children
+    uint32 m_free_base, m_free_next;
+    std::shared_ptr<AttrData> m_attrs;
     Node* m_parent;
-    void inc() { ++m_ref_count; ++m_global_refs; }
-    int dec() { --m_global_refs; return m_ref_count.fetch_sub(1); }
+    Arena* m_arena; // holding this impl or NULL
 
-	impl(const std::string &name) : m_name(name), m_parent(NULL) {
-        m_ref_count=0;
+	impl(const std::string &name, Arena* arena) : m_name(name), m_free_base(0), m_free_next(0),
+        m_attrs(arena ? std::allocate_shared<AttrData>(ArenaAlloc<AttrData>(arena)) : std::make_shared<AttrData>()),
+        m_parent(NULL), m_arena(arena) {
+    }
+    static impl* create ( const std::string& name ) {
+        Arena* arena = t_arena;
+        if (!arena) return new impl ( name, NULL );
+        void* mem = arena->alloc ( sizeof(impl) );
+        try {
+            return new (mem) impl ( name, arena );
+        } catch ( ... ) {
+            arena->release();
+            throw;
+        }
     }
 
 	bool has_child(const std::string &name);
+    // attributes for writing, unshared from any clones
+    AttrData& attrs_w() {
+        if (m_attrs.use_count() > 1) m_attrs = std::make_shared<AttrData>(*m_attrs);
+        // a clone in another thread may have just let go, its reads
+        // have to finish before this writes
+        else std::atomic_thread_fence ( std::memory_order_acquire );
+        return *m_attrs;
+    }
+    void put_attr ( const std::string& name, const DataType& value );
+    void index_add ( const NodeRef& child );
+    void index_del ( Node* child );
+    // index of name or -1
+    int find_attr ( const std::string& name ) const {
+        const attrlist_t& attrs = m_attrs->attrs;
+        attrlist_t::const_iterator itr = std::lower_bound ( attrs.begin(), attrs.end(), name, attr_less );
+        return itr != attrs.end() && itr->first == name ? (int)(itr - attrs.begin()) : -1;
+    }
+    // nodes have few attributes, a scan of pointers beats a search
+    int find_attr ( const AttrKey& key ) const {
+        const std::string* name = &key.str();
+        const std::vector<const std::string*>& keys = m_attrs->keys;
+        for (size_t i=0;i<keys.size();++i) 
+            if (keys[i] == name) return (int)i;
+        return -1;
+    }
     ~impl() {}
 };
 
 
-std::atomic<int> Node::impl::m_global_refs(0);
-
 bool Node::impl::has_child(const std::string &name) {	
 	return m_childrenmap.find( name ) != m_childrenmap.end();
 }
 
+static bool int_addr ( const Node* n, uint32& addr ) {
+    if (!n->has_attr("addr")) return false;
+    DataType a = n->get_attr("addr");
+    if (a.get_type() != INT_DATA && a.get_type() != UINT_DATA) return false;
+    addr = a;
+    return true;
+}
+
+void Node::impl::put_attr ( const std::string& name, const DataType& value ) {
+    AttrData& data = attrs_w();
+    attrlist_t::iterator itr = std::lower_bound ( data.attrs.begin(), data.attrs.end(), name, attr_less );
+    if (itr != data.attrs.end() && itr->first == name) {
+        itr->second = value;
+        return;
+    }
+    size_t i = itr - data.attrs.begin();
+    const std::string* key = intern_attr ( name );
+    data.keys.reserve ( data.keys.size()+1 ); // keep both lists in step
+    data.attrs.insert ( itr, std::make_pair ( name, value ) );
+    data.keys.insert ( data.keys.begin() + i, key );
+}
+
+void Node::impl::index_add ( const NodeRef& child ) {
+    uint32 addr;
+    if (int_addr ( child.get(), addr )) m_addrmap.insert ( std::make_pair ( addr, child ) );
+}
+
+void Node::impl::index_del ( Node* child ) {
+    uint32 addr;
+    if (!int_addr ( child, addr )) return;
+    std::pair<addrmap_t::iterator,addrmap_t::iterator> range = m_addrmap.equal_range ( addr );
+    for (addrmap_t::iterator itr = range.first; itr != range.second; ++itr) {
+        if (itr->second.get() == child) {
+            m_addrmap.erase ( itr );
+            break;
+        }
+    }
+    if (addr >= m_free_base && addr < m_free_next) m_free_next = addr;
+}
+
 
 //********** Node *********************
 
-Node::Node(const std::string &name) : m_impl(new impl(name)) {
+Node::Node(const std::string &name) : m_impl(impl::create(name)) {
 	
 }
 
 NodeRef Node::create ( const std::string& name ) {
     node_debug ( "Create Generic Node: " << name );
-    return NodeRef ( new Node ( name ) );
+    NodeMem mem ( sizeof(Node) );
+    return mem.ref ( new ( mem.get() ) Node ( name ) );
 }
 
 NodeRef Node::clone () const {
@@ -160,8 +468,22 @@ NodeRef Node::clone () const {
     // children, childrenmap, attrmap
     NodeRef copy = this->call_create ( get_name() );
     for ( DITreeIter itr = this->child_begin(); itr != this->child_end(); ++itr ) {
-        NodeRef child = (*itr)->clone();
-        copy->add_child ( child );
+        // the child attributes are already valid
+        copy->Node::add_child ( (*itr)->clone() );
+    }
+
+    // share the attributes unless node values need to be cloned or
+    // the copy was created with attributes this node doesn't have.
+    bool share = true;
+    for ( DIAttrIter itr = this->attrs_begin(); share && itr != this->attrs_end(); ++itr ) {
+        if ( itr->second.get_type() == NODE_DATA ) share = false;
+    }
+    for ( DIAttrIter itr = copy->attrs_begin(); share && itr != copy->attrs_end(); ++itr ) {
+        if ( m_impl->find_attr ( itr->first ) < 0 ) share = false;
+    }
+    if (share) {
+        copy->m_impl->m_attrs = m_impl->m_attrs;
+        return copy;
     }
 
     for ( DIAttrIter itr = this->attrs_begin(); itr != this->attrs_end(); ++itr ) {
@@ -180,8 +502,39 @@ bool Node::has_children()  const { return !m_impl->m_children.empty(); }
 
 
 NodeRef Node::get_child ( const std::string& name ) const {
-    if (!m_impl->has_child(name)) throw Exception ( NODE_NOT_FOUND, name );
-    return m_impl->m_children[m_impl->m_childrenmap[name]];
+    childrenmap_t::const_iterator itr = m_impl->m_childrenmap.find ( name );
+    if (itr == m_impl->m_childrenmap.end()) throw Exception ( NODE_NOT_FOUND, name );
+    return itr->second;
+}
+
+NodeRef Node::get_child_by_addr ( uint32 addr ) const {
+    std::pair<addrmap_t::const_iterator,addrmap_t::const_iterator> range = m_impl->m_addrmap.equal_range ( addr );
+    if (range.first == range.second) throw Exception ( NODE_NOT_FOUND, "No child with address", addr );
+    addrmap_t::const_iterator next = range.first;
+    if (++next == range.second) return range.first->second;
+    // shared address, the first child added wins
+    for (DITreeIter itr = child_begin(); itr != child_end(); ++itr ) {
+        for (next = range.first; next != range.second; ++next) 
+            if (next->second == *itr) return *itr;
+    }
+    throw Exception ( NODE_NOT_FOUND, "No child with address", addr );
+}
+
+bool Node::has_child_addr ( uint32 addr ) const {
+    return m_impl->m_addrmap.count ( addr ) > 0;
+}
+
+uint32 Node::free_child_addr ( uint32 start ) const {
+    if (start != m_impl->m_free_base) {
+        m_impl->m_free_base = m_impl->m_free_next = start;
+    }
+    uint32 addr = m_impl->m_free_next;
+    for (addrmap_t::const_iterator itr = m_impl->m_addrmap.lower_bound ( addr );
+         itr != m_impl->m_addrmap.end() && itr->first <= addr; ++itr ) {
+        if (itr->first == addr) ++addr;
+    }
+    m_impl->m_free_next = addr;
+    return addr;
 }
 
 bool Node::has_child ( const std::string& name ) const {
@@ -191,7 +544,16 @@ bool Node::has_child ( const std::string& name ) const {
 
 Node::~Node() throw() { 
     node_debug ( "Deleting Real Node " << std::hex << this );
-    delete m_impl;
+    // children can outlive the parent
+    for (std::vector<NodeRef>::iterator itr = m_impl->m_children.begin(); itr != m_impl->m_children.end(); ++itr )
+        (*itr)->m_impl->m_parent = NULL;
+    Arena* arena = m_impl->m_arena;
+    if (arena) {
+        m_impl->~impl();
+        arena->release();
+    } else {
+        delete m_impl;
+    }
 }
 
 const std::string& Node::get_name() const { return m_impl->m_name; }
@@ -201,9 +563,9 @@ void Node::set_name(const std::string& name) {
     m_impl->m_name = name;
     if (m_impl->m_parent) {
         childrenmap_t::iterator itr = m_impl->m_parent->m_impl->m_childrenmap.find ( orig_name );
-        int pos = itr->second;
+        NodeRef self = itr->second;
         m_impl->m_parent->m_impl->m_childrenmap.erase(itr);
-        m_impl->m_parent->m_impl->m_childrenmap[name] = pos;
+        m_impl->m_parent->m_impl->m_childrenmap[name] = self;
     }
 }
 
@@ -223,26 +585,24 @@ void Node::add_child(const NodeRef& node) {
     }
 	// child in order add to vector
 	m_impl->m_children.push_back(node);
-	m_impl->m_childrenmap[node->get_name()] = m_impl->m_children.size()-1;
+	m_impl->m_childrenmap[node->get_name()] = node;
+    m_impl->index_add ( node );
     node->m_impl->m_parent = this; 
 }
 
 void Node::del_child(const std::string& name) {
     node_debug ( get_name() << ": " << "del_child(" << name << ")" );
-    if (!m_impl->has_child(name))
+    childrenmap_t::iterator itr = m_impl->m_childrenmap.find ( name );
+    if (itr == m_impl->m_childrenmap.end())
         throw Exception ( NODE_NOT_FOUND, name ); 
 
-    NodeRef child = m_impl->m_children.at(m_impl->m_childrenmap[name]);
-
+    NodeRef child = itr->second;
+    m_impl->m_childrenmap.erase ( itr );
+    m_impl->index_del ( child.get() );
     child->m_impl->m_parent = NULL;
     m_impl->m_children.erase ( 
-        m_impl->m_children.begin() + 
-        m_impl->m_childrenmap[name] );
+        std::find ( m_impl->m_children.begin(), m_impl->m_children.end(), child ) );
 
-    m_impl->m_childrenmap.clear();
-    for (size_t i=0;i<m_impl->m_children.size();++i) 
-        m_impl->m_childrenmap[m_impl->m_children.at(i)->get_name()] = i;
-    
 }
 
 uint32 Node::num_children() const {
@@ -250,32 +610,52 @@ uint32 Node::num_children() const {
 }
 
 bool Node::has_attr( const std::string& name) const {
-    return m_impl->m_attrmap.find(name) != m_impl->m_attrmap.end();
+    return m_impl->find_attr(name) >= 0;
 }
 
 DataType Node::get_attr(const std::string& name) const {
     node_debug ( get_name() << ": get_attr(" << name << ")" );
-    // The old method caused a memory corruption in the attrmap
-    // it only occurred in C# bindings and when an invalid attr name
-    // was tested for.
-    if (!has_attr(name)) throw Exception ( NODE_ATTR_NOT_FOUND,  name );
-    return m_impl->m_attrmap.find(name)->second;
+    int i = m_impl->find_attr(name);
+    if (i<0) throw Exception ( NODE_ATTR_NOT_FOUND,  name );
+    return m_impl->m_attrs->attrs[i].second;
+}
+
+const DataType& Node::get_attr_ref(const AttrKey& key) const {
+    int i = m_impl->find_attr(key);
+    if (i<0) throw Exception ( NODE_ATTR_NOT_FOUND,  key.str() );
+    return m_impl->m_attrs->attrs[i].second;
+}
+
+uint32 Node::get_attr_uint(const AttrKey& key) const {
+    return get_attr_ref(key);
 }
 
 uint32 Node::num_attrs() const {
-    return m_impl->m_attrmap.size();
+    return m_impl->m_attrs->attrs.size();
 }
 
 
 void Node::set_attr(const std::string& name, const DataType& value) {
     node_debug ( get_name() << ": set_attr(" << name << ", " << value << ")" );
-    m_impl->m_attrmap.erase(name);
-	m_impl->m_attrmap.insert( make_pair( name, value ) );
+    // keep the parent's address index current
+    if (m_impl->m_parent && name == "addr") {
+        impl* parent = m_impl->m_parent->m_impl;
+        parent->index_del ( this );
+        m_impl->put_attr ( name, value );
+        parent->index_add ( parent->m_childrenmap[get_name()] );
+    } else {
+        m_impl->put_attr ( name, value );
+    }
 }
 
 
 void Node::del_attr(const std::string &name) {
-    m_impl->m_attrmap.erase(name);
+    int i = m_impl->find_attr(name);
+    if (i<0) return;
+    if (m_impl->m_parent && name == "addr") m_impl->m_parent->m_impl->index_del ( this );
+    AttrData& data = m_impl->attrs_w();
+    data.attrs.erase ( data.attrs.begin() + i );
+    data.keys.erase ( data.keys.begin() + i );
 }
 
 DITreeIter Node::child_begin() const { return m_impl->m_children.begin(); }
@@ -291,8 +671,8 @@ NodeRef Node::find_child(std::function<bool(NodeRef)> test) const {
 }
 
 
-DIAttrIter Node::attrs_begin() const { return m_impl->m_attrmap.begin(); }
-DIAttrIter Node::attrs_end() const { return m_impl->m_attrmap.end(); }
+DIAttrIter Node::attrs_begin() const { return m_impl->m_attrs->attrs.begin(); }
+DIAttrIter Node::attrs_end() const { return m_impl->m_attrs->attrs.end(); }
 
 
 std::ostream& operator << ( std::ostream& out, const NodeRef& n ) {
@@ -334,7 +714,8 @@ DeviceInterface::DeviceInterface( const std::string& name ) : Node (name ) {
 
 NodeRef DeviceInterface::create ( const std::string& name ) {
     node_debug ( "Create Device Interface: " << name );
-    return NodeRef ( new DeviceInterface ( name ) );
+    NodeMem mem ( sizeof(DeviceInterface) );
+    return mem.ref ( new ( mem.get() ) DeviceInterface ( name ) );
 }
 
 void DeviceInterface::set_name ( const std::string& name ) {
@@ -352,29 +733,11 @@ void DeviceInterface::add_child ( const NodeRef& node ) {
     if ( !node->has_attr( "regDataWidth" ) ) throw Exception ( NODE_ATTR_ERROR, "Terminal node missing regDataWidth: ", node->get_name() );
 
     if (node->has_attr("addr")) {
-        uint32 node_addr = node->get_attr("addr");
-        for ( DITreeIter itr = child_begin(); itr != child_end(); ++itr ) {
-           uint32 child_addr = (*itr)->get_attr("addr");
-           if (node_addr == child_addr) throw Exception ( NODE_ATTR_ERROR, "Terminal address already exists in device interface.", node_addr );
-        }
+        uint32 node_addr = node->get_attr_uint(Attr::addr);
+        if (has_child_addr(node_addr)) throw Exception ( NODE_ATTR_ERROR, "Terminal address already exists in device interface.", node_addr );
     } else {
         // auto assigned addresses start at 0x200
-        uint32 next_addr = 0x200;
-        while (true) {
-            bool inc = false;
-            for (DITreeIter itr = child_begin(); itr != child_end(); ++itr ) {
-                if (next_addr == (uint32)(*itr)->get_attr("addr") ) {
-                    inc=true;
-                    break;
-                }
-            }
-            if (inc) {
-                ++next_addr;
-            } else {
-                node->set_attr("addr", next_addr );
-                break;
-            }
-        }
+        node->set_attr("addr", free_child_addr(0x200) );
     }
 
     if ( !node->has_attr("comment") ) {
@@ -392,7 +755,8 @@ void DeviceInterface::add_child ( const NodeRef& node ) {
 //********************* Terminal *********************************
 NodeRef Terminal::create ( const std::string& name ) {
     node_debug ( "Create Terminal: " << name );
-    return NodeRef ( new Terminal ( name ) );
+    NodeMem mem ( sizeof(Terminal) );
+    return mem.ref ( new ( mem.get() ) Terminal ( name ) );
 }
 
 
@@ -410,13 +774,13 @@ void Terminal::add_child ( const NodeRef& node ) {
         uint32 next_addr = 0;
         if ( has_children() ) {
             DITreeIter itr = child_end()-1;
-            uint32 width = (*itr)->get_attr("width");
-            uint32 last_addr = (*itr)->get_attr("addr");
+            uint32 width = (*itr)->get_attr_uint(Attr::width);
+            uint32 last_addr = (*itr)->get_attr_uint(Attr::addr);
             if ( !has_attr("regDataWidth" ) ) throw Exception ( NODE_ATTR_ERROR , std::string("Terminal node missing regDataWidth: ")+ get_name() );
-            uint32 data_width = get_attr("regDataWidth");
+            uint32 data_width = get_attr_uint(Attr::regDataWidth);
 
             uint32 num_regs =  width/data_width + (width % data_width > 0 ? 1 : 0);
-            num_regs *= (uint32)(*itr)->get_attr("array");
+            num_regs *= (*itr)->get_attr_uint(Attr::array);
             next_addr = last_addr + num_regs;
         }
         node->set_attr("addr", next_addr);
@@ -443,26 +807,25 @@ void Terminal::add_child ( const NodeRef& node ) {
     if ( !node->has_attr("init") ) {
         if (node->has_children()) {
             uint32 width=0;
-            mpz_class init(0);
+            BigInt init;
 
             for (DITreeIter itr=node->child_begin(); itr != node->child_end(); ++itr ) {
-                DataType sinit = (*itr)->get_attr("init"); 
+                const DataType& sinit = (*itr)->get_attr_ref(Attr::init);
 
-                mpz_class i; 
+                BigInt i;
                 if ( STR_DATA == sinit.get_type() ) {
                     // convert valuemap
-                    NodeRef valuemap = (*itr)->get_attr("valuemap");
-                    i = bi_from_dt ( valuemap->get_attr ( (std::string) sinit ) );
+                    NodeRef valuemap = (*itr)->get_attr_ref(Attr::valuemap);
+                    i = DataType::as_bigint ( valuemap->get_attr ( sinit.str_value() ) );
                 } else {
-                    i = bi_from_dt ( sinit );
-                    
+                    i = DataType::as_bigint ( sinit );
                 }
                 i <<= width;
                 init |= i;
-                width += (uint32) (*itr)->get_attr("width");
+                width += (*itr)->get_attr_uint(Attr::width);
             }
-            if ( width != (uint32) node->get_attr("width") ) throw Exception ( NODE_ATTR_ERROR, "Incorrect register width calculation");
-            node->set_attr("init", dt_from_bi(init) );
+            if ( width != node->get_attr_uint(Attr::width) ) throw Exception ( NODE_ATTR_ERROR, "Incorrect register width calculation");
+            node->set_attr("init", DataType ( init ) );
         } else {
             node->set_attr("init",0);
         }
@@ -486,7 +849,8 @@ void Terminal::add_child ( const NodeRef& node ) {
 //*********************** Register ******************************
 NodeRef Register::create ( const std::string& name ) {
     node_debug ( "Create Register: " << name );
-    return NodeRef ( new Register ( name ) );
+    NodeMem mem ( sizeof(Register) );
+    return mem.ref ( new ( mem.get() ) Register ( name ) );
 }
 
 
@@ -498,7 +862,7 @@ void Register::add_child ( const NodeRef& node ) {
     if (has_attr("width")) width = get_attr("width");
     node->set_attr("addr", width ); // offset of current subreg is previous width of register.
 
-    uint32 sub_width = (uint32) node->get_attr("width");
+    uint32 sub_width = node->get_attr_uint(Attr::width);
     if ( sub_width == 0 ) {
         throw Exception ( NODE_ATTR_ERROR, "Invalid width on subregister.", node->get_name() );
     }
@@ -528,7 +892,8 @@ void Register::add_child ( const NodeRef& node ) {
 //******************** Subregister *****************************
 NodeRef Subregister::create ( const std::string& name ) {
     node_debug ( "Create Subregister: " << name );
-    return NodeRef ( new Subregister ( name ) );
+    NodeMem mem ( sizeof(Subregister) );
+    return mem.ref ( new ( mem.get() ) Subregister ( name ) );
 }
 
 
@@ -536,7 +901,8 @@ NodeRef Subregister::create ( const std::string& name ) {
 
 NodeRef Valuemap::create ( const std::string& name ) {
     node_debug ( "Create Valuemap: " << name );
-    return NodeRef ( new Valuemap ( name ) );
+    NodeMem mem ( sizeof(Valuemap) );
+    return mem.ref ( new ( mem.get() ) Valuemap ( name ) );
 }
 
 } // end namespace
@@ -0,0 +1,60 @@
+#ifndef PIPETHROTTLE_H
+#define PIPETHROTTLE_H
+
+#include <atomic>
+#include <chrono>
+
+#include <nitro/types.h>
+
+namespace Nitro {
+
+/**
+ * How many transfers a pipe keeps queued.  Pipes stream full depth
+ * until register I/O is pending, then keep only the throttle depth in
+ * flight so register transfers don't wait behind a deep queue on the
+ * bus.  The throttle lasts hold ms after register I/O was last seen so
+ * a control loop's next call finds the queue still short.
+ *
+ * Used by the libusb pipe transfers and by the emulated bus of the
+ * io benchmark.  depth() is called from pipe callers and the transfer
+ * completion thread.
+ **/
+class PipeThrottle {
+    public:
+        PipeThrottle ( unsigned full, unsigned throttle, uint32 hold ) :
+            m_full(full), m_throttle(throttle), m_hold(hold), m_register_seen(0) {}
+
+        /**
+         * \param throttle Depth while throttled.  0 or a depth not below
+         *  full turns the throttle off.
+         * \param hold Milliseconds the throttle lasts after register I/O.
+         **/
+        void set ( unsigned throttle, uint32 hold ) {
+            m_throttle = throttle && throttle < m_full ? throttle : m_full;
+            m_hold = hold;
+        }
+
+        /**
+         * \param register_pending Whether register I/O is pending now.
+         **/
+        unsigned depth ( bool register_pending ) {
+            std::chrono::steady_clock::duration now = std::chrono::steady_clock::now().time_since_epoch();
+            if (register_pending) {
+                m_register_seen = now.count();
+                return m_throttle;
+            }
+            std::chrono::steady_clock::duration seen ( (std::chrono::steady_clock::rep)m_register_seen );
+            if (now - seen < std::chrono::milliseconds(m_hold)) return m_throttle;
+            return m_full;
+        }
+
+    private:
+        const unsigned m_full;
+        std::atomic<unsigned> m_throttle;
+        std::atomic<uint32> m_hold;
+        std::atomic<int64> m_register_seen; // steady_clock ticks
+};
+
+} // end namespace
+
+#endif
@@ -0,0 +1,416 @@
+/**
+ * Copyright (C) 2009 Ubixum, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ **/
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef WIN32
+#include <malloc.h>
+#else
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // O_DIRECT
+#endif
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef DEBUG_RECORDER
+#define rec_debug(x) std::cout << x << " (" << __FILE__ << ':' << __LINE__ << ')' << std::endl;
+#else
+#define rec_debug(x)
+#endif
+
+#include <nitro/recorder.h>
+#include <nitro/device.h>
+#include <nitro/error.h>
+
+#include "hr_time.h"
+#include "lzblock.h"
+
+// buffers are aligned for O_DIRECT. 4K covers the logical
+// block size of any disk we are likely to write to.
+#define REC_ALIGN 4096
+#define REC_MAGIC "NLZ1"
+
+using namespace std;
+
+namespace Nitro {
+
+static uint8* aligned_buf ( size_t len ) {
+#ifdef WIN32
+    uint8* p = (uint8*)_aligned_malloc ( len, REC_ALIGN );
+#else
+    void* p;
+    if (posix_memalign ( &p, REC_ALIGN, len )) p=NULL;
+#endif
+    if (!p) throw Exception ( RECORDER_IO, "Unable to allocate capture buffer" );
+    return (uint8*)p;
+}
+
+static void aligned_free ( uint8* p ) {
+#ifdef WIN32
+    _aligned_free ( p );
+#else
+    free ( p );
+#endif
+}
+
+/**
+ * Output file.  Uses O_DIRECT where the OS and file system allow it
+ * so large captures don't evict everything else from the page cache.
+ **/
+class RecFile {
+    private:
+#ifdef WIN32
+        FILE* m_fp;
+#else
+        int m_fd;
+        bool m_direct;
+#endif
+    public:
+        RecFile ( const string& path, bool direct ) {
+#ifdef WIN32
+            m_fp = fopen ( path.c_str(), "wb" );
+            if (!m_fp) throw Exception ( RECORDER_IO, "Unable to open " + path );
+#else
+            m_direct=false;
+            m_fd=-1;
+#ifdef O_DIRECT
+            if (direct) {
+                m_fd = open ( path.c_str(), O_WRONLY|O_CREAT|O_TRUNC|O_DIRECT, 0644 );
+                m_direct = m_fd >= 0;
+                rec_debug ( "O_DIRECT " << (m_direct ? "enabled" : "not supported") );
+            }
+#endif
+            if (m_fd<0) m_fd = open ( path.c_str(), O_WRONLY|O_CREAT|O_TRUNC, 0644 );
+            if (m_fd<0) throw Exception ( RECORDER_IO, "Unable to open " + path, errno );
+#endif
+        }
+        ~RecFile() throw() {
+#ifdef WIN32
+            fclose(m_fp);
+#else
+            ::close(m_fd);
+#endif
+        }
+        void write ( const uint8* data, size_t len ) {
+#ifdef WIN32
+            if (fwrite ( data, 1, len, m_fp ) != len)
+                throw Exception ( RECORDER_IO, "Write failed" );
+#else
+#ifdef O_DIRECT
+            if (m_direct && len % REC_ALIGN) {
+                // partial block at the end of a capture
+                fcntl ( m_fd, F_SETFL, fcntl ( m_fd, F_GETFL ) & ~O_DIRECT );
+                m_direct=false;
+            }
+#endif
+            while (len) {
+                ssize_t r = ::write ( m_fd, data, len );
+                if (r<0) {
+                    if (errno == EINTR) continue;
+                    throw Exception ( RECORDER_IO, "Write failed", errno );
+                }
+                data += r;
+                len -= r;
+            }
+#endif
+        }
+};
+
+static void put32 ( uint8* p, uint32 v ) {
+    for (int i=0;i<4;++i) p[i] = (uint8)(v>>(i*8));
+}
+static uint32 get32 ( const uint8* p ) {
+    return p[0] | (p[1]<<8) | (p[2]<<16) | ((uint32)p[3]<<24);
+}
+
+
+double Recorder::Stats::mbps() const {
+    return elapsed > 0 ? bytes_read / elapsed / (1024*1024) : 0;
+}
+
+struct Recorder::impl {
+    Device& m_dev;
+    DataType m_term;
+    DataType m_reg;
+    string m_path;
+    uint32 m_buffer_size;
+    uint32 m_num_buffers;
+    bool m_compress;
+    bool m_drop;
+    ProgressFunc m_progress;
+    uint32 m_interval;
+
+    atomic<bool> m_stop;
+
+    // ring state, protected by m_lock
+    mutable mutex m_lock;
+    condition_variable m_cond;
+    vector<uint8*> m_bufs;
+    vector<size_t> m_lens;
+    deque<uint32> m_free;
+    deque<uint32> m_full;
+    bool m_done;
+    Exception* m_err;
+    Stats m_stats;
+
+    impl ( Device& dev, const DataType& term, const DataType& reg, const string& path ) :
+        m_dev(dev), m_term(term), m_reg(reg), m_path(path),
+        m_buffer_size(1<<20), m_num_buffers(3), m_compress(false), m_drop(false),
+        m_interval(1000), m_stop(false), m_done(false), m_err(NULL) {
+        memset ( &m_stats, 0, sizeof(m_stats) );
+    }
+    ~impl() {
+        release();
+    }
+
+    void release() {
+        for (size_t i=0;i<m_bufs.size();++i) aligned_free ( m_bufs[i] );
+        m_bufs.clear();
+        if (m_err) {
+            delete m_err;
+            m_err=NULL;
+        }
+    }
+
+    void writer ( RecFile& out );
+};
+
+void Recorder::impl::writer ( RecFile& out ) {
+
+    vector<uint8> frame;
+    if (m_compress) frame.resize ( lz_bound ( m_buffer_size ) + 8 );
+
+    while (true) {
+        uint32 idx;
+        {
+            unique_lock<mutex> lock(m_lock);
+            m_cond.wait ( lock, [this]{ return !m_full.empty() || m_done; } );
+            if (m_full.empty()) return; // done and drained
+            idx = m_full.front();
+            m_full.pop_front();
+        }
+
+        size_t len = m_lens[idx];
+        size_t written;
+        try {
+            if (m_compress) {
+                size_t clen = lz_compress ( m_bufs[idx], len, &frame[8], frame.size()-8 );
+                put32 ( &frame[0], (uint32)len );
+                put32 ( &frame[4], (uint32)clen ); // 0 means stored
+                if (clen) {
+                    out.write ( &frame[0], clen+8 );
+                } else {
+                    out.write ( &frame[0], 8 );
+                    out.write ( m_bufs[idx], len );
+                }
+                written = (clen ? clen : len) + 8;
+            } else {
+                out.write ( m_bufs[idx], len );
+                written = len;
+            }
+        } catch ( const Exception& e ) {
+            lock_guard<mutex> lock(m_lock);
+            m_err = new Exception(e);
+            m_done = true;
+            m_cond.notify_all();
+            return;
+        }
+
+        lock_guard<mutex> lock(m_lock);
+        m_stats.bytes_written += written;
+        m_free.push_back(idx);
+        m_cond.notify_all();
+    }
+}
+
+Recorder::Recorder ( Device& dev, const DataType& term, const DataType& reg, const string& path ) :
+    m_impl ( new impl ( dev, term, reg, path ) ) {}
+
+Recorder::~Recorder() throw() {
+    delete m_impl;
+}
+
+void Recorder::set_buffer_size ( uint32 bytes ) {
+    if (!bytes) throw Exception ( RECORDER_IO, "Buffer size must be greater than 0" );
+    m_impl->m_buffer_size = bytes;
+}
+void Recorder::set_num_buffers ( uint32 count ) {
+    if (count<2) throw Exception ( RECORDER_IO, "At least 2 buffers are required", count );
+    m_impl->m_num_buffers = count;
+}
+void Recorder::set_compression ( bool compress ) {
+    m_impl->m_compress = compress;
+}
+void Recorder::set_drop_on_overflow ( bool drop ) {
+    m_impl->m_drop = drop;
+}
+void Recorder::set_progress ( ProgressFunc func, uint32 interval ) {
+    m_impl->m_progress = func;
+    m_impl->m_interval = interval;
+}
+
+void Recorder::stop() {
+    m_impl->m_stop = true;
+}
+
+Recorder::Stats Recorder::stats() const {
+    lock_guard<mutex> lock(m_impl->m_lock);
+    return m_impl->m_stats;
+}
+
+Recorder::Stats Recorder::record ( uint64 nbytes, int32 timeout ) {
+
+    impl& d = *m_impl;
+    d.release();
+    d.m_free.clear();
+    d.m_full.clear();
+    d.m_done = false;
+    d.m_stop = false;
+    memset ( &d.m_stats, 0, sizeof(d.m_stats) );
+    d.m_stats.num_buffers = d.m_num_buffers;
+
+    // +1 is the scratch buffer used when dropping data
+    for (uint32 i=0;i<d.m_num_buffers+1;++i) d.m_bufs.push_back ( aligned_buf ( d.m_buffer_size ) );
+    d.m_lens.assign ( d.m_num_buffers, 0 );
+    for (uint32 i=0;i<d.m_num_buffers;++i) d.m_free.push_back(i);
+    uint8* scratch = d.m_bufs.back();
+
+    RecFile out ( d.m_path, !d.m_compress && d.m_buffer_size % REC_ALIGN == 0 );
+    if (d.m_compress) out.write ( (const uint8*)REC_MAGIC, 4 );
+
+    CStopWatch timer;
+    timer.startTimer();
+    double last_report=0;
+
+    thread writer ( [&d,&out]{ d.writer(out); } );
+    rec_debug ( "Recording " << nbytes << " bytes to " << d.m_path );
+
+    try {
+        uint64 remaining = nbytes;
+        while (!d.m_stop && (!nbytes || remaining)) {
+            size_t len = d.m_buffer_size;
+            if (nbytes && remaining < len) len = (size_t)remaining;
+
+            int32 idx=-1;
+            {
+                unique_lock<mutex> lock(d.m_lock);
+                if (!d.m_drop) d.m_cond.wait ( lock, [&d]{ return !d.m_free.empty() || d.m_done; } );
+                if (d.m_done) break; // writer failed
+                if (!d.m_free.empty()) {
+                    idx = d.m_free.front();
+                    d.m_free.pop_front();
+                }
+            }
+
+            d.m_dev.read ( d.m_term, d.m_reg, idx<0 ? scratch : d.m_bufs[idx], len, timeout );
+            if (nbytes) remaining -= len;
+
+            timer.stopTimer();
+            Stats cur;
+            {
+                lock_guard<mutex> lock(d.m_lock);
+                if (idx<0) {
+                    d.m_stats.bytes_dropped += len;
+                } else {
+                    d.m_lens[idx] = len;
+                    d.m_full.push_back(idx);
+                    if (d.m_full.size() > d.m_stats.high_water) d.m_stats.high_water = (uint32)d.m_full.size();
+                }
+                d.m_stats.bytes_read += len;
+                d.m_stats.elapsed = timer.getElapsedTime();
+                cur = d.m_stats;
+            }
+            d.m_cond.notify_all();
+
+            if (d.m_progress && (cur.elapsed - last_report)*1000 >= d.m_interval) {
+                last_report = cur.elapsed;
+                d.m_progress ( cur );
+            }
+        }
+    } catch ( ... ) {
+        {
+            lock_guard<mutex> lock(d.m_lock);
+            d.m_done = true;
+        }
+        d.m_cond.notify_all();
+        writer.join();
+        throw;
+    }
+
+    {
+        lock_guard<mutex> lock(d.m_lock);
+        d.m_done = true;
+    }
+    d.m_cond.notify_all();
+    writer.join();
+
+    if (d.m_err) throw Exception ( *d.m_err );
+
+    timer.stopTimer();
+    lock_guard<mutex> lock(d.m_lock);
+    d.m_stats.elapsed = timer.getElapsedTime();
+    return d.m_stats;
+}
+
+
+void Recorder::decompress ( const string& src, const string& dst ) {
+
+    ifstream in ( src.c_str(), ios::binary );
+    if (!in.good()) throw Exception ( RECORDER_IO, "Unable to open " + src );
+    ofstream out ( dst.c_str(), ios::binary );
+    if (!out.good()) throw Exception ( RECORDER_IO, "Unable to open " + dst );
+
+    char magic[4];
+    in.read ( magic, 4 );
+    if (!in.good() || memcmp ( magic, REC_MAGIC, 4 ))
+        throw Exception ( RECORDER_FORMAT, src + " is not a compressed capture" );
+
+    vector<uint8> frame, raw;
+    uint8 hdr[8];
+    while (in.read ( (char*)hdr, 8 )) {
+        uint32 len = get32 ( hdr );
+        uint32 clen = get32 ( hdr+4 );
+        raw.resize ( len );
+        if (!clen) {
+            if (!in.read ( (char*)&raw[0], len )) throw Exception ( RECORDER_FORMAT, "Truncated frame" );
+        } else {
+            frame.resize ( clen );
+            if (!in.read ( (char*)&frame[0], clen )) throw Exception ( RECORDER_FORMAT, "Truncated frame" );
+            size_t out_len;
+            if (!lz_decompress ( &frame[0], clen, &raw[0], len, out_len ) || out_len != len)
+                throw Exception ( RECORDER_FORMAT, "Corrupt frame" );
+        }
+        out.write ( (const char*)&raw[0], len );
+        if (!out.good()) throw Exception ( RECORDER_IO, "Write failed" );
+    }
+    if (in.gcount()) throw Exception ( RECORDER_FORMAT, "Truncated frame header" );
+}
+
+} // end namespace
@@ -25,6 +25,13 @@ typedef int Py_ssize_t;
 #include <map>
 #include <string>
 #include <sstream>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
 
 #include <nitro/scripts.h>
 #include <nitro/error.h>
@@ -56,7 +63,36 @@ struct PyObjCleanup {
     ~PyObjCleanup() throw() { Py_XDECREF(to_dec); }
 };
 
+// module dict keys, doc strings and exception strings are str objects.
+// NULL if o isn't one.
+static const char* py_str ( PyObject* o ) {
+#if PY_MAJOR_VERSION >= 3
+    if (o && PyUnicode_Check(o)) return PyUnicode_AsUTF8(o);
+#endif
+    if (o && PyBytes_Check(o)) return PyBytes_AsString(o);
+    return NULL;
+}
+
+static PyObject* py_from_str ( const std::string& s ) {
+#if PY_MAJOR_VERSION >= 3
+    return PyUnicode_FromString ( s.c_str() );
+#else
+    return PyBytes_FromString ( s.c_str() );
+#endif
+}
 
+// true if this thread holds the interpreter lock.  PyGILState_Check
+// can't tell once there are sub interpreters.
+static bool gil_held() {
+#if PY_VERSION_HEX >= 0x030D0000
+    PyThreadState* ts = PyThreadState_GetUnchecked();
+#elif PY_VERSION_HEX >= 0x03050200
+    PyThreadState* ts = _PyThreadState_UncheckedGet();
+#else
+    PyThreadState* ts = PyThreadState_GET();
+#endif
+    return ts && (unsigned long)ts->thread_id == (unsigned long)PyThread_get_thread_ident();
+}
 
 
 
@@ -66,38 +102,163 @@ namespace Nitro {
 typedef std::map<std::string,PyObject*> pyfuncs_t;
 typedef std::map<std::string,pyfuncs_t> pymodules_t;
 
-struct Scripts::impl {
+/**
+ * Imported scripts in one interpreter.  Methods are called with the
+ * interpreter's thread state current.
+ **/
+struct ScriptInterp {
 
-    static int m_init_count;
-    static PyObject* m_base_obj;
-//    PyThreadState* m_py_thread_state;
-//
     pymodules_t m_modules;
 	PyObject* m_sys;
-    
-    impl () ; 
-    ~impl() throw();
 
-    void cleanup();
+    ScriptInterp();
+    ~ScriptInterp() throw();
 
 	/**
 	 * \return the absolute directory path to the file
 	 **/
 	std::string modname ( const std::string &path );
 	void add_path ( const std::string &path );
+
+    PyObject* func ( const std::string& module, const std::string& func_name );
+
+    void import ( const std::string& module, const std::string& script_path );
+    std::vector<std::string> func_list ( const std::string& module );
+    NodeRef get_params ( const std::string& module, const std::string& func_name );
+    std::string get_comment ( const std::string& module, const std::string& func_name );
+    DataType exec ( const std::string& module, const std::string& func_name, const NodeRef& params );
+};
+
+/**
+ * One call on a worker.  Finished calls have done set and err set if
+ * the call threw.
+ **/
+struct ScriptJob {
+    std::function<void(ScriptInterp&)> func;
+    std::exception_ptr err;
+    bool done;
+    ScriptJob ( const std::function<void(ScriptInterp&)>& f ) : func(f), done(false) {}
+};
+
+/**
+ * A sub interpreter and the thread that runs its calls.
+ **/
+struct ScriptWorker {
+    PyThreadState* m_tstate; // from Py_NewInterpreter, used to end it
+    ScriptInterp* m_interp;
+    std::deque<ScriptJob*> m_jobs; // calls for this worker only (import)
+    std::thread m_thread;
+    ScriptWorker() : m_tstate(NULL), m_interp(NULL) {}
+};
+
+
+struct Scripts::impl {
+
+    static int m_init_count;
+    static PyObject* m_base_obj;
+
+    ScriptInterp* m_main; // shared mode
+
+    // worker mode
+    std::vector<ScriptWorker*> m_workers;
+    std::deque<ScriptJob*> m_any; // exec calls for any worker
+    std::mutex m_lock;
+    std::condition_variable m_cond; // jobs queued or finished
+    bool m_stop;
+    PyThreadState* m_released; // set if the constructor released the interpreter lock
+    bool m_ensured; // lock taken with PyGILState_Ensure
+    PyGILState_STATE m_gstate;
+
+    impl ( uint32 workers ) ;
+    ~impl() throw();
+
+    void init();
+    void cleanup();
+
+    void start_workers ( uint32 workers );
+    void stop_workers () throw();
+    void run_worker ( ScriptWorker* w );
+    void wait ( std::vector<ScriptJob>& jobs );
+    void call_any ( const std::function<void(ScriptInterp&)>& func );
+    void call_all ( const std::function<void(ScriptInterp&)>& func );
 };
 
 
 int Scripts::impl::m_init_count=0;
 PyObject* Scripts::impl::m_base_obj=NULL;
 
-Scripts::impl::impl() : m_sys(NULL) {
+Scripts::impl::impl( uint32 workers ) : m_main(NULL), m_stop(false), m_released(NULL), m_ensured(false) {
+
+    bool initialized = !m_init_count;
+    init();
+
+    // a worker pool started first released the interpreter lock.
+    // Callers of a shared interpreter expect to hold it.
+    if (!initialized && !gil_held()) {
+        m_gstate = PyGILState_Ensure();
+        m_ensured = true;
+    }
+
+    try {
+        if (!workers) {
+            m_main = new ScriptInterp();
+        } else {
+            start_workers ( workers );
+            // the workers need the lock between calls
+            if (initialized) m_released = PyEval_SaveThread();
+            else if (m_ensured) {
+                PyGILState_Release ( m_gstate );
+                m_ensured = false;
+            }
+        }
+    } catch ( ... ) {
+        cleanup();
+        throw;
+    }
+
+    py_debug ("Scripts:impl: init count: " << m_init_count );
+}
 
+void Scripts::impl::init() {
     if (!m_init_count) {
         Py_Initialize();
-        if (!Py_IsInitialized()) throw Exception ( SCRIPTS_INIT  ); 
+        if (!Py_IsInitialized()) throw Exception ( SCRIPTS_INIT  );
+#if PY_VERSION_HEX < 0x03070000
+        PyEval_InitThreads();
+#endif
     }
     ++m_init_count;
+}
+
+Scripts::impl::~impl() throw() {
+
+    cleanup();
+
+   }
+
+void Scripts::impl::cleanup() {
+
+    stop_workers();
+    delete m_main;
+    m_main = NULL;
+
+    --m_init_count;
+    py_debug ( "Scripts::~impl:python init count: " << m_init_count );
+    if (!m_init_count) {
+        PyErr_Clear();
+        Py_Finalize();
+    } else if (m_ensured) {
+        PyGILState_Release ( m_gstate );
+    } else if (m_released) {
+        // other Scripts objects still use the interpreter
+        PyEval_SaveThread();
+    }
+    m_ensured = false;
+    m_released = NULL;
+}
+
+
+ScriptInterp::ScriptInterp() : m_sys(NULL) {
 
 	// sys needed for setting paths.
 	m_sys = PyImport_ImportModule("sys");
@@ -109,39 +270,173 @@ Scripts::impl::impl() : m_sys(NULL) {
     add_path(xjoin(inst_dir, "nitro_py"));
 	#endif
 
-    if (import_nitro() < 0) throw Exception ( SCRIPTS_INIT, "Unable to import nitro module." ); 
+    if (import_nitro() < 0) {
+        PyErr_Print();
+        Py_DECREF(m_sys);
+        throw Exception ( SCRIPTS_INIT, "Unable to import nitro module." );
+    }
     py_debug ( "Imported nitro module." );
+}
 
-        
-    py_debug ("Scripts:impl: init count: " << m_init_count );
+ScriptInterp::~ScriptInterp() throw() {
+    for ( pymodules_t::iterator mitr = m_modules.begin(); mitr != m_modules.end(); ++mitr ) {
+        pyfuncs_t &funcs = mitr->second;
+        for ( pyfuncs_t::iterator itr = funcs.begin(); itr != funcs.end(); ++itr ) {
+            Py_DECREF( itr->second );
+        }
+    }
+	Py_XDECREF(m_sys);
 }
 
-Scripts::impl::~impl() throw() {
 
-    cleanup();
+// ******************* worker pool ***********************
 
-    --m_init_count;
-    py_debug ( "Scripts::~impl:python init count: " << m_init_count );
-    if (!m_init_count) {
-        PyErr_Clear();
-        Py_Finalize();
+void Scripts::impl::start_workers ( uint32 workers ) {
+
+    // each worker's interpreter is created here while this thread
+    // holds the lock.  The worker thread makes its own thread state.
+    PyThreadState* main_ts = PyThreadState_Get();
+    for (uint32 i=0;i<workers;++i) {
+        ScriptWorker* w = new ScriptWorker;
+        m_workers.push_back ( w );
+        w->m_tstate = Py_NewInterpreter();
+        if (!w->m_tstate) {
+            PyThreadState_Swap ( main_ts );
+            throw Exception ( SCRIPTS_INIT, "Unable to create worker interpreter." );
+        }
+        try {
+            w->m_interp = new ScriptInterp();
+        } catch ( ... ) {
+            PyThreadState_Swap ( main_ts );
+            throw;
+        }
+        PyThreadState_Swap ( main_ts );
+        py_debug ( "Created worker interpreter " << i );
+    }
+    for (std::vector<ScriptWorker*>::iterator itr = m_workers.begin(); itr != m_workers.end(); ++itr ) {
+        (*itr)->m_thread = std::thread ( &Scripts::impl::run_worker, this, *itr );
     }
+}
 
-   }
+void Scripts::impl::stop_workers() throw() {
+    if (m_workers.empty()) return;
 
-void Scripts::impl::cleanup() {
-    
-    for ( pymodules_t::iterator mitr = m_modules.begin(); mitr != m_modules.end(); ++mitr ) {
-        pyfuncs_t &funcs = mitr->second;
-        for ( pyfuncs_t::iterator itr = funcs.begin(); itr != funcs.end(); ++itr ) {
-            Py_DECREF( itr->second );
+    bool held = gil_held();
+    PyThreadState* save = held ? PyEval_SaveThread() : NULL;
+    {
+        std::lock_guard<std::mutex> lock ( m_lock );
+        m_stop = true;
+    }
+    m_cond.notify_all();
+    for (std::vector<ScriptWorker*>::iterator itr = m_workers.begin(); itr != m_workers.end(); ++itr ) {
+        if ((*itr)->m_thread.joinable()) (*itr)->m_thread.join();
+    }
+
+    if (m_released) {
+        PyEval_RestoreThread ( m_released );
+    } else if (held) {
+        PyEval_RestoreThread ( save );
+    } else {
+        m_gstate = PyGILState_Ensure();
+        m_ensured = true;
+    }
+
+    PyThreadState* main_ts = PyThreadState_Get();
+    for (std::vector<ScriptWorker*>::iterator itr = m_workers.begin(); itr != m_workers.end(); ++itr ) {
+        ScriptWorker* w = *itr;
+        if (w->m_tstate) {
+            PyThreadState_Swap ( w->m_tstate );
+            delete w->m_interp;
+            Py_EndInterpreter ( w->m_tstate );
+            PyThreadState_Swap ( main_ts );
         }
+        delete w;
     }
-	Py_XDECREF(m_sys);
+    m_workers.clear();
+}
+
+void Scripts::impl::run_worker ( ScriptWorker* w ) {
+
+    PyThreadState* ts = PyThreadState_New ( w->m_tstate->interp );
+    PyEval_RestoreThread ( ts );
+
+    for (;;) {
+        ScriptJob* job = NULL;
+        PyThreadState* save = PyEval_SaveThread();
+        {
+            std::unique_lock<std::mutex> lock ( m_lock );
+            while (!m_stop && w->m_jobs.empty() && m_any.empty()) m_cond.wait ( lock );
+            if (!w->m_jobs.empty()) {
+                job = w->m_jobs.front();
+                w->m_jobs.pop_front();
+            } else if (!m_any.empty()) {
+                job = m_any.front();
+                m_any.pop_front();
+            }
+        }
+        PyEval_RestoreThread ( save );
+        if (!job) break; // stopped
+
+        try {
+            job->func ( *w->m_interp );
+        } catch ( ... ) {
+            job->err = std::current_exception();
+        }
+
+        save = PyEval_SaveThread();
+        {
+            std::lock_guard<std::mutex> lock ( m_lock );
+            job->done = true;
+        }
+        m_cond.notify_all();
+        PyEval_RestoreThread ( save );
+    }
+
+    PyThreadState_Clear ( ts );
+    PyThreadState_DeleteCurrent();
+}
+
+void Scripts::impl::wait ( std::vector<ScriptJob>& jobs ) {
+    // a caller holding the lock lets the workers have it
+    PyThreadState* save = gil_held() ? PyEval_SaveThread() : NULL;
+    {
+        std::unique_lock<std::mutex> lock ( m_lock );
+        for (size_t i=0;i<jobs.size();++i) {
+            while (!jobs[i].done) m_cond.wait ( lock );
+        }
+    }
+    if (save) PyEval_RestoreThread ( save );
+
+    for (size_t i=0;i<jobs.size();++i) {
+        if (jobs[i].err) std::rethrow_exception ( jobs[i].err );
+    }
+}
+
+void Scripts::impl::call_any ( const std::function<void(ScriptInterp&)>& func ) {
+    std::vector<ScriptJob> jobs ( 1, ScriptJob ( func ) );
+    {
+        std::lock_guard<std::mutex> lock ( m_lock );
+        m_any.push_back ( &jobs[0] );
+    }
+    m_cond.notify_all();
+    wait ( jobs );
 }
 
-std::string Scripts::impl::modname ( const std::string &path ) {
-	
+void Scripts::impl::call_all ( const std::function<void(ScriptInterp&)>& func ) {
+    std::vector<ScriptJob> jobs ( m_workers.size(), ScriptJob ( func ) );
+    {
+        std::lock_guard<std::mutex> lock ( m_lock );
+        for (size_t i=0;i<jobs.size();++i) m_workers[i]->m_jobs.push_back ( &jobs[i] );
+    }
+    m_cond.notify_all();
+    wait ( jobs );
+}
+
+
+// ******************* script functions ***********************
+
+std::string ScriptInterp::modname ( const std::string &path ) {
+
 #ifdef WIN32
 	char fname[_MAX_FNAME];
 	_splitpath ( path.c_str(), NULL, NULL, fname, NULL );
@@ -160,40 +455,46 @@ std::string Scripts::impl::modname ( const std::string &path ) {
 
 }
 
-void Scripts::impl::add_path ( const std::string &path ) {
-	// set the path correctly for this module	
+void ScriptInterp::add_path ( const std::string &path ) {
+	// set the path correctly for this module
 	PyObject* sys_path = PyObject_GetAttrString( m_sys, "path" );
 	if (!sys_path) throw Exception ( SCRIPTS_ERR, "Unable to set module path" );
 	PyObjCleanup sys_path_cleanup(sys_path);
 
-	PyObject* dir_str = PyBytes_FromString ( path.c_str() );
+	PyObject* dir_str = py_from_str ( path );
 	if ( !dir_str ) throw Exception ( SCRIPTS_ERR, "Unable to set module path (string creation)" );
 	PyObjCleanup dir_str_cleanup( dir_str );
 
-	if (!PySequence_Contains ( sys_path, dir_str ) ) {		
+	if (!PySequence_Contains ( sys_path, dir_str ) ) {
 		if (PyList_Insert ( sys_path, 0, dir_str )<0) throw Exception ( SCRIPTS_ERR, "Unable to set module path." );
 
 		#ifdef DEBUG_PY
 		PyObject* path_str = PyObject_Str(sys_path);
 		PyObjCleanup path_str_cleanup( path_str );
-		py_debug ( "New Path: " << PyBytes_AsString( path_str ) );
+		py_debug ( "New Path: " << py_str( path_str ) );
 		#endif
 	}
 }
 
-Scripts::Scripts() : m_impl(new impl()) {}
-Scripts::~Scripts() throw() { delete m_impl; }
+PyObject* ScriptInterp::func ( const std::string& module, const std::string& func_name ) {
+    pymodules_t::iterator mitr = m_modules.find ( module );
+    if (mitr == m_modules.end()) throw Exception ( SCRIPTS_SCRIPT, std::string("Module not found: ") + module );
+    pyfuncs_t &funcs = mitr->second;
+    pyfuncs_t::iterator itr = funcs.find ( func_name );
+    if (itr == funcs.end() ) throw Exception ( SCRIPTS_SCRIPT, std::string("Function not found: ") + func_name );
+    return itr->second;
+}
 
 
-void Scripts::import ( const std::string &module, const std::string &script_path ) {
+void ScriptInterp::import ( const std::string &module, const std::string &script_path ) {
 
 
 	// add the script path to the module python path
 	std::string dir = xdirname ( script_path );
 	// for python, the strings need escaped
-	std::string modname = m_impl->modname ( script_path );
+	std::string modname = this->modname ( script_path );
 
-	m_impl->add_path ( dir );	
+	add_path ( dir );
 
     // the module name.
 	py_debug ( "Attempt to load " << script_path << " module: " << modname );
@@ -214,37 +515,37 @@ void Scripts::import ( const std::string &module, const std::string &script_path
     PyObjCleanup dict_cleanup ( dict );
 
     if (!PyDict_Check(dict)) throw Exception ( SCRIPTS_ERR, "Error reading script.  __dict__ instance." );
-    
+
     pyfuncs_t new_funcs;
     PyObject *key, *value;
     Py_ssize_t pos=0;
     while (PyDict_Next(dict, &pos, &key, &value)) {
-        if (PyBytes_Check(key)) {
-            const char* key_str = PyBytes_AsString(key);
+        const char* key_str = py_str(key);
+        if (key_str) {
             if (PyCallable_Check( value )) {
                 Py_INCREF(value);
                 new_funcs[std::string(key_str)] = value ;
                 py_debug ( "Added funtion: " << key_str );
-            }            
+            }
         }
     }
 
-    pymodules_t::iterator mitr = m_impl->m_modules.find ( module );
-    if (mitr != m_impl->m_modules.end()) {
-        pyfuncs_t &funcs = mitr->second; 
+    pymodules_t::iterator mitr = m_modules.find ( module );
+    if (mitr != m_modules.end()) {
+        pyfuncs_t &funcs = mitr->second;
         for (pyfuncs_t::iterator itr=funcs.begin();itr!=funcs.end();++itr) {
             Py_DECREF ( itr->second );
         }
     }
-    m_impl->m_modules[module] = new_funcs;
+    m_modules[module] = new_funcs;
 
 }
 
 
-std::vector<std::string> Scripts::func_list(const std::string &module) const  {
-   
-   pymodules_t::iterator mitr = m_impl->m_modules.find ( module );
-   if (mitr == m_impl->m_modules.end()) throw Exception ( SCRIPTS_ERR, std::string("Module not found: ")+ module );
+std::vector<std::string> ScriptInterp::func_list(const std::string &module) {
+
+   pymodules_t::iterator mitr = m_modules.find ( module );
+   if (mitr == m_modules.end()) throw Exception ( SCRIPTS_ERR, std::string("Module not found: ")+ module );
    pyfuncs_t &funcs = mitr->second;
 
    std::vector<std::string> func_names;
@@ -254,22 +555,18 @@ std::vector<std::string> Scripts::func_list(const std::string &module) const  {
    return func_names;
 }
 
-NodeRef Scripts::get_params (const std::string &module, const std::string &func_name ) const {
+NodeRef ScriptInterp::get_params (const std::string &module, const std::string &func_name ) {
 
-   pymodules_t::iterator mitr = m_impl->m_modules.find ( module );
-   if (mitr == m_impl->m_modules.end()) throw Exception ( SCRIPTS_SCRIPT, std::string("Module not found: ") + module );
-   pyfuncs_t &funcs = mitr->second;
-   pyfuncs_t::iterator itr = funcs.find ( func_name );
-   if (itr == funcs.end() ) throw Exception ( SCRIPTS_SCRIPT, std::string("Function not found: ") + func_name );
-   PyObject* func = itr->second;
+   PyObject* func = this->func ( module, func_name );
 
    NodeRef params = Node::create("params");
 
    PyObject* doc_string = PyObject_GetAttrString(func,"__doc__");
    if (!doc_string) throw Exception ( SCRIPTS_SCRIPT, "Unable to read function doc string." );
    PyObjCleanup doc_string_cleanup(doc_string);
-   
-   const char* doc_cstr = PyBytes_AsString(doc_string);
+
+   const char* doc_cstr = py_str(doc_string);
+   if (!doc_cstr) return params; // no doc string
    py_debug ( "Func Docs: " << doc_cstr );
 
    std::stringstream ss;
@@ -280,72 +577,61 @@ NodeRef Scripts::get_params (const std::string &module, const std::string &func_
        if ( !ss.eof() && param== "@param" ) {
             ss >> name;
             if (ss.eof()) throw Exception ( SCRIPTS_SCRIPT, "Invalid doc string" );
-            ss >> type; 
+            ss >> type;
             if (ss.eof()) throw Exception ( SCRIPTS_SCRIPT, "Invalid doc string" );
             params->set_attr ( name, type );
             py_debug ( "Added param: " << name << ", " << type );
        }
    }
-   
-   return params; 
+
+   return params;
 
 }
 
-std::string Scripts::get_comment(const std::string &module, const std::string &func_name) const {
-	pymodules_t::iterator mitr = m_impl->m_modules.find ( module );
-    if (mitr == m_impl->m_modules.end()) throw Exception ( SCRIPTS_SCRIPT, std::string("Module not found: ") + module );
-    pyfuncs_t &funcs = mitr->second;
-    pyfuncs_t::iterator itr = funcs.find ( func_name );
-    if (itr == funcs.end() ) throw Exception ( SCRIPTS_SCRIPT, std::string("Function not found: ") + func_name );
-    PyObject* func = itr->second;
+std::string ScriptInterp::get_comment(const std::string &module, const std::string &func_name) {
+    PyObject* func = this->func ( module, func_name );
 
 	PyObject* doc_string = PyObject_GetAttrString(func,"__doc__");
     if (!doc_string) throw Exception ( SCRIPTS_SCRIPT, "Unable to read function doc string." );
     PyObjCleanup doc_string_cleanup(doc_string);
-   
-    const char* doc_cstr = PyBytes_AsString(doc_string);
-	return std::string(doc_cstr);
-}
 
+    const char* doc_cstr = py_str(doc_string);
+	return std::string(doc_cstr ? doc_cstr : "");
+}
 
-DataType Scripts::exec(const std::string &module, const std::string &func_name, const NodeRef& params ) const {
 
-    pymodules_t::iterator mitr = m_impl->m_modules.find ( module );
-    if (mitr == m_impl->m_modules.end()) throw Exception ( SCRIPTS_SCRIPT, std::string("Module not found: ") + module );
-    pyfuncs_t &funcs = mitr->second;
+DataType ScriptInterp::exec(const std::string &module, const std::string &func_name, const NodeRef& params ) {
 
-    pyfuncs_t::iterator itr=funcs.find ( func_name );
-    if (itr == funcs.end() ) throw Exception ( SCRIPTS_SCRIPT, std::string("Function not found: ") + func_name );
-    PyObject* func = itr->second;
+    PyObject* func = this->func ( module, func_name );
 
     PyObject* kw = PyDict_New();
     if (!kw) throw Exception ( SCRIPTS_ERR, "Unable to execute function. Unable to create param arguments." );
     PyObjCleanup kw_cleanup(kw);
 
     for (DIAttrIter aitr=params->attrs_begin(); aitr != params->attrs_end(); ++aitr ) {
-       DataType d = aitr->second; 
+       DataType d = aitr->second;
        PyObject* arg_data = nitro_from_datatype(d);
        if (!arg_data ) {
         PyErr_Print();
         throw Exception ( SCRIPTS_SCRIPT, std::string("Unable to convert data type to script argument: ") + aitr->first );
        }
-       PyObjCleanup arg_data_cleanup( arg_data ); // PyDict_SetItemString doesn't say it steals the ref 
+       PyObjCleanup arg_data_cleanup( arg_data ); // PyDict_SetItemString doesn't say it steals the ref
        if ( PyDict_SetItemString ( kw, aitr->first.c_str(), arg_data ) < 0 ) throw Exception ( SCRIPTS_ERR, "Unable to create function arguments." );
     }
 
-    #ifdef DEBUG_PY 
+    #ifdef DEBUG_PY
         PyObject* dstr = PyObject_Str(kw);
-        const char* dstr_str = PyBytes_AsString(dstr);
-        py_debug ( "keywords: " << dstr_str );
+        py_debug ( "keywords: " << py_str(dstr) );
         Py_DECREF(dstr);
     #endif
 
     PyObject* empty_args = PyTuple_New(0);
     PyObjCleanup empty_args_cleanup(empty_args);
-    PyObject *ret = PyObject_Call( func , empty_args, kw ); 
+    PyObject *ret = PyObject_Call( func , empty_args, kw );
     if (!ret) {
         PyObject *ptype, *pvalue, *ptraceback;
         PyErr_Fetch(&ptype,&pvalue,&ptraceback);
+        PyErr_NormalizeException(&ptype,&pvalue,&ptraceback);
         PyObjCleanup ptype_cleanup( ptype );
         PyObjCleanup pvalue_cleanup( pvalue );
         PyObjCleanup ptraceback_cleanup( ptraceback );
@@ -356,7 +642,7 @@ DataType Scripts::exec(const std::string &module, const std::string &func_name,
             #ifdef DEBUG_PY
                 PyObject* str_args = PyObject_Str(eargs);
                 PyObjCleanup str_args_cleanup(str_args);
-                py_debug ( "Exception Args: " << PyBytes_AsString(str_args) );
+                py_debug ( "Exception Args: " << py_str(str_args) );
             #endif
             int code;
             const char* msg=NULL;
@@ -365,7 +651,7 @@ DataType Scripts::exec(const std::string &module, const std::string &func_name,
                 if (msg) {
                     if ( pdt != NULL ) {
                         DataType d(0);
-                        nitro_to_datatype ( pdt, &d );
+                        if (!nitro_to_datatype ( pdt, &d )) PyErr_Clear(); // keep the code and message
                         throw Exception ( code, msg, d );
                     } else {
                         throw Exception ( code, msg );
@@ -374,16 +660,18 @@ DataType Scripts::exec(const std::string &module, const std::string &func_name,
                     throw Exception ( (NITRO_ERROR)code );
                 }
             }
-            
+            PyErr_Clear();
+            throw Exception ( SCRIPTS_SCRIPT, "Invalid nitro.Exception arguments." );
+
         } else {
-            
+
             PyObject* str_value = PyObject_Str( pvalue );
             PyObjCleanup str_value_clenaup(str_value);
-            const char* exc = PyBytes_AsString(str_value);		    
-            throw Exception ( SCRIPTS_SCRIPT, exc );
+            const char* exc = py_str(str_value);
+            throw Exception ( SCRIPTS_SCRIPT, exc ? exc : "Script error." );
         }
 
-        
+
     }
     PyObjCleanup ret_cleanup(ret);
 
@@ -393,7 +681,54 @@ DataType Scripts::exec(const std::string &module, const std::string &func_name,
         throw Exception ( SCRIPTS_ERR, "Unable to convert return value to DataType." );
     }
     return dt;
-    
+
+}
+
+
+// ******************* Scripts ***********************
+
+Scripts::Scripts() : m_impl(new impl(0)) {}
+Scripts::Scripts( uint32 workers ) : m_impl(new impl(workers)) {}
+Scripts::~Scripts() throw() { delete m_impl; }
+
+
+void Scripts::import ( const std::string &module, const std::string &script_path ) {
+    if (m_impl->m_main) return m_impl->m_main->import ( module, script_path );
+    m_impl->call_all ( [&]( ScriptInterp& in ) { in.import ( module, script_path ); } );
+}
+
+
+std::vector<std::string> Scripts::func_list(const std::string &module) const  {
+    if (m_impl->m_main) return m_impl->m_main->func_list ( module );
+    std::vector<std::string> ret;
+    m_impl->call_any ( [&]( ScriptInterp& in ) { ret = in.func_list ( module ); } );
+    return ret;
+}
+
+NodeRef Scripts::get_params (const std::string &module, const std::string &func_name ) const {
+    if (m_impl->m_main) return m_impl->m_main->get_params ( module, func_name );
+    NodeRef ret;
+    m_impl->call_any ( [&]( ScriptInterp& in ) { ret = in.get_params ( module, func_name ); } );
+    return ret;
+}
+
+std::string Scripts::get_comment(const std::string &module, const std::string &func_name) const {
+    if (m_impl->m_main) return m_impl->m_main->get_comment ( module, func_name );
+    std::string ret;
+    m_impl->call_any ( [&]( ScriptInterp& in ) { ret = in.get_comment ( module, func_name ); } );
+    return ret;
+}
+
+
+DataType Scripts::exec(const std::string &module, const std::string &func_name, const NodeRef& params ) const {
+    if (m_impl->m_main) return m_impl->m_main->exec ( module, func_name, params );
+    DataType ret(0);
+    m_impl->call_any ( [&]( ScriptInterp& in ) { ret = in.exec ( module, func_name, params ); } );
+    return ret;
+}
+
+uint32 Scripts::num_workers() const {
+    return (uint32)m_impl->m_workers.size();
 }
 
 } // end namespace
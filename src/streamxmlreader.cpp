@@ -0,0 +1,718 @@
+/**
+ * Copyright (C) 2009 Ubixum, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ **/
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <nitro/streamxmlreader.h>
+#include <nitro/error.h>
+#include <nitro/node.h>
+
+#include "didoc.h"
+
+using namespace std;
+
+#ifdef DEBUG_XML
+#define debug(x) cout << x << " (" __FILE__ ":" << __LINE__ << ")" << endl;
+#else
+#define debug(x)
+#endif
+
+namespace Nitro {
+
+struct StreamXmlReader::impl {
+    string m_path;
+    bool m_validate;
+    vector<string> m_includes;
+    Stats m_stats;
+    impl(const string& path, bool validate) : m_path(path), m_validate(validate) {
+        memset ( &m_stats, 0, sizeof(m_stats) );
+    }
+};
+
+
+/**
+ * Parses one file in a single pass over its contents.
+ *
+ * The xml layer handles elements, attributes, character data, CDATA
+ * sections, comments, processing instructions and character
+ * references.  The grammar layer mirrors the DOM walk in xmlreader.cpp
+ * so both readers produce the same ParsedDoc.
+ **/
+class DIStreamParser {
+    private:
+        struct Element {
+            string name;
+            vector<pair<string,string> > attrs;
+            bool open; // content and end tag not consumed yet
+        };
+
+        string m_path;
+        bool m_strict;
+        vector<char> m_buf;
+        const char* m_begin;
+        const char* m_pos;
+        const char* m_end;
+
+        void operator=(const DIStreamParser&); // unimpled
+        DIStreamParser(const DIStreamParser&); // unimpled
+
+    public:
+        DIStreamParser ( const string& path, bool strict ) : m_path(path), m_strict(strict), m_begin(NULL), m_pos(NULL), m_end(NULL) {}
+        ParsedDocRef parse();
+
+    private:
+        // xml layer
+        uint32 line() const;
+        void error ( const string& msg ) const;
+        bool at ( const char* s ) const {
+            size_t n = strlen(s);
+            return (size_t)(m_end-m_pos) >= n && !memcmp ( m_pos, s, n );
+        }
+        void skip_ws ();
+        void skip_past ( const char* term );
+        void skip_doctype ();
+        string read_name ();
+        enum CHARS { TEXT_CHARS, ATTR_CHARS, CDATA_CHARS };
+        void append_chars ( string& out, const char* b, const char* e, CHARS type );
+        void read_start ( Element& e );
+        bool next_child ( Element& parent, Element& child );
+        bool text ( Element& e, string& value );
+        void skip ( Element& e );
+
+        // grammar layer
+        void unexpected ( const Element& child, NITRO_ERROR err, const string& msg );
+        void check_attrs ( const Element& e, const char* const* allowed );
+        bool has_attr ( const Element& e, const char* attr ) const;
+        DataType from_str ( const string& val, DATA_TYPE t );
+        DataType get_attr ( const Element& e, const char* attr, DATA_TYPE t );
+        DataType get_node_text ( Element& e, DATA_TYPE t );
+        void handle_valuemap ( NodeRef dimap, Element& valuemap );
+        void handle_subreg ( NodeRef disubreg, Element& subreg );
+        void handle_register ( NodeRef direg, Element& reg );
+        NodeRef parse_terminal ( Element& term );
+        RegOverlayDef parse_regover ( Element& overlay );
+        TermOverlayDef parse_termoverlay ( Element& overlay );
+        DocItem parse_include ( Element& include );
+};
+
+
+uint32 DIStreamParser::line() const {
+    uint32 n=1;
+    for (const char* p=m_begin; p<m_pos && p<m_end; ++p) if (*p == '\n') ++n;
+    return n;
+}
+
+void DIStreamParser::error ( const string& msg ) const {
+    stringstream s;
+    s << msg << " (" << m_path << " Line: " << line() << ")";
+    throw Exception ( XML_PARSE, s.str() );
+}
+
+void DIStreamParser::skip_ws() {
+    while (m_pos < m_end && (*m_pos == ' ' || *m_pos == '\t' || *m_pos == '\n' || *m_pos == '\r')) ++m_pos;
+}
+
+void DIStreamParser::skip_past ( const char* term ) {
+    size_t n = strlen(term);
+    while (m_pos < m_end) {
+        if (at(term)) { m_pos += n; return; }
+        ++m_pos;
+    }
+    error ( string("Missing ") + term );
+}
+
+void DIStreamParser::skip_doctype() {
+    // internal subsets may contain '>' inside []
+    int depth=0;
+    while (m_pos < m_end) {
+        char c = *m_pos++;
+        if (c == '[') ++depth;
+        else if (c == ']') --depth;
+        else if (c == '>' && depth <= 0) return;
+    }
+    error ( "Unterminated DOCTYPE" );
+}
+
+string DIStreamParser::read_name() {
+    const char* start = m_pos;
+    while (m_pos < m_end) {
+        char c = *m_pos;
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '/' || c == '>' || c == '=') break;
+        ++m_pos;
+    }
+    if (m_pos == start) error ( "Expected a name" );
+    return string ( start, m_pos );
+}
+
+/**
+ * Line ends are normalized to \n.  Character references
+ * are replaced except in CDATA sections.  Attribute values
+ * also have whitespace characters replaced by spaces.
+ **/
+void DIStreamParser::append_chars ( string& out, const char* b, const char* e, CHARS type ) {
+    bool attr = type == ATTR_CHARS;
+    for (const char* p=b; p<e; ++p) {
+        char c = *p;
+        if (c == '\r') {
+            if (p+1 < e && p[1] == '\n') ++p;
+            out.push_back ( attr ? ' ' : '\n' );
+        } else if (attr && (c == '\n' || c == '\t')) {
+            out.push_back ( ' ' );
+        } else if (c == '&' && type != CDATA_CHARS) {
+            const char* semi = (const char*)memchr ( p, ';', e-p );
+            if (!semi) { m_pos = p; error ( "Unterminated character reference" ); }
+            string ref ( p+1, semi );
+            if (ref == "lt") out.push_back('<');
+            else if (ref == "gt") out.push_back('>');
+            else if (ref == "amp") out.push_back('&');
+            else if (ref == "quot") out.push_back('"');
+            else if (ref == "apos") out.push_back('\'');
+            else if (ref.size() > 1 && ref[0] == '#') {
+                char* endp;
+                errno=0;
+                unsigned long cp = ref[1] == 'x' ? strtoul ( ref.c_str()+2, &endp, 16 ) : strtoul ( ref.c_str()+1, &endp, 10 );
+                if (*endp || errno || !cp || cp > 0x10FFFF) { m_pos = p; error ( "Invalid character reference &" + ref + ";" ); }
+                // utf-8
+                if (cp < 0x80) out.push_back ( (char)cp );
+                else if (cp < 0x800) {
+                    out.push_back ( (char)(0xC0 | (cp >> 6)) );
+                    out.push_back ( (char)(0x80 | (cp & 0x3F)) );
+                } else if (cp < 0x10000) {
+                    out.push_back ( (char)(0xE0 | (cp >> 12)) );
+                    out.push_back ( (char)(0x80 | ((cp >> 6) & 0x3F)) );
+                    out.push_back ( (char)(0x80 | (cp & 0x3F)) );
+                } else {
+                    out.push_back ( (char)(0xF0 | (cp >> 18)) );
+                    out.push_back ( (char)(0x80 | ((cp >> 12) & 0x3F)) );
+                    out.push_back ( (char)(0x80 | ((cp >> 6) & 0x3F)) );
+                    out.push_back ( (char)(0x80 | (cp & 0x3F)) );
+                }
+            } else {
+                m_pos = p;
+                error ( "Undefined entity &" + ref + ";" );
+            }
+            p = semi;
+        } else {
+            out.push_back ( c );
+        }
+    }
+}
+
+// m_pos is just past the '<' of a start tag
+void DIStreamParser::read_start ( Element& e ) {
+    e.name = read_name();
+    e.attrs.clear();
+    while (true) {
+        skip_ws();
+        if (m_pos >= m_end) error ( "Unexpected end of file in <" + e.name + ">" );
+        if (*m_pos == '>') {
+            ++m_pos;
+            e.open = true;
+            return;
+        }
+        if (*m_pos == '/') {
+            if (!at("/>")) error ( "Expected /> in <" + e.name + ">" );
+            m_pos += 2;
+            e.open = false;
+            return;
+        }
+        string name = read_name();
+        skip_ws();
+        if (m_pos >= m_end || *m_pos != '=') error ( "Expected = after attribute " + name );
+        ++m_pos;
+        skip_ws();
+        if (m_pos >= m_end || (*m_pos != '"' && *m_pos != '\'')) error ( "Expected quoted value for attribute " + name );
+        char quote = *m_pos++;
+        const char* start = m_pos;
+        while (m_pos < m_end && *m_pos != quote) {
+            if (*m_pos == '<') error ( "< in attribute value " + name );
+            ++m_pos;
+        }
+        if (m_pos >= m_end) error ( "Unterminated attribute value " + name );
+        for (vector<pair<string,string> >::iterator itr = e.attrs.begin(); itr != e.attrs.end(); ++itr ) {
+            if (itr->first == name) error ( "Duplicate attribute " + name );
+        }
+        e.attrs.push_back ( make_pair ( name, string() ) );
+        append_chars ( e.attrs.back().second, start, m_pos, ATTR_CHARS );
+        ++m_pos;
+    }
+}
+
+/**
+ * Advance to the next child element of parent.  Character data
+ * between elements is skipped.
+ * \return false when the end tag of parent is consumed.
+ **/
+bool DIStreamParser::next_child ( Element& parent, Element& child ) {
+    if (!parent.open) return false;
+    while (true) {
+        const char* lt = (const char*) memchr ( m_pos, '<', m_end-m_pos );
+        if (!lt) {
+            m_pos = m_end;
+            error ( "Unexpected end of file in <" + parent.name + ">" );
+        }
+        m_pos = lt;
+        if (at("<!--")) {
+            skip_past("-->");
+        } else if (at("<?")) {
+            skip_past("?>");
+        } else if (at("<![CDATA[")) {
+            skip_past("]]>");
+        } else if (at("</")) {
+            m_pos += 2;
+            string name = read_name();
+            if (name != parent.name) error ( "Expected </" + parent.name + "> not </" + name + ">" );
+            skip_ws();
+            if (m_pos >= m_end || *m_pos != '>') error ( "Expected > after </" + name );
+            ++m_pos;
+            parent.open = false;
+            return false;
+        } else if (at("<!")) {
+            error ( "Unexpected markup in <" + parent.name + ">" );
+        } else {
+            ++m_pos;
+            read_start ( child );
+            return true;
+        }
+    }
+}
+
+/**
+ * The value of the first child node of e as the DOM would see it.
+ * Text is merged across comments, a CDATA section is a separate node.
+ * The rest of e is skipped.
+ * \return false if e has no text or CDATA child.
+ **/
+bool DIStreamParser::text ( Element& e, string& value ) {
+    value.clear();
+    if (!e.open) return false;
+    bool found=false;
+    while (!found) {
+        const char* lt = (const char*) memchr ( m_pos, '<', m_end-m_pos );
+        if (!lt) {
+            m_pos = m_end;
+            error ( "Unexpected end of file in <" + e.name + ">" );
+        }
+        if (lt > m_pos) {
+            append_chars ( value, m_pos, lt, TEXT_CHARS );
+            m_pos = lt;
+        }
+        if (at("<!--")) {
+            skip_past("-->");
+        } else if (at("<?")) {
+            skip_past("?>");
+        } else if (at("<![CDATA[")) {
+            if (!value.empty()) break; // text is the first child
+            m_pos += 9;
+            const char* start = m_pos;
+            skip_past ( "]]>" );
+            append_chars ( value, start, m_pos-3, CDATA_CHARS );
+            skip ( e );
+            return true;
+        } else {
+            break; // end tag or child element
+        }
+    }
+    bool has_text = !value.empty();
+    skip ( e );
+    return has_text;
+}
+
+// consume the remaining content of e
+void DIStreamParser::skip ( Element& e ) {
+    Element child;
+    while (next_child ( e, child )) skip ( child );
+}
+
+
+ParsedDocRef DIStreamParser::parse() {
+
+    ifstream in ( m_path.c_str(), ios::binary );
+    if (!in.good()) throw Exception ( XML_PARSE, "Unable to open " + m_path );
+    in.seekg(0,ios::end);
+    streamoff len = in.tellg();
+    in.seekg(0,ios::beg);
+    m_buf.resize ( (size_t)len + 1 );
+    if (len) in.read ( &m_buf[0], len );
+    if (!in.good()) throw Exception ( XML_PARSE, "Unable to read " + m_path );
+    m_buf[(size_t)len] = 0;
+    m_begin = m_pos = &m_buf[0];
+    m_end = m_begin + len;
+
+    // prolog
+    if (at("\xEF\xBB\xBF")) m_pos += 3;
+    while (true) {
+        skip_ws();
+        if (m_pos >= m_end) error ( "No root element" );
+        if (at("<?")) skip_past("?>");
+        else if (at("<!--")) skip_past("-->");
+        else if (at("<!DOCTYPE")) skip_doctype();
+        else if (*m_pos == '<') break;
+        else error ( "Content before the root element" );
+    }
+    ++m_pos;
+
+    shared_ptr<ParsedDoc> doc ( new ParsedDoc );
+    doc->path = m_path;
+
+    Element root;
+    read_start ( root );
+    if (root.name == "deviceinterface") {
+        debug ("<deviceinterface>");
+        static const char* const attrs[] = { "name", "version", NULL };
+        check_attrs ( root, attrs );
+        if (has_attr(root,"version") ) {
+            doc->attrs.push_back ( make_pair ( "version", get_attr(root,"version",STR_DATA) ) );
+        }
+        if (has_attr(root,"name") ) {
+            doc->attrs.push_back ( make_pair ( "name", get_attr(root,"name",STR_DATA) ) );
+        }
+        Element child;
+        while (next_child ( root, child )) {
+            if ( child.name == "terminal" ) {
+                DocItem item;
+                item.term = parse_terminal ( child );
+                doc->items.push_back ( item );
+            } else if ( child.name == "include" ) {
+                doc->items.push_back ( parse_include ( child ) );
+            } else {
+                unexpected ( child, XML_INVALID, "Invalid child node deviceinterface: " );
+            }
+        }
+        debug("/>");
+    } else if (root.name == "terminal") {
+        debug ("<terminal>");
+        DocItem item;
+        item.term = parse_terminal ( root );
+        doc->items.push_back ( item );
+        debug ("</terminal>");
+    } else {
+        skip ( root );
+    }
+
+    // only misc may follow the root
+    while (true) {
+        skip_ws();
+        if (m_pos >= m_end) break;
+        if (at("<?")) skip_past("?>");
+        else if (at("<!--")) skip_past("-->");
+        else error ( "Content after the root element" );
+    }
+
+    m_buf.clear();
+    return doc;
+}
+
+
+void DIStreamParser::unexpected ( const Element& child, NITRO_ERROR err, const string& msg ) {
+    throw Exception ( err, msg + child.name );
+}
+
+void DIStreamParser::check_attrs ( const Element& e, const char* const* allowed ) {
+    if (!m_strict) return;
+    for (vector<pair<string,string> >::const_iterator itr = e.attrs.begin(); itr != e.attrs.end(); ++itr ) {
+        const string& name = itr->first;
+        if (name.compare(0,5,"xmlns") == 0 || name.compare(0,4,"xsi:") == 0) continue;
+        bool ok=false;
+        for (const char* const* a = allowed; *a && !ok; ++a) ok = name == *a;
+        if (!ok) throw Exception ( XML_INVALID, "Unexpected attribute for node: " + e.name + ", " + name );
+    }
+}
+
+bool DIStreamParser::has_attr ( const Element& e, const char* attr ) const {
+    for (vector<pair<string,string> >::const_iterator itr = e.attrs.begin(); itr != e.attrs.end(); ++itr ) {
+        if (itr->first == attr) return true;
+    }
+    return false;
+}
+
+// same conversions as XMLString::parseInt and to_string
+DataType DIStreamParser::from_str ( const string& val, DATA_TYPE t ) {
+    switch (t) {
+        case INT_DATA:
+        case UINT_DATA:
+            {
+                string s ( val );
+                static const string ws = " \t\n\r";
+                size_t start = s.find_first_not_of ( ws );
+                size_t end = s.find_last_not_of ( ws );
+                if (start == string::npos) error ( "Empty value for number" );
+                s = s.substr ( start, end-start+1 );
+                size_t pos = (s[0] == '-' || s[0] == '+') ? 1 : 0;
+                if (pos == s.size()) error ( "Invalid number " + s );
+                for (;pos<s.size();++pos) {
+                    if (!isdigit(s[pos])) error ( "Invalid number " + s );
+                }
+                errno = 0;
+                long l = strtol ( s.c_str(), NULL, 10 );
+                if (errno == ERANGE) error ( "Invalid number " + s );
+                int32 i = (int32) l;
+                if (t == INT_DATA) return i;
+                return (uint32) i;
+            }
+        case STR_DATA:
+            {
+                string s ( val );
+                return trim(s);
+            }
+        default:
+            throw Exception(XML_ENTITY, "Unsupported Data Type.");
+    }
+}
+
+DataType DIStreamParser::get_attr ( const Element& e, const char* attr, DATA_TYPE t ) {
+    for (vector<pair<string,string> >::const_iterator itr = e.attrs.begin(); itr != e.attrs.end(); ++itr ) {
+        if (itr->first == attr) return from_str ( itr->second, t );
+    }
+    throw Exception ( XML_INVALID, "Missing attribute for node: " + e.name + ", " + attr );
+}
+
+DataType DIStreamParser::get_node_text ( Element& e, DATA_TYPE t ) {
+    string value;
+    if (!text ( e, value )) return string ( "" );
+    return from_str ( value, t );
+}
+
+
+void DIStreamParser::handle_valuemap ( NodeRef dimap, Element& valuemap ) {
+    Element entry;
+    while (next_child ( valuemap, entry )) {
+        if ( entry.name == "entry" ) {
+            static const char* const attrs[] = { "name", "value", NULL };
+            check_attrs ( entry, attrs );
+            debug("        entry " << get_attr( entry, "name", STR_DATA ) << " " << get_attr ( entry, "value", STR_DATA ) );
+            dimap->set_attr ( get_attr ( entry, "name", STR_DATA ), get_attr ( entry, "value", UINT_DATA ) );
+            skip ( entry );
+        } else {
+            unexpected ( entry, XML_INVALID, "Unexpected child of valuemap: " );
+        }
+    }
+}
+
+void DIStreamParser::handle_subreg ( NodeRef disubreg, Element& subreg ) {
+    Element subchild;
+    while (next_child ( subreg, subchild )) {
+        const string& node_name = subchild.name;
+        debug("        <" << node_name << " ..." );
+        if ( node_name == "comment" ) {
+             disubreg->set_attr("comment", get_node_text ( subchild, STR_DATA ) );
+        } else if (node_name == "valuemap") {
+             NodeRef valuemap = Valuemap::create("valuemap");
+             handle_valuemap ( valuemap, subchild );
+             disubreg->set_attr("valuemap", valuemap );
+        } else if (node_name == "width" ) {
+            disubreg->set_attr("width", get_node_text ( subchild, UINT_DATA ) );
+        } else if (node_name == "init" ) {
+            handle_init ( disubreg, get_node_text ( subchild, STR_DATA ) );
+        } else if (node_name == "vlog_name") {
+            disubreg->set_attr("vlog_name", get_node_text ( subchild, STR_DATA ) );
+        } else {
+            unexpected ( subchild, XML_INVALID, "Unexpected child of subregister: " );
+        }
+        debug("        />");
+    }
+}
+
+void DIStreamParser::handle_register ( NodeRef direg, Element& reg ) {
+    if (has_attr(reg,"addr")) {
+       direg->set_attr("addr", get_attr(reg,"addr",UINT_DATA));
+    }
+    if (has_attr(reg,"endian")) {
+       direg->set_attr("endian", get_attr(reg,"endian", STR_DATA ));
+    }
+    Element regchild;
+    while (next_child ( reg, regchild )) {
+          const string& nodename = regchild.name;
+          if ( nodename == "type" ) {
+             direg->set_attr("type", get_node_text ( regchild, STR_DATA ) );
+          } else if (nodename == "mode") {
+             direg->set_attr("mode", get_node_text ( regchild, STR_DATA ) );
+          } else if (nodename == "subregister") {
+             static const char* const attrs[] = { "name", NULL };
+             check_attrs ( regchild, attrs );
+             NodeRef subreg = Subregister::create ( get_attr ( regchild, "name", STR_DATA ) );
+             debug("      <subreg name=\"" << subreg->get_name() << '"');
+             handle_subreg ( subreg, regchild );
+             direg->add_child ( subreg );
+             debug("      />");
+          } else if (nodename == "array") {
+             direg->set_attr("array", get_node_text( regchild, UINT_DATA ) );
+          } else if (nodename == "init" ) {
+             handle_init ( direg, get_node_text( regchild, STR_DATA ) );
+          } else if (nodename == "valuemap" ) {
+             NodeRef valuemap = Valuemap::create("valuemap");
+             handle_valuemap ( valuemap, regchild );
+             direg->set_attr("valuemap", valuemap );
+          } else if (nodename == "width" ) {
+             direg->set_attr("width", get_node_text ( regchild, UINT_DATA ) );
+          } else if (nodename == "comment" ) {
+             direg->set_attr("comment", get_node_text ( regchild, STR_DATA ) );
+          } else {
+             unexpected ( regchild, XML_ENTITY, "Unexpected child node of register: " );
+          }
+    }
+}
+
+NodeRef DIStreamParser::parse_terminal ( Element& term ) {
+    static const char* const attrs[] = { "name", "addr", "regDataWidth", "regAddrWidth", "version", "endian", "type", NULL };
+    check_attrs ( term, attrs );
+    NodeRef diterm = Terminal::create( get_attr(term, "name", STR_DATA) );
+    debug("  <terminal name=\"" << diterm->get_name() );
+    if (has_attr(term, "regDataWidth")) {
+        diterm->set_attr ( "regDataWidth", get_attr(term, "regDataWidth", UINT_DATA ) );
+    } else {
+        diterm->set_attr ( "regDataWidth", 32);
+    }
+    if (has_attr(term, "regAddrWidth")) {
+        diterm->set_attr ( "regAddrWidth", get_attr(term, "regAddrWidth", UINT_DATA ) );
+    } else {
+        diterm->set_attr ( "regAddrWidth", 32);
+    }
+    if (has_attr(term,"endian")) {
+      diterm->set_attr("endian", get_attr(term, "endian", STR_DATA ) );
+    }
+    if (has_attr(term,"type")) {
+        diterm->set_attr("type", get_attr(term, "type", STR_DATA ) );
+    }
+    if (has_attr(term,"addr")) {
+      diterm->set_attr("addr", get_attr(term, "addr", UINT_DATA ));
+    }
+    if (has_attr(term,"version")) {
+        diterm->set_attr( "version", get_attr( term, "version", STR_DATA ) );
+    }
+
+    Element reg;
+    while (next_child ( term, reg )) {
+        if ("comment" == reg.name ) {
+            diterm->set_attr("comment", get_node_text ( reg, STR_DATA ) );
+        } else if ("register" == reg.name ) {
+            static const char* const attrs[] = { "name", "addr", "endian", NULL };
+            check_attrs ( reg, attrs );
+            NodeRef direg = Register::create ( get_attr(reg, "name", STR_DATA ) );
+            debug("    <register name=\"" << direg->get_name() );
+            handle_register ( direg, reg );
+            diterm->add_child ( direg );
+            debug("    />");
+        } else {
+            unexpected ( reg, XML_INVALID, "Unexpected child node of terminal: " );
+        }
+    }
+    debug("  />");
+    return diterm;
+}
+
+RegOverlayDef DIStreamParser::parse_regover ( Element& overlay ) {
+    static const char* const attrs[] = { "name", "newname", "addr", NULL };
+    check_attrs ( overlay, attrs );
+    RegOverlayDef def;
+    def.name = (string) get_attr ( overlay, "name", STR_DATA );
+    if (has_attr(overlay, "newname" )) {
+        def.has_newname = true;
+        def.newname = (string) get_attr ( overlay, "newname", STR_DATA );
+    }
+    if (has_attr(overlay, "addr")) {
+        def.has_addr = true;
+        def.addr = get_attr ( overlay, "addr", UINT_DATA );
+    }
+    skip ( overlay );
+    return def;
+}
+
+TermOverlayDef DIStreamParser::parse_termoverlay ( Element& overlay ) {
+    static const char* const attrs[] = { "name", "newname", "addr", "regDataWidth", "regAddrWidth", NULL };
+    check_attrs ( overlay, attrs );
+    TermOverlayDef def;
+    def.name = (string) get_attr ( overlay, "name", STR_DATA );
+    if (has_attr ( overlay, "newname" )) {
+        def.has_newname = true;
+        def.newname = (string) get_attr ( overlay, "newname", STR_DATA );
+    }
+    if (has_attr ( overlay, "addr" )) {
+        def.has_addr = true;
+        def.addr = get_attr(overlay,"addr",UINT_DATA);
+    }
+
+    Element regover;
+    while (next_child ( overlay, regover )) {
+        if ( regover.name == "register" ) {
+            static const char* const attrs[] = { "name", "addr", "endian", NULL };
+            check_attrs ( regover, attrs );
+            RegOverlayDef reg;
+            reg.reg = Register::create( get_attr ( regover, "name", STR_DATA ) );
+            handle_register ( reg.reg, regover );
+            def.regs.push_back ( reg );
+        } else if ( regover.name == "regoverlay" ) {
+            def.regs.push_back ( parse_regover ( regover ) );
+        } else {
+            if (m_strict) unexpected ( regover, XML_INVALID, "Unexpected child of termoverlay: " );
+            skip ( regover );
+        }
+    }
+    return def;
+}
+
+DocItem DIStreamParser::parse_include ( Element& include ) {
+    static const char* const attrs[] = { "src", NULL };
+    check_attrs ( include, attrs );
+    DocItem item;
+    item.src = (string) get_attr ( include, "src", STR_DATA );
+    Element overlay;
+    while (next_child ( include, overlay )) {
+        if ( overlay.name == "termoverlay" ) {
+            item.overlays.push_back ( parse_termoverlay ( overlay ) );
+        } else {
+            // else don't know how to handle element
+            if (m_strict) unexpected ( overlay, XML_INVALID, "Unexpected child of include: " );
+            skip ( overlay );
+        }
+    }
+    return item;
+}
+
+
+ParsedDocRef parse_stream ( const string& path, bool validate ) {
+    DIStreamParser parser ( path, validate );
+    return parser.parse();
+}
+
+
+StreamXmlReader::StreamXmlReader(const std::string& file_path, bool validate) : m_impl(new impl(file_path, validate)) {
+}
+StreamXmlReader::~StreamXmlReader() throw() { delete m_impl;}
+
+const vector<string>& StreamXmlReader::includes() const {
+    return m_impl->m_includes;
+}
+
+const StreamXmlReader::Stats& StreamXmlReader::stats() const {
+    return m_impl->m_stats;
+}
+
+void StreamXmlReader::read(NodeRef node) {
+    load_doc_tree ( node, m_impl->m_path, parse_stream, "stream", m_impl->m_validate, m_impl->m_includes, m_impl->m_stats );
+}
+
+
+} // end namespace
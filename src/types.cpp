@@ -23,6 +23,7 @@
 #include <iterator>
 
 #include <nitro/types.h>
+#include <nitro/bigint.h>
 #include <nitro/error.h>
 #include <nitro/node.h>
 #include <nitro/device.h>
@@ -40,34 +41,35 @@ std::string set_str(const T& val) {
     return io.rdbuf()->str();
 }
 
-DataType::DataType(int32 val) : m_type(INT_DATA), m_int(val), m_node(NULL), m_list(NULL), m_dev(NULL){
-    m_str=set_str(val);
-}
-DataType::DataType(uint32 val) : m_type(UINT_DATA), m_uint(val), m_node(NULL), m_list(NULL), m_dev(NULL){
-    m_str=set_str(val);
-}
+DataType::DataType(int32 val) : m_type(INT_DATA), m_int(val), m_has_str(false), m_fmt(NULL), m_dev(NULL), m_buf(NULL) {}
+DataType::DataType(uint32 val) : m_type(UINT_DATA), m_uint(val), m_has_str(false), m_fmt(NULL), m_dev(NULL), m_buf(NULL) {}
 
-DataType::DataType(double val) : m_type(FLOAT_DATA), m_float(val), m_node(NULL), m_list(NULL), m_dev(NULL) {
-    m_str=set_str(val);
-}
+DataType::DataType(double val) : m_type(FLOAT_DATA), m_float(val), m_has_str(false), m_fmt(NULL), m_dev(NULL), m_buf(NULL) {}
 
-DataType::DataType(const char* value): m_type(STR_DATA), m_str(value), m_node(NULL), m_list(NULL), m_dev(NULL) {}
-DataType::DataType(const std::string& val): m_type(STR_DATA), m_str(val), m_node(NULL), m_list(NULL), m_dev(NULL) {}
+DataType::DataType(const char* value): m_type(STR_DATA), m_int(0), m_has_str(true), m_fmt(NULL), m_str(value), m_dev(NULL), m_buf(NULL) {}
+DataType::DataType(const std::string& val): m_type(STR_DATA), m_int(0), m_has_str(true), m_fmt(NULL), m_str(val), m_dev(NULL), m_buf(NULL) {}
+DataType::DataType(std::string&& val): m_type(STR_DATA), m_int(0), m_has_str(true), m_fmt(NULL), m_str(std::move(val)), m_dev(NULL), m_buf(NULL) {}
 
-DataType::DataType(const NodeRef& node): m_type(NODE_DATA), m_node(new NodeRef()), m_list(NULL), m_dev(NULL) {
-    *m_node = node;
-    m_str=set_str ( *m_node );
-}
+DataType::DataType(const NodeRef& node): m_type(NODE_DATA), m_int(0), m_has_str(false), m_fmt(NULL), m_node(node), m_dev(NULL), m_buf(NULL) {}
 
-DataType::DataType(const std::vector<DataType>& list) : m_type(LIST_DATA), m_node(NULL), m_list(new std::vector<DataType>), m_dev(NULL) {
-   *m_list = list; 
-   m_str = set_str ( *m_list );
-}
+DataType::DataType(const std::vector<DataType>& list) : m_type(LIST_DATA), m_int(0), m_has_str(false), m_fmt(NULL), m_shared(std::make_shared<std::vector<DataType> >(list)), m_dev(NULL), m_buf(NULL) {}
+DataType::DataType(std::vector<DataType>&& list) : m_type(LIST_DATA), m_int(0), m_has_str(false), m_fmt(NULL), m_shared(std::make_shared<std::vector<DataType> >(std::move(list))), m_dev(NULL), m_buf(NULL) {}
 
-DataType::DataType(Device& dev) : m_type(DEV_DATA), m_node(NULL), m_list(NULL), m_dev(&dev) {
-  m_str = "Nitro::Device"; 
+DataType::DataType(const BigInt& value) : m_type(INT_DATA), m_int(0), m_has_str(false), m_fmt(NULL), m_dev(NULL), m_buf(NULL) {
+    uint32 n = value.num_words();
+    if (n <= 1) {
+        m_uint = value.word(0);
+        m_type = m_uint & 0x80000000 ? UINT_DATA : INT_DATA;
+        return;
+    }
+    std::shared_ptr<std::vector<uint32> > words = std::make_shared<std::vector<uint32> >(n);
+    for (uint32 i=0;i<n;++i) (*words)[i] = value.word(i);
+    m_shared = words;
+    m_type = BIGINT_DATA;
 }
 
+DataType::DataType(Device& dev) : m_type(DEV_DATA), m_int(0), m_has_str(false), m_fmt(NULL), m_dev(&dev), m_buf(NULL) {}
+
 DataType DataType::as_datatype(uint8* buf, uint32 len) {
 	DataType b(len);
 	b.m_buf = buf;
@@ -84,9 +86,14 @@ uint8* DataType::as_buffer(const DataType &d){
 
 DataType DataType::as_bigint_datatype ( const std::vector<DataType> &ints, const std::string str ) {
     DataType bi(0);
-    bi.m_list = new std::vector<DataType>(ints);
+    std::shared_ptr<std::vector<uint32> > words = std::make_shared<std::vector<uint32> >(ints.begin(), ints.end());
+    while (!words->empty() && !words->back()) words->pop_back();
+    bi.m_shared = words;
     bi.m_type = BIGINT_DATA;
-    bi.m_str = str;
+    if (!str.empty()) {
+        bi.m_str = str;
+        bi.m_has_str = true;
+    }
 
     return bi;
 }
@@ -95,53 +102,136 @@ std::vector<DataType> DataType::as_bigints ( const DataType& d ) {
     if (d.m_type != BIGINT_DATA) {
         throw Exception ( INVALID_TYPE );
     }
-    return *d.m_list;
+    return std::vector<DataType> ( d.words().begin(), d.words().end() );
 }
 
+BigInt DataType::as_bigint ( const DataType& d ) {
+    switch (d.m_type) {
+        case INT_DATA:
+        case UINT_DATA:
+            return BigInt ( d.m_uint );
+        case BIGINT_DATA:
+            {
+                const std::vector<uint32>& words = d.words();
+                if (words.size() > BigInt::WORDS) throw Exception ( INVALID_CAST, "Integer wider than supported" );
+                BigInt res;
+                for (uint32 i=0;i<words.size();++i) res.set_word ( i, words[i] );
+                return res;
+            }
+        default:
+            throw Exception ( INVALID_CAST, "Unsupported cast to bigint from datatype.", d );
+    }
+}
+
+const std::vector<DataType>& DataType::as_list ( const DataType& d ) {
+    if (LIST_DATA != d.m_type) throw Exception ( INVALID_CAST, "Unsupported cast to list." );
+    return d.list();
+}
 
-void DataType::copy(const DataType& other) {
+
+// scalar members only
+void DataType::copy_value(const DataType& other) {
 	m_type=other.m_type;
-	m_str=other.m_str;
     if (other.m_type == FLOAT_DATA)
         m_float=other.m_float;
     else
 	    m_int=other.m_int; // m_uint the same   
-
-    if (m_node) delete m_node;
-    if (other.m_node) {
-        m_node = new NodeRef ( *other.m_node );
-    } else {
-        m_node = NULL;
-    }
-
-    if (m_list) delete m_list;
-    if (other.m_list) {
-        m_list = new std::vector<DataType> ( *other.m_list );
-    } else {
-        m_list = NULL;
-    }
+    m_has_str=other.m_has_str;
     m_dev = other.m_dev;
 	m_buf = other.m_buf;
 }
 
-DataType::DataType(const DataType &other) : m_node(NULL), m_list(NULL) {
-	copy(other);
+// other must not be owned by this
+void DataType::take(DataType& other) throw() {
+    copy_value(other);
+    delete m_fmt.exchange ( other.m_fmt.exchange ( NULL ) );
+    m_str.swap(other.m_str);
+    m_node.swap(other.m_node);
+    m_shared.swap(other.m_shared);
+    other.clear();
+}
+
+void DataType::clear() throw() {
+    m_type = INT_DATA;
+    m_int = 0;
+    m_has_str = false;
+    delete m_fmt.exchange ( NULL );
+    m_str.clear();
+    m_node.reset();
+    m_shared.reset();
+    m_dev = NULL;
+    m_buf = NULL;
+}
+
+DataType::DataType(const DataType &other) : m_fmt(NULL), m_str(other.m_str), m_node(other.m_node), m_shared(other.m_shared) {
+	copy_value(other);
+    // don't format other just to copy it
+    const std::string* fmt = other.m_fmt.load();
+    if (fmt) m_fmt = new std::string ( *fmt );
+}
+
+DataType::DataType(DataType&& other) noexcept : m_fmt(NULL) {
+    take(other);
 }
 
 DataType::~DataType() throw() {
-    if (m_node) delete m_node;
-    if (m_list) delete m_list;
     // not currently managing m_dev memory
+    delete m_fmt.load();
 }
 
 
+// other may be an element of this list so it is
+// moved out before the current value is released.
 DataType& DataType::operator=(const DataType& other) {
-	copy(other);
+    if (this != &other) {
+        DataType tmp(other);
+        take(tmp);
+    }
 	return *this;	
 }
 
+DataType& DataType::operator=(DataType&& other) noexcept {
+    if (this != &other) {
+        DataType tmp(std::move(other));
+        take(tmp);
+    }
+    return *this;
+}
+
 const std::string& DataType::str_value() const {
-    return m_str;
+    if (m_has_str) return m_str;
+    const std::string* fmt = m_fmt.load();
+    if (fmt) return *fmt;
+    std::unique_ptr<std::string> str ( new std::string );
+    switch (m_type) {
+        case INT_DATA:
+            *str = set_str ( m_int );
+            break;
+        case UINT_DATA:
+        case BUF_DATA: // buffer length
+            *str = set_str ( m_uint );
+            break;
+        case FLOAT_DATA:
+            *str = set_str ( m_float );
+            break;
+        case NODE_DATA:
+            *str = set_str ( m_node );
+            break;
+        case LIST_DATA:
+            *str = set_str ( list() );
+            break;
+        case BIGINT_DATA:
+            *str = as_bigint ( *this ).str();
+            break;
+        case DEV_DATA:
+            *str = "Nitro::Device";
+            break;
+        default:
+            break;
+    }
+    // another thread may have formatted it first
+    if (!m_fmt.compare_exchange_strong ( fmt, str.get() )) return *fmt;
+    return *str.release();
 }
 
 const std::string& DataType::str_type() const {
@@ -196,18 +286,17 @@ DataType::operator double() const {
 }
 
 DataType::operator std::string() const {
-    return m_str;
+    return str_value();
 } 
 
 DataType::operator NodeRef() const {
     if (NODE_DATA != m_type) throw Exception ( INVALID_CAST, "Unsupported Cast to NodeRef" );
-    return *m_node;
+    return m_node;
 }
 
 
 DataType::operator std::vector<DataType> () const {
-    if (LIST_DATA != m_type) throw Exception ( INVALID_CAST, "Unsupported cast to list." );
-    return *m_list;
+    return as_list ( *this );
 }
 
 DataType::operator Device& () const {
@@ -226,11 +315,14 @@ bool DataType::operator==(const DataType& other) const {
         case STR_DATA:
             return other.m_type==STR_DATA && m_str == other.m_str;
         case NODE_DATA:
-            if (other.m_type != NODE_DATA) return false; // eliminates NULL for other node 
-            return *m_node == *other.m_node;
+            if (other.m_type != NODE_DATA) return false;
+            return m_node == other.m_node;
         case LIST_DATA:
             if (other.m_type != LIST_DATA) return false;
-            return *m_list == *other.m_list;
+            return list() == other.list();
+        case BIGINT_DATA:
+            if (other.m_type != BIGINT_DATA) return false;
+            return words() == other.words();
         default:
             throw Exception ( INVALID_TYPE, "Unsupported Data Type" );
     }
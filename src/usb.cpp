@@ -30,7 +30,7 @@
 #include <nitro/node.h>
 #include "vendor_commands.h"
 
-#include "ihx.h"
+#include "fwload.h"
 
 
 #include "hr_time.h"
@@ -81,7 +81,7 @@ typedef enum {
  NITRO_OUT // = USB_TYPE_VENDOR
 } NITRO_DIR;
 
-struct usbdev_impl_core {
+struct usbdev_impl_core : public FirmwareTransport {
 
     uint32 m_vid;
     uint32 m_pid;
@@ -111,23 +111,27 @@ struct usbdev_impl_core {
       return false;
     }
 
-    int write_ram(uint16 addr, const uint8* data, size_t length, unsigned int timeout ) {
-    
-    	size_t transferred = 0;
-    	// try 1024 bytes at a time.
-    	while ( transferred < length ) {
-    		int cur_transfer_size = length-transferred > 1024 ? 1024 : length-transferred;
-    
-            int ret = control_transfer ( NITRO_OUT, VC_RDWR_RAM, addr+transferred, 0, const_cast<uint8*>(data+transferred), cur_transfer_size, timeout );
-    		if (ret>0) {
-    			transferred += cur_transfer_size;
-                usb_debug ( "Transfered " << cur_transfer_size << " to device." );
-    		} else {
+    // one transfer at a time.  Implementations override this to
+    // pipeline the writes.
+    virtual void write_ram_blocks ( const std::vector<RamWrite>& writes, uint32 timeout ) {
+        for (std::vector<RamWrite>::const_iterator itr=writes.begin(); itr != writes.end(); ++itr) {
+            int ret = control_transfer ( NITRO_OUT, VC_RDWR_RAM, itr->value, itr->index, const_cast<uint8*>(itr->data), itr->length, timeout );
+            if (ret != itr->length) {
                 throw Exception ( USB_COMM, "Failed to transfer bytes to usb device memory.", impl_error_name(ret) );
             }
-                
-    	}
-    	return length;
+            usb_debug ( "Transfered " << itr->length << " to device." );
+        }
+    }
+
+    virtual int read_ram ( uint16 value, uint16 index, uint8* data, uint16 length, uint32 timeout ) {
+        return control_transfer ( NITRO_IN, VC_RDWR_RAM, value, index, data, length, timeout );
+    }
+
+    int write_ram(uint16 addr, const uint8* data, size_t length, unsigned int timeout ) {
+        std::vector<RamWrite> writes;
+        ram_writes ( addr, data, length, 1024, false, writes );
+        write_ram_blocks ( writes, timeout );
+        return length;
     }
    void rdwr_setup (uint8 command, size_t length, uint16 terminal_addr, uint32 reg_addr, uint32 timeout) {
         // send usb read command
@@ -216,19 +220,31 @@ void USBDevice::load_firmware(const char* bytes,size_t length) {
     return;
   }
 
-    IhxFile ihx = parse_ihx ( bytes, length );
-
-	// place the device in reset
-    m_impl->toggle_reset(false);
-    for (IhxFile::iterator itr=ihx.begin(); itr != ihx.end(); ++itr ) {
-        m_impl->write_ram(itr->addr,itr->bytes.c_str(),itr->bytes.size(),1000); 
-    }
-    m_impl->toggle_reset(true);
+    load_ihx ( *m_impl, bytes, length );
     m_impl->control_transfer ( NITRO_OUT, VC_RENUM, 0, 0, NULL, 0, 1000); 
     m_impl->close();
 
 }
 
+bool USBDevice::load_firmware(const char* bytes, size_t length, bool force) {
+    if (!force && firmware_loaded ( bytes, length )) {
+        usb_debug ( "Firmware already loaded." );
+        return false;
+    }
+    load_firmware ( bytes, length );
+    return true;
+}
+
+bool USBDevice::firmware_loaded(const char* bytes, size_t length) {
+    // fx3 images are not stamped
+    if ( length >= 2 && strncmp(bytes, "CY", 2)==0) return false;
+    return ihx_loaded ( *m_impl, bytes, length );
+}
+
+void USBDevice::set_pipe_throttle ( uint32 depth, uint32 hold ) {
+    m_impl->m_throttle.set ( depth, hold );
+}
+
 void USBDevice::renum() {
     m_impl->control_transfer ( NITRO_OUT, VC_RENUM, 0, 0, NULL, 0, 1000 );
     m_impl->close();
@@ -243,9 +259,11 @@ void USBDevice::reset() {
 
 USBDevice::USBDevice(uint32 vid, uint32 pid) {
   m_impl=new impl(vid,pid);
+  m_impl->m_register_io = [this]() { return register_io_pending(); };
 }
 
 USBDevice::~USBDevice() throw() {
+    unwatch_all();
     m_impl->close();
     delete m_impl;
 }
@@ -285,6 +303,16 @@ void USBDevice::_close() {
 }
 
 
+void USBDevice::_cancel( uint32 terminal_addr ) {
+    // register terminals share the rdwr endpoints
+    if (m_impl->is_pipe(get_di(),terminal_addr)) {
+        m_impl->cancel_transfers ( terminal_addr );
+    } else {
+        m_impl->cancel_transfers ( m_impl->m_read_ep );
+        m_impl->cancel_transfers ( m_impl->m_write_ep );
+    }
+}
+
 void USBDevice::_read( uint32 terminal_addr, uint32 reg_addr, uint8* data, size_t length, uint32 timeout ) {
 
     // send usb read command
@@ -468,81 +496,16 @@ void USBDevice::open(const std::wstring& serial) {
 
 
 size_t USBDevice::write_fx3_ram(uint32 addr, const uint8* data, size_t length, unsigned int timeout ) {
-  size_t transferred = 0;
-  uint32 addr1;
-  // try 4096 bytes at a time.
-  while ( transferred < length ) {
-    int cur_transfer_size = length-transferred > 4096 ? 4096 : length-transferred;
-    addr1 = addr + transferred;
-    int ret = m_impl->control_transfer ( NITRO_OUT, VC_RDWR_RAM, addr1 & 0xFFFF, addr1 >> 16, const_cast<uint8*>(data+transferred), cur_transfer_size, timeout );
-    if (ret>0) {
-      transferred += cur_transfer_size;
-      usb_debug ( "Transfered " << cur_transfer_size << " to device." );
-    } else {
-      throw Exception ( USB_COMM, "Failed to transfer bytes to usb device memory.", libusb_error_name(ret) );
-    }
-  }
+  std::vector<RamWrite> writes;
+  ram_writes ( addr, data, length, 4096, true, writes );
+  m_impl->write_ram_blocks ( writes, timeout );
   return length;
 }
 
 
 void USBDevice::load_fx3_firmware(const char* bytes, size_t length) {
-  uint8 *buf = (uint8 *) bytes;
-  uint32 dlen, address, program_entry;
-  int r;
-
   usb_debug("Loading firmware FX3**************");
-
-  /* Check first 2 bytes, must be equal to 'CY'	*/
-  if ( strncmp((char *) buf, "CY", 2) ) {
-    throw Exception ( USB_FIRMWARE, "Image does not have 'CY' at start. Aborting.", -2);
-  }
-  buf += 2; // advance pointer
-
-  /* Read 1 byte. bImageCTL	*/
-  if ( buf[0] & 0x01 ) {
-    throw Exception ( USB_FIRMWARE, "Image does not contain executable code.", -3);
-  }
-  buf += 1;
-
-  /* Read 1 byte. bImageType	*/
-  if ( !(buf[0] == 0xB0) ) {
-    throw Exception (USB_FIRMWARE, "Not a normal FW binary with checksum", -4);
-  }
-  buf += 1;
-
-  while (1) {
-    /* Read Length of section 1,2,3, ...	*/
-    dlen = *((uint32 *) buf);
-    buf += 4;
-    /* Read Address of section 1,2,3,...	*/
-    address = *((uint32 *)buf);   
-    buf += 4;
-    if ( dlen != 0 ) {
-      /* Write data bytes */
-      write_fx3_ram(address, (uint8 *) buf, dlen*4, 1000);
-      buf += dlen*4;
-
-//      for ( j = 0; j < len/4; ++j )
-//	checksum += pint[j];
-
-    } else {
-      program_entry = address;
-      break;
-    }
-  }
-//  /* Read checksum	*/
-//  file_checksum = *((uint32 *)buf);
-//  if ( *pdbuf != checksum ) {
-//    printf("Error in checksum\n");
-//    return -5;
-//  }
-  nitro_sleep(1e6); // 1 second
-  // write the program entry point
-  r = m_impl->control_transfer(NITRO_OUT, VC_RDWR_RAM, (program_entry & 0x0000ffff ) , program_entry >> 16, NULL, 0, 1000);
-  if ( r ) {
-    throw Exception (USB_COMM, "Error in control_transfer", m_impl->impl_error_name(r));
-  }
+  load_fx3 ( *m_impl, bytes, length );
   m_impl->close();
 }
 
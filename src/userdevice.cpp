@@ -153,6 +153,7 @@ UserDevice::UserDevice( const std::string &path, const char* args[],void* ud ) :
 }
 
 UserDevice::~UserDevice() throw() {
+    unwatch_all();
     delete m_impl;
 }
 
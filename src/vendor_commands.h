@@ -161,4 +161,18 @@ VC_SERIAL=0xb6
 
 };
 
+/**
+ * The host loader writes a stamp identifying the loaded image to the
+ * end of fx2 scratch ram while the cpu is held in reset.  It reads it
+ * back with VC_RDWR_RAM, along with the image itself, to skip loading
+ * an image the device already runs.  Firmware must not use these bytes.
+ *
+ *  4 bytes FW_STAMP_MAGIC
+ *  8 bytes image hash (little-endian)
+ *  4 bytes image length (little-endian)
+ **/
+#define FW_STAMP_ADDR 0xe1f0
+#define FW_STAMP_LEN 16
+#define FW_STAMP_MAGIC "NFWH"
+
 #endif
@@ -16,6 +16,7 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  **/
 
+#include <cstring>
 #include <memory>
 #include <iostream>
 #include <sstream>
@@ -31,7 +32,7 @@
 #include <nitro/error.h>
 #include <nitro/node.h>
 
-#include "bihelp.h"
+#include "didoc.h"
 #include "xutils.h"
 
 XERCES_CPP_NAMESPACE_USE
@@ -46,16 +47,6 @@ using namespace Nitro;
 #endif
 
 
-string& trim ( string& s ) {
-    static string ws = "\t\n\n ";
-    size_t startpos = s.find_first_not_of (ws);
-    size_t endpos = s.find_last_not_of (ws);
-    if (string::npos == startpos || string::npos == endpos ) s = "";
-    else s=s.substr( startpos, endpos-startpos+1 );
-
-    return s;
-}
-
 string to_string( const XMLCh* ent ) {
     char* str = XMLString::transcode(ent);
     string res(str);
@@ -65,18 +56,6 @@ string to_string( const XMLCh* ent ) {
 
 
 
-bool isnumeric ( const string& s ) {
-    if (!s.size()) return false;
-    char first=s.at(0);
-    if (s.size()==1 && !isdigit(first)) return false;
-    if (first != '+' && first != '-' && !isdigit(first)) return false;
-    for (size_t pos=1;pos<s.size();++pos) {
-        if (!isdigit(s.at(pos))) return false;
-    }
-    return true;
-}
-
-
 ostream& operator<<(ostream& out, const XMLCh* const ent ) {
     out << to_string(ent);
     return out;
@@ -90,11 +69,14 @@ struct XmlReader::impl {
 //    std::istream &m_in;
     string m_path;
     bool m_validate;
-    impl(const string& path, bool validate) : m_path(path), m_validate(validate) {}
+    vector<string> m_includes;
+    Stats m_stats;
+    impl(const string& path, bool validate) : m_path(path), m_validate(validate) {
+        memset ( &m_stats, 0, sizeof(m_stats) );
+    }
 
 };
 
-
 class NitroErrorHandler : public HandlerBase {
   private:
    string m_error;
@@ -184,45 +166,6 @@ void handle_valuemap ( NodeRef dimap, DOMNode *valuemap ) {
      }
 }
 
-void handle_init ( NodeRef reg, const string &init_str) {
-    string init = init_str;
-    vector<string> array;
-    do {
-        trim(init);
-        size_t pos = init.find(",");
-        if (string::npos == pos) {
-            array.push_back ( init );
-        } else {
-            string elem = init.substr(0,pos);
-            init=init.substr(pos+1); // skip the comma
-            array.push_back ( trim(elem) );
-        }
-    } while ( init.find(",") != string::npos );
-
-    vector<DataType> arraydt;
-    for (vector<string>::iterator itr = array.begin();
-             itr != array.end();
-             ++itr ) {
-             
-        string elem = *itr; 
-        if ( isnumeric(elem) ) {
-            // numeric
-            mpz_class ielem ( elem ); // for bit int support
-            arraydt.push_back ( dt_from_bi ( ielem ) ); 
-        } else {
-            // string init values are resolved when added to the di 
-            arraydt.push_back(elem);
-        } 
-
-    }
-
-    DataType initdt(0);
-    if (arraydt.size()==1) initdt = arraydt.at(0);
-    else initdt=arraydt;
-
-    reg->set_attr("init", initdt );
-}
-
 void handle_subreg( NodeRef disubreg, DOMNode *subreg ) {
     
     for (DOMNode *subchild = subreg->getFirstChild(); NULL != subchild; subchild = subchild->getNextSibling() ) {
@@ -311,7 +254,7 @@ void handle_registers ( NodeRef diterm , DOMNode *term ) {
  
 }
 
-void handle_terminal ( NodeRef di, DOMNode *term ) {
+NodeRef parse_terminal ( DOMNode *term ) {
     NodeRef diterm = Terminal::create( get_attr(term, "name", STR_DATA) );
     debug("  <terminal name=\"" << diterm->get_name() );
     if (has_attr(term, "regDataWidth")) { 
@@ -339,33 +282,35 @@ void handle_terminal ( NodeRef di, DOMNode *term ) {
    
     handle_registers ( diterm, term ); 
     debug("  />");
-
-    if (di->has_child ( diterm->get_name() ) ) di->del_child ( diterm->get_name() );
-    di->add_child ( diterm );
+    return diterm;
 }
 
 
-void handle_regover ( NodeRef term, DOMNode *overlay ) {
-    string name = get_attr ( overlay, "name", STR_DATA );
-    NodeRef origreg = term->get_child( name );
+RegOverlayDef parse_regover ( DOMNode *overlay ) {
+    RegOverlayDef def;
+    def.name = (string) get_attr ( overlay, "name", STR_DATA );
     if (has_attr(overlay, "newname" )) {
-        origreg->set_name( get_attr ( overlay, "newname", STR_DATA ) );
+        def.has_newname = true;
+        def.newname = (string) get_attr ( overlay, "newname", STR_DATA );
     }
     if (has_attr(overlay, "addr")) {
-        origreg->set_attr( "addr", get_attr ( overlay, "addr", UINT_DATA ) );
+        def.has_addr = true;
+        def.addr = get_attr ( overlay, "addr", UINT_DATA );
     }
+    return def;
 }
 
 
-void handle_termoverlay ( NodeRef di, DOMNode *overlay ) {
-    string name = get_attr ( overlay, "name", STR_DATA );
-    NodeRef origterm = di->get_child ( name );
+TermOverlayDef parse_termoverlay ( DOMNode *overlay ) {
+    TermOverlayDef def;
+    def.name = (string) get_attr ( overlay, "name", STR_DATA );
     if (has_attr ( overlay, "newname" )) {
-        string newname = get_attr ( overlay, "newname", STR_DATA );
-        origterm->set_name(newname);
+        def.has_newname = true;
+        def.newname = (string) get_attr ( overlay, "newname", STR_DATA );
     }
     if (has_attr ( overlay, "addr" )) {
-        origterm->set_attr("addr", get_attr(overlay,"addr",UINT_DATA));
+        def.has_addr = true;
+        def.addr = get_attr(overlay,"addr",UINT_DATA);
     }
 
     for (DOMNode *regover = overlay->getFirstChild();
@@ -373,76 +318,53 @@ void handle_termoverlay ( NodeRef di, DOMNode *overlay ) {
          regover = regover->getNextSibling() ) {
         string node_name = to_string(regover->getNodeName());
         if ( node_name == "register" ) {
-            NodeRef reg = Register::create( get_attr ( regover, "name", STR_DATA ) ); 
-            handle_register ( reg, regover );
-            origterm->add_child( reg );
+            RegOverlayDef reg;
+            reg.reg = Register::create( get_attr ( regover, "name", STR_DATA ) ); 
+            handle_register ( reg.reg, regover );
+            def.regs.push_back ( reg );
         } else if ( node_name == "regoverlay" ) {
-            handle_regover ( origterm, regover );
+            def.regs.push_back ( parse_regover ( regover ) );
         }
     }
+    return def;
 }
 
-void handle_include ( NodeRef dest, DOMNode *include, bool validate, string orig_path ) {
-     string src = get_attr ( include, "src", STR_DATA );
-     NodeRef includedi = DeviceInterface::create("includedi");
-     string unique_fake_term_name = "fake_addr_term879873498723947293797998749527"; 
-     if ( dest->has_children() ) {
-        /**
-         * To make sure the included terminals are 
-         * auto-number (address) from the correct 
-         * address number, we need a fake terminal
-         **/
-        NodeRef fake_addr_term = Terminal::create(unique_fake_term_name);
-        NodeRef last_real_term = *(dest->child_end()-1);
-        fake_addr_term->set_attr("addr", last_real_term->get_attr("addr"));
-        includedi->add_child(fake_addr_term);
-     }
-     
-     // resolve src path to abs path
-     string absdir = xdirname ( orig_path );
-     string abspath = xjoin ( absdir , src );
-
-     XmlReader xmlr ( abspath, validate );
-     xmlr.read ( includedi );
-
+DocItem parse_include ( DOMNode *include ) {
+     DocItem item;
+     item.src = (string) get_attr ( include, "src", STR_DATA );
      // overlay/add items
      for ( DOMNode *overlay = include->getFirstChild(); 
            NULL != overlay;
            overlay= overlay->getNextSibling () ) {
            string node_name = to_string ( overlay->getNodeName() );
            if ( node_name == "termoverlay" ) {
-               handle_termoverlay ( includedi, overlay ); 
+               item.overlays.push_back ( parse_termoverlay ( overlay ) ); 
            } 
            // else don't know how to handle element
      }
-
-     for ( DITreeIter itr = includedi->child_begin(); itr != includedi->child_end(); ++itr ) {
-         NodeRef iterm = (*itr)->clone();
-         if (iterm->get_name() != unique_fake_term_name ) {
-             if (dest->has_child( iterm->get_name() ) ) dest->del_child ( iterm->get_name() );
-             dest->add_child(iterm);
-         }
-     }
+     return item;
 }
 
-void handle_terminals ( NodeRef dest, DOMNode *di, bool validate, string orig_path ) {
+void parse_terminals ( ParsedDoc &doc, DOMNode *di ) {
 
 
   string dest_name = to_string ( di->getNodeName() ) ;
   if (dest_name == "deviceinterface") {
       debug ("<deviceinterface>");
       if (has_attr(di,"version") ) {
-         dest->set_attr("version", get_attr(di,"version",STR_DATA));
+         doc.attrs.push_back ( make_pair ( "version", get_attr(di,"version",STR_DATA) ) );
       }
       if (has_attr(di,"name") ) {
-         dest->set_attr("name", get_attr(di,"name",STR_DATA));
+         doc.attrs.push_back ( make_pair ( "name", get_attr(di,"name",STR_DATA) ) );
       }
       for ( DOMNode *term = di->getFirstChild(); NULL != term; term = term->getNextSibling() ) {
          string node_name = to_string ( term->getNodeName() ); 
          if ( node_name == "terminal" ) {
-            handle_terminal(dest, term); 
+            DocItem item;
+            item.term = parse_terminal(term);
+            doc.items.push_back ( item );
          } else if ( node_name == "include" ) {
-            handle_include ( dest, term, validate, orig_path );
+            doc.items.push_back ( parse_include ( term ) );
          } else {
             if ( term->getNodeType() != DOMNode::TEXT_NODE )
                 throw Exception ( XML_INVALID, "Invalid child node deviceinterface: " + node_name ); 
@@ -452,7 +374,9 @@ void handle_terminals ( NodeRef dest, DOMNode *di, bool validate, string orig_pa
       debug("/>");
   } else if (dest_name == "terminal") {
       debug ("<terminal>");
-      handle_terminal(dest, di); 
+      DocItem item;
+      item.term = parse_terminal(di); 
+      doc.items.push_back ( item );
       debug ("</terminal>");
   }
 }
@@ -463,6 +387,21 @@ XmlReader::XmlReader(const std::string& file_path, bool validate) : m_impl(new i
 }
 XmlReader::~XmlReader() throw() { delete m_impl;}
 
+const vector<string>& XmlReader::includes() const {
+    return m_impl->m_includes;
+}
+
+const XmlReader::Stats& XmlReader::stats() const {
+    return m_impl->m_stats;
+}
+
+void XmlReader::set_process_cache ( bool enable ) {
+    set_doc_cache ( enable );
+}
+
+void XmlReader::clear_process_cache () {
+    clear_doc_cache ();
+}
 
 struct XmlUnitializer {
     XercesDOMParser *parser;
@@ -475,7 +414,7 @@ struct XmlUnitializer {
     }
 };
 
-void XmlReader::read(NodeRef node) {
+ParsedDocRef parse_file ( const string& path, bool validate ) {
 
     try {
         XMLPlatformUtils::Initialize();
@@ -489,7 +428,7 @@ void XmlReader::read(NodeRef node) {
     
     XercesDOMParser *parser = new XercesDOMParser();
     xml_uninitializer.parser = parser;
-    if ( m_impl->m_validate ) {
+    if ( validate ) {
         parser->setValidationScheme(XercesDOMParser::Val_Always);
         parser->setDoNamespaces(true);    // optional
         parser->setDoSchema(true);
@@ -528,17 +467,19 @@ void XmlReader::read(NodeRef node) {
     parser->setErrorHandler(handler);
 
 
+    shared_ptr<ParsedDoc> doc ( new ParsedDoc );
+    doc->path = path;
     try {
-       //DOMDocument *doc = parser->parseURI(m_impl->m_path.c_str()); 
-       parser->parse(m_impl->m_path.c_str());
-       DOMDocument *doc = parser->getDocument();
+       //DOMDocument *doc = parser->parseURI(path.c_str()); 
+       parser->parse(path.c_str());
+       DOMDocument *dom = parser->getDocument();
        if ( handler->err_occurred() ) {
          throw Exception ( XML_PARSE, handler->get_message() );
        }
 
-       DOMNode* root = doc->getDocumentElement();
+       DOMNode* root = dom->getDocumentElement();
        root->normalize(); // gets rid of empty text nodes etc.
-       handle_terminals ( node, root, m_impl->m_validate, m_impl->m_path );
+       parse_terminals ( *doc, root );
        
     } catch ( const XMLException& e ) {
         //cout << e.getMessage() << endl;
@@ -551,10 +492,15 @@ void XmlReader::read(NodeRef node) {
         throw Exception ( XML_PARSE, to_string(e.getMessage()) );
     } 
 
+    return doc;
 }
 
 
+void XmlReader::read(NodeRef node) {
+    load_doc_tree ( node, m_impl->m_path, parse_file, "xerces", m_impl->m_validate, m_impl->m_includes, m_impl->m_stats );
+}
 
 
-} // end namespace
 
+
+} // end namespace
@@ -10,6 +10,9 @@
 #include <limits.h>
 #endif
 
+#include <sys/types.h>
+#include <sys/stat.h>
+
 #include <cstring>
 #include <cstdlib>
 
@@ -146,3 +149,27 @@ std::string xgetcwd() {
 	
 
 }
+
+
+std::string xabspath ( const std::string &path ) {
+#ifdef WIN32
+    char path_buffer[_MAX_PATH];
+    if ( _fullpath ( path_buffer, path.c_str(), _MAX_PATH ) == NULL) throw Exception ( PATH_LOOKUP, "Unable to lookup absolute path", path );
+    return std::string(path_buffer);
+#else
+    if (path.size() && path.at(0) == '/') return path;
+    return xjoin ( xgetcwd(), path );
+#endif
+}
+
+bool xmtime ( const std::string &path, time_t &mtime ) {
+#ifdef WIN32
+    struct _stat st;
+    if ( _stat ( path.c_str(), &st ) ) return false;
+#else
+    struct stat st;
+    if ( stat ( path.c_str(), &st ) ) return false;
+#endif
+    mtime = st.st_mtime;
+    return true;
+}
@@ -3,10 +3,13 @@
 #define XDIRNAME_H
 
 #include <string>
+#include <ctime>
 
 std::string xdirname ( const std::string &path );
 std::string xjoin ( const std::string &path, const std::string &file );
 std::string xgetcwd ( );
+std::string xabspath ( const std::string &path );
+bool xmtime ( const std::string &path, time_t &mtime );
 #ifdef WIN32
 std::string get_inst_dir ();
 #endif
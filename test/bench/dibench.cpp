@@ -0,0 +1,176 @@
+/**
+ * Device interface loading benchmark.
+ *
+ * Generates a device interface with a shared include file and
+ * compares the Xerces and streaming xml readers and the binary
+ * cache.  Reports time per load and the peak heap used during a load.
+ *
+ * usage: dibench [terminals] [registers per terminal] [includes] [iterations]
+ **/
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <new>
+#include <malloc.h>
+#include <sys/time.h>
+
+#include <nitro.h>
+
+using namespace Nitro;
+using namespace std;
+
+// heap accounting
+static size_t cur_bytes=0;
+static size_t peak_bytes=0;
+
+void* operator new ( size_t n ) {
+    void* p = malloc ( n ? n : 1 );
+    if (!p) throw bad_alloc();
+    cur_bytes += malloc_usable_size(p);
+    if (cur_bytes > peak_bytes) peak_bytes = cur_bytes;
+    return p;
+}
+void* operator new[] ( size_t n ) { return operator new ( n ); }
+void operator delete ( void* p ) throw() {
+    if (!p) return;
+    cur_bytes -= malloc_usable_size(p);
+    free(p);
+}
+void operator delete[] ( void* p ) throw() { operator delete ( p ); }
+void operator delete ( void* p, size_t ) throw() { operator delete ( p ); }
+void operator delete[] ( void* p, size_t ) throw() { operator delete ( p ); }
+
+static double now() {
+    timeval tv;
+    gettimeofday ( &tv, NULL );
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static void write_terminal ( ostream& out, const string& name, int addr, int regs ) {
+    out << "  <terminal name=\"" << name << "\" addr=\"" << addr << "\" regDataWidth=\"16\" regAddrWidth=\"16\">\n"
+        << "    <comment>Generated terminal " << name << "</comment>\n";
+    for (int r=0;r<regs;++r) {
+        out << "    <register name=\"reg" << r << "\">\n"
+            << "      <type>int</type><mode>write</mode>\n"
+            << "      <comment><![CDATA[register " << r << " & friends]]></comment>\n"
+            << "      <subregister name=\"lo\"><width>8</width><init>" << r % 256 << "</init></subregister>\n"
+            << "      <subregister name=\"hi\"><width>8</width>\n"
+            << "        <valuemap><entry name=\"OFF\" value=\"0\"/><entry name=\"ON\" value=\"1\"/></valuemap>\n"
+            << "      </subregister>\n"
+            << "    </register>\n";
+    }
+    out << "  </terminal>\n";
+}
+
+static void generate ( int terms, int regs, int includes ) {
+    {
+        ofstream inc ( "dibench_common.xml" );
+        inc << "<?xml version=\"1.0\"?>\n<deviceinterface>\n";
+        write_terminal ( inc, "common", 0, regs );
+        inc << "</deviceinterface>\n";
+    }
+    ofstream out ( "dibench.xml" );
+    out << "<?xml version=\"1.0\"?>\n<deviceinterface name=\"dibench\" version=\"1.0\">\n";
+    for (int t=0;t<terms;++t) {
+        char name[32];
+        sprintf ( name, "term%d", t );
+        write_terminal ( out, name, t+1, regs );
+    }
+    // each copy of the included terminal needs a unique name and address
+    for (int i=0;i<includes;++i) {
+        out << "  <include src=\"dibench_common.xml\">\n"
+            << "    <termoverlay name=\"common\" newname=\"common" << i << "\" addr=\"" << 0x1000+i << "\"/>\n"
+            << "  </include>\n";
+    }
+    out << "</deviceinterface>\n";
+}
+
+struct Result {
+    double secs;
+    size_t peak;
+    XmlReader::Stats stats;
+};
+
+template <class R>
+Result bench ( int iterations ) {
+    Result res = Result();
+    double start = now();
+    for (int i=0;i<iterations;++i) {
+        size_t base = cur_bytes;
+        peak_bytes = cur_bytes;
+        {
+            R reader ( "dibench.xml" );
+            NodeRef di = DeviceInterface::create("di");
+            reader.read ( di );
+            res.stats = reader.stats();
+        }
+        if (peak_bytes - base > res.peak) res.peak = peak_bytes - base;
+    }
+    res.secs = (now()-start) / iterations;
+    return res;
+}
+
+Result bench_bin ( int iterations ) {
+    {
+        StreamXmlReader reader ( "dibench.xml" );
+        NodeRef di = DeviceInterface::create("di");
+        reader.read(di);
+        BinWriter writer ( "dibench.dicache" );
+        writer.write(di);
+    }
+    Result res = Result();
+    double start = now();
+    for (int i=0;i<iterations;++i) {
+        size_t base = cur_bytes;
+        peak_bytes = cur_bytes;
+        {
+            BinReader reader ( "dibench.dicache" );
+            NodeRef di = DeviceInterface::create("di");
+            reader.read ( di );
+        }
+        if (peak_bytes - base > res.peak) res.peak = peak_bytes - base;
+    }
+    res.secs = (now()-start) / iterations;
+    return res;
+}
+
+static void report ( const char* name, const Result& r, bool stats ) {
+    cout << setw(10) << left << name << right
+         << setw(10) << fixed << setprecision(2) << r.secs*1000 << " ms"
+         << setw(10) << r.peak/1024 << " KB";
+    if (stats) {
+        cout << "   parse " << setprecision(2) << r.stats.parse_time*1000 << " ms"
+             << " build " << r.stats.build_time*1000 << " ms"
+             << " files " << r.stats.files_parsed
+             << " cached " << r.stats.cache_hits;
+    }
+    cout << endl;
+}
+
+int main ( int argc, char* argv[] ) {
+    int terms = argc > 1 ? atoi(argv[1]) : 50;
+    int regs = argc > 2 ? atoi(argv[2]) : 20;
+    int includes = argc > 3 ? atoi(argv[3]) : 10;
+    int iterations = argc > 4 ? atoi(argv[4]) : 10;
+
+    generate ( terms, regs, includes );
+    cout << terms << " terminals, " << regs << " registers each, "
+         << includes << " includes, " << iterations << " iterations" << endl;
+
+    try {
+        report ( "xerces", bench<XmlReader> ( iterations ), true );
+        report ( "stream", bench<StreamXmlReader> ( iterations ), true );
+        report ( "binary", bench_bin ( iterations ), false );
+    } catch ( const Exception& e ) {
+        cerr << e << endl;
+        return 1;
+    }
+
+    remove ( "dibench.xml" );
+    remove ( "dibench_common.xml" );
+    remove ( "dibench.dicache" );
+    return 0;
+}
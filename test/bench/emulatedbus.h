@@ -0,0 +1,117 @@
+#ifndef EMULATEDBUS_H
+#define EMULATEDBUS_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include <nitro.h>
+
+#include "../../src/pipethrottle.h"
+
+#define EMULATED_QUEUE_DEPTH 32
+#define EMULATED_PIPE_TERM 2
+
+/**
+ * Emulates a device whose register and pipe transfers share one bus
+ * that serves requests in order, like the urbs of a usb device.
+ * Requests take 20us plus 1us per 64 bytes, one at a time.
+ *
+ * Pipe reads and writes of EMULATED_PIPE_TERM are split into chunk
+ * sized requests and queued the way the libusb pipe transfers queue
+ * urbs: filled to the PipeThrottle depth and topped back up as they
+ * complete.
+ **/
+class EmulatedBus : public Nitro::Device {
+    public:
+        Nitro::PipeThrottle throttle;
+
+        EmulatedBus ( size_t chunk=64*1024 ) :
+            throttle(EMULATED_QUEUE_DEPTH, 2, 10), m_chunk(chunk), m_stop(false) {
+            throttle.set ( 0, 10 );
+            Nitro::NodeRef pipe = Nitro::Terminal::create ( "pipe" );
+            pipe->set_attr ( "addr", EMULATED_PIPE_TERM );
+            pipe->set_attr ( "type", "pipe" );
+            pipe->set_attr ( "regDataWidth", 8 );
+            Nitro::NodeRef di = Nitro::DeviceInterface::create ( "di" );
+            di->add_child ( pipe );
+            set_di ( di );
+            m_bus = std::thread ( [this]() { serve(); } );
+        }
+        ~EmulatedBus() throw() {
+            {
+                std::lock_guard<std::mutex> lock(m);
+                m_stop = true;
+            }
+            cv.notify_all();
+            m_bus.join();
+        }
+
+    protected:
+        void _read ( uint32 term_addr, uint32 reg_addr, uint8* data, size_t length, uint32 timeout ) {
+            transfer ( term_addr, length );
+            memset ( data, 0, length );
+        }
+        void _write ( uint32 term_addr, uint32 reg_addr, const uint8* data, size_t length, uint32 timeout ) {
+            transfer ( term_addr, length );
+        }
+        void _close () throw() {}
+
+    private:
+        struct Request {
+            size_t length;
+            bool done;
+        };
+        size_t m_chunk;
+        std::mutex m;
+        std::condition_variable cv;
+        std::deque<Request*> m_fifo;
+        bool m_stop;
+        std::thread m_bus;
+
+        void serve() {
+            std::unique_lock<std::mutex> lock(m);
+            for (;;) {
+                cv.wait ( lock, [this]() { return m_stop || !m_fifo.empty(); } );
+                if (m_stop) return;
+                size_t length = m_fifo.front()->length;
+                lock.unlock();
+                std::this_thread::sleep_for ( std::chrono::microseconds ( 20 + length/64 ) );
+                lock.lock();
+                m_fifo.front()->done = true;
+                m_fifo.pop_front();
+                cv.notify_all();
+            }
+        }
+
+        void transfer ( uint32 term_addr, size_t length ) {
+            std::unique_lock<std::mutex> lock(m);
+            if (term_addr != EMULATED_PIPE_TERM) {
+                Request r = { length, false };
+                m_fifo.push_back ( &r );
+                cv.notify_all();
+                cv.wait ( lock, [&]() { return r.done; } );
+                return;
+            }
+            std::deque<Request> queued;
+            size_t submitted = 0;
+            while (submitted < length || !queued.empty()) {
+                unsigned depth = throttle.depth ( register_io_pending() != 0 );
+                while (submitted < length && queued.size() < depth) {
+                    size_t n = length-submitted > m_chunk ? m_chunk : length-submitted;
+                    Request r = { n, false };
+                    queued.push_back ( r );
+                    m_fifo.push_back ( &queued.back() );
+                    submitted += n;
+                }
+                cv.notify_all();
+                cv.wait ( lock, [&]() { return queued.front().done; } );
+                queued.pop_front();
+            }
+        }
+};
+
+#endif
@@ -0,0 +1,87 @@
+/**
+ * Register latency under pipe streaming benchmark.
+ *
+ * One thread streams a pipe terminal of an EmulatedBus (see
+ * emulatedbus.h), keeping 64k chunks queued with the same
+ * PipeThrottle the libusb pipe transfers use, while a control loop
+ * gets a register.  Reports the register latency percentiles from
+ * Device::io_stats and the pipe throughput with the pipe throttle off
+ * and on.  Fails if the throttle doesn't lower the median latency.
+ *
+ * usage: iobench [register gets] [period us] [throttle depth]
+ **/
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <nitro.h>
+
+#include "emulatedbus.h"
+
+using namespace Nitro;
+using namespace std;
+
+static double now() {
+    return chrono::duration<double> ( chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+// returns the median register latency
+static double run ( EmulatedBus& dev, uint32 throttle, int gets, int period ) {
+    dev.throttle.set ( throttle, 10 );
+    atomic<bool> stop(false);
+    size_t bytes = 0;
+    vector<uint8> buf ( 8*1024*1024 );
+    thread stream ( [&]() {
+        while (!stop) {
+            dev.read ( EMULATED_PIPE_TERM, 0, buf.data(), buf.size() );
+            bytes += buf.size();
+        }
+    });
+    this_thread::sleep_for ( chrono::milliseconds(50) );
+    dev.reset_io_stats();
+    double start = now();
+    for (int i=0;i<gets;++i) {
+        dev.get ( 1, 0 );
+        this_thread::sleep_for ( chrono::microseconds(period) );
+    }
+    double secs = now()-start;
+    stop = true;
+    stream.join();
+
+    Device::IoStats st = dev.io_stats ( Device::IO_REGISTER );
+    cout << "throttle " << setw(2) << (throttle ? throttle : EMULATED_QUEUE_DEPTH)
+         << fixed << setprecision(2)
+         << "   register p50 " << setw(6) << st.percentile(.5)*1e3 << " ms"
+         << "  p99 " << setw(6) << st.percentile(.99)*1e3 << " ms"
+         << "  max " << setw(6) << st.max*1e3 << " ms"
+         << setprecision(1)
+         << "   pipe " << setw(6) << bytes/secs/1e6 << " MB/s" << endl;
+    return st.percentile(.5);
+}
+
+int main ( int argc, char* argv[] ) {
+    int gets = argc > 1 ? atoi(argv[1]) : 500;
+    int period = argc > 2 ? atoi(argv[2]) : 1000;
+    uint32 throttle = argc > 3 ? atoi(argv[3]) : 2;
+    cout << gets << " register gets every " << period << " us while streaming" << endl;
+
+    try {
+        EmulatedBus dev;
+        double off = run ( dev, 0, gets, period );
+        double on = run ( dev, throttle, gets, period );
+        cout << "throttled register p50 " << setprecision(1) << off/on << "x lower" << endl;
+        if (on >= off) {
+            cerr << "The pipe throttle didn't lower the register latency." << endl;
+            return 1;
+        }
+    } catch ( const Exception& e ) {
+        cerr << e << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,154 @@
+/**
+ * Device interface structure benchmark.
+ *
+ * Builds a device interface with many auto addressed terminals and
+ * registers, then times cloning it for several devices, address
+ * lookups through a device and child removal.  The tree is also built
+ * in a NodeArena to compare memory use and the time to walk all nodes.
+ * Heap use is reported for the builds and the clones.
+ *
+ * usage: nodebench [terminals] [registers per terminal] [lookups] [clones]
+ **/
+
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <new>
+#include <malloc.h>
+#include <sys/time.h>
+
+#include <nitro.h>
+
+#include "../tests/memorydevice.h"
+
+using namespace Nitro;
+using namespace std;
+
+// heap accounting
+static size_t cur_bytes=0;
+
+void* operator new ( size_t n ) {
+    void* p = malloc ( n ? n : 1 );
+    if (!p) throw bad_alloc();
+    cur_bytes += malloc_usable_size(p);
+    return p;
+}
+void* operator new[] ( size_t n ) { return operator new ( n ); }
+void operator delete ( void* p ) throw() {
+    if (!p) return;
+    cur_bytes -= malloc_usable_size(p);
+    free(p);
+}
+void operator delete[] ( void* p ) throw() { operator delete ( p ); }
+void operator delete ( void* p, size_t ) throw() { operator delete ( p ); }
+void operator delete[] ( void* p, size_t ) throw() { operator delete ( p ); }
+
+static double now() {
+    timeval tv;
+    gettimeofday ( &tv, NULL );
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static volatile uint32 sink;
+
+static void report ( const char* name, double secs, int ops, size_t bytes=0 ) {
+    cout << setw(12) << left << name << right
+         << setw(12) << fixed << setprecision(2) << secs*1000 << " ms"
+         << setw(12) << setprecision(1) << secs*1e9/ops << " ns/op";
+    if (bytes) cout << setw(10) << bytes/1024 << " KB";
+    cout << endl;
+}
+
+static string name ( const char* prefix, int i ) {
+    ostringstream out;
+    out << prefix << i;
+    return out.str();
+}
+
+static void build ( NodeRef di, int terms, int regs ) {
+    for (int t=0;t<terms;++t) {
+        NodeRef term = Terminal::create ( name ( "term", t ) );
+        for (int r=0;r<regs;++r) term->add_child ( Register::create ( name ( "reg", r ) ) );
+        di->add_child ( term );
+    }
+}
+
+static uint32 walk ( const NodeRef& node ) {
+    uint32 sum = node->num_attrs();
+    for (DITreeIter itr = node->child_begin(); itr != node->child_end(); ++itr ) {
+        sum += (*itr)->get_attr_uint ( Attr::addr ) + walk ( *itr );
+    }
+    return sum;
+}
+
+int main ( int argc, char* argv[] ) {
+    int terms = argc > 1 ? atoi(argv[1]) : 2000;
+    int regs = argc > 2 ? atoi(argv[2]) : 20;
+    int lookups = argc > 3 ? atoi(argv[3]) : 200000;
+    int clones = argc > 4 ? atoi(argv[4]) : 16;
+    cout << terms << " terminals, " << regs << " registers each" << endl;
+
+    try {
+        MemoryDevice dev;
+        NodeRef di = dev.get_di();
+
+        size_t base = cur_bytes;
+        double start = now();
+        build ( di, terms, regs );
+        report ( "build", now()-start, terms*regs, cur_bytes-base );
+
+        {
+            NodeRef adi = DeviceInterface::create ( "di" );
+            base = cur_bytes;
+            start = now();
+            {
+                NodeArena arena;
+                NodeArena::Scope scope ( arena );
+                build ( adi, terms, regs );
+            }
+            report ( "arena build", now()-start, terms*regs, cur_bytes-base );
+
+            const int walks = 20;
+            start = now();
+            for (int i=0;i<walks;++i) sink += walk ( di );
+            report ( "walk", now()-start, walks*terms*regs );
+            start = now();
+            for (int i=0;i<walks;++i) sink += walk ( adi );
+            report ( "arena walk", now()-start, walks*terms*regs );
+        }
+
+        {
+            // one copy per board with a small overlay on each
+            vector<NodeRef> boards;
+            base = cur_bytes;
+            start = now();
+            for (int i=0;i<clones;++i) {
+                NodeRef board = di->clone();
+                board->get_child ( "term0" )->get_child ( "reg0" )->set_attr ( "init", i );
+                boards.push_back ( board );
+            }
+            report ( "clone", now()-start, clones, cur_bytes-base );
+        }
+
+        start = now();
+        for (int i=0;i<lookups;++i) {
+            sink += (uint32)dev.get ( 0x200 + i % terms, i % regs );
+        }
+        report ( "get by addr", now()-start, lookups );
+
+        start = now();
+        for (int i=0;i<lookups;++i) {
+            sink += dev.get_register ( 0x200 + i % terms, i % regs )->get_attr_uint ( Attr::addr );
+        }
+        report ( "resolve", now()-start, lookups );
+
+        start = now();
+        for (int t=0;t<terms;t+=2) di->del_child ( name ( "term", t ) );
+        report ( "del_child", now()-start, terms/2 );
+    } catch ( const Exception& e ) {
+        cerr << e << endl;
+        return 1;
+    }
+    return 0;
+}
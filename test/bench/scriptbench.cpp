@@ -0,0 +1,107 @@
+/**
+ * Script throughput benchmark.
+ *
+ * Runs the same script for several boards.  Each board is a memory
+ * device that sleeps on every transfer like a bus round trip.  The
+ * shared interpreter runs the scripts one after another.  Worker pools
+ * of several sizes run them from one thread per board.
+ *
+ * usage: scriptbench [boards] [registers] [work per register] [transfer us]
+ **/
+
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <sys/time.h>
+
+#include <nitro.h>
+
+#include "../tests/memorydevice.h"
+
+using namespace Nitro;
+using namespace std;
+
+static double now() {
+    timeval tv;
+    gettimeofday ( &tv, NULL );
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+class SlowDevice : public MemoryDevice {
+    private:
+        int m_us;
+    protected:
+        void _read ( uint32 term_addr, uint32 reg_addr, uint8* data, size_t length, uint32 timeout ) {
+            this_thread::sleep_for ( chrono::microseconds ( m_us ) );
+            MemoryDevice::_read ( term_addr, reg_addr, data, length, timeout );
+        }
+    public:
+        SlowDevice ( int us ) : m_us(us) {}
+};
+
+static NodeRef board_args ( Device& dev, int regs, int work ) {
+    NodeRef args = Node::create("args");
+    args->set_attr ( "dev", dev );
+    args->set_attr ( "regs", regs );
+    args->set_attr ( "work", work );
+    return args;
+}
+
+static void report ( const char* name, uint32 workers, double secs, int boards ) {
+    cout << setw(10) << left << name << right << setw(4) << workers
+         << setw(12) << fixed << setprecision(2) << secs*1000 << " ms"
+         << setw(12) << setprecision(1) << boards/secs << " scripts/s" << endl;
+}
+
+int main ( int argc, char* argv[] ) {
+
+    int boards = argc > 1 ? atoi(argv[1]) : 16;
+    int regs = argc > 2 ? atoi(argv[2]) : 200;
+    int work = argc > 3 ? atoi(argv[3]) : 20;
+    int us = argc > 4 ? atoi(argv[4]) : 200;
+
+    cout << boards << " boards, " << regs << " registers, " << work
+         << " work per register, " << us << " us per transfer" << endl;
+
+    try {
+        vector<SlowDevice*> devs;
+        for (int i=0;i<boards;++i) devs.push_back ( new SlowDevice ( us ) );
+
+        {
+            Scripts sc;
+            sc.import ( "bench", "bench/scriptbench.py" );
+            double start = now();
+            for (int i=0;i<boards;++i) sc.exec ( "bench", "board_test", board_args ( *devs[i], regs, work ) );
+            report ( "shared", 0, now()-start, boards );
+        }
+
+        uint32 sizes[] = { 2, 4, 8, 16 };
+        for (size_t s=0;s<sizeof(sizes)/sizeof(sizes[0]);++s) {
+            if ((int)sizes[s] > boards) break;
+            Scripts sc ( sizes[s] );
+            sc.import ( "bench", "bench/scriptbench.py" );
+            double start = now();
+            vector<thread> threads;
+            for (int i=0;i<boards;++i) {
+                threads.push_back ( thread ( [&sc,&devs,i,regs,work]() {
+                    try {
+                        sc.exec ( "bench", "board_test", board_args ( *devs[i], regs, work ) );
+                    } catch ( const Exception& e ) {
+                        cout << e << endl;
+                    }
+                } ) );
+            }
+            for (size_t i=0;i<threads.size();++i) threads[i].join();
+            report ( "workers", sizes[s], now()-start, boards );
+        }
+
+        for (int i=0;i<boards;++i) delete devs[i];
+    } catch ( const Exception& e ) {
+        cout << e << endl;
+        return 1;
+    }
+    return 0;
+}
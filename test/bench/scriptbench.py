@@ -0,0 +1,17 @@
+"""
+Script run by scriptbench for each board.
+"""
+
+def board_test(dev, regs, work):
+    """
+        Reads registers and does some arithmetic on each value.
+        @param dev device
+        @param regs int
+        @param work int
+    """
+    total = 0
+    for i in range(regs):
+        v = dev.get(0, i % 16)
+        for j in range(work):
+            total += (v * j) % 7
+    return total
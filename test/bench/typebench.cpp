@@ -0,0 +1,160 @@
+/**
+ * DataType benchmark.
+ *
+ * Measures the cost of constructing, copying and formatting DataType
+ * values, copying a list value and reading a node attribute, and the
+ * get/set throughput of a memory backed device using numeric terminal
+ * and register addresses.  Wide register rows cover the register init
+ * computation and packing a 64 bit register with subregisters.
+ *
+ * usage: typebench [iterations]
+ **/
+
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <sys/time.h>
+
+#include <nitro.h>
+
+#include "../tests/memorydevice.h"
+
+using namespace Nitro;
+using namespace std;
+
+static double now() {
+    timeval tv;
+    gettimeofday ( &tv, NULL );
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+// keeps the compiler from discarding the loops
+static volatile uint32 sink;
+
+static void report ( const char* name, double secs, int iterations ) {
+    cout << setw(14) << left << name << right
+         << setw(10) << fixed << setprecision(1) << secs*1e9/iterations << " ns/op"
+         << setw(14) << setprecision(0) << iterations/secs << " ops/s" << endl;
+}
+
+// 64 bit register made of four 16 bit subregisters
+static NodeRef wide_reg ( const char* name ) {
+    NodeRef reg = Register::create ( name );
+    const char* subs[] = { "a", "b", "c", "d" };
+    for (int i=0;i<4;++i) {
+        NodeRef sub = Subregister::create ( subs[i] );
+        sub->set_attr ( "width", 16 );
+        sub->set_attr ( "init", 0x1234+i );
+        reg->add_child ( sub );
+    }
+    return reg;
+}
+
+int main ( int argc, char* argv[] ) {
+    int iterations = argc > 1 ? atoi(argv[1]) : 1000000;
+    cout << iterations << " iterations" << endl;
+
+    double start = now();
+    for (int i=0;i<iterations;++i) {
+        DataType d ( (uint32)i );
+        sink += (uint32)d;
+    }
+    report ( "construct", now()-start, iterations );
+
+    start = now();
+    for (int i=0;i<iterations;++i) {
+        DataType d ( 1.5*i );
+        sink += (uint32)d;
+    }
+    report ( "float", now()-start, iterations );
+
+    DataType src ( (uint32)12345 );
+    start = now();
+    for (int i=0;i<iterations;++i) {
+        DataType d ( src );
+        sink += (uint32)d;
+    }
+    report ( "copy", now()-start, iterations );
+
+    vector<DataType> values ( 64, DataType ( (uint32)1 ) );
+    DataType list ( values );
+    start = now();
+    for (int i=0;i<iterations;++i) {
+        DataType d ( list );
+        sink += DataType::as_list ( d ).size();
+    }
+    report ( "list copy", now()-start, iterations );
+
+    start = now();
+    for (int i=0;i<iterations;++i) {
+        DataType d ( i );
+        sink += d.str_value().size();
+    }
+    report ( "str_value", now()-start, iterations );
+
+    NodeRef reg = Register::create ( "reg" );
+    reg->set_attr ( "addr", 7 );
+    reg->set_attr ( "width", 16 );
+    reg->set_attr ( "mode", "write" );
+    start = now();
+    for (int i=0;i<iterations;++i) {
+        sink += (uint32)reg->get_attr ( "addr" );
+    }
+    report ( "get_attr", now()-start, iterations );
+
+    start = now();
+    for (int i=0;i<iterations;++i) {
+        sink += reg->get_attr_uint ( Attr::addr );
+    }
+    report ( "get_attr_uint", now()-start, iterations );
+
+    try {
+        MemoryDevice dev;
+        start = now();
+        for (int i=0;i<iterations;++i) {
+            dev.set ( 0, i & 0xff, i & 0xffff );
+        }
+        report ( "set", now()-start, iterations );
+
+        start = now();
+        for (int i=0;i<iterations;++i) {
+            sink += (uint32)dev.get ( 0, i & 0xff );
+        }
+        report ( "get", now()-start, iterations );
+
+        int wide = iterations / 10;
+        NodeRef term = Terminal::create ( "term" );
+        start = now();
+        for (int i=0;i<wide;++i) {
+            NodeRef t = Terminal::create ( "t" );
+            t->add_child ( wide_reg ( "wide" ) );
+            sink += t->num_children();
+        }
+        report ( "reg init", now()-start, wide );
+
+        term->add_child ( wide_reg ( "wide" ) );
+        dev.get_di()->add_child ( term );
+        start = now();
+        for (int i=0;i<wide;++i) {
+            dev.set ( "term", "wide", BigInt ( (uint32)i ) << 31 );
+        }
+        report ( "wide set", now()-start, wide );
+
+        start = now();
+        for (int i=0;i<wide;++i) {
+            sink += DataType::as_bigint ( dev.get ( "term", "wide" ) ).word(1);
+        }
+        report ( "wide get", now()-start, wide );
+
+        start = now();
+        for (int i=0;i<wide;++i) {
+            dev.set ( "term", "wide.c", i & 0xffff );
+        }
+        report ( "subreg set", now()-start, wide );
+    } catch ( const Exception& e ) {
+        cerr << e << endl;
+        return 1;
+    }
+
+    return 0;
+}
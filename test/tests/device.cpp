@@ -2,13 +2,82 @@
 
 #include <cppunit/extensions/HelperMacros.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include <nitro.h>
 
 #include "memorydevice.h"
+#include "../../src/pipethrottle.h"
 
 using namespace Nitro;
 using namespace std;
 
+// reads block until cancelled, like a pipe with no data
+class BlockingDevice : public Device {
+    public:
+        mutex m;
+        condition_variable cv;
+        int reading;
+        int cancels;
+        uint32 cancelled_term;
+        BlockingDevice() : reading(0), cancels(0), cancelled_term(0) {}
+        ~BlockingDevice() throw() {}
+    protected:
+        void _read ( uint32 term_addr, uint32 reg_addr, uint8* data, size_t length, uint32 timeout ) {
+            unique_lock<mutex> lock(m);
+            int seen = cancels;
+            ++reading;
+            cv.notify_all();
+            cv.wait ( lock, [&]() { return cancels != seen; } );
+            --reading;
+            throw Exception ( DEVICE_CANCELLED, "read cancelled", term_addr );
+        }
+        void _write ( uint32 term_addr, uint32 reg_addr, const uint8* data, size_t length, uint32 timeout ) {}
+        void _close () {}
+        void _cancel ( uint32 term_addr ) {
+            lock_guard<mutex> lock(m);
+            ++cancels;
+            cancelled_term = term_addr;
+            cv.notify_all();
+        }
+};
+
+// counts reads to check watch polls are coalesced
+class CountingDevice : public MemoryDevice {
+    public:
+        mutex m;
+        vector<size_t> reads; // lengths
+        ~CountingDevice() throw() { unwatch_all(); }
+    protected:
+        void _read ( uint32 term_addr, uint32 reg_addr, uint8* data, size_t length, uint32 timeout ) {
+            {
+                lock_guard<mutex> lock(m);
+                reads.push_back ( length );
+            }
+            MemoryDevice::_read ( term_addr, reg_addr, data, length, timeout );
+        }
+};
+
+// records register_io_pending as the transfers see it
+class PendingDevice : public MemoryDevice {
+    public:
+        vector<uint32> pending;
+        using Device::register_io_pending;
+    protected:
+        void _read ( uint32 term_addr, uint32 reg_addr, uint8* data, size_t length, uint32 timeout ) {
+            pending.push_back ( register_io_pending() );
+            MemoryDevice::_read ( term_addr, reg_addr, data, length, timeout );
+        }
+};
+
 class DeviceTest : public CppUnit::TestFixture {
     
     CPPUNIT_TEST_SUITE ( DeviceTest );
@@ -23,6 +92,11 @@ class DeviceTest : public CppUnit::TestFixture {
     CPPUNIT_TEST ( testVerify );
     CPPUNIT_TEST ( testBuffers );
     CPPUNIT_TEST ( testPipe );
+    CPPUNIT_TEST ( testSwapDi );
+    CPPUNIT_TEST ( testCancel );
+    CPPUNIT_TEST ( testWatch );
+    CPPUNIT_TEST ( testIoStats );
+    CPPUNIT_TEST ( testPipeThrottle );
     CPPUNIT_TEST_SUITE_END();
 
     MemoryDevice dev;
@@ -346,6 +420,218 @@ class DeviceTest : public CppUnit::TestFixture {
         dev.read( "pipe_term", 0, buffer, 1024*1024 );
 		delete [] buffer;
     }
+
+    void testSwapDi() {
+        NodeRef orig = dev.get_di();
+
+        // lookups don't wait for the device lock
+        dev.lock();
+        NodeRef found;
+        thread lookup ( [&]() { found = dev.get_register ( "Terminal1", "reg1" ); } );
+        lookup.join();
+        dev.unlock();
+        CPPUNIT_ASSERT ( found == orig->get_child("Terminal1")->get_child("reg1") );
+
+        // gets keep working while the tree is replaced
+        atomic<bool> done(false);
+        atomic<int> errors(0);
+        thread getter ( [&]() {
+            while (!done) {
+                try {
+                    dev.get ( "Terminal1", "reg2.sub2" );
+                    dev.get_terminal ( "pipe_term" );
+                } catch ( const Exception& ) {
+                    ++errors;
+                }
+            }
+        });
+        for (int i=0;i<200;++i) dev.set_di ( orig->clone() );
+        done=true;
+        getter.join();
+        CPPUNIT_ASSERT_EQUAL ( 0, (int)errors );
+        CPPUNIT_ASSERT ( dev.get_di() != orig );
+
+        // a tree without the terminal is seen by the next call
+        dev.set_di ( DeviceInterface::create("di") );
+        CPPUNIT_ASSERT_THROW ( dev.get_terminal ( "Terminal1" ), Exception );
+        dev.set_di ( orig );
+        CPPUNIT_ASSERT ( dev.get_di() == orig );
+    }
+
+    void testCancel() {
+        // devices without _cancel ignore it
+        CPPUNIT_ASSERT_NO_THROW ( dev.cancel ( "pipe_term" ) );
+        CPPUNIT_ASSERT_THROW ( dev.cancel ( "no_such_term" ), Exception );
+
+        // a blocked read holds the device mutex, cancel doesn't need it
+        BlockingDevice bdev;
+        int code = 0;
+        uint8 buf[4];
+        thread reader ( [&]() {
+            try {
+                bdev.read ( 5, 0, buf, sizeof(buf) );
+            } catch ( const Exception& e ) {
+                code = e.code();
+            }
+        });
+        {
+            unique_lock<mutex> lock(bdev.m);
+            bdev.cv.wait ( lock, [&]() { return bdev.reading > 0; } );
+        }
+        bdev.cancel ( 5 );
+        reader.join();
+        CPPUNIT_ASSERT_EQUAL ( (int)DEVICE_CANCELLED, code );
+        CPPUNIT_ASSERT_EQUAL ( (uint32)5, bdev.cancelled_term );
+    }
+
+    void testWatch() {
+        CountingDevice cdev;
+        XmlReader reader ("dev.xml");
+        reader.read(cdev.get_di());
+        for (int i=0;i<4;++i) cdev.set ( "int_term", i, i+1 );
+
+        CPPUNIT_ASSERT_THROW ( cdev.watch ( "int_term", "no_such_reg", [](const DataType&) { return true; }, 10 ), Exception );
+
+        // int covers addresses 0 and 1, lw repeats 0
+        mutex m;
+        map<string,vector<uint32> > seen;
+        auto record = [&](const string& name) {
+            return [&,name](const DataType& v) {
+                lock_guard<mutex> lock(m);
+                seen[name].push_back ( (uint32)v );
+                return true;
+            };
+        };
+        uint32 ids[] = {
+            cdev.watch ( "int_term", "int", record("int"), 5 ),
+            cdev.watch ( "int_term", "int.lw", record("lw"), 5 ),
+            cdev.watch ( "int_term", 2, record("2"), 5 ),
+            cdev.watch ( "int_term", 3, record("3"), 5 )
+        };
+        // waits share the polls
+        CPPUNIT_ASSERT_EQUAL ( 3, (int32)cdev.wait_until ( "int_term", 2, [](const DataType& v) { return v==3; }, 1000, 5 ) );
+        cdev.set ( "int_term", 2, 30 );
+        CPPUNIT_ASSERT_EQUAL ( 30, (int32)cdev.wait_until ( "int_term", 2, [](const DataType& v) { return (uint32)v > 10; }, 1000, 5 ) );
+        CPPUNIT_ASSERT_EQUAL ( 30, (int32)cdev.wait_until ( "int_term", 2, [&](const DataType&) { lock_guard<mutex> lock(m); return seen["2"].size() == 2; }, 1000, 5 ) );
+
+        for (int i=0;i<4;++i) cdev.unwatch ( ids[i] );
+        size_t polls;
+        {
+            lock_guard<mutex> lock(cdev.m);
+            polls = cdev.reads.size();
+            // the watched words are read together
+            CPPUNIT_ASSERT ( count ( cdev.reads.begin(), cdev.reads.end(), (size_t)8 ) > 0 );
+        }
+
+        // callbacks only on change, none after unwatch
+        lock_guard<mutex> lock(m);
+        CPPUNIT_ASSERT ( seen["int"] == vector<uint32>( 1, 0x20001 ) );
+        CPPUNIT_ASSERT ( seen["lw"] == vector<uint32>( 1, 1 ) );
+        CPPUNIT_ASSERT_EQUAL ( (size_t)2, seen["2"].size() );
+        CPPUNIT_ASSERT_EQUAL ( (uint32)30, seen["2"][1] );
+        CPPUNIT_ASSERT ( seen["3"] == vector<uint32>( 1, 4 ) );
+        this_thread::sleep_for ( chrono::milliseconds(20) );
+        CPPUNIT_ASSERT_EQUAL ( polls, cdev.reads.size() );
+
+        try {
+            cdev.wait_until ( "int_term", 3, [](const DataType& v) { return v==0; }, 20 );
+            CPPUNIT_FAIL ( "Expected timeout" );
+        } catch ( const Exception& e ) {
+            CPPUNIT_ASSERT_EQUAL ( (int)DEVICE_TIMEOUT, e.code() );
+        }
+
+        // a wait from a callback would block the only thread that polls
+        atomic<int> code(0);
+        uint32 id = cdev.watch ( "int_term", 3, [&](const DataType&) {
+            try {
+                cdev.wait_until ( "int_term", 2, [](const DataType&) { return true; }, 0 );
+            } catch ( const Exception& e ) {
+                code = e.code();
+            }
+            return false;
+        }, 5 );
+        for (int i=0;i<200 && !code;++i) this_thread::sleep_for ( chrono::milliseconds(5) );
+        cdev.unwatch ( id );
+        CPPUNIT_ASSERT_EQUAL ( (int)DEVICE_OP_ERROR, (int)code );
+
+        // a callback may destroy its own device
+        CountingDevice* owned = new CountingDevice;
+        reader.read(owned->get_di());
+        atomic<int> destroyed(0);
+        owned->watch ( "int_term", 2, [](const DataType&) { return true; }, 1, false );
+        owned->watch ( "int_term", 3, [&](const DataType&) {
+            delete owned;
+            destroyed = 1;
+            return true;
+        }, 1, false );
+        for (int i=0;i<200 && !destroyed;++i) this_thread::sleep_for ( chrono::milliseconds(5) );
+        CPPUNIT_ASSERT ( destroyed );
+        this_thread::sleep_for ( chrono::milliseconds(20) ); // the thread exits on its own
+    }
+
+    void testIoStats() {
+        PendingDevice pdev;
+        XmlReader reader ("dev.xml");
+        reader.read(pdev.get_di());
+        pdev.set_di ( pdev.get_di() ); // picks up the pipe terminal
+
+        pdev.set ( "int_term", 0, 5 );
+        pdev.get ( "int_term", 0 );
+        uint8 buf[64];
+        pdev.read ( "int_term", 0, buf, sizeof(buf) );
+        pdev.read ( "pipe_term", 0, buf, sizeof(buf) );
+
+        // pending while the register calls run, not pipe reads
+        CPPUNIT_ASSERT ( pdev.pending == vector<uint32>( { 1, 1, 0 } ) );
+        CPPUNIT_ASSERT_EQUAL ( (uint32)0, pdev.register_io_pending() );
+
+        Device::IoStats reg = pdev.io_stats ( Device::IO_REGISTER );
+        Device::IoStats pipe = pdev.io_stats ( Device::IO_PIPE );
+        CPPUNIT_ASSERT_EQUAL ( (uint64)3, reg.count );
+        CPPUNIT_ASSERT_EQUAL ( (uint64)1, pipe.count );
+        uint64 n=0;
+        for (int i=0;i<Device::IoStats::BUCKETS;++i) n += reg.buckets[i];
+        CPPUNIT_ASSERT_EQUAL ( reg.count, n );
+        CPPUNIT_ASSERT ( reg.max > 0 && reg.max >= reg.mean() );
+        CPPUNIT_ASSERT ( reg.percentile(.5) <= reg.percentile(.99) );
+        CPPUNIT_ASSERT ( reg.percentile(1) <= reg.max );
+        CPPUNIT_ASSERT_THROW ( pdev.io_stats ( Device::IO_CLASSES ), Exception );
+
+        // errors are timed too
+        CPPUNIT_ASSERT_THROW ( pdev.get ( "int_term", "no_such_reg" ), Exception );
+        CPPUNIT_ASSERT_EQUAL ( (uint64)4, pdev.io_stats ( Device::IO_REGISTER ).count );
+
+        pdev.reset_io_stats();
+        CPPUNIT_ASSERT_EQUAL ( (uint64)0, pdev.io_stats ( Device::IO_REGISTER ).count );
+        CPPUNIT_ASSERT_EQUAL ( 0.0, pdev.io_stats ( Device::IO_PIPE ).percentile(.5) );
+
+        // percentiles from the buckets: 3 calls under 2us, 1 at 3ms
+        Device::IoStats st;
+        memset ( &st, 0, sizeof(st) );
+        st.count = 4;
+        st.buckets[1] = 3;
+        st.buckets[12] = 1;
+        st.max = .003;
+        st.total = .003;
+        CPPUNIT_ASSERT_DOUBLES_EQUAL ( 2e-6, st.percentile(.5), 1e-12 );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL ( 2e-6, st.percentile(.75), 1e-12 );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL ( .003, st.percentile(.99), 1e-12 );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL ( .00075, st.mean(), 1e-12 );
+    }
+
+    void testPipeThrottle() {
+        // a long hold so the held check doesn't depend on timing, the
+        // latency the throttle saves is measured by bench/iobench
+        PipeThrottle t ( 32, 2, 60000 );
+        CPPUNIT_ASSERT_EQUAL ( 2u, t.depth ( true ) );
+        CPPUNIT_ASSERT_EQUAL ( 2u, t.depth ( false ) ); // held
+        t.set ( 2, 0 );
+        CPPUNIT_ASSERT_EQUAL ( 32u, t.depth ( false ) );
+        t.set ( 0, 50 ); // off
+        CPPUNIT_ASSERT_EQUAL ( 32u, t.depth ( true ) );
+        t.set ( 40, 50 );
+        CPPUNIT_ASSERT_EQUAL ( 32u, t.depth ( true ) );
+    }
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION ( DeviceTest );
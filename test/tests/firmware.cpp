@@ -0,0 +1,238 @@
+
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <nitro.h>
+
+#include "../../src/ihx.h"
+#include "../../src/fwload.h"
+
+using namespace Nitro;
+using namespace std;
+
+/**
+ * Emulated fx2/fx3 ram behind the firmware transport.  Records every
+ * control transfer and whether the fx2 cpu was held in reset when it
+ * arrived.
+ **/
+class EmulatedTransport : public FirmwareTransport {
+    public:
+        map<uint32,uint8> ram;
+        vector<RamWrite> log; // data pointers are not kept
+        uint32 batches;
+        bool cpu_reset;
+        bool wrote_running; // a non CPUCS write while the cpu ran
+        int fail_after; // writes before a failure, -1 never
+
+        EmulatedTransport() : batches(0), cpu_reset(false), wrote_running(false), fail_after(-1) {}
+
+        void write_ram_blocks ( const vector<RamWrite>& writes, uint32 timeout ) {
+            ++batches;
+            for (vector<RamWrite>::const_iterator itr=writes.begin(); itr != writes.end(); ++itr) {
+                if (fail_after == 0) throw Exception ( USB_COMM, "Failed to transfer bytes to usb device memory.", "emulated" );
+                if (fail_after > 0) --fail_after;
+                uint32 addr = itr->value | ((uint32)itr->index << 16);
+                if (addr == 0xe600 && itr->length == 1) {
+                    cpu_reset = itr->data[0] & 1;
+                } else if (!cpu_reset) {
+                    wrote_running = true;
+                }
+                for (uint32 i=0;i<itr->length;++i) ram[addr+i] = itr->data[i];
+                RamWrite w = *itr;
+                w.data = NULL;
+                log.push_back ( w );
+            }
+        }
+
+        int read_ram ( uint16 value, uint16 index, uint8* data, uint16 length, uint32 timeout ) {
+            uint32 addr = value | ((uint32)index << 16);
+            for (uint32 i=0;i<length;++i) data[i] = ram.count(addr+i) ? ram[addr+i] : 0xff;
+            return length;
+        }
+};
+
+// one intel hex data record
+static string ihx_line ( uint16 addr, const vector<uint8>& data ) {
+    char buf[16];
+    uint8 sum = data.size() + (addr>>8) + (addr&0xff);
+    string line = ":";
+    snprintf ( buf, sizeof(buf), "%02X%04X00", (unsigned)data.size(), addr );
+    line += buf;
+    for (size_t i=0;i<data.size();++i) {
+        snprintf ( buf, sizeof(buf), "%02X", data[i] );
+        line += buf;
+        sum += data[i];
+    }
+    snprintf ( buf, sizeof(buf), "%02X\n", (uint8)-sum );
+    return line + buf;
+}
+
+static void put32 ( string& s, uint32 v ) {
+    s.append ( (const char*)&v, 4 );
+}
+
+class FirmwareTest : public CppUnit::TestFixture {
+
+    CPPUNIT_TEST_SUITE ( FirmwareTest );
+    CPPUNIT_TEST ( testCoalesce );
+    CPPUNIT_TEST ( testLoadIhx );
+    CPPUNIT_TEST ( testLoadFx3 );
+    CPPUNIT_TEST ( testStamp );
+    CPPUNIT_TEST ( testErrors );
+    CPPUNIT_TEST_SUITE_END();
+
+    public:
+
+        void testCoalesce() {
+            string hex;
+            hex += ihx_line ( 0x0000, { 'a', 'b', 'c', 'd' } );
+            hex += ihx_line ( 0x0100, { 'z' } );
+            hex += ihx_line ( 0x0004, { 'e', 'f' } ); // adjacent
+            hex += ihx_line ( 0x0002, { 'X', 'Y' } ); // overlaps, wins
+            hex += ":00000001FF\n"; // end of file
+            IhxFile ihx = parse_ihx ( hex.data(), hex.size() );
+            CPPUNIT_ASSERT_EQUAL ( (size_t)4, ihx.size() );
+
+            IhxFile blocks = coalesce_ihx ( ihx );
+            CPPUNIT_ASSERT_EQUAL ( (size_t)2, blocks.size() );
+            CPPUNIT_ASSERT_EQUAL ( (uint16)0, blocks[0].addr );
+            CPPUNIT_ASSERT ( blocks[0].bytes == basic_string<uint8>( (const uint8*)"abXYef" ) );
+            CPPUNIT_ASSERT_EQUAL ( (uint16)0x100, blocks[1].addr );
+            CPPUNIT_ASSERT ( blocks[1].bytes == basic_string<uint8>( (const uint8*)"z" ) );
+        }
+
+        void testLoadIhx() {
+            // 4k of 16 byte records written out of order like a linker
+            // map, plus a patch record over the middle.
+            vector<uint16> addrs;
+            for (uint16 a=0; a<4096; a+=16) addrs.push_back ( a );
+            reverse ( addrs.begin()+64, addrs.begin()+192 );
+            string hex;
+            map<uint32,uint8> expect;
+            for (size_t i=0;i<addrs.size();++i) {
+                vector<uint8> data;
+                for (int j=0;j<16;++j) data.push_back ( (uint8)(addrs[i]*3+j) );
+                hex += ihx_line ( addrs[i], data );
+            }
+            hex += ihx_line ( 2040, vector<uint8> ( 20, 0xee ) );
+            IhxFile ihx = parse_ihx ( hex.data(), hex.size() );
+            for (IhxFile::iterator itr=ihx.begin(); itr != ihx.end(); ++itr)
+                for (size_t j=0;j<itr->bytes.size();++j) expect[itr->addr+j] = itr->bytes[j];
+
+            EmulatedTransport t;
+            load_ihx ( t, hex.data(), hex.size() );
+
+            // reset, one batch of 4 full transfers and the stamp, run
+            CPPUNIT_ASSERT_EQUAL ( (uint32)3, t.batches );
+            CPPUNIT_ASSERT_EQUAL ( (size_t)7, t.log.size() );
+            for (size_t i=1;i<5;++i) CPPUNIT_ASSERT_EQUAL ( (uint16)1024, t.log[i].length );
+            CPPUNIT_ASSERT_EQUAL ( (uint16)FW_STAMP_ADDR, t.log[5].value );
+            CPPUNIT_ASSERT ( !t.wrote_running );
+            CPPUNIT_ASSERT ( !t.cpu_reset );
+
+            t.ram.erase ( 0xe600 );
+            for (uint32 i=0;i<FW_STAMP_LEN;++i) t.ram.erase ( FW_STAMP_ADDR+i );
+            CPPUNIT_ASSERT ( expect == t.ram );
+        }
+
+        void testLoadFx3() {
+            string img = "CY";
+            img += (char)0x1c; // bImageCTL
+            img += (char)0xb0; // bImageType
+            map<uint32,uint8> expect;
+            uint32 sections[][2] = { { 0x40000000, 1250 }, { 0x10000, 3 } }; // address, words
+            for (int s=0;s<2;++s) {
+                put32 ( img, sections[s][1] );
+                put32 ( img, sections[s][0] );
+                for (uint32 i=0;i<sections[s][1]*4;++i) {
+                    img += (char)(i*7+s);
+                    expect[sections[s][0]+i] = (uint8)(i*7+s);
+                }
+            }
+            put32 ( img, 0 );
+            put32 ( img, 0x40000010 ); // entry
+
+            EmulatedTransport t;
+            load_fx3 ( t, img.data(), img.size() );
+            CPPUNIT_ASSERT_EQUAL ( (uint32)2, t.batches );
+            // 5000 bytes in two transfers, 12 in one, the entry point
+            CPPUNIT_ASSERT_EQUAL ( (size_t)4, t.log.size() );
+            CPPUNIT_ASSERT_EQUAL ( (uint16)4096, t.log[0].length );
+            CPPUNIT_ASSERT_EQUAL ( (uint16)0x4000, t.log[0].index );
+            CPPUNIT_ASSERT_EQUAL ( (uint16)904, t.log[1].length );
+            CPPUNIT_ASSERT_EQUAL ( (uint16)0x1000, t.log[1].value );
+            CPPUNIT_ASSERT_EQUAL ( (uint16)0, t.log[3].length );
+            CPPUNIT_ASSERT_EQUAL ( (uint16)0x0010, t.log[3].value );
+            CPPUNIT_ASSERT_EQUAL ( (uint16)0x4000, t.log[3].index );
+            CPPUNIT_ASSERT ( expect == t.ram );
+        }
+
+        void testStamp() {
+            string hex = ihx_line ( 0x0000, { 1, 2, 3, 4 } ) + ihx_line ( 0x0200, { 5, 6 } );
+            string reordered = ihx_line ( 0x0200, { 5, 6 } ) + ihx_line ( 0x0000, { 1, 2, 3, 4 } );
+            string other = ihx_line ( 0x0000, { 1, 2, 3, 4 } ) + ihx_line ( 0x0200, { 5, 7 } );
+
+            uint8 a[FW_STAMP_LEN], b[FW_STAMP_LEN];
+            CPPUNIT_ASSERT ( ihx_stamp ( hex.data(), hex.size(), a ) );
+            CPPUNIT_ASSERT ( !memcmp ( a, FW_STAMP_MAGIC, 4 ) );
+            CPPUNIT_ASSERT_EQUAL ( (uint8)6, a[12] );
+            CPPUNIT_ASSERT ( ihx_stamp ( reordered.data(), reordered.size(), b ) );
+            CPPUNIT_ASSERT ( !memcmp ( a, b, FW_STAMP_LEN ) );
+            CPPUNIT_ASSERT ( ihx_stamp ( other.data(), other.size(), b ) );
+            CPPUNIT_ASSERT ( memcmp ( a, b, FW_STAMP_LEN ) );
+
+            EmulatedTransport t;
+            CPPUNIT_ASSERT ( !ihx_loaded ( t, hex.data(), hex.size() ) ); // blank ram
+            load_ihx ( t, hex.data(), hex.size() );
+            CPPUNIT_ASSERT ( ihx_loaded ( t, hex.data(), hex.size() ) );
+            CPPUNIT_ASSERT ( ihx_loaded ( t, reordered.data(), reordered.size() ) );
+            CPPUNIT_ASSERT ( !ihx_loaded ( t, other.data(), other.size() ) );
+
+            // another loader replaced the image but left the stamp
+            t.ram[0x0201] = 7;
+            CPPUNIT_ASSERT ( !ihx_loaded ( t, hex.data(), hex.size() ) );
+
+            // firmware that uses the stamp bytes can't be stamped
+            string covers = ihx_line ( FW_STAMP_ADDR-2, { 9, 9, 9, 9 } );
+            CPPUNIT_ASSERT ( !ihx_stamp ( covers.data(), covers.size(), b ) );
+            EmulatedTransport t2;
+            load_ihx ( t2, covers.data(), covers.size() );
+            CPPUNIT_ASSERT_EQUAL ( (size_t)3, t2.log.size() );
+            CPPUNIT_ASSERT ( !ihx_loaded ( t2, covers.data(), covers.size() ) );
+        }
+
+        void testErrors() {
+            string hex = ihx_line ( 0, vector<uint8> ( 255, 1 ) );
+            hex += ihx_line ( 255, vector<uint8> ( 255, 2 ) );
+            EmulatedTransport t;
+            t.fail_after = 1; // the reset goes through
+            CPPUNIT_ASSERT_THROW ( load_ihx ( t, hex.data(), hex.size() ), Exception );
+            CPPUNIT_ASSERT ( t.cpu_reset );
+
+            // truncated fx3 section
+            string img = "CY";
+            img += (char)0x1c;
+            img += (char)0xb0;
+            put32 ( img, 100 );
+            put32 ( img, 0 );
+            img += "short";
+            EmulatedTransport t3;
+            try {
+                load_fx3 ( t3, img.data(), img.size() );
+                CPPUNIT_FAIL ( "Expected exception" );
+            } catch ( const Exception& e ) {
+                CPPUNIT_ASSERT_EQUAL ( (int)USB_FIRMWARE, e.code() );
+            }
+            CPPUNIT_ASSERT_EQUAL ( (uint32)0, t3.batches );
+        }
+
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION ( FirmwareTest );
@@ -1,6 +1,10 @@
 
 #include <cppunit/extensions/HelperMacros.h>
 
+#include <sstream>
+#include <thread>
+#include <vector>
+
 #include <nitro.h>
 
 using namespace Nitro;
@@ -18,6 +22,10 @@ class NodeTest : public CppUnit::TestFixture {
     CPPUNIT_TEST ( testNameChange );
     CPPUNIT_TEST ( testClone );
     CPPUNIT_TEST ( testValidName );
+    CPPUNIT_TEST ( testAttrKeys );
+    CPPUNIT_TEST ( testAddrIndex );
+    CPPUNIT_TEST ( testCloneShared );
+    CPPUNIT_TEST ( testArena );
 
 
     CPPUNIT_TEST_SUITE_END();
@@ -258,6 +266,183 @@ class NodeTest : public CppUnit::TestFixture {
 
         }
 
+        void testAttrKeys() {
+            CPPUNIT_ASSERT ( AttrKey("addr") == Attr::addr );
+            CPPUNIT_ASSERT ( AttrKey(std::string("width")) == Attr::width );
+            CPPUNIT_ASSERT ( AttrKey("addr") != Attr::width );
+            CPPUNIT_ASSERT_EQUAL ( std::string("regDataWidth"), Attr::regDataWidth.str() );
+
+            NodeRef n = Node::create("attrs");
+            n->set_attr ( "zeta", 1 );
+            n->set_attr ( "addr", 5 );
+            n->set_attr ( "mode", "write" );
+            n->set_attr ( "alpha", 2 );
+            CPPUNIT_ASSERT_EQUAL ( (uint32)5, n->get_attr_uint(Attr::addr) );
+            CPPUNIT_ASSERT ( n->get_attr_ref(Attr::mode) == "write" );
+            CPPUNIT_ASSERT ( n->get_attr_ref(AttrKey("zeta")) == 1 );
+            CPPUNIT_ASSERT_THROW ( n->get_attr_ref(Attr::width), Exception );
+            CPPUNIT_ASSERT_THROW ( n->get_attr_uint(AttrKey("missing")), Exception );
+
+            n->set_attr ( "addr", 6 );
+            CPPUNIT_ASSERT_EQUAL ( (uint32)6, n->get_attr_uint(Attr::addr) );
+            CPPUNIT_ASSERT_EQUAL ( (uint32)4, n->num_attrs() );
+
+            // iteration is in name order
+            const char* names[] = { "addr", "alpha", "mode", "zeta" };
+            int i=0;
+            for (DIAttrIter itr = n->attrs_begin(); itr != n->attrs_end(); ++itr, ++i ) {
+                CPPUNIT_ASSERT_EQUAL ( std::string(names[i]), itr->first );
+            }
+
+            n->del_attr ( "alpha" );
+            n->del_attr ( "alpha" );
+            CPPUNIT_ASSERT ( !n->has_attr("alpha") );
+            CPPUNIT_ASSERT ( n->get_attr_ref(AttrKey("zeta")) == 1 );
+            CPPUNIT_ASSERT_EQUAL ( (uint32)6, n->get_attr_uint(Attr::addr) );
+            CPPUNIT_ASSERT_EQUAL ( (uint32)3, n->num_attrs() );
+        }
+
+        void testAddrIndex() {
+            NodeRef di = DeviceInterface::create("di");
+            for (int i=0;i<3;++i) {
+                NodeRef t = Terminal::create("auto" + std::to_string(i));
+                di->add_child ( t );
+            }
+            NodeRef fixed = Terminal::create("fixed");
+            fixed->set_attr("addr", 0x203);
+            di->add_child ( fixed );
+            CPPUNIT_ASSERT_EQUAL ( std::string("auto1"), di->get_child_by_addr(0x201)->get_name() );
+            CPPUNIT_ASSERT_EQUAL ( std::string("fixed"), di->get_child_by_addr(0x203)->get_name() );
+            CPPUNIT_ASSERT_EQUAL ( (uint32)0x204, di->free_child_addr(0x200) );
+            CPPUNIT_ASSERT_THROW ( di->get_child_by_addr(0x300), Exception );
+
+            // duplicate explicit address
+            NodeRef dup = Terminal::create("dup");
+            dup->set_attr("addr", 0x201);
+            CPPUNIT_ASSERT_THROW ( di->add_child(dup), Exception );
+
+            // a removed address is reused
+            di->del_child ( "auto1" );
+            CPPUNIT_ASSERT ( !di->has_child_addr(0x201) );
+            CPPUNIT_ASSERT_EQUAL ( (uint32)3, di->num_children() );
+            CPPUNIT_ASSERT_EQUAL ( std::string("auto2"), di->get_child("auto2")->get_name() );
+            NodeRef t = Terminal::create("again");
+            di->add_child ( t );
+            CPPUNIT_ASSERT_EQUAL ( (uint32)0x201, t->get_attr_uint(Attr::addr) );
+            CPPUNIT_ASSERT_EQUAL ( std::string("again"), di->child_begin()[3]->get_name() );
+
+            // changing or removing a child's address updates the index
+            t->set_attr ( "addr", 0x10 );
+            CPPUNIT_ASSERT ( !di->has_child_addr(0x201) );
+            CPPUNIT_ASSERT ( t == di->get_child_by_addr(0x10) );
+            t->set_name ( "renamed" );
+            CPPUNIT_ASSERT ( t == di->get_child_by_addr(0x10) );
+            t->del_attr ( "addr" );
+            CPPUNIT_ASSERT ( !di->has_child_addr(0x10) );
+
+            // first child added wins for shared addresses
+            NodeRef term = Terminal::create("term");
+            NodeRef r1 = Register::create("r1");
+            r1->set_attr("addr", 4);
+            NodeRef r2 = Register::create("r2");
+            r2->set_attr("addr", 4);
+            term->add_child(r1);
+            term->add_child(r2);
+            CPPUNIT_ASSERT ( r1 == term->get_child_by_addr(4) );
+            term->del_child("r1");
+            CPPUNIT_ASSERT ( r2 == term->get_child_by_addr(4) );
+
+            // children outlive their parent
+            di.reset();
+            CPPUNIT_ASSERT_NO_THROW ( fixed->set_attr("addr", 1) );
+            NodeRef di2 = DeviceInterface::create("di2");
+            CPPUNIT_ASSERT_NO_THROW ( di2->add_child(fixed) );
+        }
+
+        void testCloneShared() {
+            NodeRef di = DeviceInterface::create("di");
+            NodeRef term = Terminal::create("term");
+            di->add_child(term);
+            NodeRef reg = Register::create("reg");
+            term->add_child(reg);
+
+            NodeRef copy = di->clone();
+            NodeRef creg = copy->get_child("term")->get_child("reg");
+            // unchanged attributes are shared
+            CPPUNIT_ASSERT ( &reg->get_attr_ref(Attr::width) == &creg->get_attr_ref(Attr::width) );
+            CPPUNIT_ASSERT ( creg != reg );
+            CPPUNIT_ASSERT ( copy->get_child_by_addr(0x200) == copy->get_child("term") );
+
+            // writes to either side are private
+            creg->set_attr ( "width", 8 );
+            CPPUNIT_ASSERT_EQUAL ( (uint32)16, reg->get_attr_uint(Attr::width) );
+            CPPUNIT_ASSERT_EQUAL ( (uint32)8, creg->get_attr_uint(Attr::width) );
+            CPPUNIT_ASSERT ( &reg->get_attr_ref(Attr::mode) != &creg->get_attr_ref(Attr::mode) );
+            reg->del_attr ( "comment" );
+            CPPUNIT_ASSERT ( creg->has_attr("comment") );
+            term->set_attr ( "endian", "big" );
+            CPPUNIT_ASSERT ( copy->get_child("term")->get_attr("endian") == "little" );
+
+            // attributes the clone is created with are kept
+            NodeRef t2 = Terminal::create("t2");
+            t2->del_attr ( "regAddrWidth" );
+            CPPUNIT_ASSERT ( t2->clone()->has_attr("regAddrWidth") );
+
+            // clones used from their own threads
+            std::vector<NodeRef> clones;
+            for (int i=0;i<4;++i) clones.push_back ( reg->clone() );
+            std::vector<std::thread> threads;
+            for (int i=0;i<4;++i) {
+                NodeRef c = clones[i];
+                threads.push_back ( std::thread ( [c,i]() {
+                    c->get_attr("mode").str_value();
+                    c->set_attr ( "width", i+1 );
+                }));
+            }
+            for (int i=0;i<4;++i) threads[i].join();
+            for (int i=0;i<4;++i) CPPUNIT_ASSERT_EQUAL ( (uint32)i+1, clones[i]->get_attr_uint(Attr::width) );
+            CPPUNIT_ASSERT_EQUAL ( (uint32)16, reg->get_attr_uint(Attr::width) );
+        }
+
+        void testArena() {
+            NodeRef di = DeviceInterface::create("di");
+            NodeRef term;
+            {
+                NodeArena arena ( 4096 );
+                {
+                    NodeArena::Scope scope ( arena );
+                    for (int t=0;t<10;++t) {
+                        std::ostringstream name;
+                        name << "term" << t;
+                        NodeRef tn = Terminal::create ( name.str() );
+                        for (int r=0;r<20;++r) {
+                            std::ostringstream rname;
+                            rname << "reg" << r;
+                            tn->add_child ( Register::create ( rname.str() ) );
+                        }
+                        di->add_child ( tn );
+                    }
+                    // a failed constructor gives its memory back
+                    CPPUNIT_ASSERT_THROW ( DeviceInterface::create ( "bad name" ), Exception );
+                }
+                CPPUNIT_ASSERT ( arena.bytes_allocated() > 4096 );
+                // not allocated in the arena after the scope ends
+                size_t used = arena.bytes_allocated();
+                for (int i=0;i<100;++i) Node::create ( "heap" );
+                CPPUNIT_ASSERT_EQUAL ( used, arena.bytes_allocated() );
+            }
+            // nodes outlive the arena object
+            term = di->get_child ( "term3" );
+            CPPUNIT_ASSERT_EQUAL ( 19u, term->get_child ( "reg19" )->get_attr_uint ( Attr::addr ) );
+            CPPUNIT_ASSERT ( term->get_child_by_addr ( 5 )->get_name() == "reg5" );
+            term->set_attr ( "comment", "changed" );
+            NodeRef copy = di->clone();
+            di->del_child ( "term3" );
+            di = NodeRef();
+            CPPUNIT_ASSERT ( term->get_attr("comment") == "changed" );
+            CPPUNIT_ASSERT ( copy->get_child("term3")->get_attr("comment") == "changed" );
+        }
+
 };
 
 
@@ -0,0 +1,92 @@
+
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include <nitro.h>
+
+#include "memorydevice.h"
+
+using namespace Nitro;
+using namespace std;
+
+class RecorderTest : public CppUnit::TestFixture {
+
+    CPPUNIT_TEST_SUITE ( RecorderTest );
+    CPPUNIT_TEST ( testRecord );
+    CPPUNIT_TEST ( testCompress );
+    CPPUNIT_TEST ( testStop );
+    CPPUNIT_TEST_SUITE_END();
+
+    MemoryDevice dev;
+
+    string slurp ( const char* path ) {
+        ifstream in ( path, ios::binary );
+        return string ( (istreambuf_iterator<char>(in)), istreambuf_iterator<char>() );
+    }
+
+    public:
+        void setUp() {
+            for (int i=0;i<4096;++i)
+                dev.set ( 0, i, (i*7) & 0xff );
+        }
+        void tearDown() {
+            remove ( "rec_raw.bin" );
+            remove ( "rec_lz.bin" );
+            remove ( "rec_out.bin" );
+        }
+
+        void testRecord() {
+            Recorder rec ( dev, 0, 0, "rec_raw.bin" );
+            rec.set_buffer_size ( 8192 );
+            // last read is a partial buffer
+            Recorder::Stats s = rec.record ( 8192*10+100 );
+            CPPUNIT_ASSERT_EQUAL ( (uint64)(8192*10+100), s.bytes_read );
+            CPPUNIT_ASSERT_EQUAL ( s.bytes_read, s.bytes_written );
+            CPPUNIT_ASSERT_EQUAL ( (uint64)0, s.bytes_dropped );
+            CPPUNIT_ASSERT ( s.high_water <= 3 );
+
+            string data = slurp ( "rec_raw.bin" );
+            CPPUNIT_ASSERT_EQUAL ( (size_t)s.bytes_read, data.size() );
+            // every chunk re-reads registers 0..
+            uint8 expect[8192];
+            dev.read ( 0, 0, expect, sizeof(expect) );
+            CPPUNIT_ASSERT ( !memcmp ( data.data()+8192*3, expect, sizeof(expect) ) );
+        }
+
+        void testCompress() {
+            Recorder raw ( dev, 0, 0, "rec_raw.bin" );
+            raw.set_buffer_size ( 8192 );
+            raw.record ( 8192*4+10 );
+
+            Recorder rec ( dev, 0, 0, "rec_lz.bin" );
+            rec.set_buffer_size ( 8192 );
+            rec.set_compression ( true );
+            Recorder::Stats s = rec.record ( 8192*4+10 );
+            CPPUNIT_ASSERT ( s.bytes_written < s.bytes_read );
+
+            Recorder::decompress ( "rec_lz.bin", "rec_out.bin" );
+            CPPUNIT_ASSERT ( slurp ( "rec_raw.bin" ) == slurp ( "rec_out.bin" ) );
+
+            CPPUNIT_ASSERT_THROW ( Recorder::decompress ( "rec_raw.bin", "rec_out.bin" ), Exception );
+        }
+
+        void testStop() {
+            Recorder rec ( dev, 0, 0, "rec_raw.bin" );
+            rec.set_buffer_size ( 1024 );
+            rec.set_progress ( [&rec](const Recorder::Stats& s) {
+                if (s.bytes_read >= 1024*5) rec.stop();
+            }, 0 );
+            // 0 bytes records until stopped
+            Recorder::Stats s = rec.record ( 0 );
+            CPPUNIT_ASSERT_EQUAL ( (uint64)1024*5, s.bytes_read );
+            CPPUNIT_ASSERT_EQUAL ( (size_t)1024*5, slurp ( "rec_raw.bin" ).size() );
+        }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION ( RecorderTest );
@@ -0,0 +1,127 @@
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <nitro.h>
+#include <nitro/regs.h>
+
+#include "memorydevice.h"
+#include "dev_regs.h" // nitro.printCppDefs of dev.xml, see the Makefile
+
+using namespace Nitro;
+using namespace std;
+
+using namespace devxml;
+
+static BigInt big ( uint64 v ) {
+    BigInt b ( (uint32)(v >> 32) );
+    b <<= 32;
+    b |= BigInt ( (uint32)v );
+    return b;
+}
+
+// counts transfers
+class TransferCountingDevice : public MemoryDevice {
+    public:
+        uint32 reads, writes;
+        TransferCountingDevice() : reads(0), writes(0) {}
+    protected:
+        void _read ( uint32 term_addr, uint32 reg_addr, uint8* data, size_t length, uint32 timeout ) {
+            ++reads;
+            MemoryDevice::_read ( term_addr, reg_addr, data, length, timeout );
+        }
+        void _write ( uint32 term_addr, uint32 reg_addr, const uint8* data, size_t length, uint32 timeout ) {
+            ++writes;
+            MemoryDevice::_write ( term_addr, reg_addr, data, length, timeout );
+        }
+};
+
+class RegsTest : public CppUnit::TestFixture {
+
+    CPPUNIT_TEST_SUITE ( RegsTest );
+    CPPUNIT_TEST ( testDescriptors );
+    CPPUNIT_TEST ( testRegister );
+    CPPUNIT_TEST ( testSubregister );
+    CPPUNIT_TEST ( testWide );
+    CPPUNIT_TEST ( testTransfers );
+    CPPUNIT_TEST_SUITE_END();
+
+    TransferCountingDevice dev;
+
+    public:
+        void setUp() {
+            XmlReader reader ("dev.xml");
+            reader.read(dev.get_di());
+        }
+
+        void testDescriptors() {
+            CPPUNIT_ASSERT_EQUAL ( (uint32)4, Terminal1::reg1::words );
+            CPPUNIT_ASSERT_EQUAL ( (uint32)1, Terminal1::terminal::word_bytes );
+            CPPUNIT_ASSERT_EQUAL ( (uint32)0x3ffff, Terminal1::reg1::mask );
+            CPPUNIT_ASSERT_EQUAL ( (uint32)3, int_term::wide_reg::big_sub1::words );
+            CPPUNIT_ASSERT_EQUAL ( (uint32)3, int_term::wide_reg::big_sub3::words );
+            CPPUNIT_ASSERT_EQUAL ( (uint64)0x1ffffffffULL, int_term::wide_reg::big_sub3::mask );
+            CPPUNIT_ASSERT_EQUAL ( (uint32)2, int_term::many_subregs::eleven::words );
+        }
+
+        void testRegister() {
+            set<Terminal1::reg1> ( dev, Terminal1::reg1::values::evens );
+            CPPUNIT_ASSERT_EQUAL ( (uint32)174762, (uint32)dev.get ( "Terminal1", "reg1" ) );
+            dev.set ( "Terminal1", "reg1", "odds" );
+            CPPUNIT_ASSERT_EQUAL ( (uint32)Terminal1::reg1::values::odds, get<Terminal1::reg1> ( dev ) );
+
+            dev.set ( "int_term", "int", 0x12345678 );
+            CPPUNIT_ASSERT_EQUAL ( (uint32)0x12345678, get<int_term::int_> ( dev ) );
+            CPPUNIT_ASSERT_EQUAL ( (uint32)0x5678, get<int_term::int_::lw> ( dev ) );
+            CPPUNIT_ASSERT_EQUAL ( (uint32)0x1234, get<int_term::int_::hw> ( dev ) );
+        }
+
+        void testSubregister() {
+            dev.set ( "Terminal1", "reg2", 0 );
+            set<Terminal1::reg2::sub2> ( dev, Terminal1::reg2::sub2::values::_7 );
+            set<Terminal1::reg2::sub1> ( dev, 5 );
+            CPPUNIT_ASSERT_EQUAL ( (uint32)5, (uint32)dev.get ( "Terminal1", "reg2.sub1" ) );
+            CPPUNIT_ASSERT_EQUAL ( (uint32)7, (uint32)dev.get ( "Terminal1", "reg2.sub2" ) );
+            CPPUNIT_ASSERT_EQUAL ( (uint32)((7<<3)|5), get<Terminal1::reg2> ( dev ) );
+
+            // values are cut to the subregister width
+            set<Terminal1::reg2::sub1> ( dev, 0xa );
+            CPPUNIT_ASSERT_EQUAL ( (uint32)2, get<Terminal1::reg2::sub1> ( dev ) );
+            CPPUNIT_ASSERT_EQUAL ( (uint32)7, get<Terminal1::reg2::sub2> ( dev ) );
+        }
+
+        void testWide() {
+            dev.set ( "int_term", "wide_reg.big_sub1", big ( 0x1234567890ULL ) );
+            dev.set ( "int_term", "wide_reg.big_sub3", big ( 0x155555555ULL ) );
+            set<int_term::wide_reg::big_sub2> ( dev, 9 );
+            CPPUNIT_ASSERT_EQUAL ( (uint32)9, (uint32)dev.get ( "int_term", "wide_reg.big_sub2" ) );
+            CPPUNIT_ASSERT_EQUAL ( (uint64)0x1234567890ULL, get<int_term::wide_reg::big_sub1> ( dev ) );
+            CPPUNIT_ASSERT_EQUAL ( (uint64)0x155555555ULL, get<int_term::wide_reg::big_sub3> ( dev ) );
+
+            set<int_term::wide_reg::big_sub3> ( dev, 0x1aaaaaaaaULL );
+            CPPUNIT_ASSERT ( big ( 0x1aaaaaaaaULL ) == DataType::as_bigint ( dev.get ( "int_term", "wide_reg.big_sub3" ) ) );
+            CPPUNIT_ASSERT_EQUAL ( (uint32)9, get<int_term::wide_reg::big_sub2> ( dev ) );
+
+            set<int_term::many_subregs::eleven> ( dev, 0xabc );
+            CPPUNIT_ASSERT_EQUAL ( (uint32)0xabc, (uint32)dev.get ( "int_term", "many_subregs.eleven" ) );
+        }
+
+        void testTransfers() {
+            // whole words are written without a read
+            dev.reads = dev.writes = 0;
+            set<int_term::int_> ( dev, 0xdeadbeef );
+            CPPUNIT_ASSERT_EQUAL ( (uint32)0, dev.reads );
+            CPPUNIT_ASSERT_EQUAL ( (uint32)2, dev.writes );
+            CPPUNIT_ASSERT_EQUAL ( (uint32)0xbeef, get<int_term::int_::lw> ( dev ) );
+            CPPUNIT_ASSERT_EQUAL ( (uint32)1, dev.reads );
+
+            // a subregister reads then writes the words it covers
+            dev.reads = dev.writes = 0;
+            set<int_term::many_subregs::eleven> ( dev, 1 );
+            CPPUNIT_ASSERT_EQUAL ( (uint32)2, dev.reads );
+            CPPUNIT_ASSERT_EQUAL ( (uint32)2, dev.writes );
+            // one call each, the read-modify-write under one lock
+            CPPUNIT_ASSERT_EQUAL ( (uint64)3, dev.io_stats ( Device::IO_REGISTER ).count );
+        }
+
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION ( RegsTest );
@@ -2,6 +2,8 @@
 #include <cppunit/extensions/HelperMacros.h>
 
 #include <iostream>
+#include <thread>
+#include <vector>
 
 #include <nitro.h>
 #include "memorydevice.h"
@@ -14,6 +16,7 @@ class ScriptTest : public CppUnit::TestFixture {
     
     CPPUNIT_TEST_SUITE ( ScriptTest );
     CPPUNIT_TEST ( testScript );
+    CPPUNIT_TEST ( testWorkers );
     CPPUNIT_TEST_SUITE_END();
 
     public:
@@ -123,6 +126,63 @@ class ScriptTest : public CppUnit::TestFixture {
             }
 
         }
+
+        void testWorkers() {
+
+            try {
+                Scripts sc(4);
+                CPPUNIT_ASSERT_EQUAL ( (uint32)4, sc.num_workers() );
+                CPPUNIT_ASSERT_NO_THROW( sc.import ( "s", "script_test.py" ) );
+                CPPUNIT_ASSERT_EQUAL ( 9, (int) sc.func_list("s").size() );
+                NodeRef args = sc.get_params ( "s", "MyFunction" );
+                CPPUNIT_ASSERT ( args->has_attr ( "val" ) );
+
+                // exec from several threads at once
+                vector<int> results(16,-1);
+                vector<thread> threads;
+                for (int i=0;i<(int)results.size();++i) {
+                    threads.push_back ( thread ( [&sc,&results,i]() {
+                        try {
+                            NodeRef args = Node::create("args");
+                            args->set_attr ( "val", i );
+                            results[i] = (int) sc.exec ( "s", "MyFunction", args );
+                        } catch ( const Exception& ) {}
+                    } ) );
+                }
+                for (size_t i=0;i<threads.size();++i) threads[i].join();
+                for (int i=0;i<(int)results.size();++i) CPPUNIT_ASSERT_EQUAL ( i*3, results[i] );
+
+                // devices are wrapped in the worker's interpreter
+                MemoryDevice dev;
+                dev.set ( 0, 5, 0x1234 );
+                args = Node::create("args");
+                args->set_attr ( "dev", dev );
+                args->set_attr ( "term", 0 );
+                args->set_attr ( "reg", 5 );
+                CPPUNIT_ASSERT_EQUAL ( 0x1234, (int) sc.exec ("s", "DevFunction", args ) );
+
+                // script exceptions reach the caller
+                try {
+                    sc.exec ( "s" , "broken_func", Node::create("no args") );
+                    CPPUNIT_FAIL ( "Func didn't throw" );
+                } catch ( Exception &e ) {
+                    CPPUNIT_ASSERT_EQUAL ( 5, e.code() );
+                }
+                CPPUNIT_ASSERT_THROW ( sc.exec ( "s", "non-existent func", args ), Exception );
+
+                // callbacks run in the worker's interpreter
+                dev.set_error_step(0);
+                dev.set_error_mode(1);
+                dev.enable_mode(Device::RETRY_ON_FAILURE);
+                args = Node::create("args");
+                args->set_attr ( "dev", dev );
+                CPPUNIT_ASSERT_NO_THROW ( sc.exec ( "s", "callback", args ) );
+
+            } catch ( Exception &e ) {
+                cout << "Script Exception: " << e << endl;
+                CPPUNIT_FAIL ( "Script Exception." );
+            }
+        }
 };
 
 
@@ -2,6 +2,8 @@
 
 #include <cppunit/extensions/HelperMacros.h>
 
+#include <thread>
+
 #include <nitro.h>
 
 using namespace Nitro;
@@ -17,6 +19,9 @@ class TypeTest : public CppUnit::TestFixture {
     CPPUNIT_TEST ( testNode );
     CPPUNIT_TEST ( testList );
     CPPUNIT_TEST ( testBigInt );
+    CPPUNIT_TEST ( testStrValue );
+    CPPUNIT_TEST ( testSharedStr );
+    CPPUNIT_TEST ( testMove );
     CPPUNIT_TEST_SUITE_END();
 
     public:
@@ -110,6 +115,113 @@ class TypeTest : public CppUnit::TestFixture {
             std::vector<DataType> ints2 = DataType::as_bigints ( bi2 );
 
             CPPUNIT_ASSERT_EQUAL ( ints, ints2 );
+
+            BigInt v = DataType::as_bigint ( bi );
+            CPPUNIT_ASSERT_EQUAL ( 2u, v.num_words() );
+            CPPUNIT_ASSERT_EQUAL ( std::string("11150031900141442680"), v.str() );
+            CPPUNIT_ASSERT_EQUAL ( std::string("11150031900141442680"), bi.str_value() );
+            CPPUNIT_ASSERT ( v == BigInt::parse ( "11150031900141442680" ) );
+            CPPUNIT_ASSERT ( v == BigInt::parse ( "0x9abcdef012345678" ) );
+            CPPUNIT_ASSERT ( DataType ( v ) == bi );
+
+            // shifts across words
+            BigInt s = v << 100;
+            CPPUNIT_ASSERT_EQUAL ( 6u, s.num_words() );
+            CPPUNIT_ASSERT ( (s >> 100) == v );
+            CPPUNIT_ASSERT ( !(v << BigInt::BITS).any() );
+            CPPUNIT_ASSERT ( (v & BigInt::mask(36)) == BigInt::parse ( "0x012345678" ) );
+            CPPUNIT_ASSERT ( (BigInt(1) << 1023 | BigInt(1)).str() == 
+                             "89884656743115795386465259539451236680898848947115328636715040578866337902750481566354238661203768010560056939935696678829394884407208311246423715319737062188883946712432742638151109800623047059726541476042502884419075341171231440736956555270413618581675255342293149119973622969239858152417678164812112068609" );
+            CPPUNIT_ASSERT_EQUAL ( std::string("0"), BigInt().str() );
+            CPPUNIT_ASSERT_THROW ( BigInt::parse ( "12a" ), Exception );
+            CPPUNIT_ASSERT_THROW ( BigInt::parse ( "0x1" + std::string(256,'0') ), Exception );
+
+            // values that fit are stored as 32 bit integers
+            CPPUNIT_ASSERT_EQUAL ( INT_DATA, DataType ( BigInt(5) ).get_type() );
+            CPPUNIT_ASSERT_EQUAL ( UINT_DATA, DataType ( BigInt(0x80000000) ).get_type() );
+            CPPUNIT_ASSERT_EQUAL ( 0xffffffffu, DataType::as_bigint ( -1 ).word(0) );
+            CPPUNIT_ASSERT_THROW ( DataType::as_bigint ( "5" ), Exception );
+        }
+
+        void testStrValue() {
+            CPPUNIT_ASSERT_EQUAL ( std::string("-5"), DataType(-5).str_value() );
+            CPPUNIT_ASSERT_EQUAL ( std::string("4294967295"), (std::string)DataType((uint32)0xffffffff) );
+            CPPUNIT_ASSERT_EQUAL ( std::string("1.5"), DataType(1.5).str_value() );
+
+            // copies and assignments made before and after the value is formatted
+            DataType t ( 17 );
+            DataType before ( t );
+            CPPUNIT_ASSERT_EQUAL ( std::string("17"), t.str_value() );
+            DataType after ( t );
+            CPPUNIT_ASSERT_EQUAL ( std::string("17"), before.str_value() );
+            CPPUNIT_ASSERT_EQUAL ( std::string("17"), after.str_value() );
+            after = 18;
+            CPPUNIT_ASSERT_EQUAL ( std::string("18"), after.str_value() );
+            after = "str";
+            CPPUNIT_ASSERT_EQUAL ( std::string("str"), after.str_value() );
+
+            std::vector<DataType> list;
+            list.push_back ( 1 );
+            list.push_back ( "two" );
+            CPPUNIT_ASSERT_EQUAL ( std::string("1, two"), DataType(list).str_value() );
+
+            uint8 buf[4];
+            CPPUNIT_ASSERT_EQUAL ( std::string("4"), DataType::as_datatype ( buf, 4 ).str_value() );
+        }
+
+        void testSharedStr() {
+            // threads formatting and copying the same values all see
+            // the one string that was published
+            std::vector<DataType> values;
+            for (int i=0;i<64;++i) values.push_back ( DataType ( i*1000 ) );
+            std::vector<const std::string*> seen[4];
+            std::vector<std::thread> threads;
+            for (int t=0;t<4;++t) {
+                threads.push_back ( std::thread ( [&values,&seen,t]() {
+                    for (size_t i=0;i<values.size();++i) {
+                        DataType copy ( values[i] );
+                        seen[t].push_back ( &values[i].str_value() );
+                        if (copy.str_value() != *seen[t].back()) seen[t].back() = NULL;
+                    }
+                }));
+            }
+            for (int t=0;t<4;++t) threads[t].join();
+            for (size_t i=0;i<values.size();++i) {
+                CPPUNIT_ASSERT ( seen[0][i] );
+                CPPUNIT_ASSERT_EQUAL ( std::to_string ( i*1000 ), *seen[0][i] );
+                for (int t=1;t<4;++t) CPPUNIT_ASSERT ( seen[0][i] == seen[t][i] );
+            }
+        }
+
+        void testMove() {
+            std::vector<DataType> list;
+            for (int i=0;i<5;++i) list.push_back ( i );
+            DataType l ( list );
+            // copies share the list
+            DataType l2 ( l );
+            CPPUNIT_ASSERT ( &DataType::as_list(l) == &DataType::as_list(l2) );
+            CPPUNIT_ASSERT_THROW ( DataType::as_list ( DataType(1) ), Exception );
+
+            DataType moved ( std::move(l) );
+            CPPUNIT_ASSERT_EQUAL ( LIST_DATA, moved.get_type() );
+            CPPUNIT_ASSERT_EQUAL ( INT_DATA, l.get_type() );
+            CPPUNIT_ASSERT_EQUAL ( 0, (int32)l );
+            CPPUNIT_ASSERT ( moved == l2 );
+
+            DataType s ( "string" );
+            l = std::move(s);
+            CPPUNIT_ASSERT ( l == "string" );
+            CPPUNIT_ASSERT_EQUAL ( INT_DATA, s.get_type() );
+            l = std::move(l);
+            CPPUNIT_ASSERT ( l == "string" );
+
+            // assigning a value from inside the list being replaced
+            moved = DataType::as_list(moved).at(3);
+            CPPUNIT_ASSERT_EQUAL ( 3, (int32)moved );
+            l2 = DataType ( std::move(list) );
+            CPPUNIT_ASSERT_EQUAL ( (size_t)5, DataType::as_list(l2).size() );
+
+            CPPUNIT_ASSERT ( std::is_nothrow_move_constructible<DataType>::value );
         }
             
 
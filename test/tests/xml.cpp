@@ -1,5 +1,9 @@
 
 #include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <thread>
+#include <vector>
 
 #include <cppunit/extensions/HelperMacros.h>
 
@@ -8,12 +12,20 @@
 using namespace Nitro;
 using namespace std;
 
+// the same cases run against each reader
+template <class R>
 class XmlTest : public CppUnit::TestFixture {
     
     CPPUNIT_TEST_SUITE ( XmlTest );
     CPPUNIT_TEST ( testXml );
     CPPUNIT_TEST ( testTwice );
     CPPUNIT_TEST ( testPaths );
+    CPPUNIT_TEST ( testBinary );
+    CPPUNIT_TEST ( testSerialize );
+    CPPUNIT_TEST ( testIncludeCache );
+    CPPUNIT_TEST ( testArenaCache );
+    CPPUNIT_TEST ( testSameTree );
+    CPPUNIT_TEST ( testMalformed );
     CPPUNIT_TEST_SUITE_END();
 
     public:
@@ -22,14 +34,34 @@ class XmlTest : public CppUnit::TestFixture {
         void tearDown() {
         }
 
+        // deep compare including node valued attributes
+        void assertSameTree ( const NodeRef& a, const NodeRef& b ) {
+            CPPUNIT_ASSERT_EQUAL ( a->get_name(), b->get_name() );
+            CPPUNIT_ASSERT_EQUAL ( a->get_type(), b->get_type() );
+            CPPUNIT_ASSERT_EQUAL ( a->num_attrs(), b->num_attrs() );
+            for (DIAttrIter itr = a->attrs_begin(); itr != a->attrs_end(); ++itr ) {
+                DataType other = b->get_attr ( itr->first );
+                CPPUNIT_ASSERT_EQUAL ( itr->second.get_type(), other.get_type() );
+                if (itr->second.get_type() == NODE_DATA) {
+                    assertSameTree ( itr->second, other );
+                } else {
+                    CPPUNIT_ASSERT_EQUAL ( itr->second.str_value(), other.str_value() );
+                }
+            }
+            CPPUNIT_ASSERT_EQUAL ( a->num_children(), b->num_children() );
+            for (DITreeIter ai = a->child_begin(), bi = b->child_begin(); ai != a->child_end(); ++ai, ++bi ) {
+                assertSameTree ( *ai, *bi );
+            }
+        }
+
         void testXml () {
             
             const char* xml_path="test.xml";
-            XmlReader dummy ( "some_nonexistent_file_path" ) ;
+            R dummy ( "some_nonexistent_file_path" ) ;
             NodeRef tmp = DeviceInterface::create("hi");
             CPPUNIT_ASSERT_THROW(dummy.read(tmp), Exception);
                         
-            XmlReader reader (xml_path, true);
+            R reader (xml_path, true);
             NodeRef tree = DeviceInterface::create("root");
             CPPUNIT_ASSERT_NO_THROW(reader.read(tree));
             CPPUNIT_ASSERT_NO_THROW(tree->get_attr("name"));
@@ -123,7 +155,7 @@ class XmlTest : public CppUnit::TestFixture {
 
         void testTwice() {
             const char* xml_path="test.xml";
-            XmlReader reader ( xml_path, true );
+            R reader ( xml_path, true );
             NodeRef tree = DeviceInterface::create("di");
             try {
                 reader.read(tree);
@@ -135,7 +167,7 @@ class XmlTest : public CppUnit::TestFixture {
 
         void testPaths() {
             const char* xml_path = "xmldir/test.xml";
-            XmlReader reader ( xml_path, true );
+            R reader ( xml_path, true );
             NodeRef di = DeviceInterface::create("di");
             CPPUNIT_ASSERT_NO_THROW( reader.read(di) );
 
@@ -143,7 +175,215 @@ class XmlTest : public CppUnit::TestFixture {
 
         }
 
+        void testBinary() {
+            R reader ( "test.xml" );
+            NodeRef xml = DeviceInterface::create("di");
+            reader.read(xml);
+            CPPUNIT_ASSERT ( reader.includes().size() > 0 );
+
+            // copy the xml so the dependency can be changed
+            {
+                ifstream in ( "test.xml" );
+                ofstream out ( "bintest.xml" );
+                out << in.rdbuf();
+            }
+            vector<string> deps ( 1, "bintest.xml" );
+            BinWriter writer ( "bintest.dicache", deps );
+            CPPUNIT_ASSERT_NO_THROW ( writer.write ( xml ) );
+
+            BinReader bin ( "bintest.dicache" );
+            NodeRef cached = DeviceInterface::create("di");
+            CPPUNIT_ASSERT_NO_THROW ( bin.read ( cached ) );
+            assertSameTree ( xml, cached );
+
+            {
+                ofstream out ( "bintest.xml", ios::app );
+                out << "<!-- changed -->" << endl;
+            }
+            NodeRef stale = DeviceInterface::create("di");
+            try {
+                bin.read ( stale );
+                CPPUNIT_FAIL ( "Stale cache loaded" );
+            } catch ( const Exception &e ) {
+                CPPUNIT_ASSERT_EQUAL ( (int32)BIN_STALE, e.code() );
+            }
+            CPPUNIT_ASSERT ( !stale->has_children() );
+
+            BinReader nocheck ( "bintest.dicache", false );
+            CPPUNIT_ASSERT_NO_THROW ( nocheck.read ( stale ) );
+
+            BinReader notbin ( "test.xml" );
+            CPPUNIT_ASSERT_THROW ( notbin.read ( stale ), Exception );
+
+            // concurrent writers never leave a partial cache to read
+            bool partial = false;
+            vector<thread> writers;
+            for (int t=0;t<4;++t) {
+                writers.push_back ( thread ( [&]() {
+                    BinWriter w ( "bintest.dicache", deps );
+                    for (int i=0;i<20;++i) w.write ( xml );
+                }));
+            }
+            for (int i=0;i<50;++i) {
+                NodeRef n = DeviceInterface::create("di");
+                try {
+                    BinReader ( "bintest.dicache", false ).read ( n );
+                } catch ( const Exception& ) {
+                    partial = true;
+                }
+            }
+            for (size_t t=0;t<writers.size();++t) writers[t].join();
+            CPPUNIT_ASSERT ( !partial );
+
+            remove ( "bintest.xml" );
+            remove ( "bintest.dicache" );
+        }
+
+        void testSerialize() {
+            R reader ( "test.xml" );
+            NodeRef xml = DeviceInterface::create("di");
+            reader.read(xml);
+
+            string data = BinWriter::serialize ( xml );
+            NodeRef copy = BinReader::deserialize ( data.data(), data.size() );
+            assertSameTree ( xml, copy );
+
+            // any subtree
+            NodeRef term = *xml->child_begin();
+            data = BinWriter::serialize ( term );
+            NodeRef term_copy = BinReader::deserialize ( data.data(), data.size() );
+            CPPUNIT_ASSERT_EQUAL ( (int)Node::TERMINAL, (int)term_copy->get_type() );
+            assertSameTree ( term, term_copy );
+
+            // serialized nodes load across library versions, not formats
+            string other = data;
+            other[8] ^= 1; // library version
+            assertSameTree ( term, BinReader::deserialize ( other.data(), other.size() ) );
+            {
+                ofstream out ( "bintest.dicache", ios::binary );
+                out << other;
+            }
+            NodeRef cached = DeviceInterface::create("di");
+            try {
+                BinReader ( "bintest.dicache" ).read ( cached );
+                CPPUNIT_FAIL ( "Cache from another library version loaded" );
+            } catch ( const Exception &e ) {
+                CPPUNIT_ASSERT_EQUAL ( (int32)BIN_STALE, e.code() );
+            }
+            remove ( "bintest.dicache" );
+            other = data;
+            other[4] ^= 1; // format version
+            try {
+                BinReader::deserialize ( other.data(), other.size() );
+                CPPUNIT_FAIL ( "Other format loaded" );
+            } catch ( const Exception &e ) {
+                CPPUNIT_ASSERT_EQUAL ( (int32)BIN_STALE, e.code() );
+            }
+
+            CPPUNIT_ASSERT_THROW ( BinReader::deserialize ( data.data(), data.size()-1 ), Exception );
+            CPPUNIT_ASSERT_THROW ( BinReader::deserialize ( data.data()+1, data.size()-1 ), Exception );
+            data += '\0';
+            CPPUNIT_ASSERT_THROW ( BinReader::deserialize ( data.data(), data.size() ), Exception );
+        }
+
+        void testIncludeCache() {
+            // test.xml includes testinclude.xml twice
+            R reader ( "test.xml" );
+            NodeRef di = DeviceInterface::create("di");
+            reader.read(di);
+            CPPUNIT_ASSERT_EQUAL ( (uint32)2, reader.stats().files_parsed );
+            CPPUNIT_ASSERT_EQUAL ( (uint32)1, reader.stats().cache_hits );
+            CPPUNIT_ASSERT_EQUAL ( (size_t)2, reader.includes().size() );
+
+            // overlays on one include must not change the other
+            NodeRef term = di->get_child ( "include_term" );
+            NodeRef term1 = di->get_child ( "include_term1" );
+            CPPUNIT_ASSERT_EQUAL ( (uint32)76, (uint32)term->get_attr("addr") );
+            CPPUNIT_ASSERT_EQUAL ( (uint32)77, (uint32)term1->get_attr("addr") );
+            CPPUNIT_ASSERT ( term->has_child ( "rename_me" ) );
+            CPPUNIT_ASSERT ( !term->has_child ( "new_register" ) );
+            CPPUNIT_ASSERT ( term1->has_child ( "reg_renamed" ) );
+            CPPUNIT_ASSERT ( term1->has_child ( "new_register" ) );
+
+            XmlReader::set_process_cache ( true );
+            R first ( "test.xml" );
+            NodeRef a = DeviceInterface::create("di");
+            first.read(a);
+            R second ( "test.xml" );
+            NodeRef b = DeviceInterface::create("di");
+            second.read(b);
+            XmlReader::set_process_cache ( false );
+
+            CPPUNIT_ASSERT_EQUAL ( (uint32)0, second.stats().files_parsed );
+            CPPUNIT_ASSERT_EQUAL ( (uint32)3, second.stats().cache_hits );
+            assertSameTree ( di, a );
+            assertSameTree ( di, b );
+        }
+
+        // cached documents aren't parsed into the reading di's arena,
+        // so a parse and a cache hit leave the same bytes in the arena
+        // and dropping the di releases it.
+        size_t arena_read ( NodeRef& di ) {
+            NodeArena arena ( 256 );
+            NodeArena::Scope scope ( arena );
+            R reader ( "test.xml" );
+            di = DeviceInterface::create("di");
+            reader.read(di);
+            return arena.bytes_allocated();
+        }
+
+        void testArenaCache() {
+            NodeRef plain;
+            size_t bytes = arena_read ( plain );
+            XmlReader::set_process_cache ( true );
+            NodeRef parsed, cached;
+            size_t parsed_bytes = arena_read ( parsed );
+            size_t cached_bytes = arena_read ( cached );
+            XmlReader::set_process_cache ( false );
+            CPPUNIT_ASSERT ( bytes > 0 );
+            CPPUNIT_ASSERT_EQUAL ( bytes, parsed_bytes );
+            CPPUNIT_ASSERT_EQUAL ( bytes, cached_bytes );
+            assertSameTree ( plain, parsed );
+            assertSameTree ( plain, cached );
+        }
+
+        void testSameTree() {
+            const char* paths[] = { "test.xml", "xmldir/test.xml" };
+            for (int i=0;i<2;++i) {
+                XmlReader xerces ( paths[i] );
+                NodeRef a = DeviceInterface::create("di");
+                xerces.read(a);
+                R reader ( paths[i] );
+                NodeRef b = DeviceInterface::create("di");
+                reader.read(b);
+                assertSameTree ( a, b );
+                CPPUNIT_ASSERT ( xerces.includes() == reader.includes() );
+            }
+        }
+
+        void testMalformed() {
+            const char* docs[] = {
+                "<deviceinterface><terminal name=\"t\"></deviceinterface>",
+                "<deviceinterface><terminal name=\"t\" regDataWidth=\"x\"/></deviceinterface>",
+                "<deviceinterface><terminal name=\"t\"><bogus/></terminal></deviceinterface>",
+                "<deviceinterface><terminal name=\"t\">"
+            };
+            for (int i=0;i<4;++i) {
+                {
+                    ofstream out ( "malformed.xml" );
+                    out << docs[i] << endl;
+                }
+                R reader ( "malformed.xml" );
+                NodeRef di = DeviceInterface::create("di");
+                CPPUNIT_ASSERT_THROW ( reader.read(di), Exception );
+            }
+            remove ( "malformed.xml" );
+        }
+
 
 };
 
-CPPUNIT_TEST_SUITE_REGISTRATION ( XmlTest );
+typedef XmlTest<XmlReader> XercesXmlTest;
+typedef XmlTest<StreamXmlReader> StreamXmlTest;
+CPPUNIT_TEST_SUITE_REGISTRATION ( XercesXmlTest );
+CPPUNIT_TEST_SUITE_REGISTRATION ( StreamXmlTest );